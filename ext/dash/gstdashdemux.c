@@ -170,6 +170,7 @@ enum
   PROP_MAX_BUFFERING_TIME,
   PROP_BANDWIDTH_USAGE,
   PROP_MAX_BITRATE,
+  PROP_ABR_POLICY,
   PROP_LAST
 };
 
@@ -177,9 +178,12 @@ enum
 #define DEFAULT_MAX_BUFFERING_TIME       30     /* in seconds */
 #define DEFAULT_BANDWIDTH_USAGE         0.8     /* 0 to 1     */
 #define DEFAULT_MAX_BITRATE        24000000     /* in bit/s  */
+#define DEFAULT_ABR_POLICY GST_ABR_POLICY_HYBRID
 
 #define DEFAULT_FAILED_COUNT 3
-#define DOWNLOAD_RATE_HISTORY_MAX 3
+/* Longest interval over which the download rate is averaged while
+ * downloads are running continuously */
+#define DOWNLOAD_RATE_WINDOW (GST_SECOND)
 
 /* Custom internal event to signal end of period */
 #define GST_EVENT_DASH_EOP GST_EVENT_MAKE_TYPE(81, GST_EVENT_TYPE_DOWNSTREAM | GST_EVENT_TYPE_SERIALIZED)
@@ -195,6 +199,7 @@ static void gst_dash_demux_set_property (GObject * object, guint prop_id,
 static void gst_dash_demux_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec);
 static void gst_dash_demux_dispose (GObject * obj);
+static void gst_dash_demux_finalize (GObject * obj);
 
 /* GstElement */
 static GstStateChangeReturn
@@ -210,14 +215,17 @@ static gboolean gst_dash_demux_src_event (GstPad * pad, GstObject * parent,
 static gboolean gst_dash_demux_src_query (GstPad * pad, GstObject * parent,
     GstQuery * query);
 static void gst_dash_demux_stream_loop (GstDashDemux * demux);
-static void gst_dash_demux_download_loop (GstDashDemux * demux);
+static void gst_dash_demux_stream_download_loop (GstDashDemuxStream * stream);
 static void gst_dash_demux_stop (GstDashDemux * demux);
 static void gst_dash_demux_resume_stream_task (GstDashDemux * demux);
 static void gst_dash_demux_resume_download_task (GstDashDemux * demux);
 static gboolean gst_dash_demux_setup_all_streams (GstDashDemux * demux);
-static gboolean gst_dash_demux_select_representations (GstDashDemux * demux);
-static gboolean gst_dash_demux_get_next_fragment (GstDashDemux * demux,
-    GstActiveStream ** stream, GstClockTime * next_ts);
+static gboolean gst_dash_demux_stream_select_representation (GstDashDemux *
+    demux, GstDashDemuxStream * stream);
+static GstFlowReturn gst_dash_demux_stream_download_fragment (GstDashDemux *
+    demux, GstDashDemuxStream * stream, GstClockTime * fragment_ts);
+static void gst_dash_demux_stream_end_of_period (GstDashDemux * demux,
+    GstDashDemuxStream * stream);
 static gboolean gst_dash_demux_advance_period (GstDashDemux * demux);
 static void gst_dash_demux_download_wait (GstDashDemux * demux,
     GstClockTime time_diff);
@@ -254,11 +262,6 @@ gst_dash_demux_dispose (GObject * obj)
     demux->stream_task = NULL;
   }
 
-  if (demux->download_task) {
-    gst_object_unref (demux->download_task);
-    g_rec_mutex_clear (&demux->download_task_lock);
-    demux->download_task = NULL;
-  }
   g_cond_clear (&demux->download_cond);
   g_mutex_clear (&demux->download_mutex);
 
@@ -272,6 +275,16 @@ gst_dash_demux_dispose (GObject * obj)
   G_OBJECT_CLASS (parent_class)->dispose (obj);
 }
 
+static void
+gst_dash_demux_finalize (GObject * obj)
+{
+  GstDashDemux *demux = GST_DASH_DEMUX (obj);
+
+  gst_abr_controller_clear (&demux->abr);
+
+  G_OBJECT_CLASS (parent_class)->finalize (obj);
+}
+
 static void
 gst_dash_demux_class_init (GstDashDemuxClass * klass)
 {
@@ -284,6 +297,7 @@ gst_dash_demux_class_init (GstDashDemuxClass * klass)
   gobject_class->set_property = gst_dash_demux_set_property;
   gobject_class->get_property = gst_dash_demux_get_property;
   gobject_class->dispose = gst_dash_demux_dispose;
+  gobject_class->finalize = gst_dash_demux_finalize;
 
   g_object_class_install_property (gobject_class, PROP_MAX_BUFFERING_TIME,
       g_param_spec_uint ("max-buffering-time", "Maximum buffering time",
@@ -304,6 +318,12 @@ gst_dash_demux_class_init (GstDashDemuxClass * klass)
           1000, G_MAXUINT, DEFAULT_MAX_BITRATE,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_ABR_POLICY,
+      g_param_spec_enum ("abr-policy", "ABR policy",
+          "Policy used to select the representations",
+          GST_TYPE_ABR_POLICY, DEFAULT_ABR_POLICY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state =
       GST_DEBUG_FUNCPTR (gst_dash_demux_change_state);
 
@@ -343,14 +363,15 @@ gst_dash_demux_init (GstDashDemux * demux)
   demux->bandwidth_usage = DEFAULT_BANDWIDTH_USAGE;
   demux->max_bitrate = DEFAULT_MAX_BITRATE;
 
-  /* Updates task */
-  g_rec_mutex_init (&demux->download_task_lock);
-  demux->download_task =
-      gst_task_new ((GstTaskFunction) gst_dash_demux_download_loop, demux,
-      NULL);
-  gst_task_set_lock (demux->download_task, &demux->download_task_lock);
+  /* Download tasks are created with the streams */
   g_cond_init (&demux->download_cond);
   g_mutex_init (&demux->download_mutex);
+  gst_abr_controller_init (&demux->abr);
+  gst_abr_controller_set_policy (&demux->abr, DEFAULT_ABR_POLICY);
+  gst_abr_controller_set_bandwidth_usage (&demux->abr, demux->bandwidth_usage);
+  gst_abr_controller_set_max_bitrate (&demux->abr, demux->max_bitrate);
+  gst_abr_controller_set_buffer_target (&demux->abr,
+      demux->max_buffering_time);
 
   /* Streaming task */
   g_rec_mutex_init (&demux->stream_task_lock);
@@ -370,12 +391,20 @@ gst_dash_demux_set_property (GObject * object, guint prop_id,
   switch (prop_id) {
     case PROP_MAX_BUFFERING_TIME:
       demux->max_buffering_time = g_value_get_uint (value) * GST_SECOND;
+      gst_abr_controller_set_buffer_target (&demux->abr,
+          demux->max_buffering_time);
       break;
     case PROP_BANDWIDTH_USAGE:
       demux->bandwidth_usage = g_value_get_float (value);
+      gst_abr_controller_set_bandwidth_usage (&demux->abr,
+          demux->bandwidth_usage);
       break;
     case PROP_MAX_BITRATE:
       demux->max_bitrate = g_value_get_uint (value);
+      gst_abr_controller_set_max_bitrate (&demux->abr, demux->max_bitrate);
+      break;
+    case PROP_ABR_POLICY:
+      gst_abr_controller_set_policy (&demux->abr, g_value_get_enum (value));
       break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -399,6 +428,9 @@ gst_dash_demux_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_MAX_BITRATE:
       g_value_set_uint (value, demux->max_bitrate);
       break;
+    case PROP_ABR_POLICY:
+      g_value_set_enum (value, gst_abr_controller_get_policy (&demux->abr));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -457,20 +489,27 @@ gst_dash_demux_stream_push_event (GstDashDemuxStream * stream, GstEvent * event)
   gst_data_queue_push_force (stream->queue, item);
 }
 
-static void
+static gboolean
 gst_dash_demux_stream_push_data (GstDashDemuxStream * stream,
     GstBuffer * fragment)
 {
   GstDataQueueItem *item = g_new (GstDataQueueItem, 1);
 
   item->object = GST_MINI_OBJECT_CAST (fragment);
-  item->duration = GST_BUFFER_DURATION (fragment);
+  /* only the first chunk of a fragment carries its duration */
+  item->duration = GST_BUFFER_DURATION_IS_VALID (fragment) ?
+      GST_BUFFER_DURATION (fragment) : 0;
   item->visible = TRUE;
   item->size = gst_buffer_get_size (fragment);
 
   item->destroy = (GDestroyNotify) _data_queue_item_destroy;
 
-  gst_data_queue_push (stream->queue, item);
+  if (!gst_data_queue_push (stream->queue, item)) {
+    item->destroy (item);
+    return FALSE;
+  }
+
+  return TRUE;
 }
 
 static gboolean
@@ -492,7 +531,6 @@ gst_dash_demux_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
       GstClockTime current_pos, target_pos;
       guint current_sequence, current_period;
       GstActiveStream *active_stream;
-      GstMediaSegment *chunk;
       GstStreamPeriod *period;
       GSList *iter;
       gboolean update;
@@ -579,30 +617,17 @@ gst_dash_demux_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
         /* Update the current sequence on all streams */
         for (iter = demux->streams; iter; iter = g_slist_next (iter)) {
           GstDashDemuxStream *stream = iter->data;
-          gint seg_i;
 
           active_stream =
               gst_mpdparser_get_active_stream_by_index (demux->client,
               stream->index);
-          current_pos = 0;
-          current_sequence = 0;
-          for (seg_i = 0; seg_i < active_stream->segments->len; seg_i++) {
-            chunk = g_ptr_array_index (active_stream->segments, seg_i);
-            current_pos = chunk->start_time;
-            /* current_sequence = chunk->number; */
-            GST_DEBUG_OBJECT (demux, "current_pos:%" GST_TIME_FORMAT
-                " <= target_pos:%" GST_TIME_FORMAT " duration:%"
-                GST_TIME_FORMAT, GST_TIME_ARGS (current_pos),
-                GST_TIME_ARGS (target_pos), GST_TIME_ARGS (chunk->duration));
-            if (current_pos <= target_pos
-                && target_pos < current_pos + chunk->duration) {
-              GST_DEBUG_OBJECT (demux,
-                  "selecting sequence %d for stream %" GST_PTR_FORMAT,
-                  current_sequence, stream);
-              break;
-            }
-            current_sequence++;
-          }
+          current_sequence =
+              gst_mpd_client_get_segment_index_at_position (demux->client,
+              active_stream, target_pos);
+          GST_DEBUG_OBJECT (demux,
+              "selecting sequence %u for stream %" GST_PTR_FORMAT
+              " at target_pos:%" GST_TIME_FORMAT, current_sequence, stream,
+              GST_TIME_ARGS (target_pos));
           gst_mpd_client_set_segment_index (active_stream, current_sequence);
         }
 
@@ -702,6 +727,7 @@ gst_dash_demux_setup_all_streams (GstDashDemux * demux)
   gst_active_streams_free (demux->client);
 
   if (!gst_dash_demux_setup_mpdparser_streams (demux, demux->client)) {
+    GST_MPD_CLIENT_UNLOCK (demux->client);
     return FALSE;
   }
 
@@ -723,13 +749,18 @@ gst_dash_demux_setup_all_streams (GstDashDemux * demux)
         gst_data_queue_new ((GstDataQueueCheckFullFunction) _check_queue_full,
         NULL, NULL, demux);
 
+    stream->demux = demux;
     stream->index = i;
     stream->input_caps = caps;
     stream->need_header = TRUE;
     stream->has_data_queued = FALSE;
-    gst_download_rate_init (&stream->dnl_rate);
-    gst_download_rate_set_max_length (&stream->dnl_rate,
-        DOWNLOAD_RATE_HISTORY_MAX);
+
+    stream->downloader = gst_uri_downloader_new ();
+    g_rec_mutex_init (&stream->download_task_lock);
+    stream->download_task =
+        gst_task_new ((GstTaskFunction) gst_dash_demux_stream_download_loop,
+        stream, NULL);
+    gst_task_set_lock (stream->download_task, &stream->download_task_lock);
 
     GST_LOG_OBJECT (demux, "Creating stream %d %" GST_PTR_FORMAT, i, caps);
     streams = g_slist_prepend (streams, stream);
@@ -762,7 +793,9 @@ gst_dash_demux_setup_all_streams (GstDashDemux * demux)
   }
   streams = g_slist_reverse (streams);
 
+  g_mutex_lock (&demux->streams_lock);
   demux->next_periods = g_slist_append (demux->next_periods, streams);
+  g_mutex_unlock (&demux->streams_lock);
   GST_MPD_CLIENT_UNLOCK (demux->client);
 
   return TRUE;
@@ -1027,27 +1060,44 @@ gst_dash_demux_stop (GstDashDemux * demux)
 {
   GSList *iter;
 
+  GSList *downloading = NULL;
+
   GST_DEBUG_OBJECT (demux, "Stopping demux");
 
   if (demux->downloader)
     gst_uri_downloader_cancel (demux->downloader);
 
+  g_mutex_lock (&demux->streams_lock);
+  if (demux->next_periods)
+    downloading = g_slist_last (demux->next_periods)->data;
+  g_mutex_unlock (&demux->streams_lock);
+
   for (iter = demux->streams; iter; iter = g_slist_next (iter)) {
     GstDashDemuxStream *stream = iter->data;
 
     gst_data_queue_set_flushing (stream->queue, TRUE);
   }
 
-  if (GST_TASK_STATE (demux->download_task) != GST_TASK_STOPPED) {
-    GST_TASK_SIGNAL (demux->download_task);
-    gst_task_stop (demux->download_task);
-    g_mutex_lock (&demux->download_mutex);
-    g_cond_signal (&demux->download_cond);
-    g_mutex_unlock (&demux->download_mutex);
-    g_rec_mutex_lock (&demux->download_task_lock);
-    g_rec_mutex_unlock (&demux->download_task_lock);
-    gst_task_join (demux->download_task);
+  /* The download tasks run on the streams of the last period, which might
+   * not be exposed yet */
+  for (iter = downloading; iter; iter = g_slist_next (iter)) {
+    GstDashDemuxStream *stream = iter->data;
+
+    gst_uri_downloader_cancel (stream->downloader);
+    gst_data_queue_set_flushing (stream->queue, TRUE);
+    gst_task_stop (stream->download_task);
+  }
+
+  g_mutex_lock (&demux->download_mutex);
+  g_cond_broadcast (&demux->download_cond);
+  g_mutex_unlock (&demux->download_mutex);
+
+  for (iter = downloading; iter; iter = g_slist_next (iter)) {
+    GstDashDemuxStream *stream = iter->data;
+
+    gst_task_join (stream->download_task);
   }
+
   if (GST_TASK_STATE (demux->stream_task) != GST_TASK_STOPPED) {
     GST_TASK_SIGNAL (demux->stream_task);
     gst_task_stop (demux->stream_task);
@@ -1271,10 +1321,12 @@ gst_dash_demux_stream_loop (GstDashDemux * demux)
         }
         demux->need_segment = FALSE;
       }
-      /* make timestamp start from 0 by subtracting the offset */
-      timestamp -= demux->timestamp_offset;
-
-      GST_BUFFER_TIMESTAMP (buffer) = timestamp;
+      /* make timestamp start from 0 by subtracting the offset. Only the
+       * first chunk of a fragment has a timestamp */
+      if (GST_CLOCK_TIME_IS_VALID (timestamp)) {
+        timestamp -= demux->timestamp_offset;
+        GST_BUFFER_TIMESTAMP (buffer) = timestamp;
+      }
 
       GST_DEBUG_OBJECT (demux,
           "Pushing fragment ts: %" GST_TIME_FORMAT " at pad %s",
@@ -1288,7 +1340,8 @@ gst_dash_demux_stream_loop (GstDashDemux * demux)
           GST_DEBUG_PAD_NAME (selected_stream->pad));
 #endif
       ret = gst_pad_push (selected_stream->pad, gst_buffer_ref (buffer));
-      demux->segment.position = timestamp;
+      if (GST_CLOCK_TIME_IS_VALID (timestamp))
+        demux->segment.position = timestamp;
 
       item->destroy (item);
       if ((ret != GST_FLOW_OK) && (active_stream
@@ -1354,7 +1407,19 @@ error_pushing:
 static void
 gst_dash_demux_stream_free (GstDashDemuxStream * stream)
 {
-  gst_download_rate_deinit (&stream->dnl_rate);
+  if (stream->download_task) {
+    gst_uri_downloader_cancel (stream->downloader);
+    gst_data_queue_set_flushing (stream->queue, TRUE);
+    gst_task_stop (stream->download_task);
+    gst_task_join (stream->download_task);
+    gst_object_unref (stream->download_task);
+    g_rec_mutex_clear (&stream->download_task_lock);
+    stream->download_task = NULL;
+  }
+  if (stream->downloader) {
+    g_object_unref (stream->downloader);
+    stream->downloader = NULL;
+  }
   if (stream->input_caps) {
     gst_caps_unref (stream->input_caps);
     stream->input_caps = NULL;
@@ -1378,7 +1443,6 @@ gst_dash_demux_reset (GstDashDemux * demux, gboolean dispose)
 
   GST_DEBUG_OBJECT (demux, "Resetting demux");
 
-  demux->end_of_period = FALSE;
   demux->end_of_manifest = FALSE;
 
   demux->cancelled = TRUE;
@@ -1425,6 +1489,9 @@ gst_dash_demux_reset (GstDashDemux * demux, gboolean dispose)
 
   gst_segment_init (&demux->segment, GST_FORMAT_TIME);
   demux->last_manifest_update = GST_CLOCK_TIME_NONE;
+  demux->updating_manifest = FALSE;
+  gst_abr_controller_reset (&demux->abr);
+  demux->n_downloading = 0;
   demux->cancelled = FALSE;
 }
 
@@ -1473,6 +1540,8 @@ gst_dash_demux_all_streams_have_data (GstDashDemux * demux)
   return TRUE;
 }
 
+/* Called with the download_mutex held, which is released while the
+ * manifest is downloaded so the other streams keep downloading */
 static GstFlowReturn
 gst_dash_demux_refresh_mpd (GstDashDemux * demux)
 {
@@ -1480,6 +1549,7 @@ gst_dash_demux_refresh_mpd (GstDashDemux * demux)
   GstBuffer *buffer;
   GstClockTime duration, now = gst_util_get_timestamp ();
   gint64 update_period = demux->client->mpd_node->minimumUpdatePeriod;
+  gchar *mpd_uri;
 
   if (update_period == -1) {
     GST_DEBUG_OBJECT (demux, "minimumUpdatePeriod unspecified, "
@@ -1496,98 +1566,44 @@ gst_dash_demux_refresh_mpd (GstDashDemux * demux)
       GST_TIME_ARGS ((demux->last_manifest_update +
               update_period * GST_MSECOND)), GST_TIME_ARGS (now));
 
-  /* update the manifest file */
-  if (now >= demux->last_manifest_update + update_period * GST_MSECOND) {
-    GST_DEBUG_OBJECT (demux, "Updating manifest file from URL %s",
-        demux->client->mpd_uri);
-    download = gst_uri_downloader_fetch_uri (demux->downloader,
-        demux->client->mpd_uri);
-    if (download) {
-      GstMpdClient *new_client = NULL;
+  /* update the manifest file, unless another stream already does */
+  if (now >= demux->last_manifest_update + update_period * GST_MSECOND
+      && !demux->updating_manifest) {
+    mpd_uri = g_strdup (demux->client->mpd_uri);
+    GST_DEBUG_OBJECT (demux, "Updating manifest file from URL %s", mpd_uri);
+
+    demux->updating_manifest = TRUE;
+    g_mutex_unlock (&demux->download_mutex);
+    download = gst_uri_downloader_fetch_uri (demux->downloader, mpd_uri);
+    g_mutex_lock (&demux->download_mutex);
+    demux->updating_manifest = FALSE;
 
+    if (demux->cancelled) {
+      if (download)
+        g_object_unref (download);
+    } else if (download) {
       buffer = gst_fragment_get_buffer (download);
       g_object_unref (download);
       /* parse the manifest file */
       if (buffer != NULL) {
         GstMapInfo mapinfo;
-
-        new_client = gst_mpd_client_new ();
-        new_client->mpd_uri = g_strdup (demux->client->mpd_uri);
+        gboolean changed;
 
         gst_buffer_map (buffer, &mapinfo, GST_MAP_READ);
 
-        if (gst_mpd_parse (new_client, (gchar *) mapinfo.data, mapinfo.size)) {
-          const gchar *period_id;
-          guint period_idx;
-          GSList *iter;
-
-          /* prepare the new manifest and try to transfer the stream position
-           * status from the old manifest client  */
-
+        /* the streams are kept, only moved to the nodes of the new
+         * manifest with their current position */
+        if (gst_mpd_client_update (demux->client, (gchar *) mapinfo.data,
+                mapinfo.size, &changed)) {
           gst_buffer_unmap (buffer, &mapinfo);
           gst_buffer_unref (buffer);
 
-          GST_DEBUG_OBJECT (demux, "Updating manifest");
-
-          period_id = gst_mpd_client_get_period_id (demux->client);
-          period_idx = gst_mpd_client_get_period_index (demux->client);
-
-          /* setup video, audio and subtitle streams, starting from current Period */
-          if (!gst_mpd_client_setup_media_presentation (new_client)) {
-            /* TODO */
-          }
-
-          if (period_idx) {
-            if (!gst_mpd_client_set_period_id (new_client, period_id)) {
-              GST_DEBUG_OBJECT (demux,
-                  "Error setting up the updated manifest file");
-              return GST_FLOW_EOS;
-            }
-          } else {
-            if (!gst_mpd_client_set_period_index (new_client, period_idx)) {
-              GST_DEBUG_OBJECT (demux,
-                  "Error setting up the updated manifest file");
-              return GST_FLOW_EOS;
-            }
-          }
-
-          if (!gst_dash_demux_setup_mpdparser_streams (demux, new_client)) {
-            GST_ERROR_OBJECT (demux, "Failed to setup streams on manifest "
-                "update");
-            return GST_FLOW_ERROR;
-          }
-
-          /* update the streams to play from the next segment */
-          for (iter = demux->streams; iter; iter = g_slist_next (iter)) {
-            GstDashDemuxStream *demux_stream = iter->data;
-            GstActiveStream *new_stream;
-            GstClockTime ts;
-
-            new_stream =
-                gst_mpdparser_get_active_stream_by_index (new_client,
-                demux_stream->index);
-
-            if (!new_stream) {
-              GST_DEBUG_OBJECT (demux,
-                  "Stream of index %d is missing from manifest update",
-                  demux_stream->index);
-              return GST_FLOW_EOS;
-            }
-
-            if (gst_mpd_client_get_next_fragment_timestamp (demux->client,
-                    demux_stream->index, &ts)) {
-              gst_mpd_client_stream_seek (new_client, new_stream, ts);
-            } else
-                if (gst_mpd_client_get_last_fragment_timestamp (demux->client,
-                    demux_stream->index, &ts)) {
-              /* try to set to the old timestamp + 1 */
-              gst_mpd_client_stream_seek (new_client, new_stream, ts + 1);
-            }
+          demux->last_manifest_update = gst_util_get_timestamp ();
+          if (!changed) {
+            GST_DEBUG_OBJECT (demux, "Manifest file did not change");
+            return GST_FLOW_OK;
           }
 
-          gst_mpd_client_free (demux->client);
-          demux->client = new_client;
-
           /* Send an updated duration message */
           duration =
               gst_mpd_client_get_media_presentation_duration (demux->client);
@@ -1602,13 +1618,13 @@ gst_dash_demux_refresh_mpd (GstDashDemux * demux)
             GST_DEBUG_OBJECT (demux,
                 "mediaPresentationDuration unknown, can not send the duration message");
           }
-          demux->last_manifest_update = gst_util_get_timestamp ();
           GST_DEBUG_OBJECT (demux, "Manifest file successfully updated");
         } else {
           /* In most cases, this will happen if we set a wrong url in the
            * source element and we have received the 404 HTML response instead of
-           * the manifest */
-          GST_WARNING_OBJECT (demux, "Error parsing the manifest.");
+           * the manifest, or if the streams can not be found anymore in the
+           * updated manifest */
+          GST_WARNING_OBJECT (demux, "Error updating the manifest.");
           gst_buffer_unmap (buffer, &mapinfo);
           gst_buffer_unref (buffer);
         }
@@ -1619,48 +1635,59 @@ gst_dash_demux_refresh_mpd (GstDashDemux * demux)
     } else {
       /* download failed */
       GST_WARNING_OBJECT (demux,
-          "Failed to update the manifest file from URL %s",
-          demux->client->mpd_uri);
+          "Failed to update the manifest file from URL %s", mpd_uri);
     }
+    g_free (mpd_uri);
   }
   return GST_FLOW_OK;
 }
 
-/* gst_dash_demux_download_loop:
+/* gst_dash_demux_stream_download_loop:
+ * 
+ * Loop for the "download" task of a stream, fetching the fragments of the
+ * selected representation of that stream.
  * 
- * Loop for the "download' task that fetches fragments based on the 
- * selected representations.
+ * Every stream has its own task and downloader, so a slow fragment of one
+ * stream does not delay the fragments of the others. The tasks share the
+ * MPD client, which is protected by the download_mutex. It is held for
+ * everything but the actual downloads.
  * 
  * Startup: 
  * 
- * The task is started from the stream loop.
+ * The tasks are started once the manifest was parsed and the streams
+ * of the first period were created.
  * 
  * During playback:  
  * 
- * It sequentially fetches fragments corresponding to the current 
- * representations and pushes them into a queue.
+ * It sequentially fetches the fragments of its stream and pushes them
+ * into the queue of the stream as the data arrives. The queue blocks
+ * when it is full.
  * 
- * It tries to maintain the number of queued items within a predefined 
- * range: if the queue is full, it will pause, checking every 100 ms if 
- * it needs to restart downloading fragments.
- * 
- * When a new set of fragments has been downloaded, it evaluates the
- * download time to check if we can or should switch to a different 
- * set of representations.
+ * Before each fragment it checks against the download rate of all
+ * streams whether a different representation should be selected.
  *
  * Teardown:
  * 
- * The task will exit when it encounters an error or when the end of the
- * manifest has been reached.
+ * The task exits when it encounters an error, at the end of the manifest
+ * and when the stream reached the end of the period. The last stream to
+ * get there sets up the streams of the next period.
  * 
  */
-void
-gst_dash_demux_download_loop (GstDashDemux * demux)
+static void
+gst_dash_demux_stream_download_loop (GstDashDemuxStream * stream)
 {
+  GstDashDemux *demux = stream->demux;
   GstClockTime fragment_ts = GST_CLOCK_TIME_NONE;
-  GstActiveStream *fragment_stream = NULL;
+  GstActiveStream *fragment_stream;
+  GstFlowReturn ret;
+
+  GST_LOG_OBJECT (demux, "Starting download loop for stream %d",
+      stream->index);
+
+  g_mutex_lock (&demux->download_mutex);
 
-  GST_LOG_OBJECT (demux, "Starting download loop");
+  if (demux->cancelled)
+    goto cancelled;
 
   if (gst_mpd_client_is_live (demux->client)
       && demux->client->mpd_uri != NULL) {
@@ -1670,41 +1697,41 @@ gst_dash_demux_download_loop (GstDashDemux * demux)
       default:
         break;
     }
+
+    /* the lock was released during the manifest download */
+    if (demux->cancelled)
+      goto cancelled;
   }
 
   GST_DEBUG_OBJECT (demux, "download loop %i", demux->end_of_manifest);
 
-  /* try to switch to another set of representations if needed */
+  /* try to switch to another representation if needed */
   if (gst_dash_demux_all_streams_have_data (demux)) {
-    gst_dash_demux_select_representations (demux);
+    gst_dash_demux_stream_select_representation (demux, stream);
   }
 
   /* fetch the next fragment */
-  while (!gst_dash_demux_get_next_fragment (demux, &fragment_stream,
-          &fragment_ts)) {
-    if (demux->end_of_period) {
-      GST_INFO_OBJECT (demux, "Reached the end of the Period");
-      /* setup video, audio and subtitle streams, starting from the next Period */
-      if (!gst_mpd_client_set_period_index (demux->client,
-              gst_mpd_client_get_period_index (demux->client) + 1)
-          || !gst_dash_demux_setup_all_streams (demux)) {
-        GST_INFO_OBJECT (demux, "Reached the end of the manifest file");
-        demux->end_of_manifest = TRUE;
-        gst_task_start (demux->stream_task);
-        goto end_of_manifest;
-      }
-      /* start playing from the first segment of the new period */
-      gst_mpd_client_set_segment_index_for_all_streams (demux->client, 0);
-      demux->end_of_period = FALSE;
+  ret = gst_dash_demux_stream_download_fragment (demux, stream, &fragment_ts);
+  switch (ret) {
+    case GST_FLOW_OK:
+      break;
+    case GST_FLOW_EOS:
+      GST_INFO_OBJECT (demux, "Stream %d reached the end of the Period",
+          stream->index);
+      gst_dash_demux_stream_end_of_period (demux, stream);
+      goto end_of_period;
+    default:
+      if (demux->cancelled)
+        goto cancelled;
 
-    } else if (demux->cancelled) {
-      goto cancelled;
-    } else {
       /* Download failed 'by itself'
        * in case this is live, we might be ahead or before playback, where
        * segments don't exist (are still being created or were already deleted)
        * so we either wait or jump ahead */
-      if (gst_mpd_client_is_live (demux->client)) {
+      fragment_stream =
+          gst_mpdparser_get_active_stream_by_index (demux->client,
+          stream->index);
+      if (gst_mpd_client_is_live (demux->client) && fragment_stream) {
         gint64 time_diff;
         gint pos;
 
@@ -1748,7 +1775,6 @@ gst_dash_demux_download_loop (GstDashDemux * demux)
       } else {
         goto error_downloading;
       }
-    }
   }
 
   GST_INFO_OBJECT (demux, "Internal buffering : %" G_GUINT64_FORMAT " s",
@@ -1756,190 +1782,255 @@ gst_dash_demux_download_loop (GstDashDemux * demux)
   demux->client->update_failed_count = 0;
 
 quit:
+  g_mutex_unlock (&demux->download_mutex);
   GST_DEBUG_OBJECT (demux, "Finishing download loop");
   return;
 
 cancelled:
   {
+    g_mutex_unlock (&demux->download_mutex);
     GST_WARNING_OBJECT (demux, "Cancelled, leaving download task");
-    gst_task_stop (demux->download_task);
+    gst_task_stop (stream->download_task);
+    return;
+  }
+
+end_of_period:
+  {
+    g_mutex_unlock (&demux->download_mutex);
+    GST_INFO_OBJECT (demux, "End of period, leaving download task");
     return;
   }
 
 end_of_manifest:
   {
+    g_mutex_unlock (&demux->download_mutex);
     GST_INFO_OBJECT (demux, "End of manifest, leaving download task");
-    gst_task_stop (demux->download_task);
+    gst_task_stop (stream->download_task);
     return;
   }
 
 error_downloading:
   {
+    g_mutex_unlock (&demux->download_mutex);
     GST_ELEMENT_ERROR (demux, RESOURCE, NOT_FOUND,
         ("Could not fetch the next fragment, leaving download task"), (NULL));
-    gst_task_stop (demux->download_task);
+    gst_task_stop (stream->download_task);
     return;
   }
 }
 
+/* Called with the download_mutex held when @stream has no more fragments
+ * in the current period. */
+static void
+gst_dash_demux_stream_end_of_period (GstDashDemux * demux,
+    GstDashDemuxStream * stream)
+{
+  GSList *streams, *iter;
+  GstEvent *event;
+  gboolean last = TRUE;
+
+  if (gst_mpd_client_has_next_period (demux->client)) {
+    event = gst_event_new_dash_eop ();
+  } else {
+    GST_DEBUG_OBJECT (demux,
+        "No more fragments or periods for this stream, setting EOS");
+    event = gst_event_new_eos ();
+  }
+
+  /* The stream might be freed as soon as the event was pushed */
+  gst_task_stop (stream->download_task);
+  stream->download_end_of_period = TRUE;
+
+  g_mutex_lock (&demux->streams_lock);
+  streams = g_slist_last (demux->next_periods)->data;
+  g_mutex_unlock (&demux->streams_lock);
+
+  for (iter = streams; iter; iter = g_slist_next (iter)) {
+    GstDashDemuxStream *other = iter->data;
+
+    if (!other->download_end_of_period)
+      last = FALSE;
+  }
+
+  /* the last stream that finished the period sets up the next one */
+  if (last && !demux->cancelled) {
+    GST_INFO_OBJECT (demux, "Reached the end of the Period");
+    /* setup video, audio and subtitle streams, starting from the next Period */
+    if (!gst_mpd_client_set_period_index (demux->client,
+            gst_mpd_client_get_period_index (demux->client) + 1)
+        || !gst_dash_demux_setup_all_streams (demux)) {
+      GST_INFO_OBJECT (demux, "Reached the end of the manifest file");
+      demux->end_of_manifest = TRUE;
+      gst_task_start (demux->stream_task);
+    } else {
+      /* start playing from the first segment of the new period */
+      gst_mpd_client_set_segment_index_for_all_streams (demux->client, 0);
+      gst_dash_demux_resume_download_task (demux);
+    }
+  }
+
+  gst_dash_demux_stream_push_event (stream, event);
+}
+
 static void
 gst_dash_demux_resume_stream_task (GstDashDemux * demux)
 {
   gst_task_start (demux->stream_task);
 }
 
+/* Starts the download tasks of the streams of the last period */
 static void
 gst_dash_demux_resume_download_task (GstDashDemux * demux)
 {
-  gst_task_start (demux->download_task);
+  GSList *iter;
+
+  g_mutex_lock (&demux->streams_lock);
+  if (demux->next_periods == NULL) {
+    g_mutex_unlock (&demux->streams_lock);
+    return;
+  }
+
+  for (iter = g_slist_last (demux->next_periods)->data; iter;
+      iter = g_slist_next (iter)) {
+    GstDashDemuxStream *stream = iter->data;
+
+    if (stream->download_end_of_period)
+      continue;
+
+    gst_uri_downloader_reset (stream->downloader);
+    gst_data_queue_set_flushing (stream->queue, FALSE);
+    gst_task_start (stream->download_task);
+  }
+  g_mutex_unlock (&demux->streams_lock);
 }
 
-/* gst_dash_demux_select_representations:
+/* gst_dash_demux_stream_select_representation:
  *
- * Select the most appropriate media representations based on current target 
- * bitrate.
+ * Select the most appropriate media representation for @stream with the
+ * ABR controller, from the current download rate and the amount of data
+ * buffered for @stream.
  * 
- * FIXME: all representations are selected against the same bitrate, but
- * they will share the same bandwidth. This only works today because the
- * audio representations bitrate usage is negligible as compared to the
- * video representation one.
+ * All streams share the same bandwidth, so the bitrate of the
+ * representations that are currently selected for the other streams
+ * is not available for this one.
  * 
- * Returns TRUE if a new set of representations has been selected
+ * Returns TRUE if a new representation has been selected
  */
 static gboolean
-gst_dash_demux_select_representations (GstDashDemux * demux)
+gst_dash_demux_stream_select_representation (GstDashDemux * demux,
+    GstDashDemuxStream * stream)
 {
   GstActiveStream *active_stream = NULL;
-  GList *rep_list = NULL;
-  gint new_index;
+  GList *rep_list = NULL, *iter;
+  GstDataQueueSize level;
+  guint64 *bitrates = NULL;
+  gint *rep_indexes = NULL;
+  gint new_index, current = 0, selected;
   gboolean ret = FALSE;
-  GSList *iter;
-  GstDashDemuxStream *stream;
+  guint64 used = 0;
+  guint i, j, n_reps;
 
-  guint i = 0;
+  GST_MPD_CLIENT_LOCK (demux->client);
+  active_stream =
+      gst_mpdparser_get_active_stream_by_index (demux->client, stream->index);
+  if (!active_stream)
+    goto done;
 
+  /* retrieve representation list */
+  if (active_stream->cur_adapt_set)
+    rep_list = active_stream->cur_adapt_set->Representations;
+  if (!rep_list)
+    goto done;
 
-  GST_MPD_CLIENT_LOCK (demux->client);
-  for (iter = demux->streams; iter; iter = g_slist_next (iter)) {
-    guint64 bitrate;
-    stream = iter->data;
-    active_stream =
-        gst_mpdparser_get_active_stream_by_index (demux->client, stream->index);
-    if (!active_stream)
-      return FALSE;
+  for (i = 0; i < gst_mpdparser_get_nb_active_stream (demux->client); i++) {
+    GstActiveStream *other;
 
-    /* retrieve representation list */
-    if (active_stream->cur_adapt_set)
-      rep_list = active_stream->cur_adapt_set->Representations;
-    if (!rep_list)
-      return FALSE;
+    if (i == stream->index)
+      continue;
 
-    bitrate =
-        gst_download_rate_get_current_rate (&stream->dnl_rate) *
-        demux->bandwidth_usage;
-    GST_DEBUG_OBJECT (demux, "Trying to change to bitrate: %" G_GUINT64_FORMAT,
-        bitrate);
-
-    /* get representation index with current max_bandwidth */
-    new_index =
-        gst_mpdparser_get_rep_idx_with_max_bandwidth (rep_list, bitrate);
-
-    /* if no representation has the required bandwidth, take the lowest one */
-    if (new_index == -1)
-      new_index = gst_mpdparser_get_rep_idx_with_min_bandwidth (rep_list);
-
-    if (new_index != active_stream->representation_idx) {
-      GstRepresentationNode *rep = g_list_nth_data (rep_list, new_index);
-      GST_INFO_OBJECT (demux, "Changing representation idx: %d %d %u",
-          stream->index, new_index, rep->bandwidth);
-      if (gst_mpd_client_setup_representation (demux->client, active_stream,
-              rep)) {
-        ret = TRUE;
-        stream->need_header = TRUE;
-        stream->has_data_queued = FALSE;
-        GST_INFO_OBJECT (demux, "Switching bitrate to %d",
-            active_stream->cur_representation->bandwidth);
-        gst_caps_unref (stream->input_caps);
-        stream->input_caps =
-            gst_dash_demux_get_input_caps (demux, active_stream);
-        gst_dash_demux_stream_push_event (stream,
-            gst_event_new_caps (stream->input_caps));
-      } else {
-        GST_WARNING_OBJECT (demux,
-            "Can not switch representation, aborting...");
-      }
+    other = gst_mpdparser_get_active_stream_by_index (demux->client, i);
+    if (other && other->cur_representation)
+      used += other->cur_representation->bandwidth;
+  }
+
+  /* the controller wants the bitrates in ascending order */
+  n_reps = g_list_length (rep_list);
+  bitrates = g_new (guint64, n_reps);
+  rep_indexes = g_new (gint, n_reps);
+  for (iter = rep_list, i = 0; iter; iter = g_list_next (iter), i++) {
+    GstRepresentationNode *rep = iter->data;
+
+    for (j = i; j > 0 && bitrates[j - 1] > rep->bandwidth; j--) {
+      bitrates[j] = bitrates[j - 1];
+      rep_indexes[j] = rep_indexes[j - 1];
     }
-    i++;
+    bitrates[j] = rep->bandwidth;
+    rep_indexes[j] = i;
   }
+  for (i = 0; i < n_reps; i++) {
+    if (rep_indexes[i] == active_stream->representation_idx)
+      current = i;
+  }
+
+  gst_data_queue_get_level (stream->queue, &level);
+  selected = gst_abr_controller_select (&demux->abr, bitrates, n_reps,
+      current, used, level.time,
+      gst_mpd_client_get_next_fragment_duration (demux->client,
+          active_stream));
+  new_index = rep_indexes[selected];
+  GST_DEBUG_OBJECT (demux, "Selected bitrate %" G_GUINT64_FORMAT
+      " for stream %d", bitrates[selected], stream->index);
+
+  if (new_index != active_stream->representation_idx) {
+    GstRepresentationNode *rep = g_list_nth_data (rep_list, new_index);
+    GST_INFO_OBJECT (demux, "Changing representation idx: %d %d %u",
+        stream->index, new_index, rep->bandwidth);
+    if (gst_mpd_client_setup_representation (demux->client, active_stream,
+            rep)) {
+      ret = TRUE;
+      stream->need_header = TRUE;
+      stream->has_data_queued = FALSE;
+      GST_INFO_OBJECT (demux, "Switching bitrate to %d",
+          active_stream->cur_representation->bandwidth);
+      gst_caps_unref (stream->input_caps);
+      stream->input_caps = gst_dash_demux_get_input_caps (demux, active_stream);
+      gst_dash_demux_stream_push_event (stream,
+          gst_event_new_caps (stream->input_caps));
+    } else {
+      GST_WARNING_OBJECT (demux, "Can not switch representation, aborting...");
+    }
+  }
+
+done:
   GST_MPD_CLIENT_UNLOCK (demux->client);
+  g_free (bitrates);
+  g_free (rep_indexes);
+
+  if (ret) {
+    gst_element_post_message (GST_ELEMENT_CAST (demux),
+        gst_abr_controller_new_decision_message (&demux->abr,
+            GST_OBJECT_CAST (demux), GST_PAD_NAME (stream->pad)));
+  }
+
   return ret;
 }
 
-static GstBuffer *
-gst_dash_demux_download_header_fragment (GstDashDemux * demux, guint stream_idx,
-    gchar * path, gint64 range_start, gint64 range_end)
+static gchar *
+gst_dash_demux_get_header_uri (GstDashDemux * demux, guint stream_idx,
+    gchar * path)
 {
-  GstBuffer *buffer = NULL;
-  gchar *next_header_uri;
-  GstFragment *fragment;
+  gchar *header_uri;
 
   if (strncmp (path, "http://", 7) != 0) {
-    next_header_uri =
+    header_uri =
         g_strconcat (gst_mpdparser_get_baseURL (demux->client, stream_idx),
         path, NULL);
     g_free (path);
   } else {
-    next_header_uri = path;
-  }
-
-  fragment = gst_uri_downloader_fetch_uri_with_range (demux->downloader,
-      next_header_uri, range_start, range_end);
-  g_free (next_header_uri);
-  if (fragment) {
-    buffer = gst_fragment_get_buffer (fragment);
-    g_object_unref (fragment);
-  }
-  return buffer;
-}
-
-static GstBuffer *
-gst_dash_demux_get_next_header (GstDashDemux * demux, guint stream_idx)
-{
-  gchar *initializationURL;
-  GstBuffer *header_buffer, *index_buffer = NULL;
-  gint64 range_start, range_end;
-
-  if (!gst_mpd_client_get_next_header (demux->client, &initializationURL,
-          stream_idx, &range_start, &range_end))
-    return NULL;
-
-  GST_INFO_OBJECT (demux, "Fetching header %s %" G_GINT64_FORMAT "-%"
-      G_GINT64_FORMAT, initializationURL, range_start, range_end);
-  header_buffer = gst_dash_demux_download_header_fragment (demux, stream_idx,
-      initializationURL, range_start, range_end);
-
-  /* check if we have an index */
-  if (header_buffer
-      && gst_mpd_client_get_next_header_index (demux->client,
-          &initializationURL, stream_idx, &range_start, &range_end)) {
-    GST_INFO_OBJECT (demux,
-        "Fetching index %s %" G_GINT64_FORMAT "-%" G_GINT64_FORMAT,
-        initializationURL, range_start, range_end);
-    index_buffer =
-        gst_dash_demux_download_header_fragment (demux, stream_idx,
-        initializationURL, range_start, range_end);
-  }
-
-  if (header_buffer == NULL) {
-    GST_WARNING_OBJECT (demux, "Unable to fetch header");
-    return NULL;
-  }
-
-  if (index_buffer) {
-    header_buffer = gst_buffer_append (header_buffer, index_buffer);
+    header_uri = path;
   }
 
-  return header_buffer;
+  return header_uri;
 }
 
 static GstCaps *
@@ -2036,100 +2127,149 @@ gst_dash_demux_get_input_caps (GstDashDemux * demux, GstActiveStream * stream)
   }
 }
 
-/* gst_dash_demux_get_next_fragment:
+/* Called with the download_mutex held */
+static void
+gst_dash_demux_download_started (GstDashDemux * demux)
+{
+  if (demux->n_downloading++ == 0) {
+    demux->download_window_start = gst_util_get_timestamp ();
+    demux->download_window_bytes = 0;
+  }
+}
+
+/* Called with the download_mutex held. The rate is measured over all
+ * downloads while at least one of them is running, so concurrent
+ * downloads of several streams add up. */
+static void
+gst_dash_demux_download_progress (GstDashDemux * demux, guint64 bytes,
+    gboolean finished)
+{
+  GstClockTime now = gst_util_get_timestamp ();
+  GstClockTime elapsed;
+
+  demux->download_window_bytes += bytes;
+  if (finished)
+    demux->n_downloading--;
+
+  elapsed = now - demux->download_window_start;
+  if (demux->n_downloading == 0 || elapsed >= DOWNLOAD_RATE_WINDOW) {
+    if (elapsed > 0 && demux->download_window_bytes > 0) {
+      GST_LOG_OBJECT (demux, "Download rate = %" G_GUINT64_FORMAT " Kbits/s",
+          gst_util_uint64_scale (demux->download_window_bytes, 8 * GST_SECOND,
+              elapsed) / 1000);
+      gst_abr_controller_add_sample (&demux->abr,
+          demux->download_window_bytes, elapsed);
+    }
+    demux->download_window_start = now;
+    demux->download_window_bytes = 0;
+  }
+}
+
+/* Called from the streaming thread of the downloader of @stream for every
+ * chunk of data as it arrives */
+static GstFlowReturn
+gst_dash_demux_stream_chunk_received (GstUriDownloader * downloader,
+    GstBuffer * buffer, gpointer user_data)
+{
+  GstDashDemuxStream *stream = user_data;
+  GstDashDemux *demux = stream->demux;
+
+  g_mutex_lock (&demux->download_mutex);
+  gst_dash_demux_download_progress (demux, gst_buffer_get_size (buffer),
+      FALSE);
+  g_mutex_unlock (&demux->download_mutex);
+
+  buffer = gst_buffer_make_writable (buffer);
+  if (!stream->fragment_started) {
+    GST_BUFFER_TIMESTAMP (buffer) = stream->fragment_timestamp;
+    GST_BUFFER_DURATION (buffer) = stream->fragment_duration;
+    GST_BUFFER_OFFSET (buffer) = stream->fragment_offset;
+    if (stream->fragment_discont) {
+      GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_DISCONT);
+      stream->fragment_discont = FALSE;
+    }
+    stream->fragment_started = TRUE;
+  } else {
+    GST_BUFFER_TIMESTAMP (buffer) = GST_CLOCK_TIME_NONE;
+    GST_BUFFER_DURATION (buffer) = GST_CLOCK_TIME_NONE;
+  }
+
+  if (!gst_dash_demux_stream_push_data (stream, buffer))
+    return GST_FLOW_FLUSHING;
+
+  return GST_FLOW_OK;
+}
+
+/* gst_dash_demux_stream_download_fragment:
  *
- * Get the next fragments for the stream with the earlier timestamp.
- * It returns the selected timestamp so the caller can deal with
- * sync issues in case the stream is live.
+ * Get the next fragment for @stream, together with its header and index
+ * if needed. The data is pushed into the queue of the stream while it
+ * is downloaded. It returns the timestamp of the fragment so the caller
+ * can deal with sync issues in case the stream is live.
  * 
- * This function uses the generic URI downloader API.
+ * Called with the download_mutex held, which is released while
+ * downloading.
  *
- * Returns FALSE if an error occured while downloading fragments
+ * Returns GST_FLOW_EOS if the stream has no more fragments in this
+ * period, an error if the download failed
  * 
  */
-static gboolean
-gst_dash_demux_get_next_fragment (GstDashDemux * demux,
-    GstActiveStream ** stream, GstClockTime * selected_ts)
+static GstFlowReturn
+gst_dash_demux_stream_download_fragment (GstDashDemux * demux,
+    GstDashDemuxStream * stream, GstClockTime * fragment_ts)
 {
   GstActiveStream *active_stream;
   GstFragment *download;
-  GstBuffer *header_buffer;
-  GTimeVal now;
-  GTimeVal start;
-  GstClockTime diff;
-  guint64 size_buffer = 0;
-  GSList *iter;
-  gboolean end_of_period = TRUE;
-  GstDashDemuxStream *selected_stream = NULL;
-  GstClockTime best_time = GST_CLOCK_TIME_NONE;
-  GSList *streams;
-
-  g_mutex_lock (&demux->streams_lock);
-  /* TODO add check */
-  streams = g_slist_last (demux->next_periods)->data;
-  g_mutex_unlock (&demux->streams_lock);
-
-  for (iter = streams; iter; iter = g_slist_next (iter)) {
-    GstDashDemuxStream *stream = iter->data;
-    GstClockTime ts;
-
-    if (stream->download_end_of_period)
-      continue;
-
-    if (gst_mpd_client_get_next_fragment_timestamp (demux->client,
-            stream->index, &ts)) {
-      if (ts < best_time || !GST_CLOCK_TIME_IS_VALID (best_time)) {
-        selected_stream = stream;
-        best_time = ts;
-      }
-    } else {
-      GstEvent *event = NULL;
-
-      GST_INFO_OBJECT (demux,
-          "This Period doesn't contain more fragments for stream %u",
-          stream->index);
-
-      /* check if this is live and we should wait for more data */
-      if (gst_mpd_client_is_live (demux->client)
-          && demux->client->mpd_node->minimumUpdatePeriod != -1) {
-        end_of_period = FALSE;
-        continue;
-      }
+  GstMediaFragmentInfo fragment;
+  gchar *header_uri = NULL, *header_index_uri = NULL;
+  gint64 header_range_start = 0, header_range_end = -1;
+  gint64 header_index_range_start = 0, header_index_range_end = -1;
+  guint stream_idx = stream->index;
+#ifndef GST_DISABLE_GST_DEBUG
+  GstClockTime start, diff;
+#endif
+  guint64 size = 0;
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstClockTime ts;
 
-      if (gst_mpd_client_has_next_period (demux->client)) {
-        event = gst_event_new_dash_eop ();
-      } else {
-        GST_DEBUG_OBJECT (demux,
-            "No more fragments or periods for this stream, setting EOS");
-        event = gst_event_new_eos ();
-      }
-      stream->download_end_of_period = TRUE;
-      gst_dash_demux_stream_push_event (stream, event);
+  if (!gst_mpd_client_get_next_fragment_timestamp (demux->client, stream_idx,
+          &ts)) {
+    GST_INFO_OBJECT (demux,
+        "This Period doesn't contain more fragments for stream %u",
+        stream_idx);
+
+    /* check if this is live and we should wait for more data */
+    if (gst_mpd_client_is_live (demux->client)
+        && demux->client->mpd_node->minimumUpdatePeriod != -1) {
+      gst_dash_demux_download_wait (demux,
+          demux->client->mpd_node->minimumUpdatePeriod * GST_MSECOND);
+      return GST_FLOW_OK;
     }
+
+    return GST_FLOW_EOS;
   }
-  if (selected_ts)
-    *selected_ts = best_time;
-  if (stream && selected_stream)
-    *stream =
-        gst_mpdparser_get_active_stream_by_index (demux->client,
-        selected_stream->index);
+  *fragment_ts = ts;
+
+  active_stream =
+      gst_mpdparser_get_active_stream_by_index (demux->client, stream_idx);
+  if (active_stream == NULL)
+    return GST_FLOW_ERROR;
 
   /* If this is a live stream, check the segment end time to make sure
    * it is available to download
    */
-  if (selected_stream && gst_mpd_client_is_live (demux->client) &&
+  if (gst_mpd_client_is_live (demux->client) &&
       demux->client->mpd_node->minimumUpdatePeriod != -1) {
     GstDateTime *seg_end_time;
-    GstDateTime *cur_time = gst_date_time_new_now_utc ();
 
     seg_end_time =
         gst_mpd_client_get_next_segment_availability_end_time (demux->client,
-        *stream);
+        active_stream);
 
     if (seg_end_time) {
+      GstDateTime *cur_time = gst_date_time_new_now_utc ();
       gint64 diff;
 
-      cur_time = gst_date_time_new_now_utc ();
       diff = gst_mpd_client_calculate_time_difference (cur_time, seg_end_time)
           / GST_MSECOND;
       gst_date_time_unref (seg_end_time);
@@ -2138,128 +2278,146 @@ gst_dash_demux_get_next_fragment (GstDashDemux * demux,
         GST_DEBUG_OBJECT (demux,
             "Selected fragment has end timestamp > now (%" PRIi64
             "), delaying download", diff);
-        end_of_period = FALSE;
         gst_dash_demux_download_wait (demux, diff);
       }
     }
   }
 
-  /* Get the fragment corresponding to each stream index */
-  if (selected_stream) {
-    guint stream_idx = selected_stream->index;
-    GstBuffer *buffer;
-    GstMediaFragmentInfo fragment;
-
-    if (gst_mpd_client_get_next_fragment (demux->client, stream_idx, &fragment)) {
-
-      g_get_current_time (&start);
-      GST_INFO_OBJECT (demux, "Next fragment for stream #%i", stream_idx);
-      GST_INFO_OBJECT (demux,
-          "Fetching next fragment %s ts:%" GST_TIME_FORMAT " dur:%"
-          GST_TIME_FORMAT " Range:%" G_GINT64_FORMAT "-%" G_GINT64_FORMAT,
-          fragment.uri, GST_TIME_ARGS (fragment.timestamp),
-          GST_TIME_ARGS (fragment.duration),
-          fragment.range_start, fragment.range_end);
+  if (!gst_mpd_client_get_next_fragment (demux->client, stream_idx, &fragment)) {
+    GST_WARNING_OBJECT (demux, "Failed to download fragment for stream %p %d",
+        stream, stream_idx);
+    return GST_FLOW_ERROR;
+  }
 
-      /* got a fragment to fetch, no end of period */
-      end_of_period = FALSE;
+  GST_INFO_OBJECT (demux, "Next fragment for stream #%i", stream_idx);
+  GST_INFO_OBJECT (demux,
+      "Fetching next fragment %s ts:%" GST_TIME_FORMAT " dur:%"
+      GST_TIME_FORMAT " Range:%" G_GINT64_FORMAT "-%" G_GINT64_FORMAT,
+      fragment.uri, GST_TIME_ARGS (fragment.timestamp),
+      GST_TIME_ARGS (fragment.duration),
+      fragment.range_start, fragment.range_end);
+
+  if (stream->need_header) {
+    /* We need to fetch a new header */
+    if (gst_mpd_client_get_next_header (demux->client, &header_uri,
+            stream_idx, &header_range_start, &header_range_end)) {
+      header_uri = gst_dash_demux_get_header_uri (demux, stream_idx,
+          header_uri);
+
+      /* check if we have an index */
+      if (gst_mpd_client_get_next_header_index (demux->client,
+              &header_index_uri, stream_idx, &header_index_range_start,
+              &header_index_range_end))
+        header_index_uri = gst_dash_demux_get_header_uri (demux, stream_idx,
+            header_index_uri);
+    }
+    stream->need_header = FALSE;
+  }
 
-      download = gst_uri_downloader_fetch_uri_with_range (demux->downloader,
-          fragment.uri, fragment.range_start, fragment.range_end);
+  stream->fragment_timestamp = fragment.timestamp;
+  stream->fragment_duration = fragment.duration;
+  stream->fragment_offset = gst_mpd_client_get_segment_index (active_stream) - 1;
+  stream->fragment_started = FALSE;
 
-      if (download == NULL) {
-        gst_media_fragment_info_clear (&fragment);
-        return FALSE;
-      }
+  gst_dash_demux_download_started (demux);
+  g_mutex_unlock (&demux->download_mutex);
 
-      active_stream =
-          gst_mpdparser_get_active_stream_by_index (demux->client, stream_idx);
-      if (active_stream == NULL) {
-        gst_media_fragment_info_clear (&fragment);
-        g_object_unref (download);
-        return FALSE;
-      }
+#ifndef GST_DISABLE_GST_DEBUG
+  start = gst_util_get_timestamp ();
+#endif
 
-      buffer = gst_fragment_get_buffer (download);
+  /* The header, the index and the fragment are pushed in this order, the
+   * timestamp is put on the first data of the fragment */
+  if (header_uri) {
+    GST_INFO_OBJECT (demux, "Fetching header %s %" G_GINT64_FORMAT "-%"
+        G_GINT64_FORMAT, header_uri, header_range_start, header_range_end);
+    download = gst_uri_downloader_fetch_uri_streaming (stream->downloader,
+        header_uri, header_range_start, header_range_end,
+        gst_dash_demux_stream_chunk_received, stream);
+    if (download) {
+      size += download->size;
       g_object_unref (download);
 
-      /* it is possible to have an index per fragment, so check and download */
-      if (fragment.index_uri || fragment.index_range_start
-          || fragment.index_range_end != -1) {
-        const gchar *uri = fragment.index_uri;
-        GstBuffer *index_buffer;
-
-        if (!uri)               /* fallback to default media uri */
-          uri = fragment.uri;
-
-        GST_DEBUG_OBJECT (demux,
-            "Fragment index download: %s %" G_GINT64_FORMAT "-%"
-            G_GINT64_FORMAT, uri, fragment.index_range_start,
-            fragment.index_range_end);
-        download =
-            gst_uri_downloader_fetch_uri_with_range (demux->downloader, uri,
-            fragment.index_range_start, fragment.index_range_end);
+      if (header_index_uri) {
+        GST_INFO_OBJECT (demux,
+            "Fetching index %s %" G_GINT64_FORMAT "-%" G_GINT64_FORMAT,
+            header_index_uri, header_index_range_start,
+            header_index_range_end);
+        download = gst_uri_downloader_fetch_uri_streaming (stream->downloader,
+            header_index_uri, header_index_range_start,
+            header_index_range_end, gst_dash_demux_stream_chunk_received,
+            stream);
         if (download) {
-          index_buffer = gst_fragment_get_buffer (download);
-          if (index_buffer)
-            buffer = gst_buffer_append (index_buffer, buffer);
+          size += download->size;
           g_object_unref (download);
         }
       }
-
-      if (selected_stream->need_header) {
-        /* We need to fetch a new header */
-        if ((header_buffer =
-                gst_dash_demux_get_next_header (demux, stream_idx)) != NULL) {
-          buffer = gst_buffer_append (header_buffer, buffer);
-        }
-        selected_stream->need_header = FALSE;
-      }
-      g_get_current_time (&now);
-
-      buffer = gst_buffer_make_writable (buffer);
-
-      GST_BUFFER_TIMESTAMP (buffer) = fragment.timestamp;
-      GST_BUFFER_DURATION (buffer) = fragment.duration;
-      GST_BUFFER_OFFSET (buffer) =
-          gst_mpd_client_get_segment_index (active_stream) - 1;
-
-      gst_media_fragment_info_clear (&fragment);
-
-      gst_dash_demux_stream_push_data (selected_stream, buffer);
-      selected_stream->has_data_queued = TRUE;
-      size_buffer += gst_buffer_get_size (buffer);
     } else {
-      GST_WARNING_OBJECT (demux, "Failed to download fragment for stream %p %d",
-          selected_stream, selected_stream->index);
+      GST_WARNING_OBJECT (demux, "Unable to fetch header");
     }
   }
 
-  demux->end_of_period = end_of_period;
-  if (end_of_period)
-    return FALSE;
+  /* it is possible to have an index per fragment, so check and download */
+  if (fragment.index_uri || fragment.index_range_start
+      || fragment.index_range_end != -1) {
+    const gchar *uri = fragment.index_uri;
+
+    if (!uri)                   /* fallback to default media uri */
+      uri = fragment.uri;
+
+    GST_DEBUG_OBJECT (demux,
+        "Fragment index download: %s %" G_GINT64_FORMAT "-%"
+        G_GINT64_FORMAT, uri, fragment.index_range_start,
+        fragment.index_range_end);
+    download = gst_uri_downloader_fetch_uri_streaming (stream->downloader, uri,
+        fragment.index_range_start, fragment.index_range_end,
+        gst_dash_demux_stream_chunk_received, stream);
+    if (download) {
+      size += download->size;
+      g_object_unref (download);
+    }
+  }
 
-  /* Wake the download task up */
-  GST_TASK_SIGNAL (demux->download_task);
-  if (selected_stream) {
+  download = gst_uri_downloader_fetch_uri_streaming (stream->downloader,
+      fragment.uri, fragment.range_start, fragment.range_end,
+      gst_dash_demux_stream_chunk_received, stream);
+
+  g_mutex_lock (&demux->download_mutex);
+  gst_dash_demux_download_progress (demux, 0, TRUE);
+
+  if (download == NULL) {
+    /* whatever comes next doesn't continue the data that was already
+     * pushed */
+    if (stream->fragment_started)
+      stream->fragment_discont = TRUE;
+    ret = demux->cancelled ? GST_FLOW_FLUSHING : GST_FLOW_ERROR;
+  } else {
 #ifndef GST_DISABLE_GST_DEBUG
     guint64 brate;
 #endif
 
-    diff = (GST_TIMEVAL_TO_TIME (now) - GST_TIMEVAL_TO_TIME (start));
-    gst_download_rate_add_rate (&selected_stream->dnl_rate, size_buffer, diff);
+    size += download->size;
+    g_object_unref (download);
+    stream->has_data_queued = TRUE;
 
 #ifndef GST_DISABLE_GST_DEBUG
-    brate = (size_buffer * 8) / ((double) diff / GST_SECOND);
+    diff = gst_util_get_timestamp () - start;
+    brate = diff ? gst_util_uint64_scale (size, 8 * GST_SECOND, diff) : 0;
 #endif
     GST_INFO_OBJECT (demux,
-        "Stream: %d Download rate = %" G_GUINT64_FORMAT " Kbits/s (%" G_GUINT64_FORMAT
-        " Ko in %.2f s)", selected_stream->index,
-        brate / 1000, size_buffer / 1024, ((double) diff / GST_SECOND));
+        "Stream: %d Download rate = %" G_GUINT64_FORMAT " Kbits/s (%"
+        G_GUINT64_FORMAT " Ko in %.2f s)", stream_idx, brate / 1000,
+        size / 1024, ((double) diff / GST_SECOND));
   }
-  return TRUE;
+
+  gst_media_fragment_info_clear (&fragment);
+  g_free (header_uri);
+  g_free (header_index_uri);
+
+  return ret;
 }
 
+/* Called with the download_mutex held */
 static void
 gst_dash_demux_download_wait (GstDashDemux * demux, GstClockTime time_diff)
 {
@@ -2267,6 +2425,8 @@ gst_dash_demux_download_wait (GstDashDemux * demux, GstClockTime time_diff)
 
   GST_DEBUG_OBJECT (demux, "Download waiting for %" GST_TIME_FORMAT,
       GST_TIME_ARGS (time_diff));
-  g_cond_wait_until (&demux->download_cond, &demux->download_mutex, end_time);
+  if (!demux->cancelled)
+    g_cond_wait_until (&demux->download_cond, &demux->download_mutex,
+        end_time);
   GST_DEBUG_OBJECT (demux, "Download finished waiting");
 }
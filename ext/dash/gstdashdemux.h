@@ -34,8 +34,8 @@
 #include <gst/base/gstadapter.h>
 #include <gst/base/gstdataqueue.h>
 #include "gstmpdparser.h"
-#include "gstdownloadrate.h"
 #include <gst/uridownloader/gsturidownloader.h>
+#include <gst/uridownloader/gstabrcontroller.h>
 
 G_BEGIN_DECLS
 #define GST_TYPE_DASH_DEMUX \
@@ -57,6 +57,8 @@ struct _GstDashDemuxStream
 {
   GstPad *pad;
 
+  GstDashDemux *demux;
+
   gint index;
 
   GstCaps *input_caps;
@@ -93,7 +95,18 @@ struct _GstDashDemuxStream
 
   GstDataQueue *queue;
 
-  GstDownloadRate dnl_rate;
+  /* Download task, every stream has its own so that a slow fragment
+   * of one stream doesn't hold back the others */
+  GstTask *download_task;
+  GRecMutex download_task_lock;
+  GstUriDownloader *downloader;
+
+  /* Fragment currently being streamed into the queue */
+  GstClockTime fragment_timestamp;
+  GstClockTime fragment_duration;
+  guint64 fragment_offset;
+  gboolean fragment_started;
+  gboolean fragment_discont;
 };
 
 /**
@@ -120,7 +133,6 @@ struct _GstDashDemux
   GstBuffer *manifest;
   GstUriDownloader *downloader;
   GstMpdClient *client;         /* MPD client */
-  gboolean end_of_period;
   gboolean end_of_manifest;
 
   /* Properties */
@@ -132,15 +144,22 @@ struct _GstDashDemux
   GstTask *stream_task;
   GRecMutex stream_task_lock;
 
-  /* Download task */
-  GstTask *download_task;
-  GRecMutex download_task_lock;
+  /* Download tasks of the streams. The mutex protects the MPD client
+   * and the download rate, it is only released while downloading */
   GMutex download_mutex;
   GCond download_cond;
   gboolean cancelled;
 
+  /* Download rate over all streams, measured while at least one of
+   * them is downloading */
+  GstAbrController abr;
+  guint n_downloading;
+  GstClockTime download_window_start;
+  guint64 download_window_bytes;
+
   /* Manifest update */
   GstClockTime last_manifest_update;
+  gboolean updating_manifest;   /* a stream is downloading the manifest */
 };
 
 struct _GstDashDemuxClass
@@ -260,6 +260,30 @@ gst_mpdparser_get_xml_prop_string_vector_type (xmlNode * a_node,
   return exists;
 }
 
+static gboolean
+gst_mpdparser_get_xml_prop_signed_integer (xmlNode * a_node,
+    const gchar * property_name, gint default_val, gint * property_value)
+{
+  xmlChar *prop_string;
+  gboolean exists = FALSE;
+
+  *property_value = default_val;
+  prop_string = xmlGetProp (a_node, (const xmlChar *) property_name);
+  if (prop_string) {
+    if (sscanf ((gchar *) prop_string, "%d", property_value)) {
+      exists = TRUE;
+      GST_LOG (" - %s: %d", property_name, *property_value);
+    } else {
+      GST_WARNING
+          ("failed to parse signed integer property %s from xml string %s",
+          property_name, prop_string);
+    }
+    xmlFree (prop_string);
+  }
+
+  return exists;
+}
+
 static gboolean
 gst_mpdparser_get_xml_prop_unsigned_integer (xmlNode * a_node,
     const gchar * property_name, guint default_val, guint * property_value)
@@ -1279,7 +1303,7 @@ gst_mpdparser_parse_s_node (GQueue * queue, xmlNode * a_node)
       &new_s_node->t);
   gst_mpdparser_get_xml_prop_unsigned_integer_64 (a_node, "d", 0,
       &new_s_node->d);
-  gst_mpdparser_get_xml_prop_unsigned_integer (a_node, "r", 0, &new_s_node->r);
+  gst_mpdparser_get_xml_prop_signed_integer (a_node, "r", 0, &new_s_node->r);
 }
 
 static GstSegmentTimelineNode *
@@ -2610,6 +2634,8 @@ gst_mpdparser_free_active_stream (GstActiveStream * active_stream)
     active_stream->queryURL = NULL;
     if (active_stream->segments)
       g_ptr_array_unref (active_stream->segments);
+    if (active_stream->timeline)
+      g_array_free (active_stream->timeline, TRUE);
     g_slice_free (GstActiveStream, active_stream);
   }
 }
@@ -2935,52 +2961,426 @@ gst_mpd_client_free (GstMpdClient * client)
     g_free (client->mpd_uri);
     client->mpd_uri = NULL;
   }
+  g_free (client->mpd_checksum);
 
   g_free (client);
 }
 
+static gboolean
+gst_mpdparser_parse_data (GstMPDNode ** mpd_node, const gchar * data,
+    gint size)
+{
+  xmlDocPtr doc;
+  xmlNode *root_element = NULL;
+
+  /* parse the complete MPD file into a tree (using the libxml2 default parser API) */
+
+  /* this initialize the library and check potential ABI mismatches
+   * between the version it was compiled for and the actual shared
+   * library used
+   */
+  LIBXML_TEST_VERSION
+      /* parse "data" into a document (which is a libxml2 tree structure xmlDoc) */
+      doc = xmlReadMemory (data, size, "noname.xml", NULL, 0);
+  if (doc == NULL) {
+    GST_ERROR ("failed to parse the MPD file");
+    return FALSE;
+  }
+
+  /* get the root element node */
+  root_element = xmlDocGetRootElement (doc);
+
+  if (root_element->type != XML_ELEMENT_NODE
+      || xmlStrcmp (root_element->name, (xmlChar *) "MPD") != 0) {
+    GST_ERROR
+        ("can not find the root element MPD, failed to parse the MPD file");
+  } else {
+    /* now we can parse the MPD root node and all children nodes, recursively */
+    gst_mpdparser_parse_root_node (mpd_node, root_element);
+  }
+  /* free the document */
+  xmlFreeDoc (doc);
+
+  return TRUE;
+}
+
 gboolean
 gst_mpd_parse (GstMpdClient * client, const gchar * data, gint size)
 {
   if (data) {
-    xmlDocPtr doc;
-    xmlNode *root_element = NULL;
+    gboolean ret;
 
     GST_DEBUG ("MPD file fully buffered, start parsing...");
 
     GST_MPD_CLIENT_LOCK (client);
-    /* parse the complete MPD file into a tree (using the libxml2 default parser API) */
-
-    /* this initialize the library and check potential ABI mismatches
-     * between the version it was compiled for and the actual shared
-     * library used
-     */
-    LIBXML_TEST_VERSION
-        /* parse "data" into a document (which is a libxml2 tree structure xmlDoc) */
-        doc = xmlReadMemory (data, size, "noname.xml", NULL, 0);
-    if (doc == NULL) {
-      GST_ERROR ("failed to parse the MPD file");
-      GST_MPD_CLIENT_UNLOCK (client);
+    ret = gst_mpdparser_parse_data (&client->mpd_node, data, size);
+    if (ret) {
+      g_free (client->mpd_checksum);
+      client->mpd_checksum =
+          g_compute_checksum_for_data (G_CHECKSUM_SHA1, (const guchar *) data,
+          size);
+    }
+    GST_MPD_CLIENT_UNLOCK (client);
+
+    return ret;
+  }
+
+  return FALSE;
+}
+
+/* index of the first timeline segment starting at or after the media
+ * time start, in timescale units */
+static guint
+gst_mpdparser_get_timeline_index_at_start (GstActiveStream * stream,
+    guint64 start)
+{
+  GstMediaTimelineRun *run;
+  guint lo, hi, mid;
+  guint64 offset;
+
+  /* find the last run starting at or before start */
+  lo = 0;
+  hi = stream->timeline->len;
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    run = &g_array_index (stream->timeline, GstMediaTimelineRun, mid);
+    if (run->start <= start)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo == 0)
+    return 0;
+
+  run = &g_array_index (stream->timeline, GstMediaTimelineRun, lo - 1);
+  if (run->d == 0)
+    return run->first_idx + run->count;
+  offset = (start - run->start + run->d - 1) / run->d;
+  if (offset > run->count)
+    offset = run->count;
+
+  return run->first_idx + offset;
+}
+
+/* position and nodes of an active stream while the MPD is updated */
+typedef struct
+{
+  GstAdaptationSetNode *old_adapt_set;
+  GstRepresentationNode *old_representation;
+  GstAdaptationSetNode *adapt_set;
+  GstRepresentationNode *representation;
+  guint segment_idx;
+  GstMediaSegment chunk;
+  gboolean have_chunk;
+  gboolean after_chunk;
+} GstMpdStreamUpdate;
+
+/* remembers the nodes used by the active streams and their position */
+static gboolean
+gst_mpd_client_save_stream_positions (GstMpdClient * client,
+    GstMpdStreamUpdate * updates)
+{
+  GList *list;
+  guint stream_idx = 0;
+
+  for (list = client->active_streams; list;
+      list = g_list_next (list), stream_idx++) {
+    GstActiveStream *stream = list->data;
+    GstMpdStreamUpdate *update = &updates[stream_idx];
+
+    if (stream->cur_adapt_set == NULL || stream->cur_representation == NULL)
       return FALSE;
-    } else {
-      /* get the root element node */
-      root_element = xmlDocGetRootElement (doc);
 
-      if (root_element->type != XML_ELEMENT_NODE
-          || xmlStrcmp (root_element->name, (xmlChar *) "MPD") != 0) {
-        GST_ERROR
-            ("can not find the root element MPD, failed to parse the MPD file");
-      } else {
-        /* now we can parse the MPD root node and all children nodes, recursively */
-        gst_mpdparser_parse_root_node (&client->mpd_node, root_element);
+    update->old_adapt_set = stream->cur_adapt_set;
+    update->old_representation = stream->cur_representation;
+    update->segment_idx = gst_mpd_client_get_segment_index (stream);
+    update->have_chunk =
+        gst_mpdparser_get_chunk_by_index (client, stream_idx,
+        update->segment_idx, &update->chunk);
+    if (!update->have_chunk && update->segment_idx > 0) {
+      /* waiting for a new segment, continue after the last one */
+      update->have_chunk =
+          gst_mpdparser_get_chunk_by_index (client, stream_idx,
+          update->segment_idx - 1, &update->chunk);
+      update->after_chunk = TRUE;
+    }
+  }
+
+  return TRUE;
+}
+
+/* finds the nodes of the updated MPD matching the ones used by the active
+ * streams */
+static gboolean
+gst_mpd_client_prepare_stream_updates (GstMpdClient * client,
+    GstPeriodNode * old_period, GstPeriodNode * new_period,
+    GstMpdStreamUpdate * updates)
+{
+  GList *list, *iter;
+  guint stream_idx = 0;
+
+  for (list = client->active_streams; list;
+      list = g_list_next (list), stream_idx++) {
+    GstActiveStream *stream = list->data;
+    GstMpdStreamUpdate *update = &updates[stream_idx];
+
+    for (iter = new_period->AdaptationSets; iter; iter = g_list_next (iter)) {
+      GstAdaptationSetNode *node = iter->data;
+
+      if (stream->cur_adapt_set->id && node->id == stream->cur_adapt_set->id) {
+        update->adapt_set = node;
+        break;
       }
-      /* free the document */
-      xmlFreeDoc (doc);
     }
-    GST_MPD_CLIENT_UNLOCK (client);
+    if (update->adapt_set == NULL) {
+      update->adapt_set = g_list_nth_data (new_period->AdaptationSets,
+          g_list_index (old_period->AdaptationSets, stream->cur_adapt_set));
+    }
+    if (update->adapt_set == NULL) {
+      GST_WARNING ("AdaptationSet of stream %u missing from MPD update",
+          stream_idx);
+      return FALSE;
+    }
+
+    for (iter = update->adapt_set->Representations; iter;
+        iter = g_list_next (iter)) {
+      GstRepresentationNode *node = iter->data;
+
+      if (stream->cur_representation->id && node->id
+          && strcmp (node->id, stream->cur_representation->id) == 0) {
+        update->representation = node;
+        break;
+      }
+    }
+    if (update->representation == NULL) {
+      update->representation =
+          g_list_nth_data (update->adapt_set->Representations,
+          stream->representation_idx);
+    }
+    if (update->representation == NULL) {
+      GST_WARNING ("Representation of stream %u missing from MPD update",
+          stream_idx);
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/* moves the active streams to the nodes of the updated MPD, continuing
+ * from the segment following the last one they downloaded */
+static gboolean
+gst_mpd_client_apply_stream_updates (GstMpdClient * client,
+    GstMpdStreamUpdate * updates)
+{
+  GList *list;
+  guint stream_idx = 0;
+
+  for (list = client->active_streams; list;
+      list = g_list_next (list), stream_idx++) {
+    GstActiveStream *stream = list->data;
+    GstMpdStreamUpdate *update = &updates[stream_idx];
+    GstMediaSegment *chunk = &update->chunk;
+    guint segment_idx = 0;
+
+    stream->cur_adapt_set = update->adapt_set;
+    stream->cur_segment_base = NULL;
+    stream->cur_segment_list = NULL;
+    stream->cur_seg_template = NULL;
+    if (!gst_mpd_client_setup_representation (client, stream,
+            update->representation))
+      return FALSE;
 
+    if (!update->have_chunk) {
+      segment_idx = 0;
+    } else if (stream->timeline) {
+      segment_idx = gst_mpdparser_get_timeline_index_at_start (stream,
+          chunk->start + (update->after_chunk ? 1 : 0));
+    } else if (stream->segments) {
+      GstClockTime ts = chunk->start_time + (update->after_chunk ? 1 : 0);
+
+      for (segment_idx = 0; segment_idx < stream->segments->len;
+          segment_idx++) {
+        GstMediaSegment *segment =
+            g_ptr_array_index (stream->segments, segment_idx);
+
+        if (segment->start_time >= ts)
+          break;
+      }
+    } else if (stream->cur_seg_template) {
+      guint start_number =
+          stream->cur_seg_template->MultSegBaseType->startNumber;
+
+      /* segments are generated from their number */
+      segment_idx = chunk->number + (update->after_chunk ? 1 : 0);
+      segment_idx = segment_idx > start_number ? segment_idx - start_number : 0;
+    }
+    gst_mpd_client_set_segment_index (stream, segment_idx);
+    GST_DEBUG ("Stream %u continues from segment %u of the updated MPD",
+        stream_idx, segment_idx);
+  }
+
+  return TRUE;
+}
+
+/* puts the active streams back on the nodes of the previous MPD */
+static void
+gst_mpd_client_revert_stream_updates (GstMpdClient * client,
+    GstMpdStreamUpdate * updates)
+{
+  GList *list;
+  guint stream_idx = 0;
+
+  for (list = client->active_streams; list;
+      list = g_list_next (list), stream_idx++) {
+    GstActiveStream *stream = list->data;
+    GstMpdStreamUpdate *update = &updates[stream_idx];
+
+    if (update->old_representation == NULL)
+      break;
+
+    stream->cur_adapt_set = update->old_adapt_set;
+    stream->cur_segment_base = NULL;
+    stream->cur_segment_list = NULL;
+    stream->cur_seg_template = NULL;
+    gst_mpd_client_setup_representation (client, stream,
+        update->old_representation);
+    gst_mpd_client_set_segment_index (stream, update->segment_idx);
+  }
+}
+
+/* Updates the MPD of a client that is already streaming. The active
+ * streams are kept and moved to the matching nodes of the new MPD, only
+ * their segment lists or timelines are rebuilt. If the MPD file did not
+ * change since it was last parsed, it is not parsed again and changed is
+ * set to FALSE. On failure the previous MPD is kept */
+gboolean
+gst_mpd_client_update (GstMpdClient * client, const gchar * data, gint size,
+    gboolean * changed)
+{
+  GstMPDNode *new_mpd_node = NULL, *old_mpd_node;
+  GstStreamPeriod *stream_period;
+  GstPeriodNode *old_period;
+  GstMpdStreamUpdate *updates;
+  GList *old_periods, *list;
+  gchar *checksum;
+  guint old_period_idx, idx;
+  gboolean ret = FALSE;
+
+  g_return_val_if_fail (client != NULL, FALSE);
+  g_return_val_if_fail (data != NULL, FALSE);
+
+  if (changed)
+    *changed = FALSE;
+
+  checksum =
+      g_compute_checksum_for_data (G_CHECKSUM_SHA1, (const guchar *) data,
+      size);
+  GST_MPD_CLIENT_LOCK (client);
+  if (client->mpd_checksum && strcmp (client->mpd_checksum, checksum) == 0) {
+    GST_MPD_CLIENT_UNLOCK (client);
+    GST_DEBUG ("MPD file did not change, skipping parsing");
+    g_free (checksum);
     return TRUE;
   }
+  GST_MPD_CLIENT_UNLOCK (client);
+
+  if (!gst_mpdparser_parse_data (&new_mpd_node, data, size)
+      || new_mpd_node == NULL) {
+    g_free (checksum);
+    return FALSE;
+  }
+
+  GST_MPD_CLIENT_LOCK (client);
+  stream_period = gst_mpdparser_get_stream_period (client);
+  if (stream_period == NULL) {
+    GST_MPD_CLIENT_UNLOCK (client);
+    gst_mpdparser_free_mpd_node (new_mpd_node);
+    g_free (checksum);
+    return FALSE;
+  }
+  old_period = stream_period->period;
+  old_period_idx = client->period_idx;
+
+  updates = g_new0 (GstMpdStreamUpdate,
+      g_list_length (client->active_streams));
+  if (!gst_mpd_client_save_stream_positions (client, updates)) {
+    GST_MPD_CLIENT_UNLOCK (client);
+    gst_mpdparser_free_mpd_node (new_mpd_node);
+    g_free (updates);
+    g_free (checksum);
+    return FALSE;
+  }
+
+  /* the streams keep using the old nodes until they are moved to the new
+   * ones */
+  old_mpd_node = client->mpd_node;
+  old_periods = client->periods;
+  client->mpd_node = new_mpd_node;
+  client->periods = NULL;
+  GST_MPD_CLIENT_UNLOCK (client);
+
+  if (!gst_mpd_client_setup_media_presentation (client))
+    goto revert;
+
+  GST_MPD_CLIENT_LOCK (client);
+  /* find the current period in the new MPD */
+  idx = old_period_idx;
+  if (old_period->id) {
+    for (list = client->periods, idx = 0; list;
+        list = g_list_next (list), idx++) {
+      GstStreamPeriod *period = list->data;
+
+      if (period->period->id && strcmp (period->period->id, old_period->id) == 0)
+        break;
+    }
+  }
+  stream_period = g_list_nth_data (client->periods, idx);
+  if (stream_period == NULL) {
+    GST_MPD_CLIENT_UNLOCK (client);
+    GST_WARNING ("Current Period missing from MPD update");
+    goto revert;
+  }
+
+  client->period_idx = idx;
+
+  ret = gst_mpd_client_prepare_stream_updates (client, old_period,
+      stream_period->period, updates);
+  if (ret)
+    ret = gst_mpd_client_apply_stream_updates (client, updates);
+  GST_MPD_CLIENT_UNLOCK (client);
+
+  if (!ret)
+    goto revert;
+
+  GST_MPD_CLIENT_LOCK (client);
+  g_free (client->mpd_checksum);
+  client->mpd_checksum = checksum;
+  GST_MPD_CLIENT_UNLOCK (client);
+  if (changed)
+    *changed = TRUE;
+
+  gst_mpdparser_free_mpd_node (old_mpd_node);
+  g_list_free_full (old_periods,
+      (GDestroyNotify) gst_mpdparser_free_stream_period);
+  g_free (updates);
+
+  return TRUE;
+
+revert:
+  GST_WARNING ("Failed to update the MPD, keeping the previous one");
+  GST_MPD_CLIENT_LOCK (client);
+  list = client->periods;
+  client->mpd_node = old_mpd_node;
+  client->periods = old_periods;
+  client->period_idx = old_period_idx;
+  gst_mpd_client_revert_stream_updates (client, updates);
+  GST_MPD_CLIENT_UNLOCK (client);
+
+  gst_mpdparser_free_mpd_node (new_mpd_node);
+  g_list_free_full (list, (GDestroyNotify) gst_mpdparser_free_stream_period);
+  g_free (updates);
+  g_free (checksum);
 
   return FALSE;
 }
@@ -2998,6 +3398,135 @@ gst_mpdparser_get_baseURL (GstMpdClient * client, guint indexStream)
   return stream->baseURL;
 }
 
+/* binary search for the run containing the segment with index indexChunk */
+static GstMediaTimelineRun *
+gst_mpdparser_get_timeline_run (GstActiveStream * stream, guint indexChunk)
+{
+  GstMediaTimelineRun *run;
+  guint lo, hi, mid;
+
+  if (indexChunk >= stream->timeline_n_segments)
+    return NULL;
+
+  lo = 0;
+  hi = stream->timeline->len;
+  while (hi - lo > 1) {
+    mid = lo + (hi - lo) / 2;
+    run = &g_array_index (stream->timeline, GstMediaTimelineRun, mid);
+    if (run->first_idx <= indexChunk)
+      lo = mid;
+    else
+      hi = mid;
+  }
+
+  return &g_array_index (stream->timeline, GstMediaTimelineRun, lo);
+}
+
+static gboolean
+gst_mpdparser_get_timeline_chunk (GstActiveStream * stream, guint indexChunk,
+    GstMediaSegment * segment)
+{
+  GstMediaTimelineRun *run;
+  guint offset;
+
+  run = gst_mpdparser_get_timeline_run (stream, indexChunk);
+  if (run == NULL)
+    return FALSE;
+
+  offset = indexChunk - run->first_idx;
+  segment->SegmentURL = NULL;
+  segment->number = run->number + offset;
+  segment->start = run->start + offset * run->d;
+  segment->start_time = run->start_time + offset * run->duration;
+  segment->duration = run->duration;
+
+  return TRUE;
+}
+
+/* index of the segment of the timeline containing ts if containing is
+ * TRUE, or of the first one starting at or after ts otherwise. A ts in a
+ * gap of the timeline maps to the segment after the gap. Returns
+ * timeline_n_segments if there is no such segment */
+static guint
+gst_mpdparser_get_timeline_index_at_time (GstActiveStream * stream,
+    GstClockTime ts, gboolean containing)
+{
+  GstMediaTimelineRun *run;
+  GstClockTime end;
+  guint lo, hi, mid, offset;
+
+  /* find the last run starting at or before ts */
+  lo = 0;
+  hi = stream->timeline->len;
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    run = &g_array_index (stream->timeline, GstMediaTimelineRun, mid);
+    if (run->start_time <= ts)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo == 0)
+    return 0;
+
+  run = &g_array_index (stream->timeline, GstMediaTimelineRun, lo - 1);
+  end = run->start_time + run->count * run->duration;
+  if (ts >= end || run->duration == 0)
+    return run->first_idx + run->count;
+
+  offset = (ts - run->start_time) / run->duration;
+  if (!containing && run->start_time + offset * run->duration < ts)
+    offset++;
+
+  return run->first_idx + offset;
+}
+
+/* index of the timeline segment containing the position ts, relative to
+ * the start of the period. The media time is matched against the S@t
+ * values so variable segment durations are honoured. A position falling
+ * in a gap or past the end of the timeline maps to the latest segment
+ * published before it */
+static guint
+gst_mpdparser_get_timeline_index_at_period_time (GstActiveStream * stream,
+    GstClockTime ts)
+{
+  GstSegmentBaseType *base = stream->cur_seg_template->MultSegBaseType->
+      SegBaseType;
+  GstMediaTimelineRun *run;
+  guint64 t, offset;
+  guint lo, hi, mid;
+
+  t = ts;
+  if (base) {
+    if (base->timescale > 1)
+      t = gst_util_uint64_scale (ts, base->timescale, GST_SECOND);
+    else
+      t = ts / GST_SECOND;
+    t += base->presentationTimeOffset;
+  }
+
+  /* find the last run starting at or before t */
+  lo = 0;
+  hi = stream->timeline->len;
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    run = &g_array_index (stream->timeline, GstMediaTimelineRun, mid);
+    if (run->start <= t)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo == 0)
+    return 0;
+
+  run = &g_array_index (stream->timeline, GstMediaTimelineRun, lo - 1);
+  offset = run->d ? (t - run->start) / run->d : 0;
+  if (offset >= run->count)
+    offset = run->count - 1;
+
+  return run->first_idx + offset;
+}
+
 gboolean
 gst_mpdparser_get_chunk_by_index (GstMpdClient * client, guint indexStream,
     guint indexChunk, GstMediaSegment * segment)
@@ -3010,7 +3539,10 @@ gst_mpdparser_get_chunk_by_index (GstMpdClient * client, guint indexStream,
   stream = g_list_nth_data (client->active_streams, indexStream);
   g_return_val_if_fail (stream != NULL, FALSE);
 
-  if (stream->segments) {
+  if (stream->timeline) {
+    /* segment template with a timeline */
+    return gst_mpdparser_get_timeline_chunk (stream, indexChunk, segment);
+  } else if (stream->segments) {
     GstMediaSegment *list_segment;
     /* fixed list of segments */
     if (indexChunk >= stream->segments->len)
@@ -3076,6 +3608,7 @@ gst_mpd_client_setup_representation (GstMpdClient * client,
   GList *rep_list;
   GstClockTime PeriodStart, PeriodEnd, start_time, duration;
   GstMediaSegment *last_media_segment;
+  GstMediaTimelineRun *last_run;
   guint i;
   guint64 start;
 
@@ -3093,6 +3626,11 @@ gst_mpd_client_setup_representation (GstMpdClient * client,
     g_ptr_array_unref (stream->segments);
     stream->segments = NULL;
   }
+  if (stream->timeline) {
+    g_array_free (stream->timeline, TRUE);
+    stream->timeline = NULL;
+  }
+  stream->timeline_n_segments = 0;
 
   stream_period = gst_mpdparser_get_stream_period (client);
   g_return_val_if_fail (stream_period != NULL, FALSE);
@@ -3171,7 +3709,9 @@ gst_mpd_client_setup_representation (GstMpdClient * client,
               start_time /= timescale;
           }
 
-          for (j = 0; j <= S->r && SegmentURL != NULL; j++) {
+          /* a negative repeat count repeats until the list ends */
+          for (j = 0; (S->r < 0 || j <= (guint) S->r) && SegmentURL != NULL;
+              j++) {
             if (!gst_mpd_client_add_media_segment (stream, SegmentURL->data, i,
                     start, start_time, duration)) {
               return FALSE;
@@ -3229,12 +3769,16 @@ gst_mpd_client_setup_representation (GstMpdClient * client,
         GList *list;
 
         timeline = stream->cur_seg_template->MultSegBaseType->SegmentTimeline;
-        gst_mpdparser_init_active_stream_segments (stream);
+        /* only keep one run per S node, the segments are computed on
+         * demand from it */
+        stream->timeline = g_array_sized_new (FALSE, FALSE,
+            sizeof (GstMediaTimelineRun), timeline->S.length);
         for (list = g_queue_peek_head_link (&timeline->S); list; list = g_list_next (list)) {
-          guint j, timescale;
+          GstMediaTimelineRun run;
+          guint timescale;
 
           S = (GstSNode *) list->data;
-          GST_LOG ("Processing S node: d=%" G_GUINT64_FORMAT " r=%u t=%"
+          GST_LOG ("Processing S node: d=%" G_GUINT64_FORMAT " r=%d t=%"
               G_GUINT64_FORMAT, S->d, S->r, S->t);
           duration = S->d * GST_SECOND;
           timescale =
@@ -3248,15 +3792,36 @@ gst_mpd_client_setup_representation (GstMpdClient * client,
               start_time /= timescale;
           }
 
-          for (j = 0; j <= S->r; j++) {
-            if (!gst_mpd_client_add_media_segment (stream, NULL, i, start,
-                    start_time, duration)) {
-              return FALSE;
+          if (S->r >= 0) {
+            run.count = S->r + 1;
+          } else {
+            GstSNode *next = list->next ? list->next->data : NULL;
+
+            /* a negative repeat count repeats the segment until the start
+             * of the next S node or the end of the Period */
+            if (next && next->t > start && S->d > 0) {
+              run.count = (next->t - start + S->d - 1) / S->d;
+            } else if (GST_CLOCK_TIME_IS_VALID (PeriodEnd)
+                && PeriodEnd > start_time && duration > 0) {
+              run.count = (PeriodEnd - start_time + duration - 1) / duration;
+            } else {
+              GST_WARNING ("Can't tell how often the S node repeats, "
+                  "using a single segment");
+              run.count = 1;
             }
-            i++;
-            start += S->d;
-            start_time += duration;
           }
+          run.first_idx = stream->timeline_n_segments;
+          run.number = i;
+          run.start = start;
+          run.d = S->d;
+          run.start_time = start_time;
+          run.duration = duration;
+          g_array_append_val (stream->timeline, run);
+
+          stream->timeline_n_segments += run.count;
+          i += run.count;
+          start += run.count * S->d;
+          start_time += run.count * duration;
         }
       } else {
         /* NOP - The segment is created on demand with the template, no need
@@ -3266,6 +3831,38 @@ gst_mpd_client_setup_representation (GstMpdClient * client,
   }
 
   /* check duration of last segment */
+  last_run = (stream->timeline && stream->timeline->len) ?
+      &g_array_index (stream->timeline, GstMediaTimelineRun,
+      stream->timeline->len - 1) : NULL;
+
+  if (last_run && GST_CLOCK_TIME_IS_VALID (PeriodEnd)) {
+    GstClockTime last_start_time =
+        last_run->start_time + (last_run->count - 1) * last_run->duration;
+
+    if (last_start_time + last_run->duration > PeriodEnd) {
+      GstMediaTimelineRun run = *last_run;
+
+      /* split the last segment off its run to fix its duration */
+      run.first_idx += run.count - 1;
+      run.number += run.count - 1;
+      run.start += (run.count - 1) * run.d;
+      run.start_time = last_start_time;
+      run.duration = PeriodEnd > last_start_time ?
+          PeriodEnd - last_start_time : 0;
+      run.count = 1;
+      if (last_run->count > 1) {
+        last_run->count--;
+        g_array_append_val (stream->timeline, run);
+      } else {
+        *last_run = run;
+      }
+      GST_LOG ("Fixed duration of last segment: %" GST_TIME_FORMAT,
+          GST_TIME_ARGS (run.duration));
+    }
+    GST_LOG ("Built a timeline of %u segments in %u runs",
+        stream->timeline_n_segments, stream->timeline->len);
+  }
+
   last_media_segment = (stream->segments && stream->segments->len) ?
       g_ptr_array_index (stream->segments, stream->segments->len - 1) : NULL;
 
@@ -3529,7 +4126,13 @@ gst_mpd_client_stream_seek (GstMpdClient * client, GstActiveStream * stream,
   g_return_val_if_fail (stream != NULL, 0);
 
   GST_MPD_CLIENT_LOCK (client);
-  if (stream->segments) {
+  if (stream->timeline) {
+    segment_idx = gst_mpdparser_get_timeline_index_at_time (stream, ts, FALSE);
+    if (segment_idx >= stream->timeline_n_segments) {
+      GST_MPD_CLIENT_UNLOCK (client);
+      return FALSE;
+    }
+  } else if (stream->segments) {
     for (i = 0; i < stream->segments->len; i++, segment_idx++) {
       GstMediaSegment *segment = g_ptr_array_index (stream->segments, i);
       GST_DEBUG ("Looking at fragment sequence chunk %d", segment_idx);
@@ -3562,6 +4165,40 @@ gst_mpd_client_stream_seek (GstMpdClient * client, GstActiveStream * stream,
   return TRUE;
 }
 
+/* Returns the index of the segment containing ts, or the number of
+ * segments if ts is past the last one */
+guint
+gst_mpd_client_get_segment_index_at_position (GstMpdClient * client,
+    GstActiveStream * stream, GstClockTime ts)
+{
+  guint segment_idx = 0;
+
+  g_return_val_if_fail (stream != NULL, 0);
+
+  GST_MPD_CLIENT_LOCK (client);
+  if (stream->timeline) {
+    segment_idx = gst_mpdparser_get_timeline_index_at_time (stream, ts, TRUE);
+  } else if (stream->segments) {
+    for (segment_idx = 0; segment_idx < stream->segments->len; segment_idx++) {
+      GstMediaSegment *segment =
+          g_ptr_array_index (stream->segments, segment_idx);
+
+      if (segment->start_time <= ts
+          && ts < segment->start_time + segment->duration)
+        break;
+    }
+  } else {
+    GstClockTime duration =
+        gst_mpd_client_get_segment_duration (client, stream);
+
+    if (GST_CLOCK_TIME_IS_VALID (duration) && duration > 0)
+      segment_idx = ts / duration;
+  }
+  GST_MPD_CLIENT_UNLOCK (client);
+
+  return segment_idx;
+}
+
 gint64
 gst_mpd_client_calculate_time_difference (const GstDateTime * t1,
     const GstDateTime * t2)
@@ -3624,7 +4261,13 @@ gst_mpd_client_get_segment_index_at_time (GstMpdClient * client,
   if (diff > gst_mpd_client_get_media_presentation_duration (client))
     return -3;
 
-  /* TODO: Assumes all fragments are roughly the same duration */
+  if (stream->timeline) {
+    if (stream->timeline_n_segments == 0)
+      return -1;
+    return gst_mpdparser_get_timeline_index_at_period_time (stream, diff);
+  }
+
+  /* Without a timeline all fragments have the same duration */
   seg_duration = gst_mpd_client_get_next_fragment_duration (client, stream);
   if (seg_duration == 0)
     return -1;
@@ -3928,7 +4571,13 @@ gst_mpd_client_get_next_fragment_duration (GstMpdClient * client,
 
   seg_idx = gst_mpd_client_get_segment_index (stream);
 
-  if (stream->segments) {
+  if (stream->timeline) {
+    GstMediaSegment segment;
+
+    if (!gst_mpdparser_get_timeline_chunk (stream, seg_idx, &segment))
+      return 0;
+    return segment.duration;
+  } else if (stream->segments) {
     if (seg_idx < stream->segments->len)
       media_segment = g_ptr_array_index (stream->segments, seg_idx);
 
@@ -4094,6 +4743,8 @@ gst_mpd_client_get_segments_counts (GstActiveStream * stream)
 {
   g_return_val_if_fail (stream != NULL, 0);
 
+  if (stream->timeline)
+    return stream->timeline_n_segments;
   if (stream->segments)
     return stream->segments->len;
   g_return_val_if_fail (stream->cur_seg_template->MultSegBaseType->
@@ -4301,7 +4952,7 @@ gst_mpd_client_get_next_segment_availability_end_time (GstMpdClient * client,
 
   seg_idx = gst_mpd_client_get_segment_index (stream);
   seg_duration = gst_mpd_client_get_segment_duration (client, stream);
-  if (seg_duration == 0)
+  if (seg_duration == 0 && stream->timeline == NULL)
     return NULL;
   availability_start_time = gst_mpd_client_get_availability_start_time (client);
   if (availability_start_time == NULL)
@@ -4315,7 +4966,30 @@ gst_mpd_client_get_next_segment_availability_end_time (GstMpdClient * client,
     availability_start_time = t;
   }
 
-  offset = (1 + seg_idx) * seg_duration;
+  if (stream->timeline) {
+    GstSegmentBaseType *base =
+        stream->cur_seg_template->MultSegBaseType->SegBaseType;
+    GstMediaSegment segment;
+    guint64 end;
+
+    if (!gst_mpdparser_get_timeline_chunk (stream, seg_idx, &segment)) {
+      gst_date_time_unref (availability_start_time);
+      return NULL;
+    }
+    /* end of the segment relative to the period start */
+    end = segment.start;
+    if (base) {
+      end = end > base->presentationTimeOffset ?
+          end - base->presentationTimeOffset : 0;
+      if (base->timescale > 1)
+        end = gst_util_uint64_scale (end, GST_SECOND, base->timescale);
+      else
+        end *= GST_SECOND;
+    }
+    offset = end + segment.duration;
+  } else {
+    offset = (1 + seg_idx) * seg_duration;
+  }
   rv = gst_mpd_client_add_time_difference (availability_start_time,
       offset / GST_USECOND);
   gst_date_time_unref (availability_start_time);
@@ -4402,7 +5076,24 @@ gst_mpd_client_seek_to_time (GstMpdClient * client, GDateTime * time)
 
   ts = ts_microseconds * GST_USECOND;
   for (stream = client->active_streams; stream; stream = g_list_next (stream)) {
-    ret = ret & gst_mpd_client_stream_seek (client, stream->data, ts);
+    GstActiveStream *active_stream = stream->data;
+
+    if (active_stream->timeline) {
+      GstStreamPeriod *stream_period = gst_mpdparser_get_stream_period (client);
+      GstClockTime period_start = stream_period ? stream_period->start : 0;
+
+      if (active_stream->timeline_n_segments == 0) {
+        ret = FALSE;
+        continue;
+      }
+      GST_MPD_CLIENT_LOCK (client);
+      gst_mpd_client_set_segment_index (active_stream,
+          gst_mpdparser_get_timeline_index_at_period_time (active_stream,
+              ts > period_start ? ts - period_start : 0));
+      GST_MPD_CLIENT_UNLOCK (client);
+    } else {
+      ret = ret & gst_mpd_client_stream_seek (client, active_stream, ts);
+    }
   }
   return ret;
 }
@@ -36,6 +36,7 @@ typedef struct _GstActiveStream           GstActiveStream;
 typedef struct _GstStreamPeriod           GstStreamPeriod;
 typedef struct _GstMediaFragmentInfo      GstMediaFragmentInfo;
 typedef struct _GstMediaSegment           GstMediaSegment;
+typedef struct _GstMediaTimelineRun       GstMediaTimelineRun;
 typedef struct _GstMPDNode                GstMPDNode;
 typedef struct _GstPeriodNode             GstPeriodNode;
 typedef struct _GstRepresentationBaseType GstRepresentationBaseType;
@@ -124,7 +125,7 @@ struct _GstSNode
 {
   guint64 t;
   guint64 d;
-  guint r;
+  gint r;                          /* negative: repeat until the next S@t or the Period end */
 };
 
 struct _GstSegmentTimelineNode
@@ -418,6 +419,23 @@ struct _GstMediaSegment
   GstClockTime duration;                      /* segment duration */
 };
 
+/**
+ * GstMediaTimelineRun:
+ *
+ * A run of consecutive segments of the same duration, built from a
+ * SegmentTimeline S node when using a SegmentTemplate
+ */
+struct _GstMediaTimelineRun
+{
+  guint first_idx;                            /* index of the first segment of the run */
+  guint count;                                /* number of segments in the run */
+  guint number;                               /* number of the first segment */
+  guint64 start;                              /* first segment start time in timescale units */
+  guint64 d;                                  /* segment duration in timescale units */
+  GstClockTime start_time;                    /* first segment start time */
+  GstClockTime duration;                      /* segment duration */
+};
+
 struct _GstMediaFragmentInfo
 {
   gchar *uri;
@@ -455,6 +473,8 @@ struct _GstActiveStream
   GstSegmentTemplateNode *cur_seg_template;   /* active segment template */
   guint segment_idx;                          /* index of next sequence chunk */
   GPtrArray *segments;                        /* array of GstMediaSegment */
+  GArray *timeline;                           /* array of GstMediaTimelineRun, for SegmentTemplate with SegmentTimeline */
+  guint timeline_n_segments;                  /* number of segments described by timeline */
 };
 
 struct _GstMpdClient
@@ -468,6 +488,7 @@ struct _GstMpdClient
 
   guint update_failed_count;
   gchar *mpd_uri;                             /* manifest file URI */
+  gchar *mpd_checksum;                        /* checksum of the last parsed manifest file */
   GMutex lock;
 };
 
@@ -479,6 +500,7 @@ void gst_media_fragment_info_clear (GstMediaFragmentInfo * fragment);
 
 /* MPD file parsing */
 gboolean gst_mpd_parse (GstMpdClient *client, const gchar *data, gint size);
+gboolean gst_mpd_client_update (GstMpdClient *client, const gchar *data, gint size, gboolean * changed);
 
 /* Streaming management */
 gboolean gst_mpd_client_setup_media_presentation (GstMpdClient *client);
@@ -493,6 +515,7 @@ gboolean gst_mpd_client_get_next_header (GstMpdClient *client, gchar **uri, guin
 gboolean gst_mpd_client_get_next_header_index (GstMpdClient *client, gchar **uri, guint stream_idx, gint64 * range_start, gint64 * range_end);
 gboolean gst_mpd_client_is_live (GstMpdClient * client);
 gboolean gst_mpd_client_stream_seek (GstMpdClient * client, GstActiveStream * stream, GstClockTime ts);
+guint gst_mpd_client_get_segment_index_at_position (GstMpdClient * client, GstActiveStream * stream, GstClockTime ts);
 gboolean gst_mpd_client_seek_to_time (GstMpdClient * client, GDateTime * time);
 GstDateTime *gst_mpd_client_add_time_difference (GstDateTime * t1, gint64 usecs);
 gint gst_mpd_client_get_segment_index_at_time (GstMpdClient *client, GstActiveStream * stream, const GstDateTime *time);
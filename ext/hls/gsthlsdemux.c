@@ -71,6 +71,8 @@ enum
   PROP_FRAGMENTS_CACHE,
   PROP_BITRATE_LIMIT,
   PROP_CONNECTION_SPEED,
+  PROP_ABR_POLICY,
+  PROP_MAX_BUFFERING_BYTES,
   PROP_LAST
 };
 
@@ -80,6 +82,12 @@ static const float update_interval_factor[] = { 1, 0.5, 1.5, 3 };
 #define DEFAULT_FAILED_COUNT 3
 #define DEFAULT_BITRATE_LIMIT 0.8
 #define DEFAULT_CONNECTION_SPEED    0
+#define DEFAULT_ABR_POLICY GST_ABR_POLICY_HYBRID
+#define DEFAULT_MAX_BUFFERING_BYTES (16 * 1024 * 1024)
+
+#define AES_BLOCK_SIZE 16
+#define DECRYPT_CHUNK_SIZE (64 * 1024)
+#define MAX_CACHED_KEYS 16
 
 /* GObject */
 static void gst_hls_demux_set_property (GObject * object, guint prop_id,
@@ -87,6 +95,7 @@ static void gst_hls_demux_set_property (GObject * object, guint prop_id,
 static void gst_hls_demux_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec);
 static void gst_hls_demux_dispose (GObject * obj);
+static void gst_hls_demux_finalize (GObject * obj);
 
 /* GstElement */
 static GstStateChangeReturn
@@ -110,6 +119,8 @@ static gboolean gst_hls_demux_schedule (GstHLSDemux * demux);
 static gboolean gst_hls_demux_switch_playlist (GstHLSDemux * demux);
 static gboolean gst_hls_demux_get_next_fragment (GstHLSDemux * demux,
     gboolean caching);
+static gboolean gst_hls_demux_prefetch_fragments (GstHLSDemux * demux);
+static void gst_hls_demux_clear_queue (GstHLSDemux * demux);
 static gboolean gst_hls_demux_update_playlist (GstHLSDemux * demux,
     gboolean update);
 static void gst_hls_demux_reset (GstHLSDemux * demux, gboolean dispose);
@@ -164,9 +175,20 @@ gst_hls_demux_dispose (GObject * obj)
 
   gst_hls_demux_reset (demux, TRUE);
 
+  G_OBJECT_CLASS (parent_class)->dispose (obj);
+}
+
+static void
+gst_hls_demux_finalize (GObject * obj)
+{
+  GstHLSDemux *demux = GST_HLS_DEMUX (obj);
+
   g_queue_free (demux->queue);
+  g_mutex_clear (&demux->queue_lock);
+  g_hash_table_unref (demux->keys);
+  gst_abr_controller_clear (&demux->abr);
 
-  G_OBJECT_CLASS (parent_class)->dispose (obj);
+  G_OBJECT_CLASS (parent_class)->finalize (obj);
 }
 
 static void
@@ -181,10 +203,12 @@ gst_hls_demux_class_init (GstHLSDemuxClass * klass)
   gobject_class->set_property = gst_hls_demux_set_property;
   gobject_class->get_property = gst_hls_demux_get_property;
   gobject_class->dispose = gst_hls_demux_dispose;
+  gobject_class->finalize = gst_hls_demux_finalize;
 
   g_object_class_install_property (gobject_class, PROP_FRAGMENTS_CACHE,
       g_param_spec_uint ("fragments-cache", "Fragments cache",
-          "Number of fragments needed to be cached to start playing",
+          "Number of fragments needed to be cached to start playing, "
+          "and downloaded ahead while playing",
           2, G_MAXUINT, DEFAULT_FRAGMENTS_CACHE,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
@@ -201,6 +225,18 @@ gst_hls_demux_class_init (GstHLSDemuxClass * klass)
           0, G_MAXUINT / 1000, DEFAULT_CONNECTION_SPEED,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_ABR_POLICY,
+      g_param_spec_enum ("abr-policy", "ABR policy",
+          "Policy used to select the variant playlists",
+          GST_TYPE_ABR_POLICY, DEFAULT_ABR_POLICY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_MAX_BUFFERING_BYTES,
+      g_param_spec_uint ("max-buffering-bytes", "Max buffering bytes",
+          "Maximum size of the fragments downloaded ahead (0 = no limit)",
+          0, G_MAXUINT, DEFAULT_MAX_BUFFERING_BYTES,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   element_class->change_state = GST_DEBUG_FUNCPTR (gst_hls_demux_change_state);
 
   gst_element_class_add_pad_template (element_class,
@@ -233,6 +269,8 @@ gst_hls_demux_init (GstHLSDemux * demux)
 
   /* Downloader */
   demux->downloader = gst_uri_downloader_new ();
+  demux->keys = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+      (GDestroyNotify) gst_buffer_unref);
 
   demux->do_typefind = TRUE;
 
@@ -240,8 +278,13 @@ gst_hls_demux_init (GstHLSDemux * demux)
   demux->fragments_cache = DEFAULT_FRAGMENTS_CACHE;
   demux->bitrate_limit = DEFAULT_BITRATE_LIMIT;
   demux->connection_speed = DEFAULT_CONNECTION_SPEED;
+  demux->max_buffering_bytes = DEFAULT_MAX_BUFFERING_BYTES;
+
+  gst_abr_controller_init (&demux->abr);
+  gst_abr_controller_set_policy (&demux->abr, DEFAULT_ABR_POLICY);
 
   demux->queue = g_queue_new ();
+  g_mutex_init (&demux->queue_lock);
 
   /* Updates task */
   g_rec_mutex_init (&demux->updates_lock);
@@ -276,6 +319,12 @@ gst_hls_demux_set_property (GObject * object, guint prop_id,
     case PROP_CONNECTION_SPEED:
       demux->connection_speed = g_value_get_uint (value) * 1000;
       break;
+    case PROP_ABR_POLICY:
+      gst_abr_controller_set_policy (&demux->abr, g_value_get_enum (value));
+      break;
+    case PROP_MAX_BUFFERING_BYTES:
+      demux->max_buffering_bytes = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -298,6 +347,12 @@ gst_hls_demux_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_CONNECTION_SPEED:
       g_value_set_uint (value, demux->connection_speed / 1000);
       break;
+    case PROP_ABR_POLICY:
+      g_value_set_enum (value, gst_abr_controller_get_policy (&demux->abr));
+      break;
+    case PROP_MAX_BUFFERING_BYTES:
+      g_value_set_uint (value, demux->max_buffering_bytes);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -349,10 +404,8 @@ gst_hls_demux_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
       GstSeekFlags flags;
       GstSeekType start_type, stop_type;
       gint64 start, stop;
-      GList *walk;
-      GstClockTime position, current_pos, target_pos;
+      GstClockTime position;
       gint current_sequence;
-      GstM3U8MediaFile *file;
 
       GST_INFO_OBJECT (demux, "Received GST_EVENT_SEEK");
 
@@ -371,24 +424,8 @@ gst_hls_demux_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
           " stop: %" GST_TIME_FORMAT, rate, GST_TIME_ARGS (start),
           GST_TIME_ARGS (stop));
 
-      GST_M3U8_CLIENT_LOCK (demux->client);
-      file = GST_M3U8_MEDIA_FILE (demux->client->current->files->data);
-      current_sequence = file->sequence;
-      current_pos = 0;
-      target_pos = (GstClockTime) start;
-      for (walk = demux->client->current->files; walk; walk = walk->next) {
-        file = walk->data;
-
-        current_sequence = file->sequence;
-        if (current_pos <= target_pos
-            && target_pos < current_pos + file->duration) {
-          break;
-        }
-        current_pos += file->duration;
-      }
-      GST_M3U8_CLIENT_UNLOCK (demux->client);
-
-      if (walk == NULL) {
+      if (!gst_m3u8_client_get_sequence_at_position (demux->client,
+              (GstClockTime) start, &current_sequence)) {
         GST_WARNING_OBJECT (demux, "Could not find seeked fragment");
         return FALSE;
       }
@@ -413,11 +450,7 @@ gst_hls_demux_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
       g_rec_mutex_lock (&demux->stream_lock);
 
       demux->need_cache = TRUE;
-      while (!g_queue_is_empty (demux->queue)) {
-        GstFragment *fragment = g_queue_pop_head (demux->queue);
-        g_object_unref (fragment);
-      }
-      g_queue_clear (demux->queue);
+      gst_hls_demux_clear_queue (demux);
 
       GST_M3U8_CLIENT_LOCK (demux->client);
       GST_DEBUG_OBJECT (demux, "seeking to sequence %d", current_sequence);
@@ -718,14 +751,26 @@ gst_hls_demux_stream_loop (GstHLSDemux * demux)
     GST_INFO_OBJECT (demux, "First fragments cached successfully");
   }
 
-  if (g_queue_is_empty (demux->queue)) {
+  g_mutex_lock (&demux->queue_lock);
+  fragment = g_queue_pop_head (demux->queue);
+  if (fragment)
+    demux->queued_bytes -= fragment->size;
+  g_mutex_unlock (&demux->queue_lock);
+
+  if (fragment == NULL) {
     if (demux->end_of_playlist)
       goto end_of_playlist;
 
     goto pause_task;
   }
 
-  fragment = g_queue_pop_head (demux->queue);
+  /* wake up the updates thread so it downloads the next fragment while we
+   * push this one */
+  g_mutex_lock (&demux->updates_timed_lock);
+  demux->prefetch_wakeup = TRUE;
+  GST_TASK_SIGNAL (demux->updates_task);
+  g_mutex_unlock (&demux->updates_timed_lock);
+
   buf = gst_fragment_get_buffer (fragment);
 
   /* Figure out if we need to create/switch pads */
@@ -836,11 +881,12 @@ gst_hls_demux_reset (GstHLSDemux * demux, gboolean dispose)
     demux->client = gst_m3u8_client_new ("");
   }
 
-  while (!g_queue_is_empty (demux->queue)) {
-    GstFragment *fragment = g_queue_pop_head (demux->queue);
-    g_object_unref (fragment);
-  }
-  g_queue_clear (demux->queue);
+  gst_hls_demux_clear_queue (demux);
+  demux->prefetch_wakeup = FALSE;
+
+  g_hash_table_remove_all (demux->keys);
+
+  gst_abr_controller_reset (&demux->abr);
 
   demux->position_shift = 0;
   demux->need_segment = TRUE;
@@ -859,50 +905,148 @@ gst_hls_demux_set_location (GstHLSDemux * demux, const gchar * uri)
   return TRUE;
 }
 
+static void
+gst_hls_demux_clear_queue (GstHLSDemux * demux)
+{
+  g_mutex_lock (&demux->queue_lock);
+  while (!g_queue_is_empty (demux->queue)) {
+    GstFragment *fragment = g_queue_pop_head (demux->queue);
+    g_object_unref (fragment);
+  }
+  g_queue_clear (demux->queue);
+  demux->queued_bytes = 0;
+  g_mutex_unlock (&demux->queue_lock);
+}
+
+/* Whether there is room in the queue for one more fragment. The queue
+ * holds up to fragments-cache fragments, as long as the next one fits in
+ * max-buffering-bytes, and at least one */
+static gboolean
+gst_hls_demux_need_prefetch (GstHLSDemux * demux)
+{
+  guint64 next_size = 0;
+  guint length;
+  gboolean ret;
+
+  if (demux->end_of_playlist)
+    return FALSE;
+
+  /* live playlists get new fragments with the next update */
+  if (gst_m3u8_client_is_live (demux->client) &&
+      !gst_m3u8_client_has_next_fragment (demux->client))
+    return FALSE;
+
+  /* estimate the size of the next fragment from the variant bandwidth */
+  if (demux->max_buffering_bytes > 0) {
+    GST_M3U8_CLIENT_LOCK (demux->client);
+    if (demux->client->current && demux->client->current->bandwidth > 0)
+      next_size =
+          gst_util_uint64_scale (demux->client->current->bandwidth,
+          demux->client->current->targetduration, 8 * GST_SECOND);
+    GST_M3U8_CLIENT_UNLOCK (demux->client);
+  }
+
+  g_mutex_lock (&demux->queue_lock);
+  length = g_queue_get_length (demux->queue);
+  ret = length == 0 || (length < demux->fragments_cache
+      && (demux->max_buffering_bytes == 0
+          || demux->queued_bytes + next_size <= demux->max_buffering_bytes));
+  GST_LOG_OBJECT (demux, "%u fragments (%" G_GUINT64_FORMAT " bytes) queued, "
+      "%s", length, demux->queued_bytes, ret ? "prefetching" : "full");
+  g_mutex_unlock (&demux->queue_lock);
+
+  return ret;
+}
+
+/* Downloads fragments until the queue is full. Returns FALSE on fatal
+ * errors */
+static gboolean
+gst_hls_demux_prefetch_fragments (GstHLSDemux * demux)
+{
+  while (!demux->cancelled && gst_hls_demux_need_prefetch (demux)) {
+    GST_DEBUG_OBJECT (demux, "get next fragment");
+    if (!gst_hls_demux_get_next_fragment (demux, FALSE)) {
+      if (demux->cancelled || demux->end_of_playlist)
+        return TRUE;
+
+      demux->client->update_failed_count++;
+      if (demux->client->update_failed_count < DEFAULT_FAILED_COUNT) {
+        GST_WARNING_OBJECT (demux, "Could not fetch the next fragment");
+        return TRUE;
+      }
+      GST_ELEMENT_ERROR (demux, RESOURCE, NOT_FOUND,
+          ("Could not fetch the next fragment"), (NULL));
+      return FALSE;
+    }
+
+    demux->client->update_failed_count = 0;
+
+    if (demux->cancelled)
+      return TRUE;
+
+    /* try to switch to another bitrate if needed */
+    gst_hls_demux_switch_playlist (demux);
+  }
+
+  return TRUE;
+}
+
 void
 gst_hls_demux_updates_loop (GstHLSDemux * demux)
 {
   /* Loop for the updates. It's started when the first fragments are cached and
-   * schedules the next update of the playlist (for lives sources) and the next
-   * update of fragments. When a new fragment is downloaded, it compares the
-   * download time with the next scheduled update to check if we can or should
-   * switch to a different bitrate */
+   * schedules the next update of the playlist (for lives sources). It keeps
+   * up to fragments-cache fragments downloaded ahead, topping up the queue
+   * after every update and every time the streaming thread takes a fragment
+   * from it. When a new fragment is downloaded, it uses its download rate to
+   * check if we can or should switch to a different bitrate. The timed lock
+   * is only held while waiting, the downloads happen without it so the
+   * streaming thread is never blocked on the network */
 
-  /* block until the next scheduled update or the signal to quit this thread */
   g_mutex_lock (&demux->updates_timed_lock);
   GST_DEBUG_OBJECT (demux, "Started updates task");
+
+  /* schedule the first update */
+  gst_hls_demux_schedule (demux);
+
   while (TRUE) {
+    gboolean update = FALSE, ok = TRUE;
+
     if (demux->cancelled)
       goto quit;
 
-    /* schedule the next update */
-    gst_hls_demux_schedule (demux);
-
-    /*  block until the next scheduled update or the signal to quit this thread */
-    GST_DEBUG_OBJECT (demux, "Waiting");
-    if (g_cond_timed_wait (GST_TASK_GET_COND (demux->updates_task),
-            &demux->updates_timed_lock, &demux->next_update)) {
-      GST_DEBUG_OBJECT (demux, "Unlocked");
-      goto quit;
+    /* block until the next scheduled update, the signal to quit this thread
+     * or until a fragment was consumed */
+    if (!demux->prefetch_wakeup) {
+      GST_DEBUG_OBJECT (demux, "Waiting");
+      update = !g_cond_timed_wait (GST_TASK_GET_COND (demux->updates_task),
+          &demux->updates_timed_lock, &demux->next_update);
+      if (demux->cancelled) {
+        GST_DEBUG_OBJECT (demux, "Unlocked");
+        goto quit;
+      }
     }
+    demux->prefetch_wakeup = FALSE;
     GST_DEBUG_OBJECT (demux, "Continue");
 
-    if (demux->cancelled)
-      goto quit;
+    /* after a failure, only retry on the next scheduled update */
+    if (!update && demux->client->update_failed_count > 0)
+      continue;
+
+    g_mutex_unlock (&demux->updates_timed_lock);
 
     /* update the playlist for live sources */
-    if (gst_m3u8_client_is_live (demux->client)) {
+    if (update && gst_m3u8_client_is_live (demux->client)) {
       if (!gst_hls_demux_update_playlist (demux, TRUE)) {
-        if (demux->cancelled)
-          goto quit;
-        demux->client->update_failed_count++;
-        if (demux->client->update_failed_count < DEFAULT_FAILED_COUNT) {
-          GST_WARNING_OBJECT (demux, "Could not update the playlist");
-          continue;
-        } else {
-          GST_ELEMENT_ERROR (demux, RESOURCE, NOT_FOUND,
-              ("Could not update the playlist"), (NULL));
-          goto error;
+        if (!demux->cancelled) {
+          demux->client->update_failed_count++;
+          if (demux->client->update_failed_count < DEFAULT_FAILED_COUNT) {
+            GST_WARNING_OBJECT (demux, "Could not update the playlist");
+          } else {
+            GST_ELEMENT_ERROR (demux, RESOURCE, NOT_FOUND,
+                ("Could not update the playlist"), (NULL));
+            ok = FALSE;
+          }
         }
       }
     }
@@ -910,44 +1054,23 @@ gst_hls_demux_updates_loop (GstHLSDemux * demux)
     /* if it's a live source and the playlist couldn't be updated, there aren't
      * more fragments in the playlist, so we just wait for the next schedulled
      * update */
-    if (gst_m3u8_client_is_live (demux->client) &&
+    if (ok && gst_m3u8_client_is_live (demux->client) &&
         demux->client->update_failed_count > 0) {
       GST_WARNING_OBJECT (demux,
           "The playlist hasn't been updated, failed count is %d",
           demux->client->update_failed_count);
-      continue;
+    } else if (ok) {
+      ok = gst_hls_demux_prefetch_fragments (demux);
     }
 
-    if (demux->cancelled)
-      goto quit;
-
-    /* fetch the next fragment */
-    if (g_queue_is_empty (demux->queue)) {
-      GST_DEBUG_OBJECT (demux, "queue empty, get next fragment");
-      if (!gst_hls_demux_get_next_fragment (demux, FALSE)) {
-        if (demux->cancelled) {
-          goto quit;
-        } else if (!demux->end_of_playlist) {
-          demux->client->update_failed_count++;
-          if (demux->client->update_failed_count < DEFAULT_FAILED_COUNT) {
-            GST_WARNING_OBJECT (demux, "Could not fetch the next fragment");
-            continue;
-          } else {
-            GST_ELEMENT_ERROR (demux, RESOURCE, NOT_FOUND,
-                ("Could not fetch the next fragment"), (NULL));
-            goto error;
-          }
-        }
-      } else {
-        demux->client->update_failed_count = 0;
+    g_mutex_lock (&demux->updates_timed_lock);
 
-        if (demux->cancelled)
-          goto quit;
+    if (!ok)
+      goto error;
 
-        /* try to switch to another bitrate if needed */
-        gst_hls_demux_switch_playlist (demux);
-      }
-    }
+    /* schedule the next update */
+    if (update)
+      gst_hls_demux_schedule (demux);
   }
 
 quit:
@@ -1090,14 +1213,16 @@ gst_hls_demux_update_playlist (GstHLSDemux * demux, gboolean update)
    * three fragments before the end of the list */
   if (updated && update == FALSE && demux->client->current &&
       gst_m3u8_client_is_live (demux->client)) {
+    GPtrArray *files;
     guint last_sequence;
 
     GST_M3U8_CLIENT_LOCK (demux->client);
-    last_sequence =
-        GST_M3U8_MEDIA_FILE (g_list_last (demux->client->current->
-            files)->data)->sequence;
+    files = demux->client->current->files;
+    last_sequence = files->len > 0 ?
+        GST_M3U8_MEDIA_FILE (g_ptr_array_index (files,
+            files->len - 1))->sequence : 0;
 
-    if (demux->client->sequence >= last_sequence - 3) {
+    if (files->len > 0 && demux->client->sequence >= last_sequence - 3) {
       GST_DEBUG_OBJECT (demux, "Sequence is beyond playlist. Moving back to %d",
           last_sequence - 3);
       demux->need_segment = TRUE;
@@ -1210,91 +1335,256 @@ gst_hls_demux_schedule (GstHLSDemux * demux)
 static gboolean
 gst_hls_demux_switch_playlist (GstHLSDemux * demux)
 {
-  GTimeVal now;
-  GstClockTime diff;
-  gsize size;
-  gint bitrate;
-  GstFragment *fragment;
-  GstBuffer *buffer;
+  GstClockTime buffer_level = 0, target_duration;
+  guint64 *bitrates;
+  guint n_bitrates, i;
+  gint current = 0, selected;
+  guint64 old_bitrate, new_bitrate;
+  GList *iter;
+
+  g_mutex_lock (&demux->queue_lock);
+  for (iter = demux->queue->head; iter; iter = g_list_next (iter)) {
+    GstBuffer *buf = gst_fragment_get_buffer (iter->data);
+
+    if (buf) {
+      if (GST_BUFFER_DURATION_IS_VALID (buf))
+        buffer_level += GST_BUFFER_DURATION (buf);
+      gst_buffer_unref (buf);
+    }
+  }
+  g_mutex_unlock (&demux->queue_lock);
 
   GST_M3U8_CLIENT_LOCK (demux->client);
-  fragment = g_queue_peek_tail (demux->queue);
-  if (!demux->client->main->lists || !fragment) {
+  if (!demux->client->main->lists) {
     GST_M3U8_CLIENT_UNLOCK (demux->client);
     return TRUE;
   }
+
+  /* the variants are sorted by ascending bandwidth */
+  n_bitrates = g_list_length (demux->client->main->lists);
+  bitrates = g_new (guint64, n_bitrates);
+  for (iter = demux->client->main->lists, i = 0; iter;
+      iter = g_list_next (iter), i++) {
+    bitrates[i] = GST_M3U8 (iter->data)->bandwidth;
+    if (iter == demux->client->main->current_variant)
+      current = i;
+  }
   GST_M3U8_CLIENT_UNLOCK (demux->client);
 
-  /* compare the time when the fragment was downloaded with the time when it was
-   * scheduled */
-  g_get_current_time (&now);
-  diff = (GST_TIMEVAL_TO_TIME (now) - GST_TIMEVAL_TO_TIME (demux->next_update));
-  buffer = gst_fragment_get_buffer (fragment);
-  size = gst_buffer_get_size (buffer);
-  bitrate = (size * 8) / ((double) diff / GST_SECOND);
+  target_duration = gst_m3u8_client_get_target_duration (demux->client);
+  gst_abr_controller_set_bandwidth_usage (&demux->abr, demux->bitrate_limit);
+  gst_abr_controller_set_max_bitrate (&demux->abr, demux->connection_speed);
+  gst_abr_controller_set_buffer_target (&demux->abr,
+      demux->fragments_cache * target_duration);
 
-  GST_DEBUG ("Downloaded %d bytes in %" GST_TIME_FORMAT ". Bitrate is : %d",
-      (guint) size, GST_TIME_ARGS (diff), bitrate);
+  selected = gst_abr_controller_select (&demux->abr, bitrates, n_bitrates,
+      current, 0, buffer_level, target_duration);
+  old_bitrate = bitrates[current];
+  new_bitrate = bitrates[selected];
+  g_free (bitrates);
 
-  gst_buffer_unref (buffer);
-  return gst_hls_demux_change_playlist (demux, bitrate * demux->bitrate_limit);
+  if (new_bitrate == old_bitrate)
+    return TRUE;
+
+  if (!gst_hls_demux_change_playlist (demux, new_bitrate))
+    return FALSE;
+
+  gst_element_post_message (GST_ELEMENT_CAST (demux),
+      gst_abr_controller_new_decision_message (&demux->abr,
+          GST_OBJECT_CAST (demux), NULL));
+
+  return TRUE;
 }
 
-static GstFragment *
-gst_hls_demux_decrypt_fragment (GstHLSDemux * demux,
-    GstFragment * encrypted_fragment, const gchar * key, const guint8 * iv)
+typedef struct
 {
-  GstFragment *key_fragment, *ret = NULL;
-  GstBuffer *key_buffer, *encrypted_buffer, *decrypted_buffer;
-  GstMapInfo key_info, encrypted_info, decrypted_info;
   gnutls_cipher_hd_t aes_ctx;
-  gnutls_datum_t key_d, iv_d;
-  gsize unpadded_size;
+  GstAdapter *adapter;          /* encrypted data not decrypted yet */
+  GstBuffer *decrypted;         /* decrypted data */
+} GstHLSDemuxDecryptor;
+
+/* Returns the AES key at @uri, only downloading it the first time */
+static GstBuffer *
+gst_hls_demux_get_key (GstHLSDemux * demux, const gchar * uri)
+{
+  GstFragment *key_fragment;
+  GstBuffer *key_buffer;
+
+  key_buffer = g_hash_table_lookup (demux->keys, uri);
+  if (key_buffer) {
+    GST_LOG_OBJECT (demux, "Using cached key %s", uri);
+    return gst_buffer_ref (key_buffer);
+  }
 
-  GST_INFO_OBJECT (demux, "Fetching key %s", key);
-  key_fragment = gst_uri_downloader_fetch_uri (demux->downloader, key);
+  GST_INFO_OBJECT (demux, "Fetching key %s", uri);
+  key_fragment = gst_uri_downloader_fetch_uri (demux->downloader, uri);
   if (key_fragment == NULL)
-    goto key_failed;
+    return NULL;
 
   key_buffer = gst_fragment_get_buffer (key_fragment);
-  encrypted_buffer = gst_fragment_get_buffer (encrypted_fragment);
-  decrypted_buffer =
-      gst_buffer_new_allocate (NULL, gst_buffer_get_size (encrypted_buffer),
-      NULL);
+  g_object_unref (key_fragment);
+  if (key_buffer == NULL)
+    return NULL;
 
-  gst_buffer_map (key_buffer, &key_info, GST_MAP_READ);
-  gst_buffer_map (encrypted_buffer, &encrypted_info, GST_MAP_READ);
-  gst_buffer_map (decrypted_buffer, &decrypted_info, GST_MAP_WRITE);
+  if (gst_buffer_get_size (key_buffer) < AES_BLOCK_SIZE) {
+    GST_WARNING_OBJECT (demux, "Key %s is too short", uri);
+    gst_buffer_unref (key_buffer);
+    return NULL;
+  }
+
+  /* keys are only rotated in live streams, where the old ones are never
+   * needed again */
+  if (g_hash_table_size (demux->keys) >= MAX_CACHED_KEYS)
+    g_hash_table_remove_all (demux->keys);
+  g_hash_table_insert (demux->keys, g_strdup (uri),
+      gst_buffer_ref (key_buffer));
+
+  return key_buffer;
+}
+
+/* Decrypts @buffer in place and appends it to the decrypted data */
+static gboolean
+gst_hls_demux_decryptor_decrypt (GstHLSDemuxDecryptor * decryptor,
+    GstBuffer * buffer)
+{
+  GstMapInfo info;
+  gint ret;
+
+  buffer = gst_buffer_make_writable (buffer);
+  if (!gst_buffer_map (buffer, &info, GST_MAP_READWRITE)) {
+    gst_buffer_unref (buffer);
+    return FALSE;
+  }
+  ret = gnutls_cipher_decrypt (decryptor->aes_ctx, info.data, info.size);
+  gst_buffer_unmap (buffer, &info);
+
+  if (ret < 0) {
+    GST_WARNING ("Failed to decrypt: %s", gnutls_strerror (ret));
+    gst_buffer_unref (buffer);
+    return FALSE;
+  }
+
+  if (decryptor->decrypted)
+    decryptor->decrypted = gst_buffer_append (decryptor->decrypted, buffer);
+  else
+    decryptor->decrypted = buffer;
 
+  return TRUE;
+}
+
+static GstFlowReturn
+gst_hls_demux_decrypt_chunk (GstUriDownloader * downloader, GstBuffer * buffer,
+    gpointer user_data)
+{
+  GstHLSDemuxDecryptor *decryptor = user_data;
+  gsize available;
+
+  gst_adapter_push (decryptor->adapter, buffer);
+
+  /* decrypt all the complete blocks but the last one, it holds the padding
+   * and can only be handled once the download finished. Wait for a few
+   * network chunks so the decrypted data isn't split in tiny memories */
+  available = gst_adapter_available (decryptor->adapter);
+  if (available <= DECRYPT_CHUNK_SIZE)
+    return GST_FLOW_OK;
+  available = (available - 1) / AES_BLOCK_SIZE * AES_BLOCK_SIZE;
+
+  if (!gst_hls_demux_decryptor_decrypt (decryptor,
+          gst_adapter_take_buffer (decryptor->adapter, available)))
+    return GST_FLOW_ERROR;
+
+  return GST_FLOW_OK;
+}
+
+/* Decrypts the remaining blocks and removes the PKCS7 padding */
+static gboolean
+gst_hls_demux_decryptor_finish (GstHLSDemuxDecryptor * decryptor)
+{
+  gsize available;
+  guint8 padding;
+
+  available = gst_adapter_available (decryptor->adapter);
+  if (available == 0 || available % AES_BLOCK_SIZE != 0) {
+    GST_WARNING ("Encrypted data is not a multiple of the block size");
+    return FALSE;
+  }
+
+  if (!gst_hls_demux_decryptor_decrypt (decryptor,
+          gst_adapter_take_buffer (decryptor->adapter, available)))
+    return FALSE;
+
+  gst_buffer_extract (decryptor->decrypted,
+      gst_buffer_get_size (decryptor->decrypted) - 1, &padding, 1);
+  if (padding == 0 || padding > AES_BLOCK_SIZE) {
+    GST_WARNING ("Invalid padding %u", padding);
+    return FALSE;
+  }
+
+  gst_buffer_resize (decryptor->decrypted, 0,
+      gst_buffer_get_size (decryptor->decrypted) - padding);
+
+  return TRUE;
+}
+
+/* Downloads the fragment at @uri and decrypts it in place as it arrives,
+ * instead of decrypting a copy of the whole fragment once downloaded. The
+ * decrypted chunks are appended to one buffer, which still copies the
+ * data decrypted so far whenever it merges its memories */
+static GstFragment *
+gst_hls_demux_fetch_encrypted_fragment (GstHLSDemux * demux,
+    const gchar * uri, const gchar * key, const guint8 * iv)
+{
+  GstHLSDemuxDecryptor decryptor = { NULL, };
+  GstFragment *download, *ret = NULL;
+  GstBuffer *key_buffer;
+  GstMapInfo key_info;
+  gnutls_datum_t key_d, iv_d;
+  gint res;
+
+  key_buffer = gst_hls_demux_get_key (demux, key);
+  if (key_buffer == NULL) {
+    GST_WARNING_OBJECT (demux, "Failed to get the key %s", key);
+    return NULL;
+  }
+
+  gst_buffer_map (key_buffer, &key_info, GST_MAP_READ);
   key_d.data = key_info.data;
-  key_d.size = 16;
+  key_d.size = AES_BLOCK_SIZE;
   iv_d.data = (unsigned char *) iv;
-  iv_d.size = 16;
-  gnutls_cipher_init (&aes_ctx, gnutls_cipher_get_id ("AES-128-CBC"), &key_d,
-      &iv_d);
-  gnutls_cipher_decrypt2 (aes_ctx, encrypted_info.data, encrypted_info.size,
-      decrypted_info.data, decrypted_info.size);
-  gnutls_cipher_deinit (aes_ctx);
-
-  /* Handle pkcs7 unpadding here */
-  unpadded_size =
-      decrypted_info.size - decrypted_info.data[decrypted_info.size - 1];
-
-  gst_buffer_unmap (decrypted_buffer, &decrypted_info);
-  gst_buffer_unmap (encrypted_buffer, &encrypted_info);
+  iv_d.size = AES_BLOCK_SIZE;
+  res = gnutls_cipher_init (&decryptor.aes_ctx,
+      gnutls_cipher_get_id ("AES-128-CBC"), &key_d, &iv_d);
   gst_buffer_unmap (key_buffer, &key_info);
+  gst_buffer_unref (key_buffer);
+
+  if (res < 0) {
+    GST_WARNING_OBJECT (demux, "Failed to initialize the cipher: %s",
+        gnutls_strerror (res));
+    return NULL;
+  }
 
-  gst_buffer_resize (decrypted_buffer, 0, unpadded_size);
+  decryptor.adapter = gst_adapter_new ();
+  download = gst_uri_downloader_fetch_uri_streaming (demux->downloader, uri,
+      0, -1, gst_hls_demux_decrypt_chunk, &decryptor);
+
+  if (download && gst_hls_demux_decryptor_finish (&decryptor)) {
+    ret = gst_fragment_new ();
+    gst_fragment_add_buffer (ret, decryptor.decrypted);
+    decryptor.decrypted = NULL;
+    ret->completed = TRUE;
+    /* keep the download statistics for the bitrate adaptation */
+    ret->download_start_time = download->download_start_time;
+    ret->download_stop_time = download->download_stop_time;
+    ret->size = download->size;
+  }
 
-  gst_buffer_unref (key_buffer);
-  gst_buffer_unref (encrypted_buffer);
-  g_object_unref (key_fragment);
+  if (download)
+    g_object_unref (download);
+  if (decryptor.decrypted)
+    gst_buffer_unref (decryptor.decrypted);
+  g_object_unref (decryptor.adapter);
+  gnutls_cipher_deinit (decryptor.aes_ctx);
 
-  ret = gst_fragment_new ();
-  gst_fragment_add_buffer (ret, decrypted_buffer);
-  ret->completed = TRUE;
-key_failed:
-  g_object_unref (encrypted_fragment);
   return ret;
 }
 
@@ -1309,9 +1599,11 @@ gst_hls_demux_get_next_fragment (GstHLSDemux * demux, gboolean caching)
   gboolean discont;
   const gchar *key = NULL;
   const guint8 *iv = NULL;
+  gboolean unsupported_key = FALSE;
 
   if (!gst_m3u8_client_get_next_fragment (demux->client, &discont,
-          &next_fragment_uri, &duration, &timestamp, &key, &iv)) {
+          &next_fragment_uri, &duration, &timestamp, &key, &iv,
+          &unsupported_key)) {
     GST_INFO_OBJECT (demux, "This playlist doesn't contain more fragments");
     demux->end_of_playlist = TRUE;
     gst_task_start (demux->stream_task);
@@ -1320,11 +1612,18 @@ gst_hls_demux_get_next_fragment (GstHLSDemux * demux, gboolean caching)
 
   GST_INFO_OBJECT (demux, "Fetching next fragment %s", next_fragment_uri);
 
-  download = gst_uri_downloader_fetch_uri (demux->downloader,
-      next_fragment_uri);
+  if (unsupported_key) {
+    GST_WARNING_OBJECT (demux, "Can't decrypt fragment %s",
+        next_fragment_uri);
+    goto error;
+  }
 
-  if (download && key)
-    download = gst_hls_demux_decrypt_fragment (demux, download, key, iv);
+  if (key)
+    download = gst_hls_demux_fetch_encrypted_fragment (demux,
+        next_fragment_uri, key, iv);
+  else
+    download = gst_uri_downloader_fetch_uri (demux->downloader,
+        next_fragment_uri);
 
   if (download == NULL)
     goto error;
@@ -1358,12 +1657,24 @@ gst_hls_demux_get_next_fragment (GstHLSDemux * demux, gboolean caching)
   /* The buffer ref is still kept inside the fragment download */
   gst_buffer_unref (buf);
 
+  /* feed the throughput estimation before the streaming thread can take
+   * the fragment from the queue */
+  if (download->download_stop_time > download->download_start_time) {
+    GstClockTime diff;
+
+    diff = download->download_stop_time - download->download_start_time;
+    GST_DEBUG_OBJECT (demux, "Downloaded %" G_GUINT64_FORMAT " bytes in %"
+        GST_TIME_FORMAT, download->size, GST_TIME_ARGS (diff));
+    gst_abr_controller_add_sample (&demux->abr, download->size, diff);
+  }
+
   GST_DEBUG_OBJECT (demux, "Pushing fragment in queue");
+  g_mutex_lock (&demux->queue_lock);
   g_queue_push_tail (demux->queue, download);
-  if (!caching) {
-    GST_TASK_SIGNAL (demux->updates_task);
+  demux->queued_bytes += download->size;
+  g_mutex_unlock (&demux->queue_lock);
+  if (!caching)
     gst_task_start (demux->stream_task);
-  }
   return TRUE;
 
 error:
@@ -29,6 +29,7 @@
 #include "m3u8.h"
 #include "gstfragmented.h"
 #include <gst/uridownloader/gsturidownloader.h>
+#include <gst/uridownloader/gstabrcontroller.h>
 
 G_BEGIN_DECLS
 #define GST_TYPE_HLS_DEMUX \
@@ -64,17 +65,24 @@ struct _GstHLSDemux
   GstBuffer *playlist;
   GstCaps *input_caps;
   GstUriDownloader *downloader;
+  GHashTable *keys;             /* AES keys already fetched, by URI */
   GstM3U8Client *client;        /* M3U8 client */
   GQueue *queue;                /* Queue storing the fetched fragments */
+  GMutex queue_lock;            /* Protects the queue and queued_bytes */
+  guint64 queued_bytes;         /* Size of the fragments in the queue */
   gboolean need_cache;          /* Wheter we need to cache some fragments before starting to push data */
   gboolean end_of_playlist;
   gboolean do_typefind;         /* Whether we need to typefind the next buffer */
 
   /* Properties */
-  guint fragments_cache;        /* number of fragments needed to be cached to start playing */
+  guint fragments_cache;        /* number of fragments needed to be cached to start playing, and downloaded ahead afterwards */
+  guint max_buffering_bytes;    /* maximum size of the fragments downloaded ahead (0 = no limit) */
   gfloat bitrate_limit;         /* limit of the available bitrate to use */
   guint connection_speed;       /* Network connection speed in kbps (0 = unknown) */
 
+  /* Bitrate adaptation */
+  GstAbrController abr;
+
   /* Streaming task */
   GstTask *stream_task;
   GRecMutex stream_lock;
@@ -85,6 +93,7 @@ struct _GstHLSDemux
   GRecMutex updates_lock;
   GMutex updates_timed_lock;
   GTimeVal next_update;         /* Time of the next update */
+  gboolean prefetch_wakeup;     /* the streaming thread consumed a fragment */
   gboolean cancelled;
 
   /* Position in the stream */
@@ -38,6 +38,7 @@ static gboolean gst_m3u8_update (GstM3U8 * m3u8, gchar * data,
 static GstM3U8MediaFile *gst_m3u8_media_file_new (gchar * uri,
     gchar * title, GstClockTime duration, guint sequence);
 static void gst_m3u8_media_file_free (GstM3U8MediaFile * self);
+static void gst_m3u8_free_files (GPtrArray * files);
 gchar *uri_join (const gchar * uri, const gchar * path);
 
 static GstM3U8 *
@@ -70,8 +71,8 @@ gst_m3u8_free (GstM3U8 * self)
   g_free (self->codecs);
   g_free (self->key);
 
-  g_list_foreach (self->files, (GFunc) gst_m3u8_media_file_free, NULL);
-  g_list_free (self->files);
+  if (self->files)
+    gst_m3u8_free_files (self->files);
 
   g_free (self->last_data);
   g_list_foreach (self->lists, (GFunc) gst_m3u8_free, NULL);
@@ -102,10 +103,54 @@ gst_m3u8_media_file_free (GstM3U8MediaFile * self)
 
   g_free (self->title);
   g_free (self->uri);
+  g_free (self->relative_uri);
   g_free (self->key);
   g_free (self);
 }
 
+/* the arrays might contain NULL entries for the files moved to a newer
+ * array */
+static void
+gst_m3u8_free_files (GPtrArray * files)
+{
+  guint i;
+
+  for (i = 0; i < files->len; i++) {
+    GstM3U8MediaFile *file = g_ptr_array_index (files, i);
+
+    if (file)
+      gst_m3u8_media_file_free (file);
+  }
+  g_ptr_array_free (files, TRUE);
+}
+
+/* Returns the index of the file with @sequence in @files, whose first file
+ * has @first_sequence, or -1. The sequence numbers of the files are
+ * consecutive */
+static gint
+gst_m3u8_get_file_index (GPtrArray * files, guint first_sequence,
+    guint sequence)
+{
+  if (files == NULL || sequence < first_sequence
+      || sequence - first_sequence >= files->len
+      || g_ptr_array_index (files, sequence - first_sequence) == NULL)
+    return -1;
+
+  return sequence - first_sequence;
+}
+
+static void
+gst_m3u8_add_file (GstM3U8 * self, GstM3U8MediaFile * file)
+{
+  if (self->files->len > 0) {
+    GstM3U8MediaFile *prev =
+        g_ptr_array_index (self->files, self->files->len - 1);
+
+    file->start = prev->start + prev->duration;
+  }
+  g_ptr_array_add (self->files, file);
+}
+
 static gboolean
 int_from_string (gchar * ptr, gchar ** endptr, gint * val)
 {
@@ -166,6 +211,28 @@ double_from_string (gchar * ptr, gchar ** endptr, gdouble * val)
   return end != ptr;
 }
 
+static gboolean
+iv_from_string (const gchar * str, guint8 * iv)
+{
+  gint i, high, low;
+
+  if (g_str_has_prefix (str, "0x") || g_str_has_prefix (str, "0X"))
+    str += 2;
+
+  if (strlen (str) != 32)
+    return FALSE;
+
+  for (i = 0; i < 16; i++) {
+    high = g_ascii_xdigit_value (str[2 * i]);
+    low = g_ascii_xdigit_value (str[2 * i + 1]);
+    if (high < 0 || low < 0)
+      return FALSE;
+    iv[i] = (high << 4) | low;
+  }
+
+  return TRUE;
+}
+
 static gboolean
 parse_attributes (gchar ** ptr, gchar ** a, gchar ** v)
 {
@@ -223,9 +290,13 @@ gst_m3u8_update (GstM3U8 * self, gchar * data, gboolean * updated)
 {
   gint val;
   GstClockTime duration;
-  gchar *title, *end;
+  const gchar *title;
+  gchar *end;
 //  gboolean discontinuity;
   GstM3U8 *list;
+  GPtrArray *old_files;
+  guint old_first = 0;
+  gint index;
 
   g_return_val_if_fail (self != NULL, FALSE);
   g_return_val_if_fail (data != NULL, FALSE);
@@ -251,11 +322,15 @@ gst_m3u8_update (GstM3U8 * self, gchar * data, gboolean * updated)
   g_free (self->last_data);
   self->last_data = data;
 
-  if (self->files) {
-    g_list_foreach (self->files, (GFunc) gst_m3u8_media_file_free, NULL);
-    g_list_free (self->files);
-    self->files = NULL;
-  }
+  /* Live playlists are a sliding window over the same fragments, identified
+   * by their sequence number: keep the files we already know about, as long
+   * as their URI didn't change, and only parse the new ones. The title
+   * points into the playlist data and is only copied for new files */
+  old_files = self->files;
+  if (old_files && old_files->len > 0)
+    old_first =
+        GST_M3U8_MEDIA_FILE (g_ptr_array_index (old_files, 0))->sequence;
+  self->files = g_ptr_array_new ();
 
   list = NULL;
   duration = 0;
@@ -267,48 +342,78 @@ gst_m3u8_update (GstM3U8 * self, gchar * data, gboolean * updated)
       *end = '\0';
 
     if (data[0] != '#') {
-      gchar *r;
+      gchar *r, *uri;
 
       if (duration <= 0 && list == NULL) {
         GST_LOG ("%s: got line without EXTINF or EXTSTREAMINF, dropping", data);
         goto next_line;
       }
 
-      data = uri_join (self->uri, data);
-      if (data == NULL)
-        goto next_line;
-
       r = g_utf8_strchr (data, -1, '\r');
       if (r)
         *r = '\0';
 
+      index = list ? -1 : gst_m3u8_get_file_index (old_files, old_first,
+          self->mediasequence);
+      if (index >= 0) {
+        GstM3U8MediaFile *file = g_ptr_array_index (old_files, index);
+
+        if (g_str_equal (file->relative_uri, data)) {
+          GST_LOG ("Reusing fragment %u", self->mediasequence);
+          gst_m3u8_add_file (self, file);
+          g_ptr_array_index (old_files, index) = NULL;
+          self->mediasequence++;
+          duration = 0;
+          title = NULL;
+          goto next_line;
+        }
+
+        /* the server restarted the numbering, after a discontinuity or an
+         * encoder restart: none of the known fragments can be trusted */
+        GST_DEBUG ("Fragment %u changed, not reusing the known fragments",
+            self->mediasequence);
+        gst_m3u8_free_files (old_files);
+        old_files = NULL;
+      }
+
+      uri = uri_join (self->uri, data);
+      if (uri == NULL)
+        goto next_line;
+
       if (list != NULL) {
-        if (g_list_find_custom (self->lists, data,
+        if (g_list_find_custom (self->lists, uri,
                 (GCompareFunc) _m3u8_compare_uri)) {
           GST_DEBUG ("Already have a list with this URI");
           gst_m3u8_free (list);
-          g_free (data);
+          g_free (uri);
         } else {
-          gst_m3u8_set_uri (list, data);
+          gst_m3u8_set_uri (list, uri);
           self->lists = g_list_append (self->lists, list);
         }
         list = NULL;
       } else {
         GstM3U8MediaFile *file;
         file =
-            gst_m3u8_media_file_new (data, title, duration,
+            gst_m3u8_media_file_new (uri, g_strdup (title), duration,
             self->mediasequence++);
+        file->relative_uri = g_strdup (data);
 
-        /* set encryption params */
+        /* set encryption params, without an explicit IV the sequence
+         * number is used */
         file->key = g_strdup (self->key);
+        file->unsupported_key = self->unsupported_key;
         if (file->key) {
-          guint8 *iv = file->iv + 12;
-          GST_WRITE_UINT32_BE (iv, file->sequence);
+          if (self->has_iv) {
+            memcpy (file->iv, self->iv, sizeof (file->iv));
+          } else {
+            guint8 *iv = file->iv + 12;
+            GST_WRITE_UINT32_BE (iv, file->sequence);
+          }
         }
 
         duration = 0;
         title = NULL;
-        self->files = g_list_append (self->files, file);
+        gst_m3u8_add_file (self, file);
       }
 
     } else if (g_str_has_prefix (data, "#EXT-X-ENDLIST")) {
@@ -366,8 +471,23 @@ gst_m3u8_update (GstM3U8 * self, gchar * data, gboolean * updated)
       gchar *v, *a;
 
       data = data + 11;
+      self->has_iv = FALSE;
+      self->unsupported_key = FALSE;
       while (data && parse_attributes (&data, &a, &v)) {
-        if (g_str_equal (a, "URI")) {
+        if (g_str_equal (a, "METHOD")) {
+          if (g_str_equal (v, "NONE")) {
+            g_free (self->key);
+            self->key = NULL;
+          } else if (!g_str_equal (v, "AES-128")) {
+            GST_WARNING ("Unsupported encryption method %s", v);
+            self->unsupported_key = TRUE;
+          }
+        } else if (g_str_equal (a, "IV")) {
+          if (iv_from_string (v, self->iv))
+            self->has_iv = TRUE;
+          else
+            GST_WARNING ("Invalid IV %s", v);
+        } else if (g_str_equal (a, "URI")) {
           gchar *key = g_strdup (v);
           gchar *keyp = key;
           int len = strlen (key);
@@ -378,10 +498,17 @@ gst_m3u8_update (GstM3U8 * self, gchar * data, gboolean * updated)
           if (key[0] == '"')
             key += 1;
 
+          g_free (self->key);
           self->key = uri_join (self->uri, key);
           g_free (keyp);
         }
       }
+      /* the following files can't be decrypted, they must not be handed
+       * out as clear ones either */
+      if (self->unsupported_key) {
+        g_free (self->key);
+        self->key = NULL;
+      }
     } else if (g_str_has_prefix (data, "#EXTINF:")) {
       gdouble fval;
       if (!double_from_string (data + 8, &data, &fval)) {
@@ -394,10 +521,8 @@ gst_m3u8_update (GstM3U8 * self, gchar * data, gboolean * updated)
       if (!data || *data != ',')
         goto next_line;
       data = g_utf8_next_char (data);
-      if (data != end) {
-        g_free (title);
-        title = g_strdup (data);
-      }
+      if (data != end)
+        title = data;
     } else {
       GST_LOG ("Ignored line: %s", data);
     }
@@ -408,6 +533,10 @@ gst_m3u8_update (GstM3U8 * self, gchar * data, gboolean * updated)
     data = g_utf8_next_char (end);      /* skip \n */
   }
 
+  /* the fragments that left the window */
+  if (old_files)
+    gst_m3u8_free_files (old_files);
+
   /* redorder playlists by bitrate */
   if (self->lists) {
     gchar *top_variant_uri = NULL;
@@ -498,9 +627,9 @@ gst_m3u8_client_update (GstM3U8Client * self, gchar * data)
     }
   }
 
-  if (m3u8->files && self->sequence == -1) {
+  if (m3u8->files && m3u8->files->len > 0 && self->sequence == -1) {
     self->sequence =
-        GST_M3U8_MEDIA_FILE (g_list_first (m3u8->files)->data)->sequence;
+        GST_M3U8_MEDIA_FILE (g_ptr_array_index (m3u8->files, 0))->sequence;
     GST_DEBUG ("Setting first sequence at %d", self->sequence);
   }
 
@@ -510,40 +639,66 @@ out:
   return ret;
 }
 
-static gboolean
-_find_next (GstM3U8MediaFile * file, GstM3U8Client * client)
+/* Returns the index of the next file to download, or -1 */
+static gint
+_find_next (GstM3U8Client * client)
 {
-  GST_DEBUG ("Found fragment %d", file->sequence);
-  if (file->sequence >= client->sequence)
-    return FALSE;
-  return TRUE;
+  GPtrArray *files = client->current->files;
+  GstM3U8MediaFile *first;
+
+  if (files == NULL || files->len == 0)
+    return -1;
+
+  /* start from the first file if the sequence left the window */
+  first = g_ptr_array_index (files, 0);
+  if (client->sequence <= (gint) first->sequence)
+    return 0;
+
+  return gst_m3u8_get_file_index (files, first->sequence, client->sequence);
+}
+
+/* Returns the duration of the files in the window */
+static GstClockTime
+_get_files_duration (GPtrArray * files)
+{
+  GstM3U8MediaFile *first, *last;
+
+  if (files == NULL || files->len == 0)
+    return 0;
+
+  first = g_ptr_array_index (files, 0);
+  last = g_ptr_array_index (files, files->len - 1);
+
+  return last->start + last->duration - first->start;
 }
 
 void
 gst_m3u8_client_get_current_position (GstM3U8Client * client,
     GstClockTime * timestamp)
 {
-  GList *l;
-  GList *walk;
-
-  l = g_list_find_custom (client->current->files, client,
-      (GCompareFunc) _find_next);
-
-  *timestamp = 0;
-  for (walk = client->current->files; walk; walk = walk->next) {
-    if (walk == l)
-      break;
-    *timestamp += GST_M3U8_MEDIA_FILE (walk->data)->duration;
+  GPtrArray *files = client->current->files;
+  GstM3U8MediaFile *first, *file;
+  gint index;
+
+  index = _find_next (client);
+  if (index < 0) {
+    *timestamp = _get_files_duration (files);
+    return;
   }
+
+  first = g_ptr_array_index (files, 0);
+  file = g_ptr_array_index (files, index);
+  *timestamp = file->start - first->start;
 }
 
 gboolean
 gst_m3u8_client_get_next_fragment (GstM3U8Client * client,
     gboolean * discontinuity, const gchar ** uri, GstClockTime * duration,
-    GstClockTime * timestamp, const gchar ** key, const guint8 ** iv)
+    GstClockTime * timestamp, const gchar ** key, const guint8 ** iv,
+    gboolean * unsupported_key)
 {
-  GList *l;
   GstM3U8MediaFile *file;
+  gint index;
 
   g_return_val_if_fail (client != NULL, FALSE);
   g_return_val_if_fail (client->current != NULL, FALSE);
@@ -551,16 +706,16 @@ gst_m3u8_client_get_next_fragment (GstM3U8Client * client,
 
   GST_M3U8_CLIENT_LOCK (client);
   GST_DEBUG ("Looking for fragment %d", client->sequence);
-  l = g_list_find_custom (client->current->files, client,
-      (GCompareFunc) _find_next);
-  if (l == NULL) {
+  index = _find_next (client);
+  if (index < 0) {
     GST_M3U8_CLIENT_UNLOCK (client);
     return FALSE;
   }
 
   gst_m3u8_client_get_current_position (client, timestamp);
 
-  file = GST_M3U8_MEDIA_FILE (l->data);
+  file = g_ptr_array_index (client->current->files, index);
+  GST_DEBUG ("Found fragment %d", file->sequence);
 
   *discontinuity = client->sequence != file->sequence;
   client->sequence = file->sequence + 1;
@@ -569,15 +724,70 @@ gst_m3u8_client_get_next_fragment (GstM3U8Client * client,
   *duration = file->duration;
   *key = file->key;
   *iv = file->iv;
+  *unsupported_key = file->unsupported_key;
 
   GST_M3U8_CLIENT_UNLOCK (client);
   return TRUE;
 }
 
-static void
-_sum_duration (GstM3U8MediaFile * self, GstClockTime * duration)
+gboolean
+gst_m3u8_client_has_next_fragment (GstM3U8Client * client)
 {
-  *duration += self->duration;
+  gboolean ret;
+
+  g_return_val_if_fail (client != NULL, FALSE);
+  g_return_val_if_fail (client->current != NULL, FALSE);
+
+  GST_M3U8_CLIENT_LOCK (client);
+  ret = _find_next (client) >= 0;
+  GST_M3U8_CLIENT_UNLOCK (client);
+
+  return ret;
+}
+
+/* Finds the sequence number of the file containing @position, relative to
+ * the start of the window */
+gboolean
+gst_m3u8_client_get_sequence_at_position (GstM3U8Client * client,
+    GstClockTime position, gint * sequence)
+{
+  GPtrArray *files;
+  GstM3U8MediaFile *file;
+  guint low, high, mid;
+  gboolean ret = FALSE;
+
+  g_return_val_if_fail (client != NULL, FALSE);
+  g_return_val_if_fail (client->current != NULL, FALSE);
+  g_return_val_if_fail (sequence != NULL, FALSE);
+
+  GST_M3U8_CLIENT_LOCK (client);
+  files = client->current->files;
+  if (files == NULL || files->len == 0)
+    goto out;
+
+  position += GST_M3U8_MEDIA_FILE (g_ptr_array_index (files, 0))->start;
+
+  /* the files are sorted by start position */
+  low = 0;
+  high = files->len;
+  while (low < high) {
+    mid = low + (high - low) / 2;
+    file = g_ptr_array_index (files, mid);
+
+    if (position < file->start) {
+      high = mid;
+    } else if (position >= file->start + file->duration) {
+      low = mid + 1;
+    } else {
+      *sequence = file->sequence;
+      ret = TRUE;
+      break;
+    }
+  }
+
+out:
+  GST_M3U8_CLIENT_UNLOCK (client);
+  return ret;
 }
 
 GstClockTime
@@ -594,7 +804,7 @@ gst_m3u8_client_get_duration (GstM3U8Client * client)
     return GST_CLOCK_TIME_NONE;
   }
 
-  g_list_foreach (client->current->files, (GFunc) _sum_duration, &duration);
+  duration = _get_files_duration (client->current->files);
   GST_M3U8_CLIENT_UNLOCK (client);
   return duration;
 }
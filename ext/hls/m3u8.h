@@ -44,13 +44,17 @@ struct _GstM3U8
   GstClockTime targetduration;  /* last EXT-X-TARGETDURATION */
   gchar *allowcache;            /* last EXT-X-ALLOWCACHE */
   gchar *key;
+  guint8 iv[16];                /* IV of the last EXT-X-KEY */
+  gboolean has_iv;              /* whether the last EXT-X-KEY had an IV */
+  gboolean unsupported_key;     /* whether the last EXT-X-KEY used a METHOD
+                                 * other than NONE or AES-128 */
 
   gint bandwidth;
   gint program_id;
   gchar *codecs;
   gint width;
   gint height;
-  GList *files;
+  GPtrArray *files;             /* GstM3U8MediaFile, by consecutive sequence nb */
 
   /*< private > */
   gchar *last_data;
@@ -65,9 +69,13 @@ struct _GstM3U8MediaFile
   gchar *title;
   GstClockTime duration;
   gchar *uri;
+  gchar *relative_uri;          /* the URI as written in the playlist */
   guint sequence;               /* the sequence nb of this file */
+  GstClockTime start;           /* sum of the durations of the previous files,
+                                 * only meaningful relative to the first one */
   gchar *key;
   guint8 iv[16];
+  gboolean unsupported_key;     /* encrypted with an unsupported METHOD */
 };
 
 struct _GstM3U8Client
@@ -86,7 +94,11 @@ gboolean gst_m3u8_client_update (GstM3U8Client * client, gchar * data);
 void gst_m3u8_client_set_current (GstM3U8Client * client, GstM3U8 * m3u8);
 gboolean gst_m3u8_client_get_next_fragment (GstM3U8Client * client,
     gboolean * discontinuity, const gchar ** uri, GstClockTime * duration,
-    GstClockTime * timestamp, const gchar ** key, const guint8 ** iv);
+    GstClockTime * timestamp, const gchar ** key, const guint8 ** iv,
+    gboolean * unsupported_key);
+gboolean gst_m3u8_client_has_next_fragment (GstM3U8Client * client);
+gboolean gst_m3u8_client_get_sequence_at_position (GstM3U8Client * client,
+    GstClockTime position, gint * sequence);
 void gst_m3u8_client_get_current_position (GstM3U8Client * client,
     GstClockTime * timestamp);
 GstClockTime gst_m3u8_client_get_duration (GstM3U8Client * client);
@@ -82,10 +82,21 @@ GST_DEBUG_CATEGORY (mssdemux_debug);
 #define DEFAULT_CONNECTION_SPEED 0
 #define DEFAULT_MAX_QUEUE_SIZE_BUFFERS 0
 #define DEFAULT_BITRATE_LIMIT 0.8
+#define DEFAULT_ABR_POLICY GST_ABR_POLICY_HYBRID
 
-#define DOWNLOAD_RATE_MAX_HISTORY_LENGTH 5
 #define MAX_DOWNLOAD_ERROR_COUNT 3
 
+/* Shared by the chunks of one download of a fragment. If the download
+ * fails, the chunks that are still queued are dropped, as the fragment
+ * is downloaded again from its start */
+struct _GstMssDemuxFragmentAttempt
+{
+  volatile gint refcount;
+  volatile gint failed;
+};
+
+static GQuark fragment_attempt_quark;
+
 enum
 {
   PROP_0,
@@ -93,6 +104,7 @@ enum
   PROP_CONNECTION_SPEED,
   PROP_MAX_QUEUE_SIZE_BUFFERS,
   PROP_BITRATE_LIMIT,
+  PROP_ABR_POLICY,
   PROP_LAST
 };
 
@@ -182,10 +194,19 @@ gst_mss_demux_class_init (GstMssDemuxClass * klass)
           0, 1, DEFAULT_BITRATE_LIMIT,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_ABR_POLICY,
+      g_param_spec_enum ("abr-policy", "ABR policy",
+          "Policy used to select the bitrate of the streams",
+          GST_TYPE_ABR_POLICY, DEFAULT_ABR_POLICY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state =
       GST_DEBUG_FUNCPTR (gst_mss_demux_change_state);
 
   GST_DEBUG_CATEGORY_INIT (mssdemux_debug, "mssdemux", 0, "mssdemux plugin");
+
+  fragment_attempt_quark =
+      g_quark_from_static_string ("GstMssDemuxFragmentAttempt");
 }
 
 static void
@@ -207,6 +228,7 @@ gst_mss_demux_init (GstMssDemux * mssdemux)
 
   mssdemux->data_queue_max_size = DEFAULT_MAX_QUEUE_SIZE_BUFFERS;
   mssdemux->bitrate_limit = DEFAULT_BITRATE_LIMIT;
+  mssdemux->abr_policy = DEFAULT_ABR_POLICY;
 
   mssdemux->have_group_id = FALSE;
   mssdemux->group_id = G_MAXUINT;
@@ -245,9 +267,7 @@ gst_mss_demux_stream_new (GstMssDemux * mssdemux,
   stream->pad = srcpad;
   stream->manifest_stream = manifeststream;
   stream->parent = mssdemux;
-  gst_download_rate_init (&stream->download_rate);
-  gst_download_rate_set_max_length (&stream->download_rate,
-      DOWNLOAD_RATE_MAX_HISTORY_LENGTH);
+  gst_abr_controller_init (&stream->abr);
 
   return stream;
 }
@@ -272,7 +292,7 @@ gst_mss_demux_stream_free (GstMssDemuxStream * stream)
     stream->download_task = NULL;
   }
 
-  gst_download_rate_deinit (&stream->download_rate);
+  gst_abr_controller_clear (&stream->abr);
   if (stream->pending_newsegment) {
     gst_event_unref (stream->pending_newsegment);
     stream->pending_newsegment = NULL;
@@ -381,6 +401,9 @@ gst_mss_demux_set_property (GObject * object, guint prop_id,
     case PROP_BITRATE_LIMIT:
       mssdemux->bitrate_limit = g_value_get_float (value);
       break;
+    case PROP_ABR_POLICY:
+      mssdemux->abr_policy = g_value_get_enum (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -403,6 +426,9 @@ gst_mss_demux_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_BITRATE_LIMIT:
       g_value_set_float (value, mssdemux->bitrate_limit);
       break;
+    case PROP_ABR_POLICY:
+      g_value_set_enum (value, mssdemux->abr_policy);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -974,24 +1000,49 @@ gst_mss_demux_reload_manifest (GstMssDemux * mssdemux)
   g_object_unref (downloader);
 }
 
-static void
+/* called with the object lock, returns the message announcing a bitrate
+ * change, to be posted once the lock is released */
+static GstMessage *
 gst_mss_demux_reconfigure_stream (GstMssDemuxStream * stream)
 {
   GstMssDemux *mssdemux = stream->parent;
-  guint64 new_bitrate;
+  GstDataQueueSize level;
+  guint64 *bitrates;
+  guint64 reserved = 0;
+  guint n_bitrates;
+  gint current, index;
+  GSList *iter;
+
+  /* the settings can change at any time, keep the controller up to date */
+  gst_abr_controller_set_policy (&stream->abr, mssdemux->abr_policy);
+  gst_abr_controller_set_bandwidth_usage (&stream->abr,
+      mssdemux->bitrate_limit);
+  gst_abr_controller_set_max_bitrate (&stream->abr,
+      mssdemux->connection_speed);
+  if (mssdemux->data_queue_max_size && stream->fragment_duration)
+    gst_abr_controller_set_buffer_target (&stream->abr,
+        mssdemux->data_queue_max_size * stream->fragment_duration);
 
-  new_bitrate =
-      mssdemux->bitrate_limit *
-      gst_download_rate_get_current_rate (&stream->download_rate);
-  if (mssdemux->connection_speed) {
-    new_bitrate = MIN (mssdemux->connection_speed, new_bitrate);
+  /* the other streams share the connection */
+  for (iter = mssdemux->streams; iter; iter = g_slist_next (iter)) {
+    GstMssDemuxStream *other = iter->data;
+
+    if (other != stream)
+      reserved += gst_mss_stream_get_current_bitrate (other->manifest_stream);
   }
 
-  GST_DEBUG_OBJECT (mssdemux,
-      "Current stream %s download bitrate %" G_GUINT64_FORMAT,
-      GST_PAD_NAME (stream->pad), new_bitrate);
+  bitrates = gst_mss_stream_get_bitrates (stream->manifest_stream,
+      &n_bitrates, &current);
+  gst_data_queue_get_level (stream->dataqueue, &level);
+  index = gst_abr_controller_select (&stream->abr, bitrates, n_bitrates,
+      current, reserved, level.time, stream->fragment_duration);
+  g_free (bitrates);
+
+  GST_DEBUG_OBJECT (mssdemux, "Selected quality %d for stream %s", index,
+      GST_PAD_NAME (stream->pad));
 
-  if (gst_mss_stream_select_bitrate (stream->manifest_stream, new_bitrate)) {
+  if (index >= 0
+      && gst_mss_stream_select_bitrate_index (stream->manifest_stream, index)) {
     GstEvent *capsevent;
     GstCaps *caps;
     caps = gst_mss_stream_get_caps (stream->manifest_stream);
@@ -1009,7 +1060,39 @@ gst_mss_demux_reconfigure_stream (GstMssDemuxStream * stream)
     capsevent = gst_event_new_caps (stream->caps);
     gst_mss_demux_stream_store_object (stream,
         GST_MINI_OBJECT_CAST (capsevent));
+
+    return gst_abr_controller_new_decision_message (&stream->abr,
+        GST_OBJECT_CAST (mssdemux), GST_PAD_NAME (stream->pad));
   }
+
+  return NULL;
+}
+
+static GstMssDemuxFragmentAttempt *
+gst_mss_demux_fragment_attempt_new (void)
+{
+  GstMssDemuxFragmentAttempt *attempt;
+
+  attempt = g_slice_new (GstMssDemuxFragmentAttempt);
+  attempt->refcount = 1;
+  attempt->failed = 0;
+
+  return attempt;
+}
+
+static GstMssDemuxFragmentAttempt *
+gst_mss_demux_fragment_attempt_ref (GstMssDemuxFragmentAttempt * attempt)
+{
+  g_atomic_int_inc (&attempt->refcount);
+
+  return attempt;
+}
+
+static void
+gst_mss_demux_fragment_attempt_unref (GstMssDemuxFragmentAttempt * attempt)
+{
+  if (g_atomic_int_dec_and_test (&attempt->refcount))
+    g_slice_free (GstMssDemuxFragmentAttempt, attempt);
 }
 
 static void
@@ -1031,9 +1114,17 @@ gst_mss_demux_stream_store_object (GstMssDemuxStream * stream,
   item = g_slice_new (GstDataQueueItem);
   item->object = (GstMiniObject *) obj;
 
-  item->duration = 0;           /* we don't care */
+  /* the duration is used by the ABR controller to know how much is
+   * buffered */
+  item->duration = 0;
+  if (GST_IS_BUFFER (obj)
+      && GST_BUFFER_DURATION_IS_VALID (GST_BUFFER_CAST (obj)))
+    item->duration = GST_BUFFER_DURATION (GST_BUFFER_CAST (obj));
   item->size = 0;
-  item->visible = TRUE;
+  /* only the first chunk of a fragment carries a timestamp, the others
+   * don't count against the queue limit */
+  item->visible = !GST_IS_BUFFER (obj)
+      || GST_BUFFER_TIMESTAMP_IS_VALID (GST_BUFFER_CAST (obj));
 
   item->destroy = (GDestroyNotify) _free_data_queue_item;
 
@@ -1049,6 +1140,47 @@ gst_mss_demux_stream_store_object (GstMssDemuxStream * stream,
   }
 }
 
+static GstFlowReturn
+gst_mss_demux_stream_chunk_received (GstUriDownloader * downloader,
+    GstBuffer * buffer, gpointer user_data)
+{
+  GstMssDemuxStream *stream = user_data;
+
+  if (stream->cancelled) {
+    gst_buffer_unref (buffer);
+    return GST_FLOW_FLUSHING;
+  }
+
+  buffer = gst_buffer_make_writable (buffer);
+  if (!stream->fragment_started) {
+    GST_BUFFER_TIMESTAMP (buffer) = stream->fragment_timestamp;
+    GST_BUFFER_DURATION (buffer) = stream->fragment_duration;
+    if (stream->fragment_discont) {
+      GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_DISCONT);
+      stream->fragment_discont = FALSE;
+    }
+    stream->fragment_started = TRUE;
+
+    GST_DEBUG_OBJECT (stream->parent,
+        "Storing first chunk for stream %p - %s. Timestamp: %" GST_TIME_FORMAT
+        " Duration: %" GST_TIME_FORMAT, stream, GST_PAD_NAME (stream->pad),
+        GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (buffer)),
+        GST_TIME_ARGS (GST_BUFFER_DURATION (buffer)));
+  } else {
+    GST_BUFFER_TIMESTAMP (buffer) = GST_CLOCK_TIME_NONE;
+    GST_BUFFER_DURATION (buffer) = GST_CLOCK_TIME_NONE;
+  }
+
+  gst_mini_object_set_qdata (GST_MINI_OBJECT_CAST (buffer),
+      fragment_attempt_quark,
+      gst_mss_demux_fragment_attempt_ref (stream->fragment_attempt),
+      (GDestroyNotify) gst_mss_demux_fragment_attempt_unref);
+
+  gst_mss_demux_stream_store_object (stream, GST_MINI_OBJECT_CAST (buffer));
+
+  return GST_FLOW_OK;
+}
+
 static GstFlowReturn
 gst_mss_demux_stream_download_fragment (GstMssDemuxStream * stream,
     gboolean * buffer_downloaded)
@@ -1057,7 +1189,6 @@ gst_mss_demux_stream_download_fragment (GstMssDemuxStream * stream,
   gchar *path;
   gchar *url;
   GstFragment *fragment;
-  GstBuffer *_buffer;
   GstFlowReturn ret = GST_FLOW_OK;
   guint64 before_download, after_download;
 
@@ -1088,12 +1219,30 @@ gst_mss_demux_stream_download_fragment (GstMssDemuxStream * stream,
 
   GST_DEBUG_OBJECT (mssdemux, "Got url '%s' for stream %p", url, stream);
 
-  fragment = gst_uri_downloader_fetch_uri (stream->downloader, url);
+  /* The data is passed downstream as it arrives */
+  stream->fragment_timestamp =
+      gst_mss_stream_get_fragment_gst_timestamp (stream->manifest_stream);
+  stream->fragment_duration =
+      gst_mss_stream_get_fragment_gst_duration (stream->manifest_stream);
+  stream->fragment_started = FALSE;
+  stream->fragment_attempt = gst_mss_demux_fragment_attempt_new ();
+
+  fragment = gst_uri_downloader_fetch_uri_streaming (stream->downloader, url,
+      0, -1, gst_mss_demux_stream_chunk_received, stream);
   g_free (path);
   g_free (url);
 
+  if (!fragment)
+    g_atomic_int_set (&stream->fragment_attempt->failed, 1);
+  gst_mss_demux_fragment_attempt_unref (stream->fragment_attempt);
+  stream->fragment_attempt = NULL;
+
   if (!fragment) {
     GST_INFO_OBJECT (mssdemux, "No fragment downloaded");
+    /* The queued chunks of this download are dropped. Those that were
+     * already pushed are followed by the start of the fragment again */
+    if (stream->fragment_started)
+      stream->fragment_discont = TRUE;
     /* TODO check if we are truly stoping */
     if (gst_mss_manifest_is_live (mssdemux->manifest)) {
       /* looks like there is no way of knowing when a live stream has ended
@@ -1103,41 +1252,25 @@ gst_mss_demux_stream_download_fragment (GstMssDemuxStream * stream,
     return GST_FLOW_ERROR;
   }
 
-  _buffer = gst_fragment_get_buffer (fragment);
-  _buffer = gst_buffer_make_writable (_buffer);
-  GST_BUFFER_TIMESTAMP (_buffer) =
-      gst_mss_stream_get_fragment_gst_timestamp (stream->manifest_stream);
-  GST_BUFFER_DURATION (_buffer) =
-      gst_mss_stream_get_fragment_gst_duration (stream->manifest_stream);
-
-  g_object_unref (fragment);
-
   if (buffer_downloaded)
-    *buffer_downloaded = _buffer != NULL;
+    *buffer_downloaded = stream->fragment_started;
 
   after_download = g_get_real_time ();
-  if (_buffer) {
+  if (fragment->size > 0) {
 #ifndef GST_DISABLE_GST_DEBUG
-    guint64 bitrate = (8 * gst_buffer_get_size (_buffer) * 1000000LLU) /
+    guint64 bitrate = (8 * fragment->size * 1000000LLU) /
         (after_download - before_download);
 #endif
 
     GST_DEBUG_OBJECT (mssdemux,
         "Measured download bitrate: %s %" G_GUINT64_FORMAT " bps",
         GST_PAD_NAME (stream->pad), bitrate);
-    gst_download_rate_add_rate (&stream->download_rate,
-        gst_buffer_get_size (_buffer),
+    gst_abr_controller_add_sample (&stream->abr, fragment->size,
         1000 * (after_download - before_download));
-
-    GST_DEBUG_OBJECT (mssdemux,
-        "Storing buffer for stream %p - %s. Timestamp: %" GST_TIME_FORMAT
-        " Duration: %" GST_TIME_FORMAT,
-        stream, GST_PAD_NAME (stream->pad),
-        GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (_buffer)),
-        GST_TIME_ARGS (GST_BUFFER_DURATION (_buffer)));
-    gst_mss_demux_stream_store_object (stream, GST_MINI_OBJECT_CAST (_buffer));
   }
 
+  g_object_unref (fragment);
+
   return ret;
 
 no_url_error:
@@ -1161,6 +1294,7 @@ gst_mss_demux_download_loop (GstMssDemuxStream * stream)
 {
   GstMssDemux *mssdemux = stream->parent;
   gboolean buffer_downloaded = FALSE;
+  GstMessage *message;
   GstFlowReturn ret;
 
   GST_LOG_OBJECT (mssdemux, "download loop start %p", stream);
@@ -1168,10 +1302,13 @@ gst_mss_demux_download_loop (GstMssDemuxStream * stream)
   GST_OBJECT_LOCK (mssdemux);
   GST_DEBUG_OBJECT (mssdemux,
       "Starting streams reconfiguration due to bitrate changes");
-  gst_mss_demux_reconfigure_stream (stream);
+  message = gst_mss_demux_reconfigure_stream (stream);
   GST_DEBUG_OBJECT (mssdemux, "Finished streams reconfiguration");
   GST_OBJECT_UNLOCK (mssdemux);
 
+  if (message)
+    gst_element_post_message (GST_ELEMENT_CAST (mssdemux), message);
+
   ret = gst_mss_demux_stream_download_fragment (stream, &buffer_downloaded);
 
   if (stream->cancelled)
@@ -1251,8 +1388,10 @@ gst_mss_demux_select_latest_stream (GstMssDemux * mssdemux,
       return GST_FLOW_FLUSHING;
     }
 
-    if (GST_IS_EVENT (item->object)) {
-      /* events have higher priority */
+    if (GST_IS_EVENT (item->object)
+        || !GST_BUFFER_TIMESTAMP_IS_VALID (GST_BUFFER_CAST (item->object))) {
+      /* events and the remaining chunks of a fragment that was already
+       * started have higher priority */
       current = other;
       break;
     }
@@ -1316,13 +1455,26 @@ gst_mss_demux_stream_loop (GstMssDemux * mssdemux)
     goto stop;
   }
 
+  if (GST_IS_BUFFER (object)) {
+    GstMssDemuxFragmentAttempt *attempt =
+        gst_mini_object_get_qdata (object, fragment_attempt_quark);
+
+    if (attempt && g_atomic_int_get (&attempt->failed)) {
+      GST_DEBUG_OBJECT (mssdemux, "Dropping chunk %p of a failed download "
+          "on pad %s", object, GST_PAD_NAME (stream->pad));
+      gst_mini_object_unref (object);
+      return;
+    }
+  }
+
   if (G_UNLIKELY (stream->pending_newsegment)) {
     gst_pad_push_event (stream->pad, stream->pending_newsegment);
     stream->pending_newsegment = NULL;
   }
 
   if (G_LIKELY (GST_IS_BUFFER (object))) {
-    if (GST_BUFFER_TIMESTAMP (object) != stream->next_timestamp) {
+    if (GST_BUFFER_TIMESTAMP_IS_VALID (object)
+        && GST_BUFFER_TIMESTAMP (object) != stream->next_timestamp) {
       GST_DEBUG_OBJECT (mssdemux, "Marking buffer %p as discont buffer:%"
           GST_TIME_FORMAT " != expected:%" GST_TIME_FORMAT, object,
           GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (object)),
@@ -1338,8 +1490,9 @@ gst_mss_demux_stream_loop (GstMssDemux * mssdemux)
         GST_BUFFER_FLAG_IS_SET (object, GST_BUFFER_FLAG_DISCONT),
         GST_PAD_NAME (stream->pad));
 
-    stream->next_timestamp =
-        GST_BUFFER_TIMESTAMP (object) + GST_BUFFER_DURATION (object);
+    if (GST_BUFFER_TIMESTAMP_IS_VALID (object))
+      stream->next_timestamp =
+          GST_BUFFER_TIMESTAMP (object) + GST_BUFFER_DURATION (object);
 
     stream->have_data = TRUE;
     ret = gst_pad_push (stream->pad, GST_BUFFER_CAST (object));
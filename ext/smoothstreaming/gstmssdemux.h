@@ -28,7 +28,7 @@
 #include <gst/base/gstdataqueue.h>
 #include "gstmssmanifest.h"
 #include <gst/uridownloader/gsturidownloader.h>
-#include "gstdownloadrate.h"
+#include <gst/uridownloader/gstabrcontroller.h>
 
 G_BEGIN_DECLS
 
@@ -49,6 +49,7 @@ GST_DEBUG_CATEGORY_EXTERN (mssdemux_debug);
 #define GST_MSS_DEMUX_CAST(obj) ((GstMssDemux *)(obj))
 
 typedef struct _GstMssDemuxStream GstMssDemuxStream;
+typedef struct _GstMssDemuxFragmentAttempt GstMssDemuxFragmentAttempt;
 typedef struct _GstMssDemux GstMssDemux;
 typedef struct _GstMssDemuxClass GstMssDemuxClass;
 
@@ -68,6 +69,13 @@ struct _GstMssDemuxStream {
 
   GstClockTime next_timestamp;
 
+  /* Fragment currently being streamed from the downloader */
+  GstClockTime fragment_timestamp;
+  GstClockTime fragment_duration;
+  gboolean fragment_started;
+  gboolean fragment_discont;
+  GstMssDemuxFragmentAttempt *fragment_attempt;
+
   /* Downloading task */
   GstTask *download_task;
   GRecMutex download_lock;
@@ -76,7 +84,7 @@ struct _GstMssDemuxStream {
   gboolean have_data;
   gboolean cancelled;
 
-  GstDownloadRate download_rate;
+  GstAbrController abr;
 
   guint download_error_count;
 };
@@ -112,6 +120,7 @@ struct _GstMssDemux {
   guint64 connection_speed; /* in bps */
   guint data_queue_max_size;
   gfloat bitrate_limit;
+  GstAbrPolicy abr_policy;
 };
 
 struct _GstMssDemuxClass {
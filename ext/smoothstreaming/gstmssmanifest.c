@@ -1105,6 +1105,41 @@ gst_mss_stream_select_bitrate (GstMssStream * stream, guint64 bitrate)
   return TRUE;
 }
 
+/* Returns the bitrates of the qualities of @stream, in ascending order. The
+ * index of the current one is returned in @current */
+guint64 *
+gst_mss_stream_get_bitrates (GstMssStream * stream, guint * n_bitrates,
+    gint * current)
+{
+  guint64 *bitrates;
+  GList *iter;
+  guint i;
+
+  *n_bitrates = g_list_length (stream->qualities);
+  *current = 0;
+  bitrates = g_new (guint64, *n_bitrates);
+  for (iter = stream->qualities, i = 0; iter; iter = g_list_next (iter), i++) {
+    GstMssStreamQuality *q = iter->data;
+
+    bitrates[i] = q->bitrate;
+    if (iter == stream->current_quality)
+      *current = i;
+  }
+
+  return bitrates;
+}
+
+gboolean
+gst_mss_stream_select_bitrate_index (GstMssStream * stream, guint index)
+{
+  GList *iter = g_list_nth (stream->qualities, index);
+
+  if (iter == NULL || iter == stream->current_quality)
+    return FALSE;
+  stream->current_quality = iter;
+  return TRUE;
+}
+
 guint64
 gst_mss_stream_get_current_bitrate (GstMssStream * stream)
 {
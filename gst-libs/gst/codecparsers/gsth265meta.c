@@ -0,0 +1,274 @@
+/*
+ * GStreamer
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gsth265meta.h"
+
+#include <string.h>
+
+GST_DEBUG_CATEGORY (h265_meta_debug);
+#define GST_CAT_DEFAULT h265_meta_debug
+
+/* ATSC A/53 user data, ITU-T T.35 country code for the United States */
+#define ITU_T_T35_COUNTRY_CODE_US 0xb5
+#define ATSC_PROVIDER_CODE 0x0031
+#define ATSC_USER_IDENTIFIER_GA94 0x47413934
+#define ATSC_USER_DATA_TYPE_CC 0x03
+
+static void
+ensure_debug_category (void)
+{
+#ifndef GST_DISABLE_GST_DEBUG
+  static gsize cat_gonce = 0;
+
+  if (g_once_init_enter (&cat_gonce)) {
+    GST_DEBUG_CATEGORY_INIT (h265_meta_debug, "h265meta", 0,
+        "H.265 video GstMeta");
+    g_once_init_leave (&cat_gonce, 1);
+  }
+#endif
+}
+
+static gboolean
+gst_h265_recovery_point_meta_init (GstH265RecoveryPointMeta * rp_meta,
+    gpointer params, GstBuffer * buffer)
+{
+  rp_meta->recovery_poc_cnt = 0;
+  rp_meta->exact_match = FALSE;
+  rp_meta->broken_link = FALSE;
+
+  return TRUE;
+}
+
+GType
+gst_h265_recovery_point_meta_api_get_type (void)
+{
+  static volatile GType type;
+  static const gchar *tags[] = { NULL };
+
+  if (g_once_init_enter (&type)) {
+    GType _type =
+        gst_meta_api_type_register ("GstH265RecoveryPointMetaAPI", tags);
+    ensure_debug_category ();
+
+    g_once_init_leave (&type, _type);
+  }
+  return type;
+}
+
+const GstMetaInfo *
+gst_h265_recovery_point_meta_get_info (void)
+{
+  static const GstMetaInfo *h265_recovery_point_meta_info = NULL;
+
+  if (g_once_init_enter (&h265_recovery_point_meta_info)) {
+    const GstMetaInfo *meta =
+        gst_meta_register (GST_H265_RECOVERY_POINT_META_API_TYPE,
+        "GstH265RecoveryPointMeta", sizeof (GstH265RecoveryPointMeta),
+        (GstMetaInitFunction) gst_h265_recovery_point_meta_init,
+        (GstMetaFreeFunction) NULL,
+        (GstMetaTransformFunction) NULL);
+    g_once_init_leave (&h265_recovery_point_meta_info, meta);
+  }
+
+  return h265_recovery_point_meta_info;
+}
+
+/**
+ * gst_buffer_add_h265_recovery_point_meta:
+ * @buffer: a #GstBuffer
+ * @rp: the #GstH265RecoveryPoint SEI message preceding the picture
+ *
+ * Creates and adds a #GstH265RecoveryPointMeta to a @buffer.
+ *
+ * Returns: (transfer none): a newly created #GstH265RecoveryPointMeta
+ */
+GstH265RecoveryPointMeta *
+gst_buffer_add_h265_recovery_point_meta (GstBuffer * buffer,
+    const GstH265RecoveryPoint * rp)
+{
+  GstH265RecoveryPointMeta *rp_meta;
+
+  g_return_val_if_fail (GST_IS_BUFFER (buffer), NULL);
+  g_return_val_if_fail (rp != NULL, NULL);
+
+  rp_meta = (GstH265RecoveryPointMeta *) gst_buffer_add_meta (buffer,
+      GST_H265_RECOVERY_POINT_META_INFO, NULL);
+
+  GST_DEBUG ("recovery_poc_cnt:%d, exact_match:%d, broken_link:%d",
+      rp->recovery_poc_cnt, rp->exact_match_flag, rp->broken_link_flag);
+
+  rp_meta->recovery_poc_cnt = rp->recovery_poc_cnt;
+  rp_meta->exact_match = rp->exact_match_flag;
+  rp_meta->broken_link = rp->broken_link_flag;
+
+  return rp_meta;
+}
+
+static gboolean
+gst_h265_caption_meta_init (GstH265CaptionMeta * cc_meta,
+    gpointer params, GstBuffer * buffer)
+{
+  cc_meta->data = NULL;
+  cc_meta->size = 0;
+
+  return TRUE;
+}
+
+static void
+gst_h265_caption_meta_free (GstH265CaptionMeta * cc_meta, GstBuffer * buffer)
+{
+  g_free (cc_meta->data);
+}
+
+static gboolean
+gst_h265_caption_meta_transform (GstBuffer * dest, GstMeta * meta,
+    GstBuffer * buffer, GQuark type, gpointer data)
+{
+  GstH265CaptionMeta *cc_meta = (GstH265CaptionMeta *) meta;
+
+  /* only copy the caption data along with the whole buffer */
+  if (GST_META_TRANSFORM_IS_COPY (type)) {
+    GstMetaTransformCopy *copy = data;
+
+    if (!copy->region)
+      gst_buffer_add_h265_caption_meta (dest, cc_meta->data, cc_meta->size);
+  }
+
+  return TRUE;
+}
+
+GType
+gst_h265_caption_meta_api_get_type (void)
+{
+  static volatile GType type;
+  static const gchar *tags[] = { NULL };
+
+  if (g_once_init_enter (&type)) {
+    GType _type = gst_meta_api_type_register ("GstH265CaptionMetaAPI", tags);
+    ensure_debug_category ();
+
+    g_once_init_leave (&type, _type);
+  }
+  return type;
+}
+
+const GstMetaInfo *
+gst_h265_caption_meta_get_info (void)
+{
+  static const GstMetaInfo *h265_caption_meta_info = NULL;
+
+  if (g_once_init_enter (&h265_caption_meta_info)) {
+    const GstMetaInfo *meta = gst_meta_register (GST_H265_CAPTION_META_API_TYPE,
+        "GstH265CaptionMeta", sizeof (GstH265CaptionMeta),
+        (GstMetaInitFunction) gst_h265_caption_meta_init,
+        (GstMetaFreeFunction) gst_h265_caption_meta_free,
+        (GstMetaTransformFunction) gst_h265_caption_meta_transform);
+    g_once_init_leave (&h265_caption_meta_info, meta);
+  }
+
+  return h265_caption_meta_info;
+}
+
+/**
+ * gst_buffer_add_h265_caption_meta:
+ * @buffer: a #GstBuffer
+ * @data: the cc_data() triplets
+ * @size: the size of @data in bytes
+ *
+ * Creates and adds a #GstH265CaptionMeta to a @buffer. @data is copied.
+ *
+ * Returns: (transfer none): a newly created #GstH265CaptionMeta
+ */
+GstH265CaptionMeta *
+gst_buffer_add_h265_caption_meta (GstBuffer * buffer, const guint8 * data,
+    gsize size)
+{
+  GstH265CaptionMeta *cc_meta;
+
+  g_return_val_if_fail (GST_IS_BUFFER (buffer), NULL);
+  g_return_val_if_fail (data != NULL || size == 0, NULL);
+
+  cc_meta = (GstH265CaptionMeta *) gst_buffer_add_meta (buffer,
+      GST_H265_CAPTION_META_INFO, NULL);
+
+  GST_DEBUG ("adding %" G_GSIZE_FORMAT " bytes of caption data", size);
+
+  cc_meta->data = g_memdup (data, size);
+  cc_meta->size = size;
+
+  return cc_meta;
+}
+
+/**
+ * gst_h265_registered_user_data_get_cc_data:
+ * @rud: a #GstH265RegisteredUserData
+ * @data: (out) (transfer none): the location of the cc_data() triplets
+ * @size: (out): the size of the triplets in bytes
+ *
+ * Checks whether @rud carries ATSC A/53 closed caption data and, if so,
+ * points @data to the cc_data() triplets inside @rud.
+ *
+ * Returns: %TRUE if @rud carries closed caption data
+ */
+gboolean
+gst_h265_registered_user_data_get_cc_data (const GstH265RegisteredUserData *
+    rud, const guint8 ** data, gsize * size)
+{
+  const guint8 *p;
+  guint cc_count;
+
+  g_return_val_if_fail (rud != NULL, FALSE);
+  g_return_val_if_fail (data != NULL, FALSE);
+  g_return_val_if_fail (size != NULL, FALSE);
+
+  if (rud->country_code != ITU_T_T35_COUNTRY_CODE_US)
+    return FALSE;
+
+  /* provider code, user identifier, user data type, cc flags/count
+   * and em_data */
+  if (rud->size < 10)
+    return FALSE;
+
+  p = rud->data;
+  if (GST_READ_UINT16_BE (p) != ATSC_PROVIDER_CODE ||
+      GST_READ_UINT32_BE (p + 2) != ATSC_USER_IDENTIFIER_GA94 ||
+      p[6] != ATSC_USER_DATA_TYPE_CC)
+    return FALSE;
+
+  /* process_cc_data_flag */
+  if (!(p[7] & 0x40))
+    return FALSE;
+
+  cc_count = p[7] & 0x1f;
+  if (rud->size < 9 + cc_count * 3) {
+    GST_WARNING ("truncated caption data, %u triplets announced in %u bytes",
+        cc_count, rud->size);
+    return FALSE;
+  }
+
+  *data = p + 9;
+  *size = cc_count * 3;
+
+  return TRUE;
+}
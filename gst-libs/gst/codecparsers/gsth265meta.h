@@ -0,0 +1,103 @@
+/* Gstreamer
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_H265_META_H__
+#define __GST_H265_META_H__
+
+#ifndef GST_USE_UNSTABLE_API
+#warning "The H.265 parsing library is unstable API and may change in future."
+#warning "You can define GST_USE_UNSTABLE_API to avoid this warning."
+#endif
+
+#include <gst/gst.h>
+#include <gst/codecparsers/gsth265parser.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstH265RecoveryPointMeta GstH265RecoveryPointMeta;
+typedef struct _GstH265CaptionMeta GstH265CaptionMeta;
+
+GType gst_h265_recovery_point_meta_api_get_type (void);
+#define GST_H265_RECOVERY_POINT_META_API_TYPE  (gst_h265_recovery_point_meta_api_get_type())
+#define GST_H265_RECOVERY_POINT_META_INFO  (gst_h265_recovery_point_meta_get_info())
+const GstMetaInfo * gst_h265_recovery_point_meta_get_info (void);
+
+GType gst_h265_caption_meta_api_get_type (void);
+#define GST_H265_CAPTION_META_API_TYPE  (gst_h265_caption_meta_api_get_type())
+#define GST_H265_CAPTION_META_INFO  (gst_h265_caption_meta_get_info())
+const GstMetaInfo * gst_h265_caption_meta_get_info (void);
+
+/**
+ * GstH265RecoveryPointMeta:
+ * @meta: parent #GstMeta
+ * @recovery_poc_cnt: the recovery point, as a picture order count offset
+ *   from the picture carried in the buffer
+ * @exact_match: %TRUE if decoding starting from this buffer gives an exact
+ *   match at the recovery point
+ * @broken_link: %TRUE if pictures preceding this buffer in decoding order
+ *   may not be available
+ *
+ * Extra buffer metadata carrying the contents of a recovery point SEI
+ * message preceding the picture in the buffer.
+ *
+ * A buffer with this meta can be used as a random access point even if it
+ * is not an IRAP picture.
+ */
+struct _GstH265RecoveryPointMeta {
+  GstMeta  meta;
+
+  gint32   recovery_poc_cnt;
+  gboolean exact_match;
+  gboolean broken_link;
+};
+
+/**
+ * GstH265CaptionMeta:
+ * @meta: parent #GstMeta
+ * @data: the cc_data() triplets, as carried in ATSC A/53 user data
+ * @size: the size of @data in bytes, a multiple of 3
+ *
+ * Extra buffer metadata carrying the closed caption data found in the
+ * registered user data SEI messages of the picture in the buffer.
+ */
+struct _GstH265CaptionMeta {
+  GstMeta  meta;
+
+  guint8  *data;
+  gsize    size;
+};
+
+#define gst_buffer_get_h265_recovery_point_meta(b) ((GstH265RecoveryPointMeta*)gst_buffer_get_meta((b),GST_H265_RECOVERY_POINT_META_API_TYPE))
+#define gst_buffer_get_h265_caption_meta(b) ((GstH265CaptionMeta*)gst_buffer_get_meta((b),GST_H265_CAPTION_META_API_TYPE))
+
+GstH265RecoveryPointMeta *
+gst_buffer_add_h265_recovery_point_meta (GstBuffer * buffer,
+					 const GstH265RecoveryPoint * rp);
+
+GstH265CaptionMeta *
+gst_buffer_add_h265_caption_meta (GstBuffer * buffer,
+				  const guint8 * data, gsize size);
+
+gboolean
+gst_h265_registered_user_data_get_cc_data (const GstH265RegisteredUserData * rud,
+					   const guint8 ** data, gsize * size);
+
+G_END_DECLS
+
+#endif
@@ -60,6 +60,10 @@
  *   </listitem>
  * </itemizedlist>
  *
+ * Alternatively, a complete access unit can be handled at once with
+ * gst_h265_parser_parse_au(). Its slice headers are then parsed in
+ * parallel on a small worker pool, see gst_h265_parser_set_max_threads().
+ *
  * Note: You should always call gst_h265_parser_parse_nal() if you don't
  * actually need #GstH265NalUnitType to be parsed for your personal use, in
  * order to guarantee that the #GstH265Parser is always up to date.
@@ -1241,7 +1245,7 @@ gst_h265_parser_parse_buffering_period (GstH265Parser * parser,
   GstH265SPS *sps;
   guint8 sps_id;
   guint i;
-  guint n;
+  guint n, cpb_cnt;
 
   GST_DEBUG ("parsing \"Buffering period\"");
 
@@ -1267,38 +1271,39 @@ gst_h265_parser_parse_buffering_period (GstH265Parser * parser,
       READ_UINT8 (nr, per->irap_cpb_params_present_flag, 1);
 
     if (per->irap_cpb_params_present_flag) {
-      READ_UINT8 (nr, per->cpb_delay_offset,
+      READ_UINT32 (nr, per->cpb_delay_offset,
           (hrd->au_cpb_removal_delay_length_minus1 + 1));
-      READ_UINT8 (nr, per->dpb_delay_offset,
+      READ_UINT32 (nr, per->dpb_delay_offset,
           (hrd->dpb_output_delay_length_minus1 + 1));
     }
 
     n = hrd->initial_cpb_removal_delay_length_minus1 + 1;
+    cpb_cnt = hrd->cpb_cnt_minus1[sps->max_sub_layers_minus1] + 1;
 
     READ_UINT8 (nr, per->concatenation_flag, 1);
-    READ_UINT8 (nr, per->au_cpb_removal_delay_delta_minus1,
+    READ_UINT32 (nr, per->au_cpb_removal_delay_delta_minus1,
         (hrd->au_cpb_removal_delay_length_minus1 + 1));
 
     if (hrd->nal_hrd_parameters_present_flag) {
-      for (i = 0; i <= hrd->cpb_cnt_minus1[i]; i++) {
-        READ_UINT8 (nr, per->nal_initial_cpb_removal_delay[i], n);
-        READ_UINT8 (nr, per->nal_initial_cpb_removal_offset[i], n);
+      for (i = 0; i < cpb_cnt; i++) {
+        READ_UINT32 (nr, per->nal_initial_cpb_removal_delay[i], n);
+        READ_UINT32 (nr, per->nal_initial_cpb_removal_offset[i], n);
         if (hrd->sub_pic_hrd_params_present_flag
             || per->irap_cpb_params_present_flag) {
-          READ_UINT8 (nr, per->nal_initial_alt_cpb_removal_delay[i], n);
-          READ_UINT8 (nr, per->nal_initial_alt_cpb_removal_offset[i], n);
+          READ_UINT32 (nr, per->nal_initial_alt_cpb_removal_delay[i], n);
+          READ_UINT32 (nr, per->nal_initial_alt_cpb_removal_offset[i], n);
         }
       }
     }
 
     if (hrd->vcl_hrd_parameters_present_flag) {
-      for (i = 0; i <= hrd->cpb_cnt_minus1[i]; i++) {
-        READ_UINT8 (nr, per->vcl_initial_cpb_removal_delay[i], n);
-        READ_UINT8 (nr, per->vcl_initial_cpb_removal_offset[i], n);
+      for (i = 0; i < cpb_cnt; i++) {
+        READ_UINT32 (nr, per->vcl_initial_cpb_removal_delay[i], n);
+        READ_UINT32 (nr, per->vcl_initial_cpb_removal_offset[i], n);
         if (hrd->sub_pic_hrd_params_present_flag
             || per->irap_cpb_params_present_flag) {
-          READ_UINT8 (nr, per->vcl_initial_alt_cpb_removal_delay[i], n);
-          READ_UINT8 (nr, per->vcl_initial_alt_cpb_removal_offset[i], n);
+          READ_UINT32 (nr, per->vcl_initial_alt_cpb_removal_delay[i], n);
+          READ_UINT32 (nr, per->vcl_initial_alt_cpb_removal_offset[i], n);
         }
       }
     }
@@ -1317,6 +1322,7 @@ gst_h265_parser_parse_pic_timing (GstH265Parser * parser,
 {
   GstH265ProfileTierLevel *profile_tier_level;
   guint i;
+  guint max_du;
 
   GST_DEBUG ("parsing \"Picture timing\"");
   if (!parser->last_sps || !parser->last_sps->valid) {
@@ -1353,35 +1359,38 @@ gst_h265_parser_parse_pic_timing (GstH265Parser * parser,
     if (vui->hrd_parameters_present_flag) {
       GstH265HRDParams *hrd = &vui->hrd_params;
 
-      READ_UINT8 (nr, tim->au_cpb_removal_delay_minus1,
+      READ_UINT32 (nr, tim->au_cpb_removal_delay_minus1,
           (hrd->au_cpb_removal_delay_length_minus1 + 1));
-      READ_UINT8 (nr, tim->pic_dpb_output_delay,
+      READ_UINT32 (nr, tim->pic_dpb_output_delay,
           (hrd->dpb_output_delay_length_minus1 + 1));
 
       if (hrd->sub_pic_hrd_params_present_flag)
-        READ_UINT8 (nr, tim->pic_dpb_output_du_delay,
+        READ_UINT32 (nr, tim->pic_dpb_output_du_delay,
             (hrd->dpb_output_delay_du_length_minus1 + 1));
 
       if (hrd->sub_pic_hrd_params_present_flag
           && hrd->sub_pic_cpb_params_in_pic_timing_sei_flag) {
-        READ_UE (nr, tim->num_decoding_units_minus1);
+        /* at most one decoding unit per CTB, and CTBs are at least 16x16 */
+        max_du = ((parser->last_sps->pic_width_in_luma_samples + 15) / 16) *
+            ((parser->last_sps->pic_height_in_luma_samples + 15) / 16);
+        READ_UE_ALLOWED (nr, tim->num_decoding_units_minus1, 0, max_du - 1);
 
         READ_UINT8 (nr, tim->du_common_cpb_removal_delay_flag, 1);
         if (tim->du_common_cpb_removal_delay_flag)
-          READ_UINT8 (nr, tim->du_common_cpb_removal_delay_increment_minus1,
+          READ_UINT32 (nr, tim->du_common_cpb_removal_delay_increment_minus1,
               (hrd->du_cpb_removal_delay_increment_length_minus1 + 1));
 
         tim->num_nalus_in_du_minus1 =
             g_new0 (guint32, (tim->num_decoding_units_minus1 + 1));
         tim->du_cpb_removal_delay_increment_minus1 =
-            g_new0 (guint8, (tim->num_decoding_units_minus1 + 1));
+            g_new0 (guint32, (tim->num_decoding_units_minus1 + 1));
 
-        for (i = 0; i <= (tim->num_decoding_units_minus1 + 1); i++) {
+        for (i = 0; i <= tim->num_decoding_units_minus1; i++) {
           READ_UE (nr, tim->num_nalus_in_du_minus1[i]);
 
           if (!tim->du_common_cpb_removal_delay_flag
               && (i < tim->num_decoding_units_minus1))
-            READ_UINT8 (nr, tim->du_cpb_removal_delay_increment_minus1[i],
+            READ_UINT32 (nr, tim->du_cpb_removal_delay_increment_minus1[i],
                 (hrd->du_cpb_removal_delay_increment_length_minus1 + 1));
         }
       }
@@ -1394,6 +1403,64 @@ error:
   return GST_H265_PARSER_ERROR;
 }
 
+static GstH265ParserResult
+gst_h265_parser_parse_registered_user_data (GstH265Parser * parser,
+    GstH265RegisteredUserData * rud, NalReader * nr, guint payload_size)
+{
+  guint8 *data = NULL;
+  guint i;
+
+  GST_DEBUG ("parsing \"Registered user data\"");
+
+  if (payload_size < 1)
+    goto error;
+
+  READ_UINT8 (nr, rud->country_code, 8);
+  --payload_size;
+
+  if (rud->country_code == 0xff) {
+    if (payload_size < 1)
+      goto error;
+
+    READ_UINT8 (nr, rud->country_code_extension, 8);
+    --payload_size;
+  }
+
+  if (payload_size > nal_reader_get_remaining (nr) / 8)
+    goto error;
+
+  data = g_malloc (payload_size);
+  for (i = 0; i < payload_size; i++)
+    READ_UINT8 (nr, data[i], 8);
+
+  rud->data = data;
+  rud->size = payload_size;
+
+  return GST_H265_PARSER_OK;
+
+error:
+  GST_WARNING ("error parsing \"Registered user data\"");
+  g_free (data);
+  return GST_H265_PARSER_ERROR;
+}
+
+static GstH265ParserResult
+gst_h265_parser_parse_recovery_point (GstH265Parser * parser,
+    GstH265RecoveryPoint * rp, NalReader * nr)
+{
+  GST_DEBUG ("parsing \"Recovery point\"");
+
+  READ_SE (nr, rp->recovery_poc_cnt);
+  READ_UINT8 (nr, rp->exact_match_flag, 1);
+  READ_UINT8 (nr, rp->broken_link_flag, 1);
+
+  return GST_H265_PARSER_OK;
+
+error:
+  GST_WARNING ("error parsing \"Recovery point\"");
+  return GST_H265_PARSER_ERROR;
+}
+
 /******** API *************/
 
 /**
@@ -1424,6 +1491,9 @@ gst_h265_parser_new (void)
 void
 gst_h265_parser_free (GstH265Parser * parser)
 {
+  if (parser->slice_pool)
+    g_thread_pool_free (parser->slice_pool, FALSE, TRUE);
+
   g_slice_free (GstH265Parser, parser);
   parser = NULL;
 }
@@ -2492,7 +2562,8 @@ gst_h265_parser_parse_sei (GstH265Parser * parser,
 #endif
   GstH265ParserResult res;
   GST_DEBUG ("parsing \"Sei message\"");
-  nal_reader_init (&nr, nalu->data + nalu->offset + 1, nalu->size - 1);
+  nal_reader_init (&nr, nalu->data + nalu->offset + nalu->header_bytes,
+      nalu->size - nalu->header_bytes);
   /* init */
   memset (sei, 0, sizeof (*sei));
   sei->payloadType = 0;
@@ -2521,6 +2592,12 @@ gst_h265_parser_parse_sei (GstH265Parser * parser,
     /* size not set; might depend on emulation_prevention_three_byte */
     res = gst_h265_parser_parse_pic_timing (parser,
         &sei->payload.pic_timing, &nr);
+  } else if (sei->payloadType == GST_H265_SEI_REGISTERED_USER_DATA) {
+    res = gst_h265_parser_parse_registered_user_data (parser,
+        &sei->payload.registered_user_data, &nr, payloadSize);
+  } else if (sei->payloadType == GST_H265_SEI_RECOVERY_POINT) {
+    res = gst_h265_parser_parse_recovery_point (parser,
+        &sei->payload.recovery_point, &nr);
   } else
     res = GST_H265_PARSER_OK;
 
@@ -2533,6 +2610,223 @@ error:
   return GST_H265_PARSER_ERROR;
 }
 
+typedef struct
+{
+  GMutex lock;
+  GCond cond;
+  guint pending;
+} SliceJobSync;
+
+typedef struct
+{
+  GstH265Parser *parser;
+  GstH265AUNalUnit *au_nal;
+  SliceJobSync *sync;
+} SliceJob;
+
+static inline gboolean
+gst_h265_nal_type_is_slice (guint8 type)
+{
+  return type <= GST_H265_NAL_SLICE_RASL_R ||
+      (type >= GST_H265_NAL_SLICE_BLA_W_LP && type <= GST_H265_NAL_SLICE_CRA_NUT);
+}
+
+static void
+gst_h265_parser_slice_job (gpointer data, gpointer user_data)
+{
+  SliceJob *job = data;
+
+  /* only reads the parameter sets, which don't change while the
+   * access unit is being parsed */
+  job->au_nal->result = gst_h265_parser_parse_slice_hdr (job->parser,
+      &job->au_nal->nalu, &job->au_nal->slice);
+
+  g_mutex_lock (&job->sync->lock);
+  if (--job->sync->pending == 0)
+    g_cond_signal (&job->sync->cond);
+  g_mutex_unlock (&job->sync->lock);
+}
+
+static gboolean
+gst_h265_parser_parse_slices_parallel (GstH265Parser * parser, GArray * nals,
+    guint n_slices)
+{
+  SliceJobSync sync;
+  SliceJob *jobs;
+  GError *err = NULL;
+  guint i, n = 0;
+
+  if (!parser->slice_pool) {
+    parser->slice_pool = g_thread_pool_new (gst_h265_parser_slice_job, NULL,
+        parser->max_threads, FALSE, &err);
+    if (!parser->slice_pool) {
+      GST_WARNING ("failed to create slice parsing pool: %s", err->message);
+      g_clear_error (&err);
+      return FALSE;
+    }
+  }
+
+  g_mutex_init (&sync.lock);
+  g_cond_init (&sync.cond);
+  sync.pending = n_slices;
+
+  jobs = g_new (SliceJob, n_slices);
+  for (i = 0; i < nals->len; i++) {
+    GstH265AUNalUnit *au_nal = &g_array_index (nals, GstH265AUNalUnit, i);
+
+    if (!gst_h265_nal_type_is_slice (au_nal->nalu.type))
+      continue;
+
+    jobs[n].parser = parser;
+    jobs[n].au_nal = au_nal;
+    jobs[n].sync = &sync;
+    g_thread_pool_push (parser->slice_pool, &jobs[n], NULL);
+    n++;
+  }
+
+  g_mutex_lock (&sync.lock);
+  while (sync.pending > 0)
+    g_cond_wait (&sync.cond, &sync.lock);
+  g_mutex_unlock (&sync.lock);
+
+  g_free (jobs);
+  g_cond_clear (&sync.cond);
+  g_mutex_clear (&sync.lock);
+
+  return TRUE;
+}
+
+/**
+ * gst_h265_parser_parse_au:
+ * @parser: a #GstH265Parser
+ * @data: The data of one complete access unit
+ * @size: the size of @data
+ * @nal_length_size: the size in bytes of the HEVC nal length prefix, or 0
+ *   if @data is in byte-stream format
+ * @nals: a #GArray of #GstH265AUNalUnit to append the nal units to
+ *
+ * Identifies all nal units of the access unit in @data and parses them.
+ *
+ * Parameter sets and SEI messages are parsed first, in bitstream order,
+ * so that @parser is up to date when the slice headers are parsed. If
+ * there is more than one slice segment and more than one thread was
+ * allowed with gst_h265_parser_set_max_threads(), slice headers are then
+ * parsed in parallel. Each nal unit is stored at its bitstream position in
+ * @nals, so the result does not depend on the order in which the workers
+ * complete.
+ *
+ * The per nal unit results are stored in the appended #GstH265AUNalUnit,
+ * which shall be deallocated with gst_h265_au_nal_unit_free().
+ *
+ * Returns: a #GstH265ParserResult, #GST_H265_PARSER_OK if all nal units
+ * could be identified
+ */
+GstH265ParserResult
+gst_h265_parser_parse_au (GstH265Parser * parser, const guint8 * data,
+    gsize size, guint8 nal_length_size, GArray * nals)
+{
+  GstH265AUNalUnit au_nal;
+  GstH265ParserResult res;
+  guint offset = 0, first = nals->len;
+  guint i, n_slices = 0;
+
+  g_return_val_if_fail (parser != NULL, GST_H265_PARSER_ERROR);
+  g_return_val_if_fail (nals != NULL, GST_H265_PARSER_ERROR);
+  g_return_val_if_fail (g_array_get_element_size (nals) ==
+      sizeof (GstH265AUNalUnit), GST_H265_PARSER_ERROR);
+
+  while (offset < size) {
+    memset (&au_nal, 0, sizeof (au_nal));
+
+    if (nal_length_size > 0) {
+      res = gst_h265_parser_identify_nalu_hevc (parser, data, offset, size,
+          nal_length_size, &au_nal.nalu);
+    } else {
+      res = gst_h265_parser_identify_nalu (parser, data, offset, size,
+          &au_nal.nalu);
+      /* the last nal unit ends with the access unit */
+      if (res == GST_H265_PARSER_NO_NAL_END) {
+        au_nal.nalu.size = size - au_nal.nalu.offset;
+        res = GST_H265_PARSER_OK;
+      } else if (res == GST_H265_PARSER_NO_NAL && nals->len > first) {
+        /* trailing zero bytes */
+        break;
+      }
+    }
+
+    if (res != GST_H265_PARSER_OK) {
+      GST_DEBUG ("failed to identify nal unit at offset %u", offset);
+      return res;
+    }
+
+    offset = au_nal.nalu.offset + au_nal.nalu.size;
+
+    switch (au_nal.nalu.type) {
+      case GST_H265_NAL_VPS:
+      case GST_H265_NAL_SPS:
+      case GST_H265_NAL_PPS:
+        au_nal.result = gst_h265_parser_parse_nal (parser, &au_nal.nalu);
+        break;
+      case GST_H265_NAL_PREFIX_SEI:
+      case GST_H265_NAL_SUFFIX_SEI:
+        au_nal.result = gst_h265_parser_parse_sei (parser, &au_nal.nalu,
+            &au_nal.sei);
+        break;
+      default:
+        if (gst_h265_nal_type_is_slice (au_nal.nalu.type))
+          n_slices++;
+        au_nal.result = GST_H265_PARSER_OK;
+        break;
+    }
+
+    g_array_append_val (nals, au_nal);
+  }
+
+  GST_DEBUG ("access unit with %u nal units, %u slice segments",
+      nals->len - first, n_slices);
+
+  if (n_slices > 1 && parser->max_threads > 1 &&
+      gst_h265_parser_parse_slices_parallel (parser, nals, n_slices))
+    return GST_H265_PARSER_OK;
+
+  for (i = first; i < nals->len; i++) {
+    GstH265AUNalUnit *entry = &g_array_index (nals, GstH265AUNalUnit, i);
+
+    if (gst_h265_nal_type_is_slice (entry->nalu.type))
+      entry->result = gst_h265_parser_parse_slice_hdr (parser, &entry->nalu,
+          &entry->slice);
+  }
+
+  return GST_H265_PARSER_OK;
+}
+
+/**
+ * gst_h265_parser_set_max_threads:
+ * @parser: a #GstH265Parser
+ * @max_threads: the maximum number of worker threads, 0 or 1 to parse
+ *   serially
+ *
+ * Sets how many threads gst_h265_parser_parse_au() may use to parse the
+ * slice headers of one access unit.
+ */
+void
+gst_h265_parser_set_max_threads (GstH265Parser * parser, guint max_threads)
+{
+  g_return_if_fail (parser != NULL);
+
+  parser->max_threads = max_threads;
+
+  if (!parser->slice_pool)
+    return;
+
+  if (max_threads > 1) {
+    g_thread_pool_set_max_threads (parser->slice_pool, max_threads, NULL);
+  } else {
+    g_thread_pool_free (parser->slice_pool, FALSE, TRUE);
+    parser->slice_pool = NULL;
+  }
+}
+
 /**
  * gst_h265_slice_hdr_copy:
  * @dst_slice: The destination #GstH265SliceHdr to copy into
@@ -2608,11 +2902,11 @@ gst_h265_sei_copy (GstH265SEIMessage * dst_sei,
     GstH265PicTiming *dst_pic_timing = &dst_sei->payload.pic_timing;
     const GstH265PicTiming *src_pic_timing = &src_sei->payload.pic_timing;
 
-    if (dst_pic_timing->num_decoding_units_minus1 > 0) {
+    if (src_pic_timing->num_nalus_in_du_minus1) {
       dst_pic_timing->num_nalus_in_du_minus1 =
           g_new0 (guint32, (dst_pic_timing->num_decoding_units_minus1 + 1));
       dst_pic_timing->du_cpb_removal_delay_increment_minus1 =
-          g_new0 (guint8, (dst_pic_timing->num_decoding_units_minus1 + 1));
+          g_new0 (guint32, (dst_pic_timing->num_decoding_units_minus1 + 1));
 
       for (i = 0; i <= dst_pic_timing->num_decoding_units_minus1; i++) {
         dst_pic_timing->num_nalus_in_du_minus1[i] =
@@ -2621,6 +2915,12 @@ gst_h265_sei_copy (GstH265SEIMessage * dst_sei,
             src_pic_timing->du_cpb_removal_delay_increment_minus1[i];
       }
     }
+  } else if (dst_sei->payloadType == GST_H265_SEI_REGISTERED_USER_DATA) {
+    GstH265RegisteredUserData *dst_rud = &dst_sei->payload.registered_user_data;
+    const GstH265RegisteredUserData *src_rud =
+        &src_sei->payload.registered_user_data;
+
+    dst_rud->data = g_memdup (src_rud->data, src_rud->size);
   }
 
   return TRUE;
@@ -2639,11 +2939,31 @@ gst_h265_sei_free (GstH265SEIMessage * sei)
 
   if (sei->payloadType == GST_H265_SEI_PIC_TIMING) {
     GstH265PicTiming *pic_timing = &sei->payload.pic_timing;
-    if (pic_timing->num_decoding_units_minus1 > 0) {
-      g_free (pic_timing->num_nalus_in_du_minus1);
-      g_free (pic_timing->du_cpb_removal_delay_increment_minus1);
-    }
+    g_free (pic_timing->num_nalus_in_du_minus1);
+    g_free (pic_timing->du_cpb_removal_delay_increment_minus1);
     pic_timing->num_nalus_in_du_minus1 = 0;
     pic_timing->du_cpb_removal_delay_increment_minus1 = 0;
+  } else if (sei->payloadType == GST_H265_SEI_REGISTERED_USER_DATA) {
+    GstH265RegisteredUserData *rud = &sei->payload.registered_user_data;
+    g_free (rud->data);
+    rud->data = NULL;
   }
 }
+
+/**
+ * gst_h265_au_nal_unit_free:
+ * @au_nal: The #GstH265AUNalUnit to free
+ *
+ * Frees @au_nal fields.
+ */
+void
+gst_h265_au_nal_unit_free (GstH265AUNalUnit * au_nal)
+{
+  g_return_if_fail (au_nal != NULL);
+
+  if (gst_h265_nal_type_is_slice (au_nal->nalu.type))
+    gst_h265_slice_hdr_free (&au_nal->slice);
+  else if (au_nal->nalu.type == GST_H265_NAL_PREFIX_SEI
+      || au_nal->nalu.type == GST_H265_NAL_SUFFIX_SEI)
+    gst_h265_sei_free (&au_nal->sei);
+}
@@ -154,6 +154,9 @@ typedef enum
  * GstH265SEIPayloadType:
  * @GST_H265_SEI_BUF_PERIOD: Buffering Period SEI Message
  * @GST_H265_SEI_PIC_TIMING: Picture Timing SEI Message
+ * @GST_H265_SEI_REGISTERED_USER_DATA: Registered user data (ITU-T T.35)
+ *   SEI Message
+ * @GST_H265_SEI_RECOVERY_POINT: Recovery Point SEI Message
  * ...
  *
  * The type of SEI message.
@@ -161,7 +164,9 @@ typedef enum
 typedef enum
 {
   GST_H265_SEI_BUF_PERIOD = 0,
-  GST_H265_SEI_PIC_TIMING = 1
+  GST_H265_SEI_PIC_TIMING = 1,
+  GST_H265_SEI_REGISTERED_USER_DATA = 4,
+  GST_H265_SEI_RECOVERY_POINT = 6
       /* and more...  */
 } GstH265SEIPayloadType;
 
@@ -247,8 +252,12 @@ typedef struct _GstH265SliceHdr               GstH265SliceHdr;
 
 typedef struct _GstH265PicTiming              GstH265PicTiming;
 typedef struct _GstH265BufferingPeriod        GstH265BufferingPeriod;
+typedef struct _GstH265RegisteredUserData     GstH265RegisteredUserData;
+typedef struct _GstH265RecoveryPoint          GstH265RecoveryPoint;
 typedef struct _GstH265SEIMessage             GstH265SEIMessage;
 
+typedef struct _GstH265AUNalUnit              GstH265AUNalUnit;
+
 /**
  * GstH265NalUnit:
  * @type: A #GstH265NalUnitType
@@ -920,14 +929,14 @@ struct _GstH265PicTiming
   guint8 source_scan_type;
   guint8 duplicate_flag;
 
-  guint8 au_cpb_removal_delay_minus1;
-  guint8 pic_dpb_output_delay;
-  guint8 pic_dpb_output_du_delay;
+  guint32 au_cpb_removal_delay_minus1;
+  guint32 pic_dpb_output_delay;
+  guint32 pic_dpb_output_du_delay;
   guint32 num_decoding_units_minus1;
   guint8 du_common_cpb_removal_delay_flag;
-  guint8 du_common_cpb_removal_delay_increment_minus1;
+  guint32 du_common_cpb_removal_delay_increment_minus1;
   guint32 *num_nalus_in_du_minus1;
-  guint8 *du_cpb_removal_delay_increment_minus1;
+  guint32 *du_cpb_removal_delay_increment_minus1;
 };
 
 struct _GstH265BufferingPeriod
@@ -935,22 +944,59 @@ struct _GstH265BufferingPeriod
   GstH265SPS *sps;
 
   guint8 irap_cpb_params_present_flag;
-  guint8 cpb_delay_offset;
-  guint8 dpb_delay_offset;
+  guint32 cpb_delay_offset;
+  guint32 dpb_delay_offset;
   guint8 concatenation_flag;
-  guint8 au_cpb_removal_delay_delta_minus1;
+  guint32 au_cpb_removal_delay_delta_minus1;
 
   /* seq->vui_parameters->nal_hrd_parameters_present_flag */
-  guint8 nal_initial_cpb_removal_delay[32];
-  guint8 nal_initial_cpb_removal_offset[32];
-  guint8 nal_initial_alt_cpb_removal_delay[32];
-  guint8 nal_initial_alt_cpb_removal_offset [32];
+  guint32 nal_initial_cpb_removal_delay[32];
+  guint32 nal_initial_cpb_removal_offset[32];
+  guint32 nal_initial_alt_cpb_removal_delay[32];
+  guint32 nal_initial_alt_cpb_removal_offset [32];
 
   /* seq->vui_parameters->vcl_hrd_parameters_present_flag */
-  guint8 vcl_initial_cpb_removal_delay[32];
-  guint8 vcl_initial_cpb_removal_offset[32];
-  guint8 vcl_initial_alt_cpb_removal_delay[32];
-  guint8 vcl_initial_alt_cpb_removal_offset[32];
+  guint32 vcl_initial_cpb_removal_delay[32];
+  guint32 vcl_initial_cpb_removal_offset[32];
+  guint32 vcl_initial_alt_cpb_removal_delay[32];
+  guint32 vcl_initial_alt_cpb_removal_offset[32];
+};
+
+/**
+ * GstH265RegisteredUserData:
+ * @country_code: an itu_t_t35_country_code
+ * @country_code_extension: an itu_t_t35_country_code_extension_byte, only
+ *   valid if @country_code is 0xff
+ * @data: the remaining payload bytes, starting with the terminal provider
+ *   code
+ * @size: the size of @data in bytes
+ *
+ * The User data registered by Rec. ITU-T T.35 SEI message.
+ */
+struct _GstH265RegisteredUserData
+{
+  guint8 country_code;
+  guint8 country_code_extension;
+  guint8 *data;
+  guint size;
+};
+
+/**
+ * GstH265RecoveryPoint:
+ * @recovery_poc_cnt: the recovery point of decoded pictures in output
+ *   order, as a picture order count offset
+ * @exact_match_flag: %TRUE if decoding from the associated picture gives
+ *   an exact match at the recovery point
+ * @broken_link_flag: %TRUE if pictures preceding the associated picture
+ *   in decoding order may not be available
+ *
+ * The Recovery Point SEI message.
+ */
+struct _GstH265RecoveryPoint
+{
+  gint32 recovery_poc_cnt;
+  guint8 exact_match_flag;
+  guint8 broken_link_flag;
 };
 
 struct _GstH265SEIMessage
@@ -960,10 +1006,33 @@ struct _GstH265SEIMessage
   union {
     GstH265BufferingPeriod buffering_period;
     GstH265PicTiming pic_timing;
+    GstH265RegisteredUserData registered_user_data;
+    GstH265RecoveryPoint recovery_point;
     /* ... could implement more */
   } payload;
 };
 
+/**
+ * GstH265AUNalUnit:
+ * @nalu: The identified #GstH265NalUnit
+ * @result: The result of parsing @nalu
+ * @slice: The slice header if @nalu is a slice segment, valid if @result
+ *   is #GST_H265_PARSER_OK
+ * @sei: The SEI message if @nalu is a SEI nal unit, valid if @result
+ *   is #GST_H265_PARSER_OK
+ *
+ * One nal unit of an access unit, as filled by gst_h265_parser_parse_au().
+ * Its fields shall be deallocated with gst_h265_au_nal_unit_free().
+ */
+struct _GstH265AUNalUnit
+{
+  GstH265NalUnit nalu;
+  GstH265ParserResult result;
+
+  GstH265SliceHdr slice;
+  GstH265SEIMessage sei;
+};
+
 /**
  * GstH265Parser:
  *
@@ -978,6 +1047,10 @@ struct _GstH265Parser
   GstH265VPS *last_vps;
   GstH265SPS *last_sps;
   GstH265PPS *last_pps;
+
+  /* worker pool for gst_h265_parser_parse_au() */
+  GThreadPool *slice_pool;
+  guint max_threads;
 };
 
 GstH265Parser *     gst_h265_parser_new               (void);
@@ -1025,6 +1098,15 @@ GstH265ParserResult gst_h265_parser_parse_sei       (GstH265Parser   * parser,
                                                      GstH265NalUnit  * nalu,
                                                      GstH265SEIMessage * sei);
 
+GstH265ParserResult gst_h265_parser_parse_au        (GstH265Parser   * parser,
+                                                     const guint8    * data,
+                                                     gsize             size,
+                                                     guint8            nal_length_size,
+                                                     GArray          * nals);
+
+void                gst_h265_parser_set_max_threads (GstH265Parser   * parser,
+                                                     guint             max_threads);
+
 void                gst_h265_parser_free            (GstH265Parser  * parser);
 
 GstH265ParserResult gst_h265_parse_vps              (GstH265NalUnit * nalu,
@@ -1049,5 +1131,7 @@ gboolean            gst_h265_sei_copy       (GstH265SEIMessage       * dest_sei,
 
 void                gst_h265_sei_free       (GstH265SEIMessage * sei);
 
+void                gst_h265_au_nal_unit_free (GstH265AUNalUnit * au_nal);
+
 G_END_DECLS
 #endif
@@ -427,6 +427,10 @@ failed:
 }
 
 /*** bitplanes decoding ***/
+
+/* Number of bitplanes stored in a #GstVC1BitPlanes */
+#define N_BITPLANES 7
+
 static gboolean
 bitplane_decoding (GstBitReader * br, guint8 * data,
     GstVC1SeqHdr * seqhdr, guint8 * is_raw)
@@ -2000,7 +2004,12 @@ gst_vc1_parse_frame_layer (const guint8 * data, gsize size,
  * @seqhdr: The #GstVC1SeqHdr currently being parsed
  * @bitplanes: The #GstVC1BitPlanes to store bitplanes in or %NULL
  *
- * Parses @data, and fills @entrypoint fields.
+ * Parses @data, and fills @framehdr fields.
+ *
+ * If @bitplanes is %NULL the bitplanes are skipped over without being
+ * stored. This headers only mode does not allocate any memory and is
+ * enough for callers that only need the picture type and the other
+ * header fields, like parsers.
  *
  * Returns: a #GstVC1ParserResult
  */
@@ -2131,13 +2140,18 @@ gst_vc1_bitplanes_free (GstVC1BitPlanes * bitplanes)
 void
 gst_vc1_bitplanes_free_1 (GstVC1BitPlanes * bitplanes)
 {
-  g_free (bitplanes->acpred);
-  g_free (bitplanes->fieldtx);
-  g_free (bitplanes->overflags);
-  g_free (bitplanes->mvtypemb);
-  g_free (bitplanes->skipmb);
-  g_free (bitplanes->directmb);
-  g_free (bitplanes->forwardmb);
+  g_free (bitplanes->arena);
+  bitplanes->arena = NULL;
+  bitplanes->capacity = 0;
+  bitplanes->size = 0;
+
+  bitplanes->acpred = NULL;
+  bitplanes->fieldtx = NULL;
+  bitplanes->overflags = NULL;
+  bitplanes->mvtypemb = NULL;
+  bitplanes->skipmb = NULL;
+  bitplanes->directmb = NULL;
+  bitplanes->forwardmb = NULL;
 }
 
 /**
@@ -2150,41 +2164,37 @@ gst_vc1_bitplanes_free_1 (GstVC1BitPlanes * bitplanes)
  * in simple or main mode, or after #gst_vc1_parse_entry_point_header
  * if in advanced mode.
  *
+ * All the bitplanes are stored in a single block of memory that is
+ * only reallocated when the macroblock count grows, so this can be
+ * called for every frame without allocating.
+ *
  * Returns: %TRUE if everything went fine, %FALSE otherwize
  */
 gboolean
 gst_vc1_bitplanes_ensure_size (GstVC1BitPlanes * bitplanes,
     GstVC1SeqHdr * seqhdr)
 {
+  guint size;
+
   g_return_val_if_fail (bitplanes != NULL, FALSE);
   g_return_val_if_fail (seqhdr != NULL, FALSE);
 
-  if (bitplanes->size) {
-    bitplanes->size = seqhdr->mb_height * seqhdr->mb_stride;
-    bitplanes->acpred =
-        g_realloc_n (bitplanes->acpred, bitplanes->size, sizeof (guint8));
-    bitplanes->fieldtx =
-        g_realloc_n (bitplanes->fieldtx, bitplanes->size, sizeof (guint8));
-    bitplanes->overflags =
-        g_realloc_n (bitplanes->overflags, bitplanes->size, sizeof (guint8));
-    bitplanes->mvtypemb =
-        g_realloc_n (bitplanes->mvtypemb, bitplanes->size, sizeof (guint8));
-    bitplanes->skipmb =
-        g_realloc_n (bitplanes->skipmb, bitplanes->size, sizeof (guint8));
-    bitplanes->directmb =
-        g_realloc_n (bitplanes->directmb, bitplanes->size, sizeof (guint8));
-    bitplanes->forwardmb =
-        g_realloc_n (bitplanes->forwardmb, bitplanes->size, sizeof (guint8));
-  } else {
-    bitplanes->size = seqhdr->mb_height * seqhdr->mb_stride;
-    bitplanes->acpred = g_malloc0 (bitplanes->size * sizeof (guint8));
-    bitplanes->fieldtx = g_malloc0 (bitplanes->size * sizeof (guint8));
-    bitplanes->overflags = g_malloc0 (bitplanes->size * sizeof (guint8));
-    bitplanes->mvtypemb = g_malloc0 (bitplanes->size * sizeof (guint8));
-    bitplanes->skipmb = g_malloc0 (bitplanes->size * sizeof (guint8));
-    bitplanes->directmb = g_malloc0 (bitplanes->size * sizeof (guint8));
-    bitplanes->forwardmb = g_malloc0 (bitplanes->size * sizeof (guint8));
+  size = seqhdr->mb_height * seqhdr->mb_stride;
+
+  if (size > bitplanes->capacity) {
+    g_free (bitplanes->arena);
+    bitplanes->arena = g_malloc0_n (size, N_BITPLANES);
+    bitplanes->capacity = size;
   }
 
+  bitplanes->size = size;
+  bitplanes->acpred = bitplanes->arena;
+  bitplanes->fieldtx = bitplanes->acpred + size;
+  bitplanes->overflags = bitplanes->fieldtx + size;
+  bitplanes->mvtypemb = bitplanes->overflags + size;
+  bitplanes->skipmb = bitplanes->mvtypemb + size;
+  bitplanes->directmb = bitplanes->skipmb + size;
+  bitplanes->forwardmb = bitplanes->directmb + size;
+
   return TRUE;
 }
@@ -473,6 +473,11 @@ struct _GstVC1BitPlanes
   guint8  *forwardmb;
 
   guint size; /* Size of the arrays */
+
+  /*< private >*/
+  /* single block backing all the arrays, only ever grows */
+  guint8  *arena;
+  guint capacity;
 };
 
 struct _GstVC1VopDquant
@@ -0,0 +1,446 @@
+/* GStreamer
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * gstabrcontroller.c:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Adaptive bitrate controller shared by the adaptive streaming demuxers.
+ *
+ * The throughput is estimated from the download samples with two
+ * exponentially weighted moving averages, weighted by the download
+ * duration, and a harmonic mean of the last samples. The lowest of the
+ * three is used, so the estimate drops quickly and only recovers once the
+ * throughput is stable.
+ *
+ * The buffer policy is BOLA-BASIC: the bitrate maximising
+ * (V * (utility + gp) - buffer level) / bitrate is selected, utility being
+ * the log of the bitrate relative to the lowest one. Switching up is
+ * limited by the throughput estimate to avoid oscillations (BOLA-O).
+ */
+
+#include <math.h>
+#include <string.h>
+#include "gstabrcontroller.h"
+#include "gsturidownloader_debug.h"
+
+#define GST_CAT_DEFAULT uridownloader_debug
+
+/* half-lives of the moving averages, in seconds of download */
+#define FAST_EWMA_HALF_LIFE 3.0
+#define SLOW_EWMA_HALF_LIFE 8.0
+
+/* switching up needs the throughput to be this much higher than the
+ * new bitrate */
+#define UP_SWITCH_MARGIN 1.1
+
+/* BOLA utility offset, the higher it is the sooner the buffer policy
+ * switches up */
+#define BOLA_GP 5.0
+
+#define DEFAULT_BANDWIDTH_USAGE 0.8
+#define DEFAULT_BUFFER_TARGET (30 * GST_SECOND)
+
+GType
+gst_abr_policy_get_type (void)
+{
+  static volatile gsize abr_policy_type = 0;
+  /* the custom policy is left out: the demuxers using this type for their
+   * properties have no way to set a selection function */
+  static const GEnumValue abr_policies[] = {
+    {GST_ABR_POLICY_THROUGHPUT, "Throughput based", "throughput"},
+    {GST_ABR_POLICY_BUFFER, "Buffer occupancy based (BOLA)", "buffer"},
+    {GST_ABR_POLICY_HYBRID, "Throughput while buffering, buffer occupancy "
+          "afterwards", "hybrid"},
+    {0, NULL, NULL}
+  };
+
+  if (g_once_init_enter (&abr_policy_type)) {
+    GType tmp = g_enum_register_static ("GstAbrPolicy", abr_policies);
+    g_once_init_leave (&abr_policy_type, tmp);
+  }
+
+  return (GType) abr_policy_type;
+}
+
+void
+gst_abr_controller_init (GstAbrController * abr)
+{
+  memset (abr, 0, sizeof (GstAbrController));
+  g_mutex_init (&abr->lock);
+  abr->policy = GST_ABR_POLICY_HYBRID;
+  abr->bandwidth_usage = DEFAULT_BANDWIDTH_USAGE;
+  abr->buffer_target = DEFAULT_BUFFER_TARGET;
+}
+
+void
+gst_abr_controller_clear (GstAbrController * abr)
+{
+  gst_abr_controller_set_select_func (abr, NULL, NULL, NULL);
+  g_mutex_clear (&abr->lock);
+}
+
+/* forgets about the throughput measured so far */
+void
+gst_abr_controller_reset (GstAbrController * abr)
+{
+  g_mutex_lock (&abr->lock);
+  abr->fast_ewma = 0;
+  abr->slow_ewma = 0;
+  abr->fast_weight = 0;
+  abr->slow_weight = 0;
+  abr->history_length = 0;
+  abr->history_pos = 0;
+  abr->last_throughput = 0;
+  g_mutex_unlock (&abr->lock);
+}
+
+void
+gst_abr_controller_set_policy (GstAbrController * abr, GstAbrPolicy policy)
+{
+  g_mutex_lock (&abr->lock);
+  abr->policy = policy;
+  g_mutex_unlock (&abr->lock);
+}
+
+GstAbrPolicy
+gst_abr_controller_get_policy (GstAbrController * abr)
+{
+  GstAbrPolicy policy;
+
+  g_mutex_lock (&abr->lock);
+  policy = abr->policy;
+  g_mutex_unlock (&abr->lock);
+
+  return policy;
+}
+
+void
+gst_abr_controller_set_select_func (GstAbrController * abr,
+    GstAbrSelectFunc func, gpointer user_data, GDestroyNotify notify)
+{
+  GDestroyNotify old_notify;
+  gpointer old_data;
+
+  g_mutex_lock (&abr->lock);
+  old_notify = abr->select_notify;
+  old_data = abr->select_data;
+  abr->select_func = func;
+  abr->select_data = user_data;
+  abr->select_notify = notify;
+  g_mutex_unlock (&abr->lock);
+
+  if (old_notify)
+    old_notify (old_data);
+}
+
+void
+gst_abr_controller_set_bandwidth_usage (GstAbrController * abr, gdouble usage)
+{
+  g_mutex_lock (&abr->lock);
+  abr->bandwidth_usage = usage;
+  g_mutex_unlock (&abr->lock);
+}
+
+void
+gst_abr_controller_set_max_bitrate (GstAbrController * abr,
+    guint64 max_bitrate)
+{
+  g_mutex_lock (&abr->lock);
+  abr->max_bitrate = max_bitrate;
+  g_mutex_unlock (&abr->lock);
+}
+
+void
+gst_abr_controller_set_buffer_target (GstAbrController * abr,
+    GstClockTime target)
+{
+  g_mutex_lock (&abr->lock);
+  abr->buffer_target = target;
+  g_mutex_unlock (&abr->lock);
+}
+
+static void
+_gst_abr_controller_update_ewma (gdouble * estimate, gdouble * total_weight,
+    gdouble half_life, gdouble weight, gdouble value)
+{
+  gdouble alpha = pow (0.5, weight / half_life);
+
+  *estimate = value * (1 - alpha) + alpha * (*estimate);
+  *total_weight += weight;
+}
+
+static gdouble
+_gst_abr_controller_get_ewma (gdouble estimate, gdouble total_weight,
+    gdouble half_life)
+{
+  /* the averages start at 0, correct that bias */
+  return estimate / (1 - pow (0.5, total_weight / half_life));
+}
+
+/* Adds a throughput sample of @bytes downloaded in @duration */
+void
+gst_abr_controller_add_sample (GstAbrController * abr, guint64 bytes,
+    GstClockTime duration)
+{
+  guint64 bitrate;
+  gdouble weight;
+
+  if (duration == 0 || !GST_CLOCK_TIME_IS_VALID (duration))
+    return;
+
+  bitrate = gst_util_uint64_scale (bytes, 8 * GST_SECOND, duration);
+  weight = (gdouble) duration / GST_SECOND;
+
+  g_mutex_lock (&abr->lock);
+  _gst_abr_controller_update_ewma (&abr->fast_ewma, &abr->fast_weight,
+      FAST_EWMA_HALF_LIFE, weight, bitrate);
+  _gst_abr_controller_update_ewma (&abr->slow_ewma, &abr->slow_weight,
+      SLOW_EWMA_HALF_LIFE, weight, bitrate);
+
+  abr->history[abr->history_pos] = MAX (bitrate, 1);
+  abr->history_pos = (abr->history_pos + 1) % GST_ABR_CONTROLLER_HISTORY_SIZE;
+  if (abr->history_length < GST_ABR_CONTROLLER_HISTORY_SIZE)
+    abr->history_length++;
+  g_mutex_unlock (&abr->lock);
+
+  GST_LOG ("Throughput sample: %" G_GUINT64_FORMAT " bytes in %"
+      GST_TIME_FORMAT " = %" G_GUINT64_FORMAT " bps", bytes,
+      GST_TIME_ARGS (duration), bitrate);
+}
+
+/* called with the lock */
+static guint64
+_gst_abr_controller_get_throughput (GstAbrController * abr)
+{
+  gdouble fast, slow, harmonic, sum = 0;
+  guint i;
+
+  if (abr->history_length == 0)
+    return 0;
+
+  fast = _gst_abr_controller_get_ewma (abr->fast_ewma, abr->fast_weight,
+      FAST_EWMA_HALF_LIFE);
+  slow = _gst_abr_controller_get_ewma (abr->slow_ewma, abr->slow_weight,
+      SLOW_EWMA_HALF_LIFE);
+
+  for (i = 0; i < abr->history_length; i++)
+    sum += 1.0 / abr->history[i];
+  harmonic = abr->history_length / sum;
+
+  return (guint64) MIN (MIN (fast, slow), harmonic);
+}
+
+/* Returns the estimated throughput, in bits/s, or 0 if nothing was
+ * downloaded yet */
+guint64
+gst_abr_controller_get_throughput (GstAbrController * abr)
+{
+  guint64 throughput;
+
+  g_mutex_lock (&abr->lock);
+  throughput = _gst_abr_controller_get_throughput (abr);
+  g_mutex_unlock (&abr->lock);
+
+  return throughput;
+}
+
+static gint
+_gst_abr_controller_select_throughput (const guint64 * bitrates,
+    guint n_bitrates, gint current, guint64 available)
+{
+  gint i, index = 0, up_index = 0;
+
+  for (i = 0; i < (gint) n_bitrates; i++) {
+    if (bitrates[i] <= available)
+      index = i;
+    if (bitrates[i] * UP_SWITCH_MARGIN <= available)
+      up_index = i;
+  }
+
+  /* only switch up if there is some margin, so small variations of
+   * the throughput don't make us switch back and forth */
+  if (index > current)
+    index = MAX (current, up_index);
+
+  return index;
+}
+
+static gint
+_gst_abr_controller_select_buffer (const guint64 * bitrates,
+    guint n_bitrates, gint current, guint64 available, gboolean have_throughput,
+    GstClockTime buffer_level, GstClockTime buffer_target,
+    GstClockTime fragment_duration)
+{
+  gdouble q, q_max, v, best_score = 0;
+  gint i, index = 0;
+
+  q = (gdouble) buffer_level / fragment_duration;
+  q_max = MAX ((gdouble) buffer_target / fragment_duration, 2.0);
+  v = (q_max - 1) / (log ((gdouble) bitrates[n_bitrates - 1] / bitrates[0])
+      + BOLA_GP);
+
+  for (i = 0; i < (gint) n_bitrates; i++) {
+    gdouble utility = log ((gdouble) bitrates[i] / bitrates[0]);
+    gdouble score = (v * (utility + BOLA_GP) - q) / bitrates[i];
+
+    if (i == 0 || score >= best_score) {
+      best_score = score;
+      index = i;
+    }
+  }
+
+  /* BOLA-O: don't switch up past what the throughput allows, we would
+   * have to switch down again once the buffer drained */
+  if (index > current && have_throughput) {
+    gint limit = _gst_abr_controller_select_throughput (bitrates, n_bitrates,
+        current, available);
+
+    if (index > limit)
+      index = MAX (limit, current);
+  }
+
+  return index;
+}
+
+/**
+ * gst_abr_controller_select:
+ * @abr: a #GstAbrController
+ * @bitrates: the available bitrates, in ascending order
+ * @n_bitrates: the number of available bitrates
+ * @current: index of the current bitrate
+ * @reserved_bitrate: part of the throughput used by other streams
+ * @buffer_level: duration of the data already buffered for the stream
+ * @fragment_duration: duration of the next fragment
+ *
+ * Selects the bitrate of the next fragment of a stream according to the
+ * policy of @abr.
+ *
+ * Returns: the index in @bitrates of the bitrate to use, or -1 if
+ *   @n_bitrates is 0
+ */
+gint
+gst_abr_controller_select (GstAbrController * abr, const guint64 * bitrates,
+    guint n_bitrates, gint current, guint64 reserved_bitrate,
+    GstClockTime buffer_level, GstClockTime fragment_duration)
+{
+  GstAbrPolicy policy;
+  guint64 throughput, available;
+  gboolean use_buffer;
+  gint index, max_index;
+
+  if (n_bitrates == 0)
+    return -1;
+
+  current = CLAMP (current, 0, (gint) n_bitrates - 1);
+  if (!GST_CLOCK_TIME_IS_VALID (buffer_level))
+    buffer_level = 0;
+
+  g_mutex_lock (&abr->lock);
+  throughput = _gst_abr_controller_get_throughput (abr);
+  available = throughput * abr->bandwidth_usage;
+  available = available > reserved_bitrate ? available - reserved_bitrate : 0;
+
+  policy = abr->policy;
+  if (policy == GST_ABR_POLICY_CUSTOM && abr->select_func == NULL) {
+    GST_WARNING ("Custom policy without a selection function, using the "
+        "hybrid policy");
+    policy = GST_ABR_POLICY_HYBRID;
+  }
+
+  /* the buffer policy needs to know how many fragments are buffered */
+  use_buffer = GST_CLOCK_TIME_IS_VALID (fragment_duration)
+      && fragment_duration > 0 && bitrates[0] > 0
+      && GST_CLOCK_TIME_IS_VALID (abr->buffer_target);
+  if (policy == GST_ABR_POLICY_HYBRID)
+    use_buffer = use_buffer && buffer_level >= abr->buffer_target / 2;
+  else if (policy == GST_ABR_POLICY_THROUGHPUT)
+    use_buffer = FALSE;
+
+  if (policy == GST_ABR_POLICY_CUSTOM) {
+    index = abr->select_func (abr, bitrates, n_bitrates, current, available,
+        buffer_level, abr->select_data);
+    abr->last_reason = "custom";
+  } else if (use_buffer) {
+    index = _gst_abr_controller_select_buffer (bitrates, n_bitrates, current,
+        available, throughput > 0, buffer_level, abr->buffer_target,
+        fragment_duration);
+    abr->last_reason = "buffer";
+  } else if (throughput > 0) {
+    index = _gst_abr_controller_select_throughput (bitrates, n_bitrates,
+        current, available);
+    abr->last_reason = "throughput";
+  } else {
+    /* nothing measured yet */
+    index = current;
+    abr->last_reason = "no-estimate";
+  }
+
+  max_index = n_bitrates - 1;
+  if (abr->max_bitrate) {
+    while (max_index > 0 && bitrates[max_index] > abr->max_bitrate)
+      max_index--;
+  }
+  index = CLAMP (index, 0, max_index);
+
+  abr->last_throughput = throughput;
+  abr->last_buffer_level = buffer_level;
+  abr->previous_bitrate = bitrates[current];
+  abr->last_bitrate = bitrates[index];
+  g_mutex_unlock (&abr->lock);
+
+  GST_DEBUG ("Selected bitrate %" G_GUINT64_FORMAT " (was %" G_GUINT64_FORMAT
+      "), throughput %" G_GUINT64_FORMAT " reserved %" G_GUINT64_FORMAT
+      " buffer %" GST_TIME_FORMAT, bitrates[index], bitrates[current],
+      throughput, reserved_bitrate, GST_TIME_ARGS (buffer_level));
+
+  return index;
+}
+
+/**
+ * gst_abr_controller_new_decision_message:
+ * @abr: a #GstAbrController
+ * @src: the object posting the message
+ * @stream_id: (allow-none): name of the stream the decision applies to
+ *
+ * Creates an element message describing the last decision taken by
+ * gst_abr_controller_select(), to be posted when switching bitrates.
+ *
+ * Returns: a new #GstMessage
+ */
+GstMessage *
+gst_abr_controller_new_decision_message (GstAbrController * abr,
+    GstObject * src, const gchar * stream_id)
+{
+  GstStructure *s;
+
+  g_mutex_lock (&abr->lock);
+  s = gst_structure_new (GST_ABR_DECISION_MESSAGE_NAME,
+      "policy", GST_TYPE_ABR_POLICY, abr->policy,
+      "reason", G_TYPE_STRING, abr->last_reason,
+      "throughput", G_TYPE_UINT64, abr->last_throughput,
+      "buffer-level", G_TYPE_UINT64, abr->last_buffer_level,
+      "previous-bitrate", G_TYPE_UINT64, abr->previous_bitrate,
+      "bitrate", G_TYPE_UINT64, abr->last_bitrate, NULL);
+  g_mutex_unlock (&abr->lock);
+
+  if (stream_id)
+    gst_structure_set (s, "stream-id", G_TYPE_STRING, stream_id, NULL);
+
+  return gst_message_new_element (src, s);
+}
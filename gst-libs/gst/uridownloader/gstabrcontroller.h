@@ -0,0 +1,144 @@
+/* GStreamer
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * gstabrcontroller.h:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_ABR_CONTROLLER_H__
+#define __GST_ABR_CONTROLLER_H__
+
+#include <glib-object.h>
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_ABR_POLICY (gst_abr_policy_get_type ())
+
+/* Name of the element message posted by the adaptive demuxers for every
+ * bitrate switch */
+#define GST_ABR_DECISION_MESSAGE_NAME "adaptive-bitrate-decision"
+
+/* Number of throughput samples used for the harmonic mean */
+#define GST_ABR_CONTROLLER_HISTORY_SIZE 5
+
+/**
+ * GstAbrPolicy:
+ * @GST_ABR_POLICY_THROUGHPUT: select the highest bitrate below the estimated
+ *   throughput
+ * @GST_ABR_POLICY_BUFFER: select the bitrate from the buffer occupancy
+ *   (BOLA), limited by the throughput when switching up
+ * @GST_ABR_POLICY_HYBRID: use the throughput policy while the buffer is low
+ *   and the buffer policy once it filled up
+ * @GST_ABR_POLICY_CUSTOM: use the function set with
+ *   gst_abr_controller_set_select_func(). Only available to code owning the
+ *   controller, it is not part of the registered #GST_TYPE_ABR_POLICY
+ *
+ * Policy used to select the bitrate of the next fragment.
+ */
+typedef enum
+{
+  GST_ABR_POLICY_THROUGHPUT,
+  GST_ABR_POLICY_BUFFER,
+  GST_ABR_POLICY_HYBRID,
+  GST_ABR_POLICY_CUSTOM
+} GstAbrPolicy;
+
+typedef struct _GstAbrController GstAbrController;
+
+/**
+ * GstAbrSelectFunc:
+ * @abr: the #GstAbrController
+ * @bitrates: the available bitrates, in ascending order
+ * @n_bitrates: the number of available bitrates
+ * @current: index of the current bitrate
+ * @throughput: estimated throughput available to this stream, in bits/s,
+ *   or 0 if unknown
+ * @buffer_level: duration of the data already buffered
+ * @user_data: user data
+ *
+ * Selects the bitrate of the next fragment for the custom policy. It is
+ * called with the lock of @abr held and must not call back into it.
+ *
+ * Returns: the index of the bitrate to use
+ */
+typedef gint (*GstAbrSelectFunc) (GstAbrController * abr,
+    const guint64 * bitrates, guint n_bitrates, gint current,
+    guint64 throughput, GstClockTime buffer_level, gpointer user_data);
+
+struct _GstAbrController
+{
+  GMutex lock;
+
+  GstAbrPolicy policy;
+  GstAbrSelectFunc select_func;
+  gpointer select_data;
+  GDestroyNotify select_notify;
+
+  /* settings */
+  gdouble bandwidth_usage;      /* fraction of the throughput to use */
+  guint64 max_bitrate;          /* 0 for no limit */
+  GstClockTime buffer_target;   /* buffering the demuxer aims for */
+
+  /* throughput estimation, in bits/s */
+  gdouble fast_ewma;
+  gdouble slow_ewma;
+  gdouble fast_weight;
+  gdouble slow_weight;
+  guint64 history[GST_ABR_CONTROLLER_HISTORY_SIZE];
+  guint history_length;
+  guint history_pos;
+
+  /* last decision */
+  guint64 last_throughput;
+  GstClockTime last_buffer_level;
+  guint64 last_bitrate;
+  guint64 previous_bitrate;
+  const gchar *last_reason;
+};
+
+GType gst_abr_policy_get_type (void);
+
+void gst_abr_controller_init (GstAbrController * abr);
+void gst_abr_controller_clear (GstAbrController * abr);
+void gst_abr_controller_reset (GstAbrController * abr);
+
+void gst_abr_controller_set_policy (GstAbrController * abr, GstAbrPolicy policy);
+GstAbrPolicy gst_abr_controller_get_policy (GstAbrController * abr);
+void gst_abr_controller_set_select_func (GstAbrController * abr,
+    GstAbrSelectFunc func, gpointer user_data, GDestroyNotify notify);
+void gst_abr_controller_set_bandwidth_usage (GstAbrController * abr,
+    gdouble usage);
+void gst_abr_controller_set_max_bitrate (GstAbrController * abr,
+    guint64 max_bitrate);
+void gst_abr_controller_set_buffer_target (GstAbrController * abr,
+    GstClockTime target);
+
+void gst_abr_controller_add_sample (GstAbrController * abr, guint64 bytes,
+    GstClockTime duration);
+guint64 gst_abr_controller_get_throughput (GstAbrController * abr);
+
+gint gst_abr_controller_select (GstAbrController * abr,
+    const guint64 * bitrates, guint n_bitrates, gint current,
+    guint64 reserved_bitrate, GstClockTime buffer_level,
+    GstClockTime fragment_duration);
+
+GstMessage * gst_abr_controller_new_decision_message (GstAbrController * abr,
+    GstObject * src, const gchar * stream_id);
+
+G_END_DECLS
+#endif /* __GST_ABR_CONTROLLER_H__ */
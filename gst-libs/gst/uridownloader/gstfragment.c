@@ -167,6 +167,7 @@ gst_fragment_init (GstFragment * fragment)
   fragment->name = g_strdup ("");
   fragment->completed = FALSE;
   fragment->discontinuous = FALSE;
+  fragment->size = 0;
 }
 
 GstFragment *
@@ -209,7 +210,8 @@ gst_fragment_get_buffer (GstFragment * fragment)
 {
   g_return_val_if_fail (fragment != NULL, NULL);
 
-  if (!fragment->completed)
+  /* streamed fragments don't keep their data */
+  if (!fragment->completed || fragment->priv->buffer == NULL)
     return NULL;
 
   gst_buffer_ref (fragment->priv->buffer);
@@ -235,10 +237,11 @@ gst_fragment_get_caps (GstFragment * fragment)
     return NULL;
 
   g_mutex_lock (&fragment->priv->lock);
-  if (fragment->priv->caps == NULL)
+  if (fragment->priv->caps == NULL && fragment->priv->buffer != NULL)
     fragment->priv->caps =
         gst_type_find_helper_for_buffer (NULL, fragment->priv->buffer, NULL);
-  gst_caps_ref (fragment->priv->caps);
+  if (fragment->priv->caps)
+    gst_caps_ref (fragment->priv->caps);
   g_mutex_unlock (&fragment->priv->lock);
 
   return fragment->priv->caps;
@@ -256,6 +259,7 @@ gst_fragment_add_buffer (GstFragment * fragment, GstBuffer * buffer)
   }
 
   GST_DEBUG ("Adding new buffer to the fragment");
+  fragment->size += gst_buffer_get_size (buffer);
   /* We steal the buffers you pass in */
   if (fragment->priv->buffer == NULL)
     fragment->priv->buffer = buffer;
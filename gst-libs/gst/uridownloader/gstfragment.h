@@ -49,6 +49,7 @@ struct _GstFragment
   guint64 stop_time;            /* Stop time of the fragment */
   gboolean index;               /* Index of the fragment */
   gboolean discontinuous;       /* Whether this fragment is discontinuous or not */
+  guint64 size;                 /* Number of bytes downloaded */
 
   GstFragmentPrivate *priv;
 };
@@ -41,6 +41,11 @@ struct _GstUriDownloaderPrivate
   GstFragment *download;
   GMutex download_lock;         /* used to restrict to one download only */
 
+  /* Set while streaming a download, buffers are then handed to the
+   * callback instead of being accumulated in the fragment */
+  GstUriDownloaderChunkFunc chunk_func;
+  gpointer chunk_data;
+
   GCond cond;
   gboolean cancelled;
 };
@@ -223,6 +228,10 @@ static GstFlowReturn
 gst_uri_downloader_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
 {
   GstUriDownloader *downloader;
+  GstUriDownloaderChunkFunc chunk_func;
+  gpointer chunk_data;
+  GstFragment *download;
+  GstFlowReturn ret;
 
   downloader = GST_URI_DOWNLOADER (gst_pad_get_element_private (pad));
 
@@ -234,15 +243,46 @@ gst_uri_downloader_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
   if (downloader->priv->download == NULL) {
     /* Download cancelled, quit */
     GST_OBJECT_UNLOCK (downloader);
+    gst_buffer_unref (buf);
     goto done;
   }
 
   GST_LOG_OBJECT (downloader, "The uri fetcher received a new buffer "
       "of size %" G_GSIZE_FORMAT, gst_buffer_get_size (buf));
-  if (!gst_fragment_add_buffer (downloader->priv->download, buf))
-    GST_WARNING_OBJECT (downloader, "Could not add buffer to fragment");
+
+  chunk_func = downloader->priv->chunk_func;
+  if (chunk_func == NULL) {
+    if (!gst_fragment_add_buffer (downloader->priv->download, buf))
+      GST_WARNING_OBJECT (downloader, "Could not add buffer to fragment");
+    GST_OBJECT_UNLOCK (downloader);
+    goto done;
+  }
+
+  /* Streaming: only account for the size so the bandwidth can still be
+   * measured over the whole fragment, and hand the data out without
+   * holding the lock as the callback might block */
+  download = g_object_ref (downloader->priv->download);
+  download->size += gst_buffer_get_size (buf);
+  chunk_data = downloader->priv->chunk_data;
   GST_OBJECT_UNLOCK (downloader);
 
+  ret = chunk_func (downloader, buf, chunk_data);
+
+  if (ret != GST_FLOW_OK) {
+    GST_DEBUG_OBJECT (downloader, "Chunk callback returned %s, stopping "
+        "download", gst_flow_get_name (ret));
+    GST_OBJECT_LOCK (downloader);
+    if (downloader->priv->download == download) {
+      g_object_unref (downloader->priv->download);
+      downloader->priv->download = NULL;
+      g_cond_signal (&downloader->priv->cond);
+    }
+    GST_OBJECT_UNLOCK (downloader);
+  }
+  g_object_unref (download);
+
+  return ret;
+
 done:
   {
     return GST_FLOW_OK;
@@ -276,10 +316,13 @@ gst_uri_downloader_stop (GstUriDownloader * downloader)
   GST_DEBUG_OBJECT (downloader, "Stopping source element %s",
       GST_ELEMENT_NAME (urisrc));
 
-  /* set the element state to NULL */
+  /* set the element state to NULL. The state change waits for the
+   * streaming thread, which might need the lock to finish a chain call */
   gst_bus_set_flushing (downloader->priv->bus, TRUE);
+  GST_OBJECT_UNLOCK (downloader);
   gst_element_set_state (urisrc, GST_STATE_NULL);
   gst_element_get_state (urisrc, NULL, NULL, GST_CLOCK_TIME_NONE);
+  GST_OBJECT_LOCK (downloader);
   gst_element_set_bus (urisrc, NULL);
   gst_object_unref (urisrc);
 }
@@ -383,6 +426,32 @@ gst_uri_downloader_fetch_uri (GstUriDownloader * downloader, const gchar * uri)
 GstFragment *
 gst_uri_downloader_fetch_uri_with_range (GstUriDownloader * downloader,
     const gchar * uri, gint64 range_start, gint64 range_end)
+{
+  return gst_uri_downloader_fetch_uri_streaming (downloader, uri, range_start,
+      range_end, NULL, NULL);
+}
+
+/**
+ * gst_uri_downloader_fetch_uri_streaming:
+ * @downloader: the #GstUriDownloader
+ * @uri: the uri
+ * @range_start: the starting byte index
+ * @range_end: the final byte index, use -1 for unspecified
+ * @chunk_func: (allow-none): function called for every chunk of data
+ * @user_data: user data passed to @chunk_func
+ *
+ * Like gst_uri_downloader_fetch_uri_with_range() but, if @chunk_func is
+ * not %NULL, every chunk of data is passed to @chunk_func as soon as it
+ * arrives instead of being accumulated in the fragment. The call still
+ * blocks until the download finished.
+ *
+ * Returns the downloaded #GstFragment. When streaming it does not hold
+ * a buffer but its download times and size cover the whole download.
+ */
+GstFragment *
+gst_uri_downloader_fetch_uri_streaming (GstUriDownloader * downloader,
+    const gchar * uri, gint64 range_start, gint64 range_end,
+    GstUriDownloaderChunkFunc chunk_func, gpointer user_data)
 {
   GstStateChangeReturn ret;
   GstFragment *download = NULL;
@@ -392,6 +461,8 @@ gst_uri_downloader_fetch_uri_with_range (GstUriDownloader * downloader,
   g_mutex_lock (&downloader->priv->download_lock);
 
   GST_OBJECT_LOCK (downloader);
+  downloader->priv->chunk_func = chunk_func;
+  downloader->priv->chunk_data = user_data;
   if (downloader->priv->cancelled) {
     GST_DEBUG_OBJECT (downloader, "Cancelled, aborting fetch");
     goto quit;
@@ -465,6 +536,8 @@ gst_uri_downloader_fetch_uri_with_range (GstUriDownloader * downloader,
 quit:
   {
     gst_uri_downloader_stop (downloader);
+    downloader->priv->chunk_func = NULL;
+    downloader->priv->chunk_data = NULL;
     GST_OBJECT_UNLOCK (downloader);
     g_mutex_unlock (&downloader->priv->download_lock);
     return download;
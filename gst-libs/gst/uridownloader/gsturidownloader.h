@@ -38,6 +38,18 @@ typedef struct _GstUriDownloader GstUriDownloader;
 typedef struct _GstUriDownloaderPrivate GstUriDownloaderPrivate;
 typedef struct _GstUriDownloaderClass GstUriDownloaderClass;
 
+/**
+ * GstUriDownloaderChunkFunc:
+ * @downloader: the #GstUriDownloader
+ * @buffer: (transfer full): the data that was just received
+ * @user_data: user data passed to gst_uri_downloader_fetch_uri_streaming()
+ *
+ * Called from the streaming thread of the source element for every chunk
+ * of data as soon as it arrives. Returning anything else than
+ * %GST_FLOW_OK aborts the download.
+ */
+typedef GstFlowReturn (*GstUriDownloaderChunkFunc) (GstUriDownloader * downloader, GstBuffer * buffer, gpointer user_data);
+
 struct _GstUriDownloader
 {
   GstObject parent;
@@ -58,6 +70,7 @@ GType gst_uri_downloader_get_type (void);
 GstUriDownloader * gst_uri_downloader_new (void);
 GstFragment * gst_uri_downloader_fetch_uri (GstUriDownloader * downloader, const gchar * uri);
 GstFragment * gst_uri_downloader_fetch_uri_with_range (GstUriDownloader * downloader, const gchar * uri, gint64 range_start, gint64 range_end);
+GstFragment * gst_uri_downloader_fetch_uri_streaming (GstUriDownloader * downloader, const gchar * uri, gint64 range_start, gint64 range_end, GstUriDownloaderChunkFunc chunk_func, gpointer user_data);
 void gst_uri_downloader_reset (GstUriDownloader *downloader);
 void gst_uri_downloader_cancel (GstUriDownloader *downloader);
 void gst_uri_downloader_free (GstUriDownloader *downloader);
@@ -31,7 +31,6 @@
  */
 
 /* TODO:
- *   - Seeking support: Use IndexTableSegments
  *   - Handle timecode tracks correctly (where is this documented?)
  *   - Handle drop-frame field of timecode tracks
  *   - Handle Generic container system items
@@ -76,6 +75,29 @@ GST_STATIC_PAD_TEMPLATE ("track_%u",
 GST_DEBUG_CATEGORY_STATIC (mxfdemux_debug);
 #define GST_CAT_DEFAULT mxfdemux_debug
 
+/* Header metadata with at least this many local sets per thread is
+ * parsed by several threads */
+#define METADATA_PARSE_MIN_SETS_PER_THREAD 64
+#define METADATA_PARSE_MAX_THREADS 8
+
+/* Sequential pulls of up to READ_AHEAD_MAX_PULL bytes are served from a
+ * window of READ_AHEAD_SIZE bytes, so KLV headers and small essence
+ * elements don't need a round trip upstream each. Larger pulls and
+ * jumps, e.g. to the footer or after a seek, go directly upstream */
+#define READ_AHEAD_SIZE (1024 * 1024)
+#define READ_AHEAD_MAX_PULL (READ_AHEAD_SIZE / 4)
+
+/* Interval in which the end of a followed growing file is polled. The
+ * wait is cut short by flushes, seeks and state changes */
+#define FOLLOW_POLL_INTERVAL (100 * GST_MSECOND)
+
+/* Seeks in this format are in frames of the timecode track, i.e. the
+ * same unit as the start timecode of its timecode component */
+static GstFormat gst_mxf_demux_timecode_format = GST_FORMAT_UNDEFINED;
+
+#define DEFAULT_FOLLOW FALSE
+#define DEFAULT_FOLLOW_TIMEOUT (10 * GST_SECOND)
+
 GType gst_mxf_demux_pad_get_type (void);
 G_DEFINE_TYPE (GstMXFDemuxPad, gst_mxf_demux_pad, GST_TYPE_PAD);
 
@@ -112,7 +134,9 @@ enum
   PROP_0,
   PROP_PACKAGE,
   PROP_MAX_DRIFT,
-  PROP_STRUCTURE
+  PROP_STRUCTURE,
+  PROP_FOLLOW,
+  PROP_FOLLOW_TIMEOUT
 };
 
 static gboolean gst_mxf_demux_sink_event (GstPad * pad, GstObject * parent,
@@ -178,6 +202,8 @@ gst_mxf_demux_reset_mxf_state (GstMXFDemux * demux)
       gst_caps_unref (t->caps);
   }
   g_array_set_size (demux->essence_tracks, 0);
+
+  demux->update_index_tables = TRUE;
 }
 
 static void
@@ -256,6 +282,10 @@ gst_mxf_demux_reset (GstMXFDemux * demux)
 
   gst_adapter_clear (demux->adapter);
 
+  gst_buffer_replace (&demux->read_ahead, NULL);
+  demux->read_ahead_offset = 0;
+  demux->last_pull_end = 0;
+
   gst_mxf_demux_remove_pads (demux);
 
   if (demux->random_index_pack) {
@@ -263,16 +293,20 @@ gst_mxf_demux_reset (GstMXFDemux * demux)
     demux->random_index_pack = NULL;
   }
 
-  if (demux->pending_index_table_segments) {
+  demux->follow_waiting = FALSE;
+  demux->follow_wait_start = 0;
+  demux->follow_complete = FALSE;
+
+  if (demux->index_table_segments) {
     GList *l;
 
-    for (l = demux->pending_index_table_segments; l; l = l->next) {
+    for (l = demux->index_table_segments; l; l = l->next) {
       MXFIndexTableSegment *s = l->data;
       mxf_index_table_segment_reset (s);
       g_free (s);
     }
-    g_list_free (demux->pending_index_table_segments);
-    demux->pending_index_table_segments = NULL;
+    g_list_free (demux->index_table_segments);
+    demux->index_table_segments = NULL;
   }
 
   gst_mxf_demux_reset_mxf_state (demux);
@@ -282,6 +316,87 @@ gst_mxf_demux_reset (GstMXFDemux * demux)
   demux->group_id = G_MAXUINT;
 }
 
+/* Whether the file is still being written to. Until a footer partition
+ * or a random index pack shows up, durations from the metadata are only
+ * preliminary and the end of the file is not the end of the stream */
+static gboolean
+gst_mxf_demux_is_following (GstMXFDemux * demux)
+{
+  return demux->follow && demux->random_access && !demux->follow_complete
+      && !demux->random_index_pack;
+}
+
+/* Wakes up the streaming thread if it waits for a followed file to grow
+ * and keeps it from waiting again until @interrupted is unset */
+static void
+gst_mxf_demux_set_follow_interrupted (GstMXFDemux * demux,
+    gboolean interrupted)
+{
+  g_mutex_lock (&demux->follow_lock);
+  demux->follow_interrupted = interrupted;
+  g_cond_broadcast (&demux->follow_cond);
+  g_mutex_unlock (&demux->follow_lock);
+}
+
+/* Sets the duration of the current component of @pad in edit units of
+ * its material track, or -1 if it is unknown */
+static void
+gst_mxf_demux_pad_update_component_duration (GstMXFDemux * demux,
+    GstMXFDemuxPad * pad, MXFMetadataTimelineTrack * source_track)
+{
+  MXFMetadataTimelineTrack *track = pad->material_track;
+
+  if (!pad->current_component || pad->current_component->parent.duration < 0
+      || gst_mxf_demux_is_following (demux)) {
+    pad->current_component_duration = -1;
+    return;
+  }
+
+  pad->current_component_duration = pad->current_component->parent.duration;
+  if (track->edit_rate.n != source_track->edit_rate.n ||
+      track->edit_rate.d != source_track->edit_rate.d)
+    pad->current_component_duration =
+        gst_util_uint64_scale (pad->current_component_duration,
+        source_track->edit_rate.n * track->edit_rate.d,
+        source_track->edit_rate.d * track->edit_rate.n);
+}
+
+/* Called once a followed file is complete. The durations that were left
+ * open while following are taken from the metadata now, and are updated
+ * again if the footer partition brings final metadata */
+static void
+gst_mxf_demux_set_follow_complete (GstMXFDemux * demux)
+{
+  guint i;
+
+  GST_DEBUG_OBJECT (demux, "Followed file is complete");
+
+  demux->follow_waiting = FALSE;
+  demux->follow_complete = TRUE;
+
+  g_rw_lock_reader_lock (&demux->metadata_lock);
+  for (i = 0; i < demux->essence_tracks->len; i++) {
+    GstMXFDemuxEssenceTrack *etrack =
+        &g_array_index (demux->essence_tracks, GstMXFDemuxEssenceTrack, i);
+
+    if (etrack->source_track && etrack->source_track->parent.sequence
+        && etrack->source_track->parent.sequence->duration > etrack->duration)
+      etrack->duration = etrack->source_track->parent.sequence->duration;
+  }
+
+  for (i = 0; i < demux->src->len; i++) {
+    GstMXFDemuxPad *pad = g_ptr_array_index (demux->src, i);
+
+    if (pad->current_essence_track && pad->current_essence_track->source_track)
+      gst_mxf_demux_pad_update_component_duration (demux, pad,
+          pad->current_essence_track->source_track);
+  }
+  g_rw_lock_reader_unlock (&demux->metadata_lock);
+
+  gst_element_post_message (GST_ELEMENT_CAST (demux),
+      gst_message_new_duration_changed (GST_OBJECT_CAST (demux)));
+}
+
 static GstFlowReturn
 gst_mxf_demux_combine_flows (GstMXFDemux * demux,
     GstMXFDemuxPad * pad, GstFlowReturn ret)
@@ -315,12 +430,60 @@ done:
   return ret;
 }
 
+static gboolean
+gst_mxf_demux_pull_from_read_ahead (GstMXFDemux * demux, guint64 offset,
+    guint size, GstBuffer ** buffer)
+{
+  GstMapInfo map;
+
+  if (!demux->read_ahead || offset < demux->read_ahead_offset ||
+      offset + size >
+      demux->read_ahead_offset + gst_buffer_get_size (demux->read_ahead))
+    return FALSE;
+
+  /* Copied instead of shared, a sub-buffer pushed downstream would keep
+   * the whole window alive */
+  *buffer = gst_buffer_new_allocate (NULL, size, NULL);
+  gst_buffer_map (*buffer, &map, GST_MAP_WRITE);
+  gst_buffer_extract (demux->read_ahead, offset - demux->read_ahead_offset,
+      map.data, size);
+  gst_buffer_unmap (*buffer, &map);
+  GST_BUFFER_OFFSET (*buffer) = offset;
+
+  demux->last_pull_end = offset + size;
+
+  return TRUE;
+}
+
 static GstFlowReturn
 gst_mxf_demux_pull_range (GstMXFDemux * demux, guint64 offset,
     guint size, GstBuffer ** buffer)
 {
   GstFlowReturn ret;
 
+  if (gst_mxf_demux_pull_from_read_ahead (demux, offset, size, buffer))
+    return GST_FLOW_OK;
+
+  if (size <= READ_AHEAD_MAX_PULL && offset == demux->last_pull_end) {
+    GstBuffer *read_ahead = NULL;
+
+    /* Near the end of the file this returns less data, in which
+     * case a normal pull will report the error */
+    ret =
+        gst_pad_pull_range (demux->sinkpad, offset, READ_AHEAD_SIZE,
+        &read_ahead);
+    if (ret == GST_FLOW_OK) {
+      GST_LOG_OBJECT (demux, "Read ahead %" G_GSIZE_FORMAT " bytes at offset %"
+          G_GUINT64_FORMAT, gst_buffer_get_size (read_ahead), offset);
+      gst_buffer_replace (&demux->read_ahead, NULL);
+      demux->read_ahead = read_ahead;
+      demux->read_ahead_offset = offset;
+
+      if (gst_mxf_demux_pull_from_read_ahead (demux, offset, size, buffer))
+        return GST_FLOW_OK;
+    }
+  }
+
   ret = gst_pad_pull_range (demux->sinkpad, offset, size, buffer);
   if (G_UNLIKELY (ret != GST_FLOW_OK)) {
     GST_WARNING_OBJECT (demux,
@@ -340,6 +503,8 @@ gst_mxf_demux_pull_range (GstMXFDemux * demux, guint64 offset,
     return ret;
   }
 
+  demux->last_pull_end = offset + size;
+
   return ret;
 }
 
@@ -433,6 +598,9 @@ gst_mxf_demux_handle_partition_pack (GstMXFDemux * demux, const MXFUL * key,
 
   if (partition.type == MXF_PARTITION_PACK_HEADER)
     demux->footer_partition_pack_offset = partition.footer_partition;
+  else if (partition.type == MXF_PARTITION_PACK_FOOTER
+      && gst_mxf_demux_is_following (demux))
+    gst_mxf_demux_set_follow_complete (demux);
 
   for (l = demux->partitions; l; l = l->next) {
     GstMXFDemuxPartition *tmp = l->data;
@@ -466,6 +634,8 @@ gst_mxf_demux_handle_partition_pack (GstMXFDemux * demux, const MXFUL * key,
     b->partition.prev_partition = a->partition.this_partition;
   }
 
+  demux->update_index_tables = TRUE;
+
 out:
   demux->current_partition = p;
 
@@ -775,7 +945,8 @@ gst_mxf_demux_update_essence_tracks (GstMXFDemux * demux)
         goto next;
       }
 
-      if (track->parent.sequence->duration > etrack->duration)
+      if (track->parent.sequence->duration > etrack->duration
+          && !gst_mxf_demux_is_following (demux))
         etrack->duration = track->parent.sequence->duration;
 
       g_free (etrack->mapping_data);
@@ -903,6 +1074,8 @@ gst_mxf_demux_update_essence_tracks (GstMXFDemux * demux)
 
   }
 
+  demux->update_index_tables = TRUE;
+
   return GST_FLOW_OK;
 }
 
@@ -1152,23 +1325,12 @@ gst_mxf_demux_update_tracks (GstMXFDemux * demux)
       pad->current_component_index = 0;
       pad->current_component_start = source_track->origin;
 
-      if (component->parent.duration >= -1)
-        pad->current_component_duration = component->parent.duration;
-      else
-        pad->current_component_duration = -1;
-
       if (track->edit_rate.n != source_track->edit_rate.n ||
           track->edit_rate.n != source_track->edit_rate.n) {
         pad->current_component_start +=
             gst_util_uint64_scale (component->start_position,
             source_track->edit_rate.n * track->edit_rate.d,
             source_track->edit_rate.d * track->edit_rate.n);
-
-        if (pad->current_component_duration != -1)
-          pad->current_component_duration =
-              gst_util_uint64_scale (pad->current_component_duration,
-              source_track->edit_rate.n * track->edit_rate.d,
-              source_track->edit_rate.d * track->edit_rate.n);
       } else {
         pad->current_component_start += component->start_position;
       }
@@ -1178,6 +1340,10 @@ gst_mxf_demux_update_tracks (GstMXFDemux * demux)
     /* NULL iff playing a source package */
     pad->current_component = component;
 
+    /* The duration is unknown until a followed file is complete */
+    if (component && (first_run || pad->current_component_duration == -1))
+      gst_mxf_demux_pad_update_component_duration (demux, pad, source_track);
+
     pad->current_essence_track = etrack;
 
     if (etrack->tags) {
@@ -1269,52 +1435,45 @@ error:
   return ret;
 }
 
-static GstFlowReturn
-gst_mxf_demux_handle_metadata (GstMXFDemux * demux, const MXFUL * key,
-    GstBuffer * buffer)
+static MXFMetadataBase *
+gst_mxf_demux_parse_metadata_set (GstMXFDemux * demux, MXFPrimerPack * primer,
+    const MXFUL * key, guint64 offset, GstBuffer * buffer)
 {
-  guint16 type;
-  MXFMetadata *metadata = NULL, *old = NULL;
+  MXFMetadataBase *ret = NULL;
   GstMapInfo map;
-  GstFlowReturn ret = GST_FLOW_OK;
-
-  type = GST_READ_UINT16_BE (key->u + 13);
-
-  GST_DEBUG_OBJECT (demux,
-      "Handling metadata of size %" G_GSIZE_FORMAT " at offset %"
-      G_GUINT64_FORMAT " of type 0x%04x", gst_buffer_get_size (buffer),
-      demux->offset, type);
 
-  if (G_UNLIKELY (!demux->current_partition)) {
-    GST_ERROR_OBJECT (demux, "Partition pack doesn't exist");
-    return GST_FLOW_ERROR;
-  }
+  gst_buffer_map (buffer, &map, GST_MAP_READ);
+  if (mxf_is_descriptive_metadata (key)) {
+    guint8 scheme = GST_READ_UINT8 (key->u + 12);
+    guint32 type = GST_READ_UINT24_BE (key->u + 13);
 
-  if (G_UNLIKELY (!demux->current_partition->primer.mappings)) {
-    GST_ERROR_OBJECT (demux, "Primer pack doesn't exists");
-    return GST_FLOW_ERROR;
-  }
+    ret = (MXFMetadataBase *) mxf_descriptive_metadata_new (scheme, type,
+        primer, offset, map.data, map.size);
+    if (!ret)
+      GST_WARNING_OBJECT (demux,
+          "Unknown or unhandled descriptive metadata of scheme 0x%02x and type 0x%06x",
+          scheme, type);
+  } else {
+    guint16 type = GST_READ_UINT16_BE (key->u + 13);
 
-  if (demux->current_partition->parsed_metadata) {
-    GST_DEBUG_OBJECT (demux, "Metadata of this partition was already parsed");
-    return GST_FLOW_OK;
+    ret = (MXFMetadataBase *) mxf_metadata_new (type, primer, offset,
+        map.data, map.size);
+    if (!ret)
+      GST_WARNING_OBJECT (demux,
+          "Unknown or unhandled metadata of type 0x%04x", type);
   }
-
-  gst_buffer_map (buffer, &map, GST_MAP_READ);
-  metadata =
-      mxf_metadata_new (type, &demux->current_partition->primer, demux->offset,
-      map.data, map.size);
   gst_buffer_unmap (buffer, &map);
 
-  if (!metadata) {
-    GST_WARNING_OBJECT (demux,
-        "Unknown or unhandled metadata of type 0x%04x", type);
-    return GST_FLOW_OK;
-  }
+  return ret;
+}
+
+/* Takes ownership of @metadata */
+static GstFlowReturn
+gst_mxf_demux_add_metadata (GstMXFDemux * demux, MXFMetadataBase * metadata)
+{
+  MXFMetadataBase *old;
 
-  old =
-      g_hash_table_lookup (demux->metadata,
-      &MXF_METADATA_BASE (metadata)->instance_uid);
+  old = g_hash_table_lookup (demux->metadata, &metadata->instance_uid);
 
   if (old && G_TYPE_FROM_INSTANCE (old) != G_TYPE_FROM_INSTANCE (metadata)) {
 #ifndef GST_DISABLE_GST_DEBUG
@@ -1324,21 +1483,19 @@ gst_mxf_demux_handle_metadata (GstMXFDemux * demux, const MXFUL * key,
     GST_DEBUG_OBJECT (demux,
         "Metadata with instance uid %s already exists and has different type '%s',"
         " expected '%s'",
-        mxf_uuid_to_string (&MXF_METADATA_BASE (metadata)->instance_uid, str),
+        mxf_uuid_to_string (&metadata->instance_uid, str),
         g_type_name (G_TYPE_FROM_INSTANCE (old)),
         g_type_name (G_TYPE_FROM_INSTANCE (metadata)));
     g_object_unref (metadata);
     return GST_FLOW_ERROR;
-  } else if (old
-      && MXF_METADATA_BASE (old)->offset >=
-      MXF_METADATA_BASE (metadata)->offset) {
+  } else if (old && old->offset >= metadata->offset) {
 #ifndef GST_DISABLE_GST_DEBUG
     gchar str[48];
 #endif
 
     GST_DEBUG_OBJECT (demux,
         "Metadata with instance uid %s already exists and is newer",
-        mxf_uuid_to_string (&MXF_METADATA_BASE (metadata)->instance_uid, str));
+        mxf_uuid_to_string (&metadata->instance_uid, str));
     g_object_unref (metadata);
     return GST_FLOW_OK;
   }
@@ -1352,30 +1509,58 @@ gst_mxf_demux_handle_metadata (GstMXFDemux * demux, const MXFUL * key,
 
   gst_mxf_demux_reset_linked_metadata (demux);
 
-  g_hash_table_replace (demux->metadata,
-      &MXF_METADATA_BASE (metadata)->instance_uid, metadata);
+  g_hash_table_replace (demux->metadata, &metadata->instance_uid, metadata);
   g_rw_lock_writer_unlock (&demux->metadata_lock);
 
-  return ret;
+  return GST_FLOW_OK;
+}
+
+static GstFlowReturn
+gst_mxf_demux_handle_metadata (GstMXFDemux * demux, const MXFUL * key,
+    GstBuffer * buffer)
+{
+  MXFMetadataBase *metadata;
+
+  GST_DEBUG_OBJECT (demux,
+      "Handling metadata of size %" G_GSIZE_FORMAT " at offset %"
+      G_GUINT64_FORMAT " of type 0x%04x", gst_buffer_get_size (buffer),
+      demux->offset, GST_READ_UINT16_BE (key->u + 13));
+
+  if (G_UNLIKELY (!demux->current_partition)) {
+    GST_ERROR_OBJECT (demux, "Partition pack doesn't exist");
+    return GST_FLOW_ERROR;
+  }
+
+  if (G_UNLIKELY (!demux->current_partition->primer.mappings)) {
+    GST_ERROR_OBJECT (demux, "Primer pack doesn't exists");
+    return GST_FLOW_ERROR;
+  }
+
+  if (demux->current_partition->parsed_metadata) {
+    GST_DEBUG_OBJECT (demux, "Metadata of this partition was already parsed");
+    return GST_FLOW_OK;
+  }
+
+  metadata =
+      gst_mxf_demux_parse_metadata_set (demux,
+      &demux->current_partition->primer, key, demux->offset, buffer);
+  if (!metadata)
+    return GST_FLOW_OK;
+
+  return gst_mxf_demux_add_metadata (demux, metadata);
 }
 
 static GstFlowReturn
 gst_mxf_demux_handle_descriptive_metadata (GstMXFDemux * demux,
     const MXFUL * key, GstBuffer * buffer)
 {
-  guint32 type;
-  guint8 scheme;
-  GstMapInfo map;
-  GstFlowReturn ret = GST_FLOW_OK;
-  MXFDescriptiveMetadata *m = NULL, *old = NULL;
-
-  scheme = GST_READ_UINT8 (key->u + 12);
-  type = GST_READ_UINT24_BE (key->u + 13);
+  MXFMetadataBase *m;
 
   GST_DEBUG_OBJECT (demux,
       "Handling descriptive metadata of size %" G_GSIZE_FORMAT " at offset %"
       G_GUINT64_FORMAT " with scheme 0x%02x and type 0x%06x",
-      gst_buffer_get_size (buffer), demux->offset, scheme, type);
+      gst_buffer_get_size (buffer), demux->offset,
+      GST_READ_UINT8 (key->u + 12), GST_READ_UINT24_BE (key->u + 13));
 
   if (G_UNLIKELY (!demux->current_partition)) {
     GST_ERROR_OBJECT (demux, "Partition pack doesn't exist");
@@ -1392,61 +1577,114 @@ gst_mxf_demux_handle_descriptive_metadata (GstMXFDemux * demux,
     return GST_FLOW_OK;
   }
 
-  gst_buffer_map (buffer, &map, GST_MAP_READ);
-  m = mxf_descriptive_metadata_new (scheme, type,
-      &demux->current_partition->primer, demux->offset, map.data, map.size);
-  gst_buffer_unmap (buffer, &map);
-
-  if (!m) {
-    GST_WARNING_OBJECT (demux,
-        "Unknown or unhandled descriptive metadata of scheme 0x%02x and type 0x%06x",
-        scheme, type);
+  m = gst_mxf_demux_parse_metadata_set (demux,
+      &demux->current_partition->primer, key, demux->offset, buffer);
+  if (!m)
     return GST_FLOW_OK;
-  }
 
-  old =
-      g_hash_table_lookup (demux->metadata,
-      &MXF_METADATA_BASE (m)->instance_uid);
+  return gst_mxf_demux_add_metadata (demux, m);
+}
 
-  if (old && G_TYPE_FROM_INSTANCE (old) != G_TYPE_FROM_INSTANCE (m)) {
-#ifndef GST_DISABLE_GST_DEBUG
-    gchar str[48];
-#endif
+typedef struct
+{
+  MXFUL key;
+  guint64 offset;
+  GstBuffer *buffer;
+  MXFMetadataBase *metadata;
+} GstMXFDemuxMetadataSet;
 
-    GST_DEBUG_OBJECT (demux,
-        "Metadata with instance uid %s already exists and has different type '%s',"
-        " expected '%s'",
-        mxf_uuid_to_string (&MXF_METADATA_BASE (m)->instance_uid, str),
-        g_type_name (G_TYPE_FROM_INSTANCE (old)),
-        g_type_name (G_TYPE_FROM_INSTANCE (m)));
-    g_object_unref (m);
-    return GST_FLOW_ERROR;
-  } else if (old
-      && MXF_METADATA_BASE (old)->offset >= MXF_METADATA_BASE (m)->offset) {
-#ifndef GST_DISABLE_GST_DEBUG
-    gchar str[48];
-#endif
+typedef struct
+{
+  GstMXFDemux *demux;
+  MXFPrimerPack *primer;
+  GArray *sets;
+  volatile gint next;
+} GstMXFDemuxMetadataParseJob;
 
-    GST_DEBUG_OBJECT (demux,
-        "Metadata with instance uid %s already exists and is newer",
-        mxf_uuid_to_string (&MXF_METADATA_BASE (m)->instance_uid, str));
-    g_object_unref (m);
-    return GST_FLOW_OK;
+static gpointer
+gst_mxf_demux_parse_metadata_sets_func (gpointer user_data)
+{
+  GstMXFDemuxMetadataParseJob *job = user_data;
+  gint i;
+
+  while ((i = g_atomic_int_add (&job->next, 1)) < (gint) job->sets->len) {
+    GstMXFDemuxMetadataSet *set =
+        &g_array_index (job->sets, GstMXFDemuxMetadataSet, i);
+
+    set->metadata =
+        gst_mxf_demux_parse_metadata_set (job->demux, job->primer, &set->key,
+        set->offset, set->buffer);
   }
 
-  g_rw_lock_writer_lock (&demux->metadata_lock);
+  return NULL;
+}
 
-  demux->update_metadata = TRUE;
-  gst_mxf_demux_reset_linked_metadata (demux);
+/* Parses the local sets of a complete header metadata region. Parsing
+ * of the sets is independent of each other and is split over worker
+ * threads, the results are then added to the metadata table in file
+ * order so that later sets with the same instance UID still win */
+static GstFlowReturn
+gst_mxf_demux_handle_metadata_sets (GstMXFDemux * demux, GArray * sets)
+{
+  GstMXFDemuxMetadataParseJob job;
+  GThread *threads[METADATA_PARSE_MAX_THREADS];
+  guint n_threads, i;
+  GstFlowReturn ret = GST_FLOW_OK;
 
-  g_hash_table_replace (demux->metadata, &MXF_METADATA_BASE (m)->instance_uid,
-      m);
+  if (sets->len == 0)
+    return GST_FLOW_OK;
 
-  g_rw_lock_writer_unlock (&demux->metadata_lock);
+  job.demux = demux;
+  job.primer = &demux->current_partition->primer;
+  job.sets = sets;
+  job.next = 0;
+
+#if GLIB_CHECK_VERSION(2,36,0)
+  n_threads = g_get_num_processors ();
+#else
+  n_threads = METADATA_PARSE_MAX_THREADS;
+#endif
+  n_threads = MIN (n_threads, sets->len / METADATA_PARSE_MIN_SETS_PER_THREAD);
+  n_threads = CLAMP (n_threads, 1, METADATA_PARSE_MAX_THREADS);
+
+  GST_DEBUG_OBJECT (demux, "Parsing %u metadata sets with %u threads",
+      sets->len, n_threads);
+
+  /* The current thread is the first worker */
+  for (i = 1; i < n_threads; i++) {
+    threads[i] =
+        g_thread_try_new ("mxfdemux-metadata",
+        gst_mxf_demux_parse_metadata_sets_func, &job, NULL);
+  }
+  gst_mxf_demux_parse_metadata_sets_func (&job);
+  for (i = 1; i < n_threads; i++) {
+    if (threads[i])
+      g_thread_join (threads[i]);
+  }
+
+  for (i = 0; i < sets->len; i++) {
+    GstMXFDemuxMetadataSet *set =
+        &g_array_index (sets, GstMXFDemuxMetadataSet, i);
+
+    if (set->metadata && ret == GST_FLOW_OK)
+      ret = gst_mxf_demux_add_metadata (demux, set->metadata);
+    else if (set->metadata)
+      g_object_unref (set->metadata);
+    set->metadata = NULL;
+  }
 
   return ret;
 }
 
+static void
+gst_mxf_demux_metadata_set_clear (GstMXFDemuxMetadataSet * set)
+{
+  gst_buffer_replace (&set->buffer, NULL);
+  if (set->metadata)
+    g_object_unref (set->metadata);
+  set->metadata = NULL;
+}
+
 static GstFlowReturn
 gst_mxf_demux_handle_generic_container_system_item (GstMXFDemux * demux,
     const MXFUL * key, GstBuffer * buffer)
@@ -1456,10 +1694,12 @@ gst_mxf_demux_handle_generic_container_system_item (GstMXFDemux * demux,
       " at offset %" G_GUINT64_FORMAT, gst_buffer_get_size (buffer),
       demux->offset);
 
-  if (demux->current_partition->essence_container_offset == 0)
+  if (demux->current_partition->essence_container_offset == 0) {
     demux->current_partition->essence_container_offset =
         demux->offset - demux->current_partition->partition.this_partition -
         demux->run_in;
+    demux->update_index_tables = TRUE;
+  }
 
   /* TODO: parse this */
   return GST_FLOW_OK;
@@ -1556,10 +1796,7 @@ gst_mxf_demux_pad_set_component (GstMXFDemux * demux, GstMXFDemuxPad * pad,
   }
 
   pad->current_component_start = source_track->origin;
-  if (pad->current_component->parent.duration >= -1)
-    pad->current_component_duration = pad->current_component->parent.duration;
-  else
-    pad->current_component_duration = -1;
+  gst_mxf_demux_pad_update_component_duration (demux, pad, source_track);
 
   if (pad->material_track->edit_rate.n != source_track->edit_rate.n ||
       pad->material_track->edit_rate.n != source_track->edit_rate.n) {
@@ -1567,12 +1804,6 @@ gst_mxf_demux_pad_set_component (GstMXFDemux * demux, GstMXFDemuxPad * pad,
         gst_util_uint64_scale (pad->current_component->start_position,
         source_track->edit_rate.n * pad->material_track->edit_rate.d,
         source_track->edit_rate.d * pad->material_track->edit_rate.n);
-
-    if (pad->current_component_duration != -1)
-      pad->current_component_duration =
-          gst_util_uint64_scale (pad->current_component_duration,
-          source_track->edit_rate.n * pad->material_track->edit_rate.d,
-          source_track->edit_rate.d * pad->material_track->edit_rate.n);
   } else {
     pad->current_component_start += pad->current_component->start_position;
   }
@@ -1603,6 +1834,68 @@ gst_mxf_demux_pad_set_component (GstMXFDemux * demux, GstMXFDemuxPad * pad,
   return ret;
 }
 
+/* Offsets in the index increase with the position but there can be holes
+ * for elements that were neither read nor indexed yet */
+static gint64
+gst_mxf_demux_find_index_position (GstMXFDemuxEssenceTrack * etrack,
+    guint64 offset)
+{
+  gint64 low, high;
+
+  if (!etrack->offsets)
+    return -1;
+
+  low = 0;
+  high = ((gint64) etrack->offsets->len) - 1;
+  while (low <= high) {
+    gint64 mid = low + (high - low) / 2;
+    gint64 i = mid;
+    GstMXFDemuxIndex *idx;
+
+    while (i >= low
+        && g_array_index (etrack->offsets, GstMXFDemuxIndex, i).offset == 0)
+      i--;
+
+    if (i < low) {
+      low = mid + 1;
+      continue;
+    }
+
+    idx = &g_array_index (etrack->offsets, GstMXFDemuxIndex, i);
+    if (idx->offset == offset)
+      return i;
+    else if (idx->offset < offset)
+      low = mid + 1;
+    else
+      high = i - 1;
+  }
+
+  return -1;
+}
+
+static void
+gst_mxf_demux_ignore_index_table (GstMXFDemux * demux,
+    GstMXFDemuxEssenceTrack * etrack)
+{
+  guint i;
+
+  GST_WARNING_OBJECT (demux, "Index table segments don't match the essence "
+      "elements of track %u, ignoring them", etrack->track_number);
+
+  etrack->ignore_index_table = TRUE;
+
+  if (!etrack->offsets)
+    return;
+
+  for (i = 0; i < etrack->offsets->len; i++) {
+    GstMXFDemuxIndex *idx = &g_array_index (etrack->offsets, GstMXFDemuxIndex,
+        i);
+
+    if (idx->from_index_table)
+      memset (idx, 0, sizeof (GstMXFDemuxIndex));
+  }
+}
+
 static GstFlowReturn
 gst_mxf_demux_handle_generic_container_essence_element (GstMXFDemux * demux,
     const MXFUL * key, GstBuffer * buffer, gboolean peek)
@@ -1625,10 +1918,12 @@ gst_mxf_demux_handle_generic_container_essence_element (GstMXFDemux * demux,
   GST_DEBUG_OBJECT (demux, "  essence element type = 0x%02x", key->u[14]);
   GST_DEBUG_OBJECT (demux, "  essence element number = 0x%02x", key->u[15]);
 
-  if (demux->current_partition->essence_container_offset == 0)
+  if (demux->current_partition->essence_container_offset == 0) {
     demux->current_partition->essence_container_offset =
         demux->offset - demux->current_partition->partition.this_partition -
         demux->run_in;
+    demux->update_index_tables = TRUE;
+  }
 
   if (!demux->current_package) {
     GST_ERROR_OBJECT (demux, "No package selected yet");
@@ -1667,17 +1962,9 @@ gst_mxf_demux_handle_generic_container_essence_element (GstMXFDemux * demux,
   if (etrack->position == -1) {
     GST_DEBUG_OBJECT (demux,
         "Unknown essence track position, looking into index");
-    if (etrack->offsets) {
-      for (i = 0; i < etrack->offsets->len; i++) {
-        GstMXFDemuxIndex *idx =
-            &g_array_index (etrack->offsets, GstMXFDemuxIndex, i);
-
-        if (idx->offset != 0 && idx->offset == demux->offset - demux->run_in) {
-          etrack->position = i;
-          break;
-        }
-      }
-    }
+    etrack->position =
+        gst_mxf_demux_find_index_position (etrack,
+        demux->offset - demux->run_in);
 
     if (etrack->position == -1) {
       GST_WARNING_OBJECT (demux, "Essence track position not in index");
@@ -1730,11 +2017,17 @@ gst_mxf_demux_handle_generic_container_essence_element (GstMXFDemux * demux,
       GstMXFDemuxIndex *index =
           &g_array_index (etrack->offsets, GstMXFDemuxIndex, etrack->position);
 
+      if (index->from_index_table
+          && index->offset != demux->offset - demux->run_in)
+        gst_mxf_demux_ignore_index_table (demux, etrack);
+
       index->offset = demux->offset - demux->run_in;
       index->keyframe = keyframe;
+      index->from_index_table = FALSE;
     } else {
       GstMXFDemuxIndex index;
 
+      memset (&index, 0, sizeof (index));
       index.offset = demux->offset - demux->run_in;
       index.keyframe = keyframe;
       g_array_insert_val (etrack->offsets, etrack->position, index);
@@ -1908,7 +2201,7 @@ gst_mxf_demux_handle_random_index_pack (GstMXFDemux * demux, const MXFUL * key,
   guint i;
   GList *l;
   GstMapInfo map;
-  gboolean ret;
+  gboolean ret, following;
 
   GST_DEBUG_OBJECT (demux,
       "Handling random index pack of size %" G_GSIZE_FORMAT " at offset %"
@@ -1919,6 +2212,8 @@ gst_mxf_demux_handle_random_index_pack (GstMXFDemux * demux, const MXFUL * key,
     return GST_FLOW_OK;
   }
 
+  following = gst_mxf_demux_is_following (demux);
+
   gst_buffer_map (buffer, &map, GST_MAP_READ);
   ret =
       mxf_random_index_pack_parse (key, map.data, map.size,
@@ -1930,6 +2225,9 @@ gst_mxf_demux_handle_random_index_pack (GstMXFDemux * demux, const MXFUL * key,
     return GST_FLOW_ERROR;
   }
 
+  if (following)
+    gst_mxf_demux_set_follow_complete (demux);
+
   for (i = 0; i < demux->random_index_pack->len; i++) {
     GstMXFDemuxPartition *p = NULL;
     MXFRandomIndexPackEntry *e =
@@ -1981,6 +2279,7 @@ gst_mxf_demux_handle_index_table_segment (GstMXFDemux * demux,
   MXFIndexTableSegment *segment;
   GstMapInfo map;
   gboolean ret;
+  GList *l;
 
   GST_DEBUG_OBJECT (demux,
       "Handling index table segment of size %" G_GSIZE_FORMAT " at offset %"
@@ -1999,16 +2298,249 @@ gst_mxf_demux_handle_index_table_segment (GstMXFDemux * demux,
 
   if (!ret) {
     GST_ERROR_OBJECT (demux, "Parsing index table segment failed");
+    g_free (segment);
     return GST_FLOW_ERROR;
   }
 
-  demux->pending_index_table_segments =
-      g_list_prepend (demux->pending_index_table_segments, segment);
+  /* The same segments are usually repeated in several partitions */
+  for (l = demux->index_table_segments; l; l = l->next) {
+    MXFIndexTableSegment *tmp = l->data;
 
+    if (tmp->index_sid == segment->index_sid &&
+        tmp->body_sid == segment->body_sid &&
+        tmp->index_start_position == segment->index_start_position &&
+        tmp->index_duration == segment->index_duration) {
+      GST_DEBUG_OBJECT (demux, "Replacing already known index table segment");
+      mxf_index_table_segment_reset (tmp);
+      g_free (tmp);
+      l->data = segment;
+      break;
+    }
+  }
+
+  if (!l)
+    demux->index_table_segments =
+        g_list_prepend (demux->index_table_segments, segment);
+
+  demux->update_index_tables = TRUE;
 
   return GST_FLOW_OK;
 }
 
+/* Converts an offset inside the essence container with @body_sid to
+ * an offset in the file (without run-in), or -1 if the partition
+ * containing it is not known yet. @hint is used to continue the
+ * search from the last found partition */
+static guint64
+gst_mxf_demux_stream_offset_to_offset (GstMXFDemux * demux, guint32 body_sid,
+    guint64 stream_offset, GList ** hint)
+{
+  GstMXFDemuxPartition *p = NULL;
+  gboolean unknown = FALSE;
+  GList *l;
+
+  l = *hint;
+  if (!l || ((GstMXFDemuxPartition *) l->data)->partition.body_offset >
+      stream_offset)
+    l = demux->partitions;
+
+  for (; l; l = l->next) {
+    GstMXFDemuxPartition *tmp = l->data;
+
+    if (tmp->partition.body_sid != body_sid)
+      continue;
+
+    /* Only known from the random index pack so far */
+    if (tmp->partition.major_version == 0) {
+      unknown = TRUE;
+      continue;
+    }
+
+    if (tmp->partition.body_offset > stream_offset)
+      break;
+
+    p = tmp;
+    *hint = l;
+    unknown = FALSE;
+  }
+
+  if (!p || unknown || p->essence_container_offset == 0)
+    return -1;
+
+  return p->partition.this_partition + p->essence_container_offset +
+      stream_offset - p->partition.body_offset;
+}
+
+/* Index table segments only store the offset of the content package, the
+ * delta entries then give the offset of each element inside it. Elements
+ * are ordered by their track number (SMPTE 379M 7.1) with an optional
+ * system item first */
+static gboolean
+gst_mxf_demux_find_delta_id (GstMXFDemux * demux,
+    GstMXFDemuxEssenceTrack * etrack, const MXFIndexTableSegment * segment,
+    guint * delta_id)
+{
+  guint i, n_tracks = 0, rank = 0;
+
+  for (i = 0; i < demux->essence_tracks->len; i++) {
+    GstMXFDemuxEssenceTrack *tmp =
+        &g_array_index (demux->essence_tracks, GstMXFDemuxEssenceTrack, i);
+
+    if (tmp->body_sid != etrack->body_sid)
+      continue;
+
+    n_tracks++;
+    if (tmp != etrack && tmp->track_number < etrack->track_number)
+      rank++;
+  }
+
+  if (n_tracks > 1 && etrack->track_number == 0)
+    return FALSE;
+
+  if (segment->n_delta_entries == 0 && n_tracks == 1)
+    *delta_id = 0;
+  else if (segment->n_delta_entries == n_tracks)
+    *delta_id = rank;
+  else if (segment->n_delta_entries == n_tracks + 1)
+    *delta_id = rank + 1;
+  else
+    return FALSE;
+
+  return TRUE;
+}
+
+static void
+gst_mxf_demux_apply_index_table_segment (GstMXFDemux * demux,
+    GstMXFDemuxEssenceTrack * etrack, const MXFIndexTableSegment * segment)
+{
+  const MXFMetadataTimelineTrack *track = etrack->source_track;
+  guint32 element_delta = 0;
+  guint slice = 0;
+  GList *hint = NULL;
+  guint delta_id;
+  gint64 duration, i;
+
+  if (segment->body_sid != etrack->body_sid || !track)
+    return;
+
+  if ((gint64) segment->index_edit_rate.n * track->edit_rate.d !=
+      (gint64) segment->index_edit_rate.d * track->edit_rate.n) {
+    GST_DEBUG_OBJECT (demux, "Index edit rate %d/%d differs from the edit "
+        "rate of track %u", segment->index_edit_rate.n,
+        segment->index_edit_rate.d, etrack->track_number);
+    return;
+  }
+
+  if (!gst_mxf_demux_find_delta_id (demux, etrack, segment, &delta_id)) {
+    GST_DEBUG_OBJECT (demux, "Can't find delta entry for track %u",
+        etrack->track_number);
+    return;
+  }
+
+  if (segment->n_delta_entries > 0) {
+    element_delta = segment->delta_entries[delta_id].element_delta;
+    slice = segment->delta_entries[delta_id].slice;
+  }
+
+  /* Elements after variable sized elements start a new slice whose
+   * offset is stored in the index entries */
+  if (slice > segment->slice_count ||
+      (slice > 0 && segment->edit_unit_byte_count != 0)) {
+    GST_DEBUG_OBJECT (demux, "Invalid slice %u for track %u", slice,
+        etrack->track_number);
+    return;
+  }
+
+  if (segment->edit_unit_byte_count != 0) {
+    /* A duration of 0 means the complete essence container */
+    duration = segment->index_duration;
+    if (duration <= 0)
+      duration = etrack->duration - segment->index_start_position;
+  } else {
+    duration = segment->n_index_entries;
+    if (segment->index_duration > 0)
+      duration = MIN (duration, segment->index_duration);
+  }
+
+  if (segment->index_start_position < 0 || duration <= 0 ||
+      segment->index_start_position + duration > G_MAXUINT)
+    return;
+
+  GST_DEBUG_OBJECT (demux, "Applying index table segment for positions %"
+      G_GINT64_FORMAT " to %" G_GINT64_FORMAT " of track %u",
+      segment->index_start_position,
+      segment->index_start_position + duration, etrack->track_number);
+
+  if (!etrack->offsets)
+    etrack->offsets = g_array_new (FALSE, TRUE, sizeof (GstMXFDemuxIndex));
+
+  if (etrack->offsets->len < segment->index_start_position + duration)
+    g_array_set_size (etrack->offsets,
+        segment->index_start_position + duration);
+
+  for (i = 0; i < duration; i++) {
+    GstMXFDemuxIndex *idx = &g_array_index (etrack->offsets, GstMXFDemuxIndex,
+        segment->index_start_position + i);
+    guint64 stream_offset, offset;
+    gboolean keyframe = TRUE;
+    gint8 keyframe_offset = 0;
+
+    /* Offsets of essence elements that were already read are exact */
+    if (idx->offset != 0 && !idx->from_index_table)
+      continue;
+
+    if (segment->edit_unit_byte_count != 0) {
+      stream_offset =
+          (segment->index_start_position + i) * segment->edit_unit_byte_count;
+    } else {
+      const MXFIndexEntry *entry = &segment->index_entries[i];
+
+      stream_offset = entry->stream_offset;
+      if (slice > 0)
+        stream_offset += entry->slice_offset[slice - 1];
+      /* Random access flag set or no prediction at all */
+      keyframe = (entry->flags & 0x80) || (entry->flags & 0x30) == 0;
+      keyframe_offset = entry->key_frame_offset;
+    }
+
+    offset =
+        gst_mxf_demux_stream_offset_to_offset (demux, etrack->body_sid,
+        stream_offset + element_delta, &hint);
+    if (offset == -1)
+      continue;
+
+    idx->offset = offset;
+    idx->keyframe = keyframe;
+    idx->keyframe_offset = keyframe_offset;
+    idx->from_index_table = TRUE;
+  }
+}
+
+/* Fills the offsets of all essence tracks from the index table segments */
+static void
+gst_mxf_demux_update_index_tables (GstMXFDemux * demux)
+{
+  guint i;
+  GList *l;
+
+  if (!demux->update_index_tables || !demux->index_table_segments)
+    return;
+
+  demux->update_index_tables = FALSE;
+
+  for (i = 0; i < demux->essence_tracks->len; i++) {
+    GstMXFDemuxEssenceTrack *etrack =
+        &g_array_index (demux->essence_tracks, GstMXFDemuxEssenceTrack, i);
+
+    if (etrack->ignore_index_table)
+      continue;
+
+    /* Oldest first, so that newer segments take precedence */
+    for (l = g_list_last (demux->index_table_segments); l; l = l->prev)
+      gst_mxf_demux_apply_index_table_segment (demux, etrack, l->data);
+  }
+}
+
 static GstFlowReturn
 gst_mxf_demux_pull_klv_packet (GstMXFDemux * demux, guint64 offset, MXFUL * key,
     GstBuffer ** outbuf, guint * read)
@@ -2179,6 +2711,69 @@ gst_mxf_demux_pull_random_index_pack (GstMXFDemux * demux)
   demux->offset = old_offset;
 }
 
+/* Pulls all local sets of the header metadata of the current partition,
+ * starting at the current offset, and parses them at once. Stops at the
+ * end of the header metadata or before the first essence element */
+static GstFlowReturn
+gst_mxf_demux_pull_header_metadata (GstMXFDemux * demux)
+{
+  GArray *sets;
+  guint64 end;
+  MXFUL key;
+  GstBuffer *buffer = NULL;
+  guint read = 0;
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  if (demux->current_partition->parsed_metadata ||
+      !demux->current_partition->primer.mappings)
+    return GST_FLOW_OK;
+
+  end =
+      demux->run_in + demux->current_partition->primer.offset +
+      demux->current_partition->partition.header_byte_count;
+
+  sets = g_array_new (FALSE, TRUE, sizeof (GstMXFDemuxMetadataSet));
+  g_array_set_clear_func (sets,
+      (GDestroyNotify) gst_mxf_demux_metadata_set_clear);
+
+  while (demux->offset < end) {
+    ret =
+        gst_mxf_demux_pull_klv_packet (demux, demux->offset, &key, &buffer,
+        &read);
+    if (G_UNLIKELY (ret != GST_FLOW_OK))
+      break;
+
+    if (mxf_is_metadata (&key) || mxf_is_descriptive_metadata (&key)) {
+      GstMXFDemuxMetadataSet set;
+
+      memset (&set, 0, sizeof (set));
+      memcpy (&set.key, &key, sizeof (MXFUL));
+      set.offset = demux->offset;
+      set.buffer = buffer;
+      g_array_append_val (sets, set);
+      buffer = NULL;
+    } else if (mxf_is_generic_container_system_item (&key) ||
+        mxf_is_generic_container_essence_element (&key) ||
+        mxf_is_avid_essence_container_essence_element (&key)) {
+      gst_buffer_unref (buffer);
+      buffer = NULL;
+      break;
+    } else {
+      gst_buffer_unref (buffer);
+      buffer = NULL;
+    }
+
+    demux->offset += read;
+  }
+
+  if (ret == GST_FLOW_OK)
+    ret = gst_mxf_demux_handle_metadata_sets (demux, sets);
+
+  g_array_free (sets, TRUE);
+
+  return ret;
+}
+
 static void
 gst_mxf_demux_parse_footer_metadata (GstMXFDemux * demux)
 {
@@ -2255,78 +2850,37 @@ next_try:
           buffer = NULL;
           demux->offset =
               demux->run_in +
-              demux->current_partition->partition.this_partition -
-              demux->current_partition->partition.prev_partition;
-          goto next_try;
-        }
-      }
-      demux->offset += read;
-      gst_buffer_unref (buffer);
-      buffer = NULL;
-      break;
-    } else {
-      gst_buffer_unref (buffer);
-      buffer = NULL;
-      demux->offset =
-          demux->run_in +
-          demux->current_partition->partition.this_partition -
-          demux->current_partition->partition.prev_partition;
-      goto next_try;
-    }
-  }
-
-  /* parse metadata */
-  while (demux->offset <
-      demux->run_in + demux->current_partition->primer.offset +
-      demux->current_partition->partition.header_byte_count) {
-    ret =
-        gst_mxf_demux_pull_klv_packet (demux, demux->offset, &key, &buffer,
-        &read);
-    if (G_UNLIKELY (ret != GST_FLOW_OK)) {
-      demux->offset =
-          demux->run_in +
-          demux->current_partition->partition.this_partition -
-          demux->current_partition->partition.prev_partition;
-      goto next_try;
-    }
-
-    if (mxf_is_metadata (&key)) {
-      ret = gst_mxf_demux_handle_metadata (demux, &key, buffer);
-      demux->offset += read;
-      gst_buffer_unref (buffer);
-      buffer = NULL;
-
-      if (G_UNLIKELY (ret != GST_FLOW_OK)) {
-        gst_mxf_demux_reset_metadata (demux);
-        demux->offset =
-            demux->run_in +
-            demux->current_partition->partition.this_partition -
-            demux->current_partition->partition.prev_partition;
-        goto next_try;
-      }
-    } else if (mxf_is_descriptive_metadata (&key)) {
-      ret = gst_mxf_demux_handle_descriptive_metadata (demux, &key, buffer);
-      demux->offset += read;
-      gst_buffer_unref (buffer);
-      buffer = NULL;
-    } else if (mxf_is_fill (&key)) {
-      demux->offset += read;
-      gst_buffer_unref (buffer);
-      buffer = NULL;
-    } else if (mxf_is_generic_container_system_item (&key) ||
-        mxf_is_generic_container_essence_element (&key) ||
-        mxf_is_avid_essence_container_essence_element (&key)) {
+              demux->current_partition->partition.this_partition -
+              demux->current_partition->partition.prev_partition;
+          goto next_try;
+        }
+      }
       demux->offset += read;
       gst_buffer_unref (buffer);
       buffer = NULL;
       break;
     } else {
-      demux->offset += read;
       gst_buffer_unref (buffer);
       buffer = NULL;
+      demux->offset =
+          demux->run_in +
+          demux->current_partition->partition.this_partition -
+          demux->current_partition->partition.prev_partition;
+      goto next_try;
     }
   }
 
+  /* parse metadata */
+  ret = gst_mxf_demux_pull_header_metadata (demux);
+  if (G_UNLIKELY (ret != GST_FLOW_OK)) {
+    gst_mxf_demux_reset_metadata (demux);
+    demux->offset =
+        demux->run_in +
+        demux->current_partition->partition.this_partition -
+        demux->current_partition->partition.prev_partition;
+    goto next_try;
+  }
+
   /* resolve references etc */
 
   if (gst_mxf_demux_resolve_references (demux) !=
@@ -2346,6 +2900,163 @@ out:
   demux->current_partition = old_partition;
 }
 
+static GstFlowReturn
+gst_mxf_demux_pull_key (GstMXFDemux * demux, guint64 offset, MXFUL * key)
+{
+  GstBuffer *buffer = NULL;
+  GstFlowReturn ret;
+
+  if ((ret = gst_mxf_demux_pull_range (demux, offset, 16,
+              &buffer)) != GST_FLOW_OK)
+    return ret;
+
+  gst_buffer_extract (buffer, 0, key, 16);
+  gst_buffer_unref (buffer);
+
+  return GST_FLOW_OK;
+}
+
+static GstFlowReturn
+gst_mxf_demux_pull_skip_fill (GstMXFDemux * demux)
+{
+  GstFlowReturn ret;
+  MXFUL key;
+
+  while ((ret = gst_mxf_demux_pull_key (demux, demux->offset,
+              &key)) == GST_FLOW_OK && mxf_is_fill (&key)) {
+    GstBuffer *buffer = NULL;
+    guint read = 0;
+
+    if ((ret = gst_mxf_demux_pull_klv_packet (demux, demux->offset, &key,
+                &buffer, &read)) != GST_FLOW_OK)
+      break;
+
+    gst_buffer_unref (buffer);
+    demux->offset += read;
+  }
+
+  return ret;
+}
+
+/* Pulls the partition pack and the index table segments of a partition
+ * and finds where its essence container data starts */
+static void
+gst_mxf_demux_pull_partition_index (GstMXFDemux * demux,
+    GstMXFDemuxPartition * p)
+{
+  GstBuffer *buffer = NULL;
+  GstFlowReturn ret;
+  guint64 index_end;
+  guint read = 0;
+  MXFUL key;
+
+  demux->offset = demux->run_in + p->partition.this_partition;
+
+  ret =
+      gst_mxf_demux_pull_klv_packet (demux, demux->offset, &key, &buffer,
+      &read);
+  if (ret != GST_FLOW_OK)
+    return;
+
+  if (!mxf_is_partition_pack (&key) ||
+      gst_mxf_demux_handle_partition_pack (demux, &key,
+          buffer) != GST_FLOW_OK || demux->current_partition != p) {
+    GST_WARNING_OBJECT (demux, "No valid partition pack at offset %"
+        G_GUINT64_FORMAT, demux->offset);
+    gst_buffer_unref (buffer);
+    return;
+  }
+  gst_buffer_unref (buffer);
+  buffer = NULL;
+  demux->offset += read;
+
+  if (p->partition.index_byte_count == 0 &&
+      (p->partition.body_sid == 0 || p->essence_container_offset != 0))
+    return;
+
+  /* The header byte count starts at the primer pack, after
+   * any filler following the partition pack */
+  if (gst_mxf_demux_pull_skip_fill (demux) != GST_FLOW_OK)
+    return;
+
+  demux->offset += p->partition.header_byte_count;
+  index_end = demux->offset + p->partition.index_byte_count;
+
+  while (demux->offset < index_end) {
+    ret =
+        gst_mxf_demux_pull_klv_packet (demux, demux->offset, &key, &buffer,
+        &read);
+    if (ret != GST_FLOW_OK)
+      return;
+
+    if (mxf_is_index_table_segment (&key))
+      gst_mxf_demux_handle_index_table_segment (demux, &key, buffer);
+
+    gst_buffer_unref (buffer);
+    buffer = NULL;
+    demux->offset += read;
+  }
+
+  if (p->partition.body_sid == 0 || p->essence_container_offset != 0)
+    return;
+
+  if (gst_mxf_demux_pull_skip_fill (demux) != GST_FLOW_OK ||
+      gst_mxf_demux_pull_key (demux, demux->offset, &key) != GST_FLOW_OK)
+    return;
+
+  if (mxf_is_generic_container_system_item (&key) ||
+      mxf_is_generic_container_essence_element (&key) ||
+      mxf_is_avid_essence_container_essence_element (&key)) {
+    p->essence_container_offset =
+        demux->offset - p->partition.this_partition - demux->run_in;
+    demux->update_index_tables = TRUE;
+  }
+}
+
+/* In pull mode, collect the index table segments of all known partitions
+ * so that seeking does not need to read the essence linearly */
+static void
+gst_mxf_demux_pull_index_table_segments (GstMXFDemux * demux)
+{
+  guint64 old_offset = demux->offset;
+  GstMXFDemuxPartition *old_partition = demux->current_partition;
+  GList *l;
+
+  for (l = demux->partitions; l; l = l->next) {
+    GstMXFDemuxPartition *p = l->data;
+
+    if (p->parsed_index)
+      continue;
+
+    p->parsed_index = TRUE;
+    gst_mxf_demux_pull_partition_index (demux, p);
+  }
+
+  demux->offset = old_offset;
+  demux->current_partition = old_partition;
+}
+
+/* Checks if an offset taken from the index table segments really
+ * points to an essence element of this track */
+static gboolean
+gst_mxf_demux_check_index_table_offset (GstMXFDemux * demux,
+    GstMXFDemuxEssenceTrack * etrack, guint64 offset)
+{
+  MXFUL key;
+
+  /* Let the actual reading report errors */
+  if (gst_mxf_demux_pull_key (demux, offset + demux->run_in,
+          &key) != GST_FLOW_OK)
+    return TRUE;
+
+  if (!mxf_is_generic_container_essence_element (&key) &&
+      !mxf_is_avid_essence_container_essence_element (&key))
+    return FALSE;
+
+  return etrack->track_number == 0 ||
+      GST_READ_UINT32_BE (&key.u[12]) == etrack->track_number;
+}
+
 static GstFlowReturn
 gst_mxf_demux_handle_klv_packet (GstMXFDemux * demux, const MXFUL * key,
     GstBuffer * buffer, gboolean peek)
@@ -2489,6 +3200,10 @@ gst_mxf_demux_find_essence_element (GstMXFDemux * demux,
       " of track %u with body_sid %u (keyframe %d)", *position,
       etrack->track_number, etrack->body_sid, keyframe);
 
+  if (demux->random_access)
+    gst_mxf_demux_pull_index_table_segments (demux);
+  gst_mxf_demux_update_index_tables (demux);
+
 from_index:
 
   if (etrack->duration > 0 && *position >= etrack->duration) {
@@ -2505,6 +3220,17 @@ from_index:
 
     if (idx->offset != 0 && (!keyframe || idx->keyframe)) {
       current_offset = idx->offset;
+    } else if (idx->offset != 0 && idx->keyframe_offset < 0
+        && current_position + idx->keyframe_offset >= 0
+        && g_array_index (etrack->offsets, GstMXFDemuxIndex,
+            current_position + idx->keyframe_offset).offset != 0
+        && g_array_index (etrack->offsets, GstMXFDemuxIndex,
+            current_position + idx->keyframe_offset).keyframe) {
+      /* The index table segments tell us where the keyframe is */
+      current_position += idx->keyframe_offset;
+      current_offset =
+          g_array_index (etrack->offsets, GstMXFDemuxIndex,
+          current_position).offset;
     } else if (idx->offset != 0) {
       current_position--;
       while (current_position >= 0) {
@@ -2523,6 +3249,15 @@ from_index:
       }
     }
 
+    if (current_offset != -1 && demux->random_access
+        && g_array_index (etrack->offsets, GstMXFDemuxIndex,
+            current_position).from_index_table
+        && !gst_mxf_demux_check_index_table_offset (demux, etrack,
+            current_offset)) {
+      gst_mxf_demux_ignore_index_table (demux, etrack);
+      current_offset = -1;
+    }
+
     if (current_offset != -1) {
       GST_DEBUG_OBJECT (demux, "Found in index at offset %" G_GUINT64_FORMAT,
           current_offset);
@@ -2587,7 +3322,7 @@ from_index:
           gst_mxf_demux_pull_klv_packet (demux, demux->offset, &key, &buffer,
           &read);
 
-      if (ret == GST_FLOW_EOS) {
+      if (ret == GST_FLOW_EOS && !gst_mxf_demux_is_following (demux)) {
         for (i = 0; i < demux->essence_tracks->len; i++) {
           GstMXFDemuxEssenceTrack *t =
               &g_array_index (demux->essence_tracks, GstMXFDemuxEssenceTrack,
@@ -2647,6 +3382,46 @@ from_index:
   return -1;
 }
 
+/* Waits for a followed file to grow. Returns GST_FLOW_FLUSHING if the
+ * wait was interrupted by a flush, a seek or a state change */
+static GstFlowReturn
+gst_mxf_demux_wait_for_data (GstMXFDemux * demux)
+{
+  gint64 now = g_get_monotonic_time ();
+  gboolean interrupted;
+
+  if (!demux->follow_waiting) {
+    GST_DEBUG_OBJECT (demux, "Reached end of growing file at offset %"
+        G_GUINT64_FORMAT ", waiting for more data", demux->offset);
+    demux->follow_waiting = TRUE;
+    demux->follow_wait_start = now;
+  } else if (demux->follow_timeout > 0
+      && (now - demux->follow_wait_start) * GST_USECOND >=
+      demux->follow_timeout) {
+    GST_INFO_OBJECT (demux, "File didn't grow for %" GST_TIME_FORMAT
+        ", assuming it is complete", GST_TIME_ARGS (demux->follow_timeout));
+    gst_mxf_demux_set_follow_complete (demux);
+    return GST_FLOW_OK;
+  }
+
+  /* The read-ahead window ends at the previous end of the file */
+  gst_buffer_replace (&demux->read_ahead, NULL);
+
+  g_mutex_lock (&demux->follow_lock);
+  if (!demux->follow_interrupted)
+    g_cond_wait_until (&demux->follow_cond, &demux->follow_lock,
+        now + FOLLOW_POLL_INTERVAL / GST_USECOND);
+  interrupted = demux->follow_interrupted;
+  g_mutex_unlock (&demux->follow_lock);
+
+  if (interrupted) {
+    GST_DEBUG_OBJECT (demux, "Waiting for more data was interrupted");
+    return GST_FLOW_FLUSHING;
+  }
+
+  return GST_FLOW_OK;
+}
+
 static GstFlowReturn
 gst_mxf_demux_pull_and_handle_klv_packet (GstMXFDemux * demux)
 {
@@ -2667,6 +3442,16 @@ gst_mxf_demux_pull_and_handle_klv_packet (GstMXFDemux * demux)
       gst_mxf_demux_pull_klv_packet (demux, demux->offset, &key, &buffer,
       &read);
 
+  if (ret == GST_FLOW_EOS && gst_mxf_demux_is_following (demux)) {
+    ret = gst_mxf_demux_wait_for_data (demux);
+    goto beach;
+  } else if (ret == GST_FLOW_OK && demux->follow_waiting) {
+    GST_DEBUG_OBJECT (demux, "File grew, continuing");
+    demux->follow_waiting = FALSE;
+    gst_element_post_message (GST_ELEMENT_CAST (demux),
+        gst_message_new_duration_changed (GST_OBJECT_CAST (demux)));
+  }
+
   if (ret == GST_FLOW_EOS && demux->src->len > 0) {
     guint i;
     GstMXFDemuxPad *p = NULL;
@@ -2730,6 +3515,11 @@ gst_mxf_demux_pull_and_handle_klv_packet (GstMXFDemux * demux)
   ret = gst_mxf_demux_handle_klv_packet (demux, &key, buffer, FALSE);
   demux->offset += read;
 
+  /* Parse all header metadata following the primer pack at once */
+  if (ret == GST_FLOW_OK && mxf_is_primer_pack (&key)
+      && demux->current_partition)
+    ret = gst_mxf_demux_pull_header_metadata (demux);
+
   if (ret == GST_FLOW_OK && demux->src->len > 0
       && demux->essence_tracks->len > 0) {
     GstMXFDemuxPad *earliest = NULL;
@@ -3082,6 +3872,8 @@ gst_mxf_demux_chain (GstPad * pad, GstObject * parent, GstBuffer * inbuf)
     gst_adapter_flush (demux->adapter, offset);
 
     if (length > 0) {
+      /* A sub-buffer if the value lies inside the first input buffer,
+       * otherwise the value is copied once into a new buffer */
       buffer = gst_adapter_take_buffer (demux->adapter, length);
 
       ret = gst_mxf_demux_handle_klv_packet (demux, &key, buffer, FALSE);
@@ -3340,6 +4132,9 @@ gst_mxf_demux_seek_pull (GstMXFDemux * demux, GstEvent * event)
   flush = ! !(flags & GST_SEEK_FLAG_FLUSH);
   keyframe = ! !(flags & GST_SEEK_FLAG_KEY_UNIT);
 
+  /* The loop might be waiting for a followed file to grow */
+  gst_mxf_demux_set_follow_interrupted (demux, TRUE);
+
   if (flush) {
     GstEvent *e;
 
@@ -3357,6 +4152,8 @@ gst_mxf_demux_seek_pull (GstMXFDemux * demux, GstEvent * event)
   /* Take the stream lock */
   GST_PAD_STREAM_LOCK (demux->sinkpad);
 
+  gst_mxf_demux_set_follow_interrupted (demux, FALSE);
+
   if (flush) {
     GstEvent *e;
 
@@ -3506,6 +4303,236 @@ unresolved_metadata:
   }
 }
 
+static MXFMetadataTimelineTrack *
+gst_mxf_demux_find_timecode_track_in_package (MXFMetadataGenericPackage *
+    package, MXFMetadataTimecodeComponent ** component)
+{
+  guint i;
+
+  for (i = 0; i < package->n_tracks; i++) {
+    MXFMetadataTrack *track = package->tracks[i];
+
+    if (!track || !MXF_IS_METADATA_TIMELINE_TRACK (track) || !track->sequence
+        || track->sequence->n_structural_components == 0
+        || !track->sequence->structural_components[0]
+        || !MXF_IS_METADATA_TIMECODE_COMPONENT (track->
+            sequence->structural_components[0]))
+      continue;
+
+    *component =
+        MXF_METADATA_TIMECODE_COMPONENT (track->
+        sequence->structural_components[0]);
+    return MXF_METADATA_TIMELINE_TRACK (track);
+  }
+
+  return NULL;
+}
+
+/* Gets the offset in nanoseconds from the timeline of the played package
+ * to the one of @package, from the first source clip of the played
+ * package that references @package */
+static gboolean
+gst_mxf_demux_get_package_offset (GstMXFDemux * demux,
+    MXFMetadataGenericPackage * package, gint64 * offset)
+{
+  MXFMetadataGenericPackage *current_package = demux->current_package;
+  guint i, j;
+
+  if (package == current_package) {
+    *offset = 0;
+    return TRUE;
+  }
+
+  for (i = 0; i < current_package->n_tracks; i++) {
+    MXFMetadataTrack *track = current_package->tracks[i];
+    MXFFraction *edit_rate;
+    gint64 position = 0;
+
+    if (!track || !MXF_IS_METADATA_TIMELINE_TRACK (track) || !track->sequence)
+      continue;
+
+    edit_rate = &MXF_METADATA_TIMELINE_TRACK (track)->edit_rate;
+    if (edit_rate->n <= 0 || edit_rate->d <= 0)
+      continue;
+
+    for (j = 0; j < track->sequence->n_structural_components; j++) {
+      MXFMetadataStructuralComponent *component =
+          track->sequence->structural_components[j];
+
+      if (!component)
+        break;
+
+      /* The clip starts at @position in the played package and at its
+       * start position in @package, both in edit units of this track */
+      if (MXF_IS_METADATA_SOURCE_CLIP (component)
+          && MXF_METADATA_GENERIC_PACKAGE (MXF_METADATA_SOURCE_CLIP
+              (component)->source_package) == package) {
+        gint64 diff =
+            MXF_METADATA_SOURCE_CLIP (component)->start_position - position;
+
+        *offset =
+            gst_util_uint64_scale (ABS (diff), GST_SECOND * edit_rate->d,
+            edit_rate->n);
+        if (diff < 0)
+          *offset = -*offset;
+        return TRUE;
+      }
+
+      if (component->duration < 0)
+        break;
+      position += component->duration;
+    }
+  }
+
+  return FALSE;
+}
+
+/* Prefers the timecode of the played package, then the one of any other
+ * package that the played package references. @offset is set to the
+ * offset of the timecode track's package, see above */
+static MXFMetadataTimelineTrack *
+gst_mxf_demux_find_timecode_track (GstMXFDemux * demux,
+    MXFMetadataTimecodeComponent ** component, gint64 * offset)
+{
+  MXFMetadataTimelineTrack *track = NULL;
+  guint i;
+
+  if (!demux->current_package)
+    return NULL;
+
+  track =
+      gst_mxf_demux_find_timecode_track_in_package (demux->current_package,
+      component);
+  if (track) {
+    *offset = 0;
+    return track;
+  }
+
+  if (demux->preface && demux->preface->content_storage) {
+    MXFMetadataContentStorage *storage = demux->preface->content_storage;
+
+    for (i = 0; i < storage->n_packages; i++) {
+      if (!storage->packages[i] || storage->packages[i] ==
+          demux->current_package
+          || !gst_mxf_demux_get_package_offset (demux, storage->packages[i],
+              offset))
+        continue;
+
+      track =
+          gst_mxf_demux_find_timecode_track_in_package (storage->packages[i],
+          component);
+      if (track)
+        return track;
+    }
+  }
+
+  return NULL;
+}
+
+/* Whether seeks in timecode format are possible */
+static gboolean
+gst_mxf_demux_can_seek_timecode (GstMXFDemux * demux)
+{
+  MXFMetadataTimecodeComponent *component;
+  gint64 offset;
+  gboolean ret;
+
+  if (!demux->random_access)
+    return FALSE;
+
+  g_rw_lock_reader_lock (&demux->metadata_lock);
+  ret = demux->metadata_resolved
+      && gst_mxf_demux_find_timecode_track (demux, &component, &offset);
+  g_rw_lock_reader_unlock (&demux->metadata_lock);
+
+  return ret;
+}
+
+/* Converts a timecode to a position in the played package. @offset is
+ * the offset of the package that contains the timecode track */
+static gboolean
+gst_mxf_demux_timecode_to_time (MXFMetadataTimelineTrack * track,
+    MXFMetadataTimecodeComponent * component, gint64 offset, gint64 timecode,
+    gint64 * time)
+{
+  if (timecode == -1) {
+    *time = -1;
+    return TRUE;
+  }
+
+  if (timecode < component->start_timecode || track->edit_rate.n <= 0
+      || track->edit_rate.d <= 0)
+    return FALSE;
+
+  *time =
+      gst_util_uint64_scale (timecode - component->start_timecode,
+      GST_SECOND * track->edit_rate.d, track->edit_rate.n);
+  if (*time < offset)
+    return FALSE;
+  *time -= offset;
+
+  return TRUE;
+}
+
+/* Converts a seek in timecode format to a TIME seek */
+static GstEvent *
+gst_mxf_demux_convert_timecode_seek (GstMXFDemux * demux, GstEvent * event)
+{
+  GstFormat format;
+  GstSeekFlags flags;
+  GstSeekType start_type, stop_type;
+  gint64 start, stop;
+  gdouble rate;
+  MXFMetadataTimelineTrack *track;
+  MXFMetadataTimecodeComponent *component = NULL;
+  gint64 offset = 0;
+  GstEvent *ret = NULL;
+
+  gst_event_parse_seek (event, &rate, &format, &flags,
+      &start_type, &start, &stop_type, &stop);
+
+  if (start_type == GST_SEEK_TYPE_END || stop_type == GST_SEEK_TYPE_END) {
+    GST_WARNING_OBJECT (demux, "Timecode seeks relative to the end are not "
+        "supported");
+    return NULL;
+  }
+
+  g_rw_lock_reader_lock (&demux->metadata_lock);
+  if (!demux->metadata_resolved) {
+    GST_WARNING_OBJECT (demux, "Metadata not resolved yet");
+    goto done;
+  }
+
+  track = gst_mxf_demux_find_timecode_track (demux, &component, &offset);
+  if (!track) {
+    GST_WARNING_OBJECT (demux, "No timecode track");
+    goto done;
+  }
+
+  if ((start_type == GST_SEEK_TYPE_SET &&
+          !gst_mxf_demux_timecode_to_time (track, component, offset, start,
+              &start)) || (stop_type == GST_SEEK_TYPE_SET
+          && !gst_mxf_demux_timecode_to_time (track, component, offset, stop,
+              &stop))) {
+    GST_WARNING_OBJECT (demux, "Timecode before the start of the played "
+        "package");
+    goto done;
+  }
+
+  GST_DEBUG_OBJECT (demux, "Seeking to %" GST_TIME_FORMAT " - %"
+      GST_TIME_FORMAT " from timecodes", GST_TIME_ARGS (start),
+      GST_TIME_ARGS (stop));
+
+  ret = gst_event_new_seek (rate, GST_FORMAT_TIME, flags, start_type, start,
+      stop_type, stop);
+  gst_event_set_seqnum (ret, gst_event_get_seqnum (event));
+
+done:
+  g_rw_lock_reader_unlock (&demux->metadata_lock);
+
+  return ret;
+}
+
 static gboolean
 gst_mxf_demux_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
 {
@@ -3515,13 +4542,30 @@ gst_mxf_demux_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
   GST_DEBUG_OBJECT (pad, "handling event %s", GST_EVENT_TYPE_NAME (event));
 
   switch (GST_EVENT_TYPE (event)) {
-    case GST_EVENT_SEEK:
+    case GST_EVENT_SEEK:{
+      GstFormat format;
+
+      gst_event_parse_seek (event, NULL, &format, NULL, NULL, NULL, NULL,
+          NULL);
+      if (format == gst_mxf_demux_timecode_format) {
+        GstEvent *time_event =
+            gst_mxf_demux_convert_timecode_seek (demux, event);
+
+        gst_event_unref (event);
+        if (!time_event) {
+          ret = FALSE;
+          break;
+        }
+        event = time_event;
+      }
+
       if (demux->random_access)
         ret = gst_mxf_demux_seek_pull (demux, event);
       else
         ret = gst_mxf_demux_seek_push (demux, event);
       gst_event_unref (event);
       break;
+    }
     default:
       ret = gst_pad_push_event (demux->sinkpad, event);
       break;
@@ -3621,7 +4665,11 @@ gst_mxf_demux_src_query (GstPad * pad, GstObject * parent, GstQuery * query)
 
       ret = TRUE;
       gst_query_parse_seeking (query, &fmt, NULL, NULL, NULL);
-      if (fmt != GST_FORMAT_TIME) {
+      if (fmt == gst_mxf_demux_timecode_format) {
+        gst_query_set_seeking (query, fmt,
+            gst_mxf_demux_can_seek_timecode (demux), -1, -1);
+        goto done;
+      } else if (fmt != GST_FORMAT_TIME) {
         gst_query_set_seeking (query, fmt, FALSE, -1, -1);
         goto done;
       }
@@ -3732,6 +4780,7 @@ gst_mxf_demux_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
   switch (GST_EVENT_TYPE (event)) {
     case GST_EVENT_FLUSH_START:
       demux->flushing = TRUE;
+      gst_mxf_demux_set_follow_interrupted (demux, TRUE);
       ret = gst_pad_event_default (pad, parent, event);
       break;
     case GST_EVENT_FLUSH_STOP:
@@ -3739,6 +4788,7 @@ gst_mxf_demux_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
 
       gst_adapter_clear (demux->adapter);
       demux->flushing = FALSE;
+      gst_mxf_demux_set_follow_interrupted (demux, FALSE);
       demux->offset = 0;
       ret = gst_pad_event_default (pad, parent, event);
       break;
@@ -3882,6 +4932,17 @@ gst_mxf_demux_query (GstElement * element, GstQuery * query)
           continue;
 
         pdur = pad->material_track->parent.sequence->duration;
+
+        /* While following a growing file only the part that was already
+         * seen is known */
+        if (gst_mxf_demux_is_following (demux) && pad->current_essence_track) {
+          GstMXFDemuxEssenceTrack *etrack = pad->current_essence_track;
+
+          pdur = etrack->position;
+          if (etrack->offsets)
+            pdur = MAX (pdur, etrack->offsets->len);
+        }
+
         if (pad->material_track->edit_rate.n == 0 ||
             pad->material_track->edit_rate.d == 0 || pdur <= -1)
           continue;
@@ -3912,7 +4973,11 @@ gst_mxf_demux_query (GstElement * element, GstQuery * query)
 
       ret = TRUE;
       gst_query_parse_seeking (query, &fmt, NULL, NULL, NULL);
-      if (fmt != GST_FORMAT_TIME) {
+      if (fmt == gst_mxf_demux_timecode_format) {
+        gst_query_set_seeking (query, fmt,
+            gst_mxf_demux_can_seek_timecode (demux), -1, -1);
+        goto done;
+      } else if (fmt != GST_FORMAT_TIME) {
         gst_query_set_seeking (query, fmt, FALSE, -1, -1);
         goto done;
       }
@@ -3978,6 +5043,12 @@ gst_mxf_demux_change_state (GstElement * element, GstStateChange transition)
   switch (transition) {
     case GST_STATE_CHANGE_READY_TO_PAUSED:
       demux->seqnum = gst_util_seqnum_next ();
+      gst_mxf_demux_set_follow_interrupted (demux, FALSE);
+      break;
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      /* Don't let the streaming thread wait for a followed file to grow
+       * while the sink pad is deactivated */
+      gst_mxf_demux_set_follow_interrupted (demux, TRUE);
       break;
     default:
       break;
@@ -4012,6 +5083,12 @@ gst_mxf_demux_set_property (GObject * object, guint prop_id,
     case PROP_MAX_DRIFT:
       demux->max_drift = g_value_get_uint64 (value);
       break;
+    case PROP_FOLLOW:
+      demux->follow = g_value_get_boolean (value);
+      break;
+    case PROP_FOLLOW_TIMEOUT:
+      demux->follow_timeout = g_value_get_uint64 (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -4031,6 +5108,12 @@ gst_mxf_demux_get_property (GObject * object, guint prop_id,
     case PROP_MAX_DRIFT:
       g_value_set_uint64 (value, demux->max_drift);
       break;
+    case PROP_FOLLOW:
+      g_value_set_boolean (value, demux->follow);
+      break;
+    case PROP_FOLLOW_TIMEOUT:
+      g_value_set_uint64 (value, demux->follow_timeout);
+      break;
     case PROP_STRUCTURE:{
       GstStructure *s;
 
@@ -4084,6 +5167,8 @@ gst_mxf_demux_finalize (GObject * object)
   g_hash_table_destroy (demux->metadata);
 
   g_rw_lock_clear (&demux->metadata_lock);
+  g_mutex_clear (&demux->follow_lock);
+  g_cond_clear (&demux->follow_cond);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -4096,6 +5181,9 @@ gst_mxf_demux_class_init (GstMXFDemuxClass * klass)
 
   GST_DEBUG_CATEGORY_INIT (mxfdemux_debug, "mxfdemux", 0, "MXF demuxer");
 
+  gst_mxf_demux_timecode_format =
+      gst_format_register ("mxf-timecode", "MXF timecode in frames");
+
   parent_class = g_type_class_peek_parent (klass);
 
   gobject_class->finalize = gst_mxf_demux_finalize;
@@ -4118,6 +5206,19 @@ gst_mxf_demux_class_init (GstMXFDemuxClass * klass)
           "Structural metadata of the MXF file",
           GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_FOLLOW,
+      g_param_spec_boolean ("follow", "Follow",
+          "In pull mode, follow a file that is still being written and wait "
+          "for more data at its end until a footer partition or random index "
+          "pack is found", DEFAULT_FOLLOW,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_FOLLOW_TIMEOUT,
+      g_param_spec_uint64 ("follow-timeout", "Follow timeout",
+          "Nanoseconds without new data after which a followed file is "
+          "considered complete (0 = wait forever)", 0, G_MAXUINT64,
+          DEFAULT_FOLLOW_TIMEOUT, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state =
       GST_DEBUG_FUNCPTR (gst_mxf_demux_change_state);
   gstelement_class->query = GST_DEBUG_FUNCPTR (gst_mxf_demux_query);
@@ -4149,9 +5250,13 @@ gst_mxf_demux_init (GstMXFDemux * demux)
   gst_element_add_pad (GST_ELEMENT (demux), demux->sinkpad);
 
   demux->max_drift = 500 * GST_MSECOND;
+  demux->follow = DEFAULT_FOLLOW;
+  demux->follow_timeout = DEFAULT_FOLLOW_TIMEOUT;
 
   demux->adapter = gst_adapter_new ();
   g_rw_lock_init (&demux->metadata_lock);
+  g_mutex_init (&demux->follow_lock);
+  g_cond_init (&demux->follow_cond);
 
   demux->src = g_ptr_array_new ();
   demux->essence_tracks =
@@ -52,6 +52,7 @@ typedef struct
   MXFPartitionPack partition;
   MXFPrimerPack primer;
   gboolean parsed_metadata;
+  gboolean parsed_index;
   guint64 essence_container_offset;
 } GstMXFDemuxPartition;
 
@@ -59,6 +60,12 @@ typedef struct
 {
   guint64 offset;
   gboolean keyframe;
+  /* Relative position of the previous keyframe, only
+   * known from index table segments */
+  gint8 keyframe_offset;
+  /* TRUE if the offset was taken from an index table segment
+   * and the essence element was not read yet */
+  gboolean from_index_table;
 } GstMXFDemuxIndex;
 
 typedef struct
@@ -73,6 +80,7 @@ typedef struct
   gint64 duration;
 
   GArray *offsets;
+  gboolean ignore_index_table;
 
   MXFMetadataSourcePackage *source_package;
   MXFMetadataTimelineTrack *source_track;
@@ -138,6 +146,12 @@ struct _GstMXFDemux
 
   guint64 offset;
 
+  /* Pull mode read-ahead window */
+  GstBuffer *read_ahead;
+  guint64 read_ahead_offset;
+  /* End of the previous pull, to detect sequential reads */
+  guint64 last_pull_end;
+
   gboolean random_access;
   gboolean flushing;
 
@@ -151,10 +165,19 @@ struct _GstMXFDemux
   GstMXFDemuxPartition *current_partition;
 
   GArray *essence_tracks;
-  GList *pending_index_table_segments;
+  GList *index_table_segments;
+  gboolean update_index_tables;
 
   GArray *random_index_pack;
 
+  /* Growing file state */
+  gboolean follow_waiting;
+  gint64 follow_wait_start;
+  gboolean follow_complete;
+  GMutex follow_lock;
+  GCond follow_cond;
+  gboolean follow_interrupted;
+
   /* Metadata */
   GRWLock metadata_lock;
   gboolean update_metadata;
@@ -173,6 +196,8 @@ struct _GstMXFDemux
   /* Properties */
   gchar *requested_package_string;
   GstClockTime max_drift;
+  gboolean follow;
+  GstClockTime follow_timeout;
 };
 
 struct _GstMXFDemuxClass
@@ -31,20 +31,83 @@ GST_DEBUG_CATEGORY_EXTERN (mxf_debug);
 
 static GSList *_mxf_essence_element_handler_registry = NULL;
 
+/* Maps generic container essence container labels to the handler that
+ * handles tracks with this label, or NULL if no handler does. All
+ * handlers decide generic container tracks by the label alone, so the
+ * result of the first lookup for a label can be reused for every other
+ * track with the same label */
+static GHashTable *_mxf_essence_element_handler_table = NULL;
+G_LOCK_DEFINE_STATIC (_mxf_essence_element_handler_table);
+
 void
 mxf_essence_element_handler_register (const MXFEssenceElementHandler * handler)
 {
   _mxf_essence_element_handler_registry =
       g_slist_prepend (_mxf_essence_element_handler_registry,
       (gpointer) handler);
+
+  G_LOCK (_mxf_essence_element_handler_table);
+  if (_mxf_essence_element_handler_table)
+    g_hash_table_remove_all (_mxf_essence_element_handler_table);
+  G_UNLOCK (_mxf_essence_element_handler_table);
+}
+
+static const MXFUL *
+mxf_essence_element_handler_get_table_key (const MXFMetadataTimelineTrack *
+    track)
+{
+  const MXFUL *key = NULL;
+  guint i;
+
+  if (track->parent.descriptor == NULL)
+    return NULL;
+
+  /* Only tracks with a single descriptor using a generic container
+   * label are handled by the table, everything else (e.g. Avid labels
+   * that also depend on the picture essence coding) is checked by
+   * all handlers */
+  for (i = 0; i < track->parent.n_descriptor; i++) {
+    MXFMetadataFileDescriptor *d = track->parent.descriptor[i];
+
+    if (!d)
+      continue;
+
+    if (key)
+      return NULL;
+
+    key = &d->essence_container;
+  }
+
+  if (key && !mxf_is_generic_container_essence_container_label (key))
+    return NULL;
+
+  return key;
 }
 
 const MXFEssenceElementHandler *
 mxf_essence_element_handler_find (const MXFMetadataTimelineTrack * track)
 {
   GSList *l;
+  const MXFUL *key;
+  gpointer value;
   const MXFEssenceElementHandler *ret = NULL;
 
+  key = mxf_essence_element_handler_get_table_key (track);
+
+  if (key) {
+    gboolean found = FALSE;
+
+    G_LOCK (_mxf_essence_element_handler_table);
+    if (_mxf_essence_element_handler_table)
+      found =
+          g_hash_table_lookup_extended (_mxf_essence_element_handler_table, key,
+          NULL, &value);
+    G_UNLOCK (_mxf_essence_element_handler_table);
+
+    if (found)
+      return value;
+  }
+
   for (l = _mxf_essence_element_handler_registry; l; l = l->next) {
     MXFEssenceElementHandler *current = l->data;
 
@@ -53,6 +116,17 @@ mxf_essence_element_handler_find (const MXFMetadataTimelineTrack * track)
     }
   }
 
+  if (key) {
+    G_LOCK (_mxf_essence_element_handler_table);
+    if (!_mxf_essence_element_handler_table)
+      _mxf_essence_element_handler_table =
+          g_hash_table_new_full ((GHashFunc) mxf_ul_hash,
+          (GEqualFunc) mxf_ul_is_equal, (GDestroyNotify) g_free, NULL);
+    g_hash_table_insert (_mxf_essence_element_handler_table,
+        g_memdup (key, sizeof (MXFUL)), (gpointer) ret);
+    G_UNLOCK (_mxf_essence_element_handler_table);
+  }
+
   return ret;
 }
 
@@ -408,80 +408,83 @@ mxf_metadata_init (MXFMetadata * self)
 {
 }
 
-static GArray *_mxf_metadata_registry = NULL;
+/* Maps the local set type (guint16) to the GType handling it. The
+ * class of every registered type is kept referenced so that lookups
+ * for each parsed local set are a single hash table access */
+static GHashTable *_mxf_metadata_registry = NULL;
 
-#define _add_metadata_type(type) G_STMT_START { \
-  GType t = type; \
-  \
-  g_array_append_val (_mxf_metadata_registry, t); \
-} G_STMT_END
+static void
+_mxf_metadata_add_type (GType type)
+{
+  MXFMetadataClass *klass = MXF_METADATA_CLASS (g_type_class_ref (type));
+
+  /* The first registered type for a local set type wins */
+  if (klass->type == 0 ||
+      g_hash_table_contains (_mxf_metadata_registry,
+          GUINT_TO_POINTER (klass->type))) {
+    g_type_class_unref (klass);
+    return;
+  }
+
+  g_hash_table_insert (_mxf_metadata_registry, GUINT_TO_POINTER (klass->type),
+      GSIZE_TO_POINTER (type));
+}
 
 void
 mxf_metadata_init_types (void)
 {
   g_return_if_fail (_mxf_metadata_registry == NULL);
 
-  _mxf_metadata_registry = g_array_new (FALSE, TRUE, sizeof (GType));
-
-  _add_metadata_type (MXF_TYPE_METADATA_PREFACE);
-  _add_metadata_type (MXF_TYPE_METADATA_IDENTIFICATION);
-  _add_metadata_type (MXF_TYPE_METADATA_CONTENT_STORAGE);
-  _add_metadata_type (MXF_TYPE_METADATA_ESSENCE_CONTAINER_DATA);
-  _add_metadata_type (MXF_TYPE_METADATA_MATERIAL_PACKAGE);
-  _add_metadata_type (MXF_TYPE_METADATA_SOURCE_PACKAGE);
-  _add_metadata_type (MXF_TYPE_METADATA_TIMELINE_TRACK);
-  _add_metadata_type (MXF_TYPE_METADATA_EVENT_TRACK);
-  _add_metadata_type (MXF_TYPE_METADATA_STATIC_TRACK);
-  _add_metadata_type (MXF_TYPE_METADATA_SEQUENCE);
-  _add_metadata_type (MXF_TYPE_METADATA_SOURCE_CLIP);
-  _add_metadata_type (MXF_TYPE_METADATA_FILLER);
-  _add_metadata_type (MXF_TYPE_METADATA_TIMECODE_COMPONENT);
-  _add_metadata_type (MXF_TYPE_METADATA_DM_SEGMENT);
-  _add_metadata_type (MXF_TYPE_METADATA_DM_SOURCE_CLIP);
-  _add_metadata_type (MXF_TYPE_METADATA_FILE_DESCRIPTOR);
-  _add_metadata_type (MXF_TYPE_METADATA_GENERIC_PICTURE_ESSENCE_DESCRIPTOR);
-  _add_metadata_type (MXF_TYPE_METADATA_CDCI_PICTURE_ESSENCE_DESCRIPTOR);
-  _add_metadata_type (MXF_TYPE_METADATA_RGBA_PICTURE_ESSENCE_DESCRIPTOR);
-  _add_metadata_type (MXF_TYPE_METADATA_GENERIC_SOUND_ESSENCE_DESCRIPTOR);
-  _add_metadata_type (MXF_TYPE_METADATA_GENERIC_DATA_ESSENCE_DESCRIPTOR);
-  _add_metadata_type (MXF_TYPE_METADATA_MULTIPLE_DESCRIPTOR);
-  _add_metadata_type (MXF_TYPE_METADATA_NETWORK_LOCATOR);
-  _add_metadata_type (MXF_TYPE_METADATA_TEXT_LOCATOR);
-}
-
-#undef _add_metadata_type
+  _mxf_metadata_registry = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  _mxf_metadata_add_type (MXF_TYPE_METADATA_PREFACE);
+  _mxf_metadata_add_type (MXF_TYPE_METADATA_IDENTIFICATION);
+  _mxf_metadata_add_type (MXF_TYPE_METADATA_CONTENT_STORAGE);
+  _mxf_metadata_add_type (MXF_TYPE_METADATA_ESSENCE_CONTAINER_DATA);
+  _mxf_metadata_add_type (MXF_TYPE_METADATA_MATERIAL_PACKAGE);
+  _mxf_metadata_add_type (MXF_TYPE_METADATA_SOURCE_PACKAGE);
+  _mxf_metadata_add_type (MXF_TYPE_METADATA_TIMELINE_TRACK);
+  _mxf_metadata_add_type (MXF_TYPE_METADATA_EVENT_TRACK);
+  _mxf_metadata_add_type (MXF_TYPE_METADATA_STATIC_TRACK);
+  _mxf_metadata_add_type (MXF_TYPE_METADATA_SEQUENCE);
+  _mxf_metadata_add_type (MXF_TYPE_METADATA_SOURCE_CLIP);
+  _mxf_metadata_add_type (MXF_TYPE_METADATA_FILLER);
+  _mxf_metadata_add_type (MXF_TYPE_METADATA_TIMECODE_COMPONENT);
+  _mxf_metadata_add_type (MXF_TYPE_METADATA_DM_SEGMENT);
+  _mxf_metadata_add_type (MXF_TYPE_METADATA_DM_SOURCE_CLIP);
+  _mxf_metadata_add_type (MXF_TYPE_METADATA_FILE_DESCRIPTOR);
+  _mxf_metadata_add_type (MXF_TYPE_METADATA_GENERIC_PICTURE_ESSENCE_DESCRIPTOR);
+  _mxf_metadata_add_type (MXF_TYPE_METADATA_CDCI_PICTURE_ESSENCE_DESCRIPTOR);
+  _mxf_metadata_add_type (MXF_TYPE_METADATA_RGBA_PICTURE_ESSENCE_DESCRIPTOR);
+  _mxf_metadata_add_type (MXF_TYPE_METADATA_GENERIC_SOUND_ESSENCE_DESCRIPTOR);
+  _mxf_metadata_add_type (MXF_TYPE_METADATA_GENERIC_DATA_ESSENCE_DESCRIPTOR);
+  _mxf_metadata_add_type (MXF_TYPE_METADATA_MULTIPLE_DESCRIPTOR);
+  _mxf_metadata_add_type (MXF_TYPE_METADATA_NETWORK_LOCATOR);
+  _mxf_metadata_add_type (MXF_TYPE_METADATA_TEXT_LOCATOR);
+}
 
 void
 mxf_metadata_register (GType type)
 {
   g_return_if_fail (g_type_is_a (type, MXF_TYPE_METADATA));
+  g_return_if_fail (_mxf_metadata_registry != NULL);
 
-  g_array_append_val (_mxf_metadata_registry, type);
+  _mxf_metadata_add_type (type);
 }
 
 MXFMetadata *
 mxf_metadata_new (guint16 type, MXFPrimerPack * primer, guint64 offset,
     const guint8 * data, guint size)
 {
-  guint i;
-  GType t = G_TYPE_INVALID;
+  GType t;
   MXFMetadata *ret = NULL;
 
   g_return_val_if_fail (type != 0, NULL);
   g_return_val_if_fail (primer != NULL, NULL);
   g_return_val_if_fail (_mxf_metadata_registry != NULL, NULL);
 
-  for (i = 0; i < _mxf_metadata_registry->len; i++) {
-    GType tmp = g_array_index (_mxf_metadata_registry, GType, i);
-    MXFMetadataClass *klass = MXF_METADATA_CLASS (g_type_class_ref (tmp));
-
-    if (klass->type == type) {
-      g_type_class_unref (klass);
-      t = tmp;
-      break;
-    }
-    g_type_class_unref (klass);
-  }
+  t = (GType) GPOINTER_TO_SIZE (g_hash_table_lookup (_mxf_metadata_registry,
+          GUINT_TO_POINTER (type)));
 
   if (t == G_TYPE_INVALID) {
     GST_WARNING
@@ -490,7 +493,6 @@ mxf_metadata_new (guint16 type, MXFPrimerPack * primer, guint64 offset,
     return NULL;
   }
 
-
   GST_DEBUG ("Metadata type 0x%04x is handled by type %s", type,
       g_type_name (t));
 
@@ -6458,36 +6460,40 @@ mxf_descriptive_metadata_class_init (MXFDescriptiveMetadataClass * klass)
 {
 }
 
-typedef struct
-{
-  guint8 scheme;
-  GType *types;
-} _MXFDescriptiveMetadataScheme;
+/* Maps (scheme << 24 | type) to the GType handling it */
+static GHashTable *_dm_types = NULL;
 
-static GArray *_dm_schemes = NULL;
+#define DM_TYPE_KEY(scheme, type) \
+  GUINT_TO_POINTER ((((guint32) (scheme)) << 24) | ((type) & 0xffffff))
 
 void
 mxf_descriptive_metadata_register (guint8 scheme, GType * types)
 {
-  _MXFDescriptiveMetadataScheme s;
+  GType *p;
 
-  if (!_dm_schemes)
-    _dm_schemes =
-        g_array_new (FALSE, TRUE, sizeof (_MXFDescriptiveMetadataScheme));
+  if (!_dm_types)
+    _dm_types = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  for (p = types; *p; p++) {
+    MXFDescriptiveMetadataClass *klass =
+        MXF_DESCRIPTIVE_METADATA_CLASS (g_type_class_ref (*p));
 
-  s.scheme = scheme;
-  s.types = types;
+    if (klass->type == 0 ||
+        g_hash_table_contains (_dm_types, DM_TYPE_KEY (scheme, klass->type))) {
+      g_type_class_unref (klass);
+      continue;
+    }
 
-  g_array_append_val (_dm_schemes, s);
+    g_hash_table_insert (_dm_types, DM_TYPE_KEY (scheme, klass->type),
+        GSIZE_TO_POINTER (*p));
+  }
 }
 
 MXFDescriptiveMetadata *
 mxf_descriptive_metadata_new (guint8 scheme, guint32 type,
     MXFPrimerPack * primer, guint64 offset, const guint8 * data, guint size)
 {
-  guint i;
-  GType t = G_TYPE_INVALID, *p;
-  _MXFDescriptiveMetadataScheme *s = NULL;
+  GType t = G_TYPE_INVALID;
   MXFDescriptiveMetadata *ret = NULL;
 
   g_return_val_if_fail (primer != NULL, NULL);
@@ -6497,35 +6503,9 @@ mxf_descriptive_metadata_new (guint8 scheme, guint32 type,
     return NULL;
   }
 
-  for (i = 0; i < _dm_schemes->len; i++) {
-    _MXFDescriptiveMetadataScheme *data =
-        &g_array_index (_dm_schemes, _MXFDescriptiveMetadataScheme, i);
-
-    if (data->scheme == scheme) {
-      s = data;
-      break;
-    }
-  }
-
-  if (s == NULL) {
-    GST_WARNING ("Descriptive metadata scheme 0x%02x not supported", scheme);
-    return NULL;
-  }
-
-  p = s->types;
-  while (*p) {
-    GType tmp = *p;
-    MXFDescriptiveMetadataClass *klass =
-        MXF_DESCRIPTIVE_METADATA_CLASS (g_type_class_ref (tmp));
-
-    if (klass->type == type) {
-      g_type_class_unref (klass);
-      t = tmp;
-      break;
-    }
-    g_type_class_unref (klass);
-    p++;
-  }
+  if (_dm_types)
+    t = (GType) GPOINTER_TO_SIZE (g_hash_table_lookup (_dm_types,
+            DM_TYPE_KEY (scheme, type)));
 
   if (t == G_TYPE_INVALID) {
     GST_WARNING
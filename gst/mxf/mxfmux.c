@@ -52,9 +52,14 @@ static GstStaticPadTemplate src_templ = GST_STATIC_PAD_TEMPLATE ("src",
     GST_STATIC_CAPS ("application/mxf")
     );
 
+#define DEFAULT_STREAMABLE FALSE
+#define DEFAULT_BODY_PARTITION_INTERVAL 0
+
 enum
 {
-  PROP_0
+  PROP_0,
+  PROP_STREAMABLE,
+  PROP_BODY_PARTITION_INTERVAL
 };
 
 #define gst_mxf_mux_parent_class parent_class
@@ -110,6 +115,21 @@ gst_mxf_mux_class_init (GstMXFMuxClass * klass)
   gobject_class->set_property = gst_mxf_mux_set_property;
   gobject_class->get_property = gst_mxf_mux_get_property;
 
+  g_object_class_install_property (gobject_class, PROP_STREAMABLE,
+      g_param_spec_boolean ("streamable", "Streamable",
+          "Don't seek back to rewrite the header partition at EOS. The header "
+          "partition stays open and incomplete and the final metadata is only "
+          "written to the footer partition", DEFAULT_STREAMABLE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_BODY_PARTITION_INTERVAL,
+      g_param_spec_uint64 ("body-partition-interval", "Body partition interval",
+          "Interval in nanoseconds after which a new body partition with a "
+          "copy of the header metadata and the index table of the previous "
+          "body partition is started (0 = only one body partition)", 0,
+          G_MAXUINT64, DEFAULT_BODY_PARTITION_INTERVAL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state = GST_DEBUG_FUNCPTR (gst_mxf_mux_change_state);
   gstelement_class->request_new_pad =
       GST_DEBUG_FUNCPTR (gst_mxf_mux_request_new_pad);
@@ -149,6 +169,14 @@ gst_mxf_mux_init (GstMXFMux * mux)
   gst_collect_pads_set_function (mux->collect,
       GST_DEBUG_FUNCPTR (gst_mxf_mux_collected), mux);
 
+  mux->index_entries = g_array_new (FALSE, FALSE, sizeof (GstMXFMuxIndexEntry));
+  mux->index_slice_offsets = g_array_new (FALSE, FALSE, sizeof (guint32));
+  mux->partitions =
+      g_array_new (FALSE, FALSE, sizeof (MXFRandomIndexPackEntry));
+
+  mux->streamable = DEFAULT_STREAMABLE;
+  mux->body_partition_interval = DEFAULT_BODY_PARTITION_INTERVAL;
+
   gst_mxf_mux_reset (mux);
 }
 
@@ -168,6 +196,10 @@ gst_mxf_mux_finalize (GObject * object)
 
   gst_object_unref (mux->collect);
 
+  g_array_free (mux->index_entries, TRUE);
+  g_array_free (mux->index_slice_offsets, TRUE);
+  g_array_free (mux->partitions, TRUE);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -175,9 +207,15 @@ static void
 gst_mxf_mux_set_property (GObject * object,
     guint prop_id, const GValue * value, GParamSpec * pspec)
 {
-  //GstMXFMux *mux = GST_MXF_MUX (object);
+  GstMXFMux *mux = GST_MXF_MUX (object);
 
   switch (prop_id) {
+    case PROP_STREAMABLE:
+      mux->streamable = g_value_get_boolean (value);
+      break;
+    case PROP_BODY_PARTITION_INTERVAL:
+      mux->body_partition_interval = g_value_get_uint64 (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -188,9 +226,15 @@ static void
 gst_mxf_mux_get_property (GObject * object,
     guint prop_id, GValue * value, GParamSpec * pspec)
 {
-  //GstMXFMux *mux = GST_MXF_MUX (object);
+  GstMXFMux *mux = GST_MXF_MUX (object);
 
   switch (prop_id) {
+    case PROP_STREAMABLE:
+      g_value_set_boolean (value, mux->streamable);
+      break;
+    case PROP_BODY_PARTITION_INTERVAL:
+      g_value_set_uint64 (value, mux->body_partition_interval);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -228,6 +272,18 @@ gst_mxf_mux_reset (GstMXFMux * mux)
   mux->last_gc_timestamp = 0;
   mux->last_gc_position = 0;
   mux->offset = 0;
+
+  g_array_set_size (mux->partitions, 0);
+  mux->body_partition_timestamp = 0;
+  mux->body_offset = 0;
+
+  mux->write_index = FALSE;
+  mux->index_written = FALSE;
+  mux->index_start_position = 0;
+  g_array_set_size (mux->index_entries, 0);
+  g_array_set_size (mux->index_slice_offsets, 0);
+  mux->n_content_package_elements = 0;
+  mux->last_keyframe_position = -1;
 }
 
 static gboolean
@@ -1092,6 +1148,76 @@ gst_mxf_mux_write_header_metadata (GstMXFMux * mux)
   return ret;
 }
 
+/* Elements are written in pad order, so with a common edit rate every
+ * content package starts with an element of the first pad and contains
+ * one element of every pad */
+static void
+gst_mxf_mux_add_index_entry (GstMXFMux * mux, GstMXFMuxPad * cpad,
+    guint64 size, gboolean keyframe)
+{
+  guint n_elements = g_slist_length (mux->collect->data);
+
+  if (cpad->element_size == 0)
+    cpad->element_size = size;
+  else if (cpad->element_size != size)
+    cpad->variable_element_size = TRUE;
+
+  if (!mux->write_index)
+    return;
+
+  if (cpad == mux->collect->data->data) {
+    GstMXFMuxIndexEntry entry;
+    gint64 position = mux->index_start_position + mux->index_entries->len;
+
+    if (mux->index_entries->len > 0
+        && mux->n_content_package_elements != n_elements)
+      goto incomplete;
+
+    entry.offset = mux->body_offset;
+    entry.flags = keyframe ? 0x80 : 0x20;
+    entry.keyframe_offset = 0;
+    if (keyframe) {
+      mux->last_keyframe_position = position;
+    } else if (mux->last_keyframe_position != -1 &&
+        position - mux->last_keyframe_position <= 128) {
+      entry.keyframe_offset = mux->last_keyframe_position - position;
+    }
+
+    g_array_append_val (mux->index_entries, entry);
+    mux->n_content_package_elements = 1;
+  } else {
+    GstMXFMuxIndexEntry *entry;
+    guint32 slice_offset;
+
+    if (mux->index_entries->len == 0
+        || mux->n_content_package_elements >= n_elements)
+      goto incomplete;
+
+    entry = &g_array_index (mux->index_entries, GstMXFMuxIndexEntry,
+        mux->index_entries->len - 1);
+    if (mux->body_offset - entry->offset > G_MAXUINT32)
+      goto incomplete;
+
+    slice_offset = mux->body_offset - entry->offset;
+    g_array_append_val (mux->index_slice_offsets, slice_offset);
+    mux->n_content_package_elements++;
+  }
+
+  return;
+
+incomplete:
+  {
+    if (mux->index_entries->len > 0) {
+      g_array_set_size (mux->index_entries, mux->index_entries->len - 1);
+      g_array_set_size (mux->index_slice_offsets,
+          mux->index_entries->len * (n_elements - 1));
+    }
+    GST_DEBUG_OBJECT (mux, "Incomplete content package, index table "
+        "stops after %u edit units", mux->index_entries->len);
+    mux->write_index = FALSE;
+  }
+}
+
 static const guint8 _gc_essence_element_ul[] = {
   0x06, 0x0e, 0x2b, 0x34, 0x01, 0x02, 0x01, 0x00,
   0x0d, 0x01, 0x03, 0x01, 0x00, 0x00, 0x00, 0x00
@@ -1109,6 +1235,7 @@ gst_mxf_mux_handle_buffer (GstMXFMux * mux, GstMXFMuxPad * cpad)
   guint8 slen, ber[9];
   gboolean flush = ((cpad->collect.state & GST_COLLECT_PADS_STATE_EOS)
       && !cpad->have_complete_edit_unit && cpad->collect.buffer == NULL);
+  gboolean keyframe = TRUE;
 
   if (cpad->have_complete_edit_unit) {
     GST_DEBUG_OBJECT (cpad->collect.pad,
@@ -1124,6 +1251,7 @@ gst_mxf_mux_handle_buffer (GstMXFMux * mux, GstMXFMuxPad * cpad)
         "Handling buffer of size %" G_GSIZE_FORMAT " for track %u at position %"
         G_GINT64_FORMAT, gst_buffer_get_size (buf),
         cpad->source_track->parent.track_id, cpad->pos);
+    keyframe = !GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT);
   } else {
     flush = TRUE;
     GST_DEBUG_OBJECT (cpad->collect.pad,
@@ -1169,6 +1297,10 @@ gst_mxf_mux_handle_buffer (GstMXFMux * mux, GstMXFMuxPad * cpad)
       cpad->source_track->parent.track_id);
   gst_buffer_unmap (packet, &map);
 
+  gst_mxf_mux_add_index_entry (mux, cpad, gst_buffer_get_size (packet),
+      keyframe);
+
+  mux->body_offset += gst_buffer_get_size (packet);
   if ((ret = gst_mxf_mux_push (mux, packet)) != GST_FLOW_OK) {
     GST_ERROR_OBJECT (cpad->collect.pad,
         "Failed pushing buffer for track %u, reason %s",
@@ -1184,24 +1316,205 @@ gst_mxf_mux_handle_buffer (GstMXFMux * mux, GstMXFMuxPad * cpad)
   return ret;
 }
 
+/* Writes a CBE index if all essence elements have a constant size,
+ * otherwise a VBE index where each element of a content package
+ * but the first is in its own slice. Only covers the content packages
+ * since the last body partition */
+static GList *
+gst_mxf_mux_create_index_table_segments (GstMXFMux * mux, guint32 body_sid)
+{
+  MXFIndexTableSegment segment;
+  GList *ret = NULL;
+  GSList *l;
+  guint n_elements = g_slist_length (mux->collect->data);
+  gboolean cbe = TRUE;
+  guint i, j, max_entries;
+
+  if (mux->write_index && mux->index_entries->len > 0
+      && mux->n_content_package_elements != n_elements)
+    g_array_set_size (mux->index_entries, mux->index_entries->len - 1);
+
+  if (mux->index_entries->len == 0)
+    return NULL;
+
+  /* The slice count is only 8 bit */
+  if (n_elements > 256)
+    return NULL;
+
+  for (l = mux->collect->data; l; l = l->next) {
+    GstMXFMuxPad *cpad = l->data;
+
+    if (cpad->variable_element_size)
+      cbe = FALSE;
+  }
+
+  for (i = 0; i < mux->index_entries->len && cbe; i++) {
+    GstMXFMuxIndexEntry *entry =
+        &g_array_index (mux->index_entries, GstMXFMuxIndexEntry, i);
+
+    if (entry->flags != 0x80)
+      cbe = FALSE;
+  }
+
+  memset (&segment, 0, sizeof (segment));
+  memcpy (&segment.index_edit_rate, &mux->min_edit_rate, sizeof (MXFFraction));
+  segment.index_sid = 1;
+  segment.body_sid = body_sid;
+  segment.n_delta_entries = n_elements;
+  segment.delta_entries = g_new0 (MXFDeltaEntry, n_elements);
+
+  if (cbe) {
+    guint32 element_delta = 0;
+
+    for (l = mux->collect->data, i = 0; l; l = l->next, i++) {
+      GstMXFMuxPad *cpad = l->data;
+
+      segment.delta_entries[i].element_delta = element_delta;
+      element_delta += cpad->element_size;
+    }
+
+    mxf_uuid_init (&segment.instance_id, NULL);
+    segment.index_start_position = mux->index_start_position;
+    segment.index_duration = mux->index_entries->len;
+    segment.edit_unit_byte_count = element_delta;
+
+    GST_DEBUG_OBJECT (mux, "Writing CBE index with edit unit byte count %u",
+        segment.edit_unit_byte_count);
+
+    ret = g_list_append (ret, mxf_index_table_segment_to_buffer (&segment));
+    mxf_index_table_segment_reset (&segment);
+
+    return ret;
+  }
+
+  segment.slice_count = n_elements - 1;
+  for (i = 1; i < n_elements; i++)
+    segment.delta_entries[i].slice = i;
+
+  max_entries = (G_MAXUINT16 - 8) / (11 + 4 * segment.slice_count);
+  segment.index_entries = g_new0 (MXFIndexEntry, max_entries);
+  for (i = 0; i < max_entries; i++)
+    segment.index_entries[i].slice_offset =
+        g_new0 (guint32, segment.slice_count);
+
+  GST_DEBUG_OBJECT (mux, "Writing VBE index with %u entries",
+      mux->index_entries->len);
+
+  for (i = 0; i < mux->index_entries->len; i += max_entries) {
+    segment.n_index_entries = MIN (max_entries, mux->index_entries->len - i);
+
+    mxf_uuid_init (&segment.instance_id, NULL);
+    segment.index_start_position = mux->index_start_position + i;
+    segment.index_duration = segment.n_index_entries;
+
+    for (j = 0; j < segment.n_index_entries; j++) {
+      GstMXFMuxIndexEntry *entry =
+          &g_array_index (mux->index_entries, GstMXFMuxIndexEntry, i + j);
+
+      segment.index_entries[j].key_frame_offset = entry->keyframe_offset;
+      segment.index_entries[j].flags = entry->flags;
+      segment.index_entries[j].stream_offset = entry->offset;
+      if (segment.slice_count > 0)
+        memcpy (segment.index_entries[j].slice_offset,
+            &g_array_index (mux->index_slice_offsets, guint32,
+                (i + j) * segment.slice_count),
+            segment.slice_count * sizeof (guint32));
+    }
+
+    ret = g_list_append (ret, mxf_index_table_segment_to_buffer (&segment));
+  }
+
+  /* All entries were allocated */
+  segment.n_index_entries = max_entries;
+  mxf_index_table_segment_reset (&segment);
+
+  /* The essence container data only references the index once there
+   * is one, header metadata written from now on will include it */
+  if (ret != NULL && !mux->index_written) {
+    mux->preface->content_storage->essence_container_data[0]->index_sid = 1;
+    mux->index_written = TRUE;
+  }
+
+  return ret;
+}
+
 static GstFlowReturn
-gst_mxf_mux_write_body_partition (GstMXFMux * mux)
+gst_mxf_mux_push_index_table_segments (GstMXFMux * mux, GList * segments)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  GList *l;
+
+  for (l = segments; l; l = l->next) {
+    GstBuffer *buf = l->data;
+
+    l->data = NULL;
+    if ((ret = gst_mxf_mux_push (mux, buf)) != GST_FLOW_OK) {
+      GST_ERROR_OBJECT (mux, "Failed pushing index table segment");
+      break;
+    }
+  }
+  g_list_foreach (segments, (GFunc) gst_mini_object_unref, NULL);
+  g_list_free (segments);
+
+  mux->index_start_position += mux->index_entries->len;
+  g_array_set_size (mux->index_entries, 0);
+  g_array_set_size (mux->index_slice_offsets, 0);
+
+  return ret;
+}
+
+/* Starts a new body partition. The index table of the content packages
+ * since the previous body partition is written into it, and optionally
+ * a copy of the header metadata */
+static GstFlowReturn
+gst_mxf_mux_write_body_partition (GstMXFMux * mux, gboolean repeat_metadata)
 {
   GstBuffer *buf;
+  GstFlowReturn ret;
+  GList *index_table_segments, *l;
+  guint64 index_byte_count = 0;
+  guint32 body_sid =
+      mux->preface->content_storage->essence_container_data[0]->body_sid;
+  MXFRandomIndexPackEntry entry;
+
+  index_table_segments =
+      gst_mxf_mux_create_index_table_segments (mux, body_sid);
+  for (l = index_table_segments; l; l = l->next)
+    index_byte_count += gst_buffer_get_size (l->data);
 
   mux->partition.type = MXF_PARTITION_PACK_BODY;
+  mux->partition.closed = mux->partition.complete = FALSE;
+  mux->partition.prev_partition = mux->partition.this_partition;
   mux->partition.this_partition = mux->offset;
-  mux->partition.prev_partition = 0;
   mux->partition.footer_partition = 0;
   mux->partition.header_byte_count = 0;
-  mux->partition.index_byte_count = 0;
-  mux->partition.index_sid = 0;
-  mux->partition.body_offset = 0;
-  mux->partition.body_sid =
-      mux->preface->content_storage->essence_container_data[0]->body_sid;
+  mux->partition.index_byte_count = index_byte_count;
+  mux->partition.index_sid = index_byte_count > 0 ? 1 : 0;
+  mux->partition.body_offset = mux->body_offset;
+  mux->partition.body_sid = body_sid;
 
-  buf = mxf_partition_pack_to_buffer (&mux->partition);
-  return gst_mxf_mux_push (mux, buf);
+  entry.offset = mux->partition.this_partition;
+  entry.body_sid = body_sid;
+  g_array_append_val (mux->partitions, entry);
+
+  GST_DEBUG_OBJECT (mux, "Starting body partition at offset %" G_GUINT64_FORMAT
+      " with body offset %" G_GUINT64_FORMAT, mux->partition.this_partition,
+      mux->partition.body_offset);
+
+  if (repeat_metadata) {
+    ret = gst_mxf_mux_write_header_metadata (mux);
+  } else {
+    buf = mxf_partition_pack_to_buffer (&mux->partition);
+    ret = gst_mxf_mux_push (mux, buf);
+  }
+
+  if (ret != GST_FLOW_OK) {
+    g_list_foreach (index_table_segments, (GFunc) gst_mini_object_unref, NULL);
+    g_list_free (index_table_segments);
+    return ret;
+  }
+
+  return gst_mxf_mux_push_index_table_segments (mux, index_table_segments);
 }
 
 static GstFlowReturn
@@ -1299,10 +1612,16 @@ gst_mxf_mux_handle_eos (GstMXFMux * mux)
     guint64 body_partition = mux->partition.this_partition;
     guint32 body_sid = mux->partition.body_sid;
     guint64 footer_partition = mux->offset;
-    GArray *rip;
     GstFlowReturn ret;
     GstSegment segment;
     MXFRandomIndexPackEntry entry;
+    GList *index_table_segments, *il;
+    guint64 index_byte_count = 0;
+
+    index_table_segments =
+        gst_mxf_mux_create_index_table_segments (mux, body_sid);
+    for (il = index_table_segments; il; il = il->next)
+      index_byte_count += gst_buffer_get_size (il->data);
 
     mux->partition.type = MXF_PARTITION_PACK_FOOTER;
     mux->partition.closed = TRUE;
@@ -1311,29 +1630,27 @@ gst_mxf_mux_handle_eos (GstMXFMux * mux)
     mux->partition.prev_partition = body_partition;
     mux->partition.footer_partition = mux->offset;
     mux->partition.header_byte_count = 0;
-    mux->partition.index_byte_count = 0;
-    mux->partition.index_sid = 0;
+    mux->partition.index_byte_count = index_byte_count;
+    mux->partition.index_sid = index_byte_count > 0 ? 1 : 0;
     mux->partition.body_offset = 0;
     mux->partition.body_sid = 0;
 
     gst_mxf_mux_write_header_metadata (mux);
+    gst_mxf_mux_push_index_table_segments (mux, index_table_segments);
 
-    rip = g_array_sized_new (FALSE, FALSE, sizeof (MXFRandomIndexPackEntry), 3);
-    entry.offset = 0;
-    entry.body_sid = 0;
-    g_array_append_val (rip, entry);
-    entry.offset = body_partition;
-    entry.body_sid = body_sid;
-    g_array_append_val (rip, entry);
     entry.offset = footer_partition;
     entry.body_sid = 0;
-    g_array_append_val (rip, entry);
+    g_array_append_val (mux->partitions, entry);
 
-    packet = mxf_random_index_pack_to_buffer (rip);
+    packet = mxf_random_index_pack_to_buffer (mux->partitions);
     if ((ret = gst_mxf_mux_push (mux, packet)) != GST_FLOW_OK) {
       GST_ERROR_OBJECT (mux, "Failed pushing random index pack");
     }
-    g_array_free (rip, TRUE);
+
+    if (mux->streamable) {
+      GST_DEBUG_OBJECT (mux, "Streamable, not rewriting header partition");
+      return GST_FLOW_OK;
+    }
 
     /* Rewrite header partition with updated values */
     gst_segment_init (&segment, GST_FORMAT_BYTES);
@@ -1377,7 +1694,7 @@ _sort_mux_pads (gconstpointer a, gconstpointer b)
     return ta - tb;
 
   return pa->source_track->parent.track_number -
-      pa->source_track->parent.track_number;
+      pb->source_track->parent.track_number;
 }
 
 static GstFlowReturn
@@ -1411,6 +1728,20 @@ gst_mxf_mux_collected (GstCollectPads * pads, gpointer user_data)
       if ((ret = gst_mxf_mux_create_metadata (mux)) != GST_FLOW_OK)
         goto error;
 
+      /* Content packages can only be indexed if all
+       * tracks have the same edit rate */
+      mux->write_index = TRUE;
+      for (sl = mux->collect->data; sl; sl = sl->next) {
+        GstMXFMuxPad *cpad = sl->data;
+
+        if (cpad->source_track->edit_rate.n != mux->min_edit_rate.n ||
+            cpad->source_track->edit_rate.d != mux->min_edit_rate.d) {
+          GST_DEBUG_OBJECT (mux, "Different edit rates, not writing an index");
+          mux->write_index = FALSE;
+          break;
+        }
+      }
+
       if ((ret = gst_mxf_mux_init_partition_pack (mux)) != GST_FLOW_OK)
         goto error;
 
@@ -1419,6 +1750,14 @@ gst_mxf_mux_collected (GstCollectPads * pads, gpointer user_data)
       ret = GST_FLOW_ERROR;
     }
 
+    if (ret == GST_FLOW_OK) {
+      MXFRandomIndexPackEntry entry;
+
+      entry.offset = 0;
+      entry.body_sid = 0;
+      g_array_append_val (mux->partitions, entry);
+    }
+
     if (ret != GST_FLOW_OK)
       goto error;
 
@@ -1426,7 +1765,7 @@ gst_mxf_mux_collected (GstCollectPads * pads, gpointer user_data)
     mux->collect->data = g_slist_sort (mux->collect->data, _sort_mux_pads);
 
     /* Write body partition */
-    ret = gst_mxf_mux_write_body_partition (mux);
+    ret = gst_mxf_mux_write_body_partition (mux, FALSE);
     if (ret != GST_FLOW_OK)
       goto error;
     mux->state = GST_MXF_MUX_STATE_DATA;
@@ -1461,6 +1800,17 @@ gst_mxf_mux_collected (GstCollectPads * pads, gpointer user_data)
     }
   } while (!eos && best == NULL);
 
+  /* New body partitions are only started at content package boundaries */
+  if (!eos && best && mux->body_partition_interval > 0
+      && best == mux->collect->data->data
+      && mux->last_gc_timestamp >=
+      mux->body_partition_timestamp + mux->body_partition_interval) {
+    mux->body_partition_timestamp = mux->last_gc_timestamp;
+    ret = gst_mxf_mux_write_body_partition (mux, TRUE);
+    if (ret != GST_FLOW_OK)
+      goto error;
+  }
+
   if (!eos && best) {
     ret = gst_mxf_mux_handle_buffer (mux, best);
     if (ret != GST_FLOW_OK)
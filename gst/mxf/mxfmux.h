@@ -57,8 +57,20 @@ typedef struct
 
   MXFMetadataSourcePackage *source_package;
   MXFMetadataTimelineTrack *source_track;
+
+  /* KLV size of the essence elements, if constant */
+  guint64 element_size;
+  gboolean variable_element_size;
 } GstMXFMuxPad;
 
+typedef struct
+{
+  /* Offset of the content package in the essence container */
+  guint64 offset;
+  guint8 flags;
+  gint8 keyframe_offset;
+} GstMXFMuxIndexEntry;
+
 typedef enum
 {
   GST_MXF_MUX_STATE_HEADER,
@@ -92,7 +104,30 @@ typedef struct _GstMXFMux {
   guint64 last_gc_position;
   GstClockTime last_gc_timestamp;
 
+  /* Offsets of all partitions written so far, for the random index pack */
+  GArray *partitions;
+  GstClockTime body_partition_timestamp;
+
+  /* Number of essence bytes written to the essence container */
+  guint64 body_offset;
+
+  /* Index table of the content packages since the last body partition,
+   * one entry per content package, starting at index_start_position */
+  gboolean write_index;
+  gboolean index_written;
+  gint64 index_start_position;
+  GArray *index_entries;
+  /* Offsets of all but the first element of each content
+   * package, relative to the content package */
+  GArray *index_slice_offsets;
+  guint n_content_package_elements;
+  gint64 last_keyframe_position;
+
   gchar *application;
+
+  /* Properties */
+  gboolean streamable;
+  GstClockTime body_partition_interval;
 } GstMXFMux;
 
 typedef struct _GstMXFMuxClass {
@@ -160,8 +160,8 @@ mxf_up_handle_essence_element (const MXFUL * key, GstBuffer * buffer,
     return GST_FLOW_ERROR;
   }
 
-  if (data->bpp != 4
-      || GST_ROUND_UP_4 (data->width * data->bpp) != data->width * data->bpp) {
+  /* Only copy if the rows need padding to the default stride */
+  if (GST_ROUND_UP_4 (data->width * data->bpp) != data->width * data->bpp) {
     guint y;
     GstBuffer *ret;
     GstMapInfo inmap, outmap;
@@ -401,8 +401,8 @@ mxf_up_write_func (GstBuffer * buffer, gpointer mapping_data,
     return GST_FLOW_ERROR;
   }
 
-  if (data->bpp != 4
-      || GST_ROUND_UP_4 (data->width * data->bpp) != data->width * data->bpp) {
+  /* Only copy if the rows have padding that needs to be removed */
+  if (GST_ROUND_UP_4 (data->width * data->bpp) != data->width * data->bpp) {
     guint y;
     GstBuffer *ret;
     GstMapInfo inmap, outmap;
@@ -42,6 +42,7 @@ enum
 {
   PROP_0,
   PROP_CONFIG_INTERVAL,
+  PROP_INDEX_LOCATION,
   PROP_LAST
 };
 
@@ -97,6 +98,8 @@ static GstCaps *gst_h264_parse_get_caps (GstBaseParse * parse,
 static gboolean gst_h264_parse_event (GstBaseParse * parse, GstEvent * event);
 static gboolean gst_h264_parse_src_event (GstBaseParse * parse,
     GstEvent * event);
+static gboolean gst_h264_parse_src_query (GstBaseParse * parse,
+    GstQuery * query);
 
 static void
 gst_h264_parse_class_init (GstH264ParseClass * klass)
@@ -119,6 +122,8 @@ gst_h264_parse_class_init (GstH264ParseClass * klass)
           0, 3600, DEFAULT_CONFIG_INTERVAL,
           G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
 
+  gst_keyframe_index_install_property (gobject_class, PROP_INDEX_LOCATION);
+
   /* Override BaseParse vfuncs */
   parse_class->start = GST_DEBUG_FUNCPTR (gst_h264_parse_start);
   parse_class->stop = GST_DEBUG_FUNCPTR (gst_h264_parse_stop);
@@ -129,6 +134,7 @@ gst_h264_parse_class_init (GstH264ParseClass * klass)
   parse_class->get_sink_caps = GST_DEBUG_FUNCPTR (gst_h264_parse_get_caps);
   parse_class->sink_event = GST_DEBUG_FUNCPTR (gst_h264_parse_event);
   parse_class->src_event = GST_DEBUG_FUNCPTR (gst_h264_parse_src_event);
+  parse_class->src_query = GST_DEBUG_FUNCPTR (gst_h264_parse_src_query);
 
   gst_element_class_add_pad_template (gstelement_class,
       gst_static_pad_template_get (&srctemplate));
@@ -145,6 +151,7 @@ static void
 gst_h264_parse_init (GstH264Parse * h264parse)
 {
   h264parse->frame_out = gst_adapter_new ();
+  h264parse->kf_index = gst_keyframe_index_new ();
   gst_base_parse_set_pts_interpolation (GST_BASE_PARSE (h264parse), FALSE);
   GST_PAD_SET_ACCEPT_INTERSECT (GST_BASE_PARSE_SINK_PAD (h264parse));
 }
@@ -156,6 +163,7 @@ gst_h264_parse_finalize (GObject * object)
   GstH264Parse *h264parse = GST_H264_PARSE (object);
 
   g_object_unref (h264parse->frame_out);
+  gst_keyframe_index_free (h264parse->kf_index);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -173,6 +181,7 @@ gst_h264_parse_reset_frame (GstH264Parse * h264parse)
   h264parse->idr_pos = -1;
   h264parse->sei_pos = -1;
   h264parse->keyframe = FALSE;
+  h264parse->key_type = GST_KEYFRAME_INDEX_TYPE_I;
   h264parse->frame_start = FALSE;
   gst_adapter_clear (h264parse->frame_out);
 }
@@ -224,6 +233,8 @@ gst_h264_parse_start (GstBaseParse * parse)
 
   h264parse->nalparser = gst_h264_nal_parser_new ();
 
+  gst_keyframe_index_start (h264parse->kf_index);
+
   h264parse->dts = GST_CLOCK_TIME_NONE;
   h264parse->ts_trn_nb = GST_CLOCK_TIME_NONE;
   h264parse->sei_pic_struct_pres_flag = FALSE;
@@ -251,6 +262,8 @@ gst_h264_parse_stop (GstBaseParse * parse)
 
   gst_h264_nal_parser_free (h264parse->nalparser);
 
+  gst_keyframe_index_stop (h264parse->kf_index);
+
   return TRUE;
 }
 
@@ -586,6 +599,8 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
           if (GST_H264_IS_I_SLICE (&slice) || GST_H264_IS_SI_SLICE (&slice))
             h264parse->keyframe |= TRUE;
         }
+        if (nal_type == GST_H264_NAL_SLICE_IDR)
+          h264parse->key_type = GST_KEYFRAME_INDEX_TYPE_IDR;
       }
       if (G_LIKELY (nal_type != GST_H264_NAL_SLICE_IDR &&
               !h264parse->push_codec))
@@ -1597,6 +1612,9 @@ gst_h264_parse_pre_push_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
     gst_h264_parse_prepare_key_unit (h264parse, event);
   }
 
+  gst_keyframe_index_add_frame (h264parse->kf_index, parse, frame,
+      h264parse->key_type);
+
   /* periodic SPS/PPS sending */
   if (h264parse->interval > 0 || h264parse->push_codec) {
     GstClockTime timestamp = GST_BUFFER_TIMESTAMP (buffer);
@@ -2070,6 +2088,15 @@ gst_h264_parse_src_event (GstBaseParse * parse, GstEvent * event)
   return res;
 }
 
+static gboolean
+gst_h264_parse_src_query (GstBaseParse * parse, GstQuery * query)
+{
+  GstH264Parse *h264parse = GST_H264_PARSE (parse);
+
+  return gst_keyframe_index_src_query (h264parse->kf_index, parse, query,
+      GST_BASE_PARSE_CLASS (parent_class));
+}
+
 static void
 gst_h264_parse_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
@@ -2082,6 +2109,9 @@ gst_h264_parse_set_property (GObject * object, guint prop_id,
     case PROP_CONFIG_INTERVAL:
       parse->interval = g_value_get_uint (value);
       break;
+    case PROP_INDEX_LOCATION:
+      gst_keyframe_index_set_property (parse->kf_index, value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -2100,6 +2130,9 @@ gst_h264_parse_get_property (GObject * object, guint prop_id,
     case PROP_CONFIG_INTERVAL:
       g_value_set_uint (value, parse->interval);
       break;
+    case PROP_INDEX_LOCATION:
+      gst_keyframe_index_get_property (parse->kf_index, value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -29,6 +29,8 @@
 #include <gst/base/gstbaseparse.h>
 #include <gst/codecparsers/gsth264parser.h>
 
+#include "gstkeyframeindex.h"
+
 G_BEGIN_DECLS
 
 typedef struct _H264Params H264Params;
@@ -104,6 +106,7 @@ struct _GstH264Parse
   gboolean update_caps;
   GstAdapter *frame_out;
   gboolean keyframe;
+  GstKeyframeIndexType key_type;
   gboolean frame_start;
   /* AU state */
   gboolean picture_start;
@@ -111,6 +114,8 @@ struct _GstH264Parse
   /* props */
   guint interval;
 
+  GstKeyframeIndex *kf_index;
+
   GstClockTime pending_key_unit_ts;
   GstEvent *force_key_unit_event;
 };
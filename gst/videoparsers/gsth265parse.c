@@ -25,6 +25,7 @@
 #include <gst/base/base.h>
 #include <gst/pbutils/pbutils.h>
 #include <gst/video/video.h>
+#include <gst/codecparsers/gsth265meta.h>
 #include "gsth265parse.h"
 
 #include <string.h>
@@ -38,6 +39,7 @@ enum
 {
   PROP_0,
   PROP_CONFIG_INTERVAL,
+  PROP_INDEX_LOCATION,
   PROP_LAST
 };
 
@@ -93,6 +95,8 @@ static GstCaps *gst_h265_parse_get_caps (GstBaseParse * parse,
 static gboolean gst_h265_parse_event (GstBaseParse * parse, GstEvent * event);
 static gboolean gst_h265_parse_src_event (GstBaseParse * parse,
     GstEvent * event);
+static gboolean gst_h265_parse_src_query (GstBaseParse * parse,
+    GstQuery * query);
 
 static void
 gst_h265_parse_class_init (GstH265ParseClass * klass)
@@ -114,6 +118,9 @@ gst_h265_parse_class_init (GstH265ParseClass * klass)
           "will be multiplexed in the data stream when detected.) (0 = disabled)",
           0, 3600, DEFAULT_CONFIG_INTERVAL,
           G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
+
+  gst_keyframe_index_install_property (gobject_class, PROP_INDEX_LOCATION);
+
   /* Override BaseParse vfuncs */
   parse_class->start = GST_DEBUG_FUNCPTR (gst_h265_parse_start);
   parse_class->stop = GST_DEBUG_FUNCPTR (gst_h265_parse_stop);
@@ -124,6 +131,7 @@ gst_h265_parse_class_init (GstH265ParseClass * klass)
   parse_class->get_sink_caps = GST_DEBUG_FUNCPTR (gst_h265_parse_get_caps);
   parse_class->sink_event = GST_DEBUG_FUNCPTR (gst_h265_parse_event);
   parse_class->src_event = GST_DEBUG_FUNCPTR (gst_h265_parse_src_event);
+  parse_class->src_query = GST_DEBUG_FUNCPTR (gst_h265_parse_src_query);
 
   gst_element_class_add_pad_template (gstelement_class,
       gst_static_pad_template_get (&srctemplate));
@@ -140,6 +148,8 @@ static void
 gst_h265_parse_init (GstH265Parse * h265parse)
 {
   h265parse->frame_out = gst_adapter_new ();
+  h265parse->kf_index = gst_keyframe_index_new ();
+  h265parse->cc_data = g_byte_array_new ();
   gst_base_parse_set_pts_interpolation (GST_BASE_PARSE (h265parse), FALSE);
   GST_PAD_SET_ACCEPT_INTERSECT (GST_BASE_PARSE_SINK_PAD (h265parse));
 }
@@ -151,6 +161,8 @@ gst_h265_parse_finalize (GObject * object)
   GstH265Parse *h265parse = GST_H265_PARSE (object);
 
   g_object_unref (h265parse->frame_out);
+  gst_keyframe_index_free (h265parse->kf_index);
+  g_byte_array_free (h265parse->cc_data, TRUE);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -168,6 +180,9 @@ gst_h265_parse_reset_frame (GstH265Parse * h265parse)
   h265parse->idr_pos = -1;
   h265parse->sei_pos = -1;
   h265parse->keyframe = FALSE;
+  h265parse->key_type = GST_KEYFRAME_INDEX_TYPE_I;
+  h265parse->have_recovery_point = FALSE;
+  g_byte_array_set_size (h265parse->cc_data, 0);
   gst_adapter_clear (h265parse->frame_out);
 }
 
@@ -191,6 +206,12 @@ gst_h265_parse_reset (GstH265Parse * h265parse)
   h265parse->align = GST_H265_PARSE_ALIGN_NONE;
   h265parse->format = GST_H265_PARSE_FORMAT_NONE;
 
+  h265parse->dts = GST_CLOCK_TIME_NONE;
+  h265parse->ts_trn_nb = GST_CLOCK_TIME_NONE;
+  h265parse->do_ts = TRUE;
+  h265parse->sei_pic_struct_pres_flag = FALSE;
+  h265parse->sei_pic_struct = 0;
+
   h265parse->last_report = GST_CLOCK_TIME_NONE;
   h265parse->push_codec = FALSE;
   h265parse->have_pps = FALSE;
@@ -215,6 +236,8 @@ gst_h265_parse_start (GstBaseParse * parse)
 
   h265parse->nalparser = gst_h265_parser_new ();
 
+  gst_keyframe_index_start (h265parse->kf_index);
+
   gst_base_parse_set_min_frame_size (parse, 7);
 
   return TRUE;
@@ -238,6 +261,8 @@ gst_h265_parse_stop (GstBaseParse * parse)
 
   gst_h265_parser_free (h265parse->nalparser);
 
+  gst_keyframe_index_stop (h265parse->kf_index);
+
   return TRUE;
 }
 
@@ -470,6 +495,7 @@ gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
   GstH265PPS pps = { 0, };
   GstH265SPS sps = { 0, };
   GstH265VPS vps = { 0, };
+  GstH265SEIMessage sei;
   gboolean is_irap;
   guint nal_type;
   GstH265Parser *nalparser = h265parse->nalparser;
@@ -558,7 +584,58 @@ gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
       break;
     case GST_H265_NAL_PREFIX_SEI:
     case GST_H265_NAL_SUFFIX_SEI:
-      /*Fixme: parse sei messages */
+      pres = gst_h265_parser_parse_sei (nalparser, nalu, &sei);
+      if (pres != GST_H265_PARSER_OK)
+        goto mark_sei;
+
+      switch (sei.payloadType) {
+        case GST_H265_SEI_PIC_TIMING:
+          h265parse->sei_pic_struct_pres_flag = nalparser->last_sps &&
+              nalparser->last_sps->vui_params.frame_field_info_present_flag;
+          h265parse->sei_cpb_removal_delay =
+              sei.payload.pic_timing.au_cpb_removal_delay_minus1 + 1;
+          if (h265parse->sei_pic_struct_pres_flag)
+            h265parse->sei_pic_struct = sei.payload.pic_timing.pic_struct;
+          break;
+        case GST_H265_SEI_BUF_PERIOD:
+          if (h265parse->ts_trn_nb == GST_CLOCK_TIME_NONE ||
+              h265parse->dts == GST_CLOCK_TIME_NONE)
+            h265parse->ts_trn_nb = 0;
+          else
+            h265parse->ts_trn_nb = h265parse->dts;
+
+          GST_LOG_OBJECT (h265parse,
+              "new buffering period; ts_trn_nb updated: %" GST_TIME_FORMAT,
+              GST_TIME_ARGS (h265parse->ts_trn_nb));
+          break;
+        case GST_H265_SEI_RECOVERY_POINT:
+          GST_LOG_OBJECT (h265parse, "recovery point found: %d frames, "
+              "exact match %d, broken link %d",
+              sei.payload.recovery_point.recovery_poc_cnt,
+              sei.payload.recovery_point.exact_match_flag,
+              sei.payload.recovery_point.broken_link_flag);
+          /* decoding can start at this picture */
+          h265parse->keyframe |= TRUE;
+          h265parse->have_recovery_point = TRUE;
+          h265parse->recovery_point = sei.payload.recovery_point;
+          break;
+        case GST_H265_SEI_REGISTERED_USER_DATA:
+        {
+          const guint8 *cc;
+          gsize cc_size;
+
+          if (gst_h265_registered_user_data_get_cc_data
+              (&sei.payload.registered_user_data, &cc, &cc_size)) {
+            GST_LOG_OBJECT (h265parse, "found %" G_GSIZE_FORMAT
+                " bytes of caption data", cc_size);
+            g_byte_array_append (h265parse->cc_data, cc, cc_size);
+          }
+          break;
+        }
+      }
+      gst_h265_sei_free (&sei);
+
+    mark_sei:
       /* mark SEI pos */
       if (h265parse->sei_pos == -1) {
         if (h265parse->transform)
@@ -595,6 +672,14 @@ gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
         if (GST_H265_IS_I_SLICE (&slice))
           h265parse->keyframe |= TRUE;
       }
+      if (nal_type == GST_H265_NAL_SLICE_IDR_W_RADL
+          || nal_type == GST_H265_NAL_SLICE_IDR_N_LP)
+        h265parse->key_type = GST_KEYFRAME_INDEX_TYPE_IDR;
+      else if (nal_type == GST_H265_NAL_SLICE_CRA_NUT)
+        h265parse->key_type = GST_KEYFRAME_INDEX_TYPE_CRA;
+      else if (nal_type >= GST_H265_NAL_SLICE_BLA_W_LP
+          && nal_type <= GST_H265_NAL_SLICE_BLA_N_LP)
+        h265parse->key_type = GST_KEYFRAME_INDEX_TYPE_BLA;
       if (slice.first_slice_segment_in_pic_flag == 1)
         GST_DEBUG_OBJECT (h265parse,
             "frame start, first_slice_segment_in_pic_flag = 1");
@@ -1359,6 +1444,106 @@ gst_h265_parse_update_src_caps (GstH265Parse * h265parse, GstCaps * caps)
 
 }
 
+static void
+gst_h265_parse_get_timestamp (GstH265Parse * h265parse,
+    GstClockTime * out_ts, GstClockTime * out_dur)
+{
+  GstH265SPS *sps = h265parse->nalparser->last_sps;
+  GstClockTime upstream;
+  gint duration = 1;
+
+  g_return_if_fail (out_dur != NULL);
+  g_return_if_fail (out_ts != NULL);
+
+  upstream = *out_ts;
+
+  if (!sps) {
+    GST_DEBUG_OBJECT (h265parse, "referred SPS invalid");
+    goto exit;
+  } else if (!sps->vui_parameters_present_flag) {
+    GST_DEBUG_OBJECT (h265parse,
+        "unable to compute timestamp: VUI not present");
+    goto exit;
+  } else if (!sps->vui_params.timing_info_present_flag) {
+    GST_DEBUG_OBJECT (h265parse,
+        "unable to compute timestamp: timing info not present");
+    goto exit;
+  } else if (sps->vui_params.time_scale == 0) {
+    GST_DEBUG_OBJECT (h265parse,
+        "unable to compute timestamp: time_scale = 0 "
+        "(this is forbidden in spec; bitstream probably contains error)");
+    goto exit;
+  }
+
+  /* unlike H.264, a clock tick is the duration of a whole picture, which
+   * is a single field if field_seq_flag is set */
+  if (h265parse->sei_pic_struct_pres_flag) {
+    switch (h265parse->sei_pic_struct) {
+      case GST_H265_SEI_PIC_STRUCT_FRAME_DOUBLING:
+        duration = 2;
+        break;
+      case GST_H265_SEI_PIC_STRUCT_FRAME_TRIPLING:
+        duration = 3;
+        break;
+      default:
+        duration = 1;
+        break;
+    }
+  }
+
+  GST_LOG_OBJECT (h265parse, "frame tick duration %d", duration);
+
+  /*
+   * H.265 C.2.3 Timing of coded picture removal (equivalent to DTS):
+   * AuNominalRemovalTime[n] = AuNominalRemovalTime[firstPicInPrevBuffPeriod]
+   *     + ClockTick * AuCpbRemovalDelayVal
+   * where
+   * ClockTick = num_units_in_tick / time_scale
+   */
+
+  if (h265parse->ts_trn_nb != GST_CLOCK_TIME_NONE) {
+    GST_LOG_OBJECT (h265parse, "buffering based ts");
+    /* buffering period is present */
+    if (upstream != GST_CLOCK_TIME_NONE) {
+      /* If upstream timestamp is valid, we respect it and adjust current
+       * reference point */
+      h265parse->ts_trn_nb = upstream -
+          (GstClockTime) gst_util_uint64_scale_int
+          (h265parse->sei_cpb_removal_delay * GST_SECOND,
+          sps->vui_params.num_units_in_tick, sps->vui_params.time_scale);
+    } else {
+      /* If no upstream timestamp is given, we write in new timestamp */
+      upstream = h265parse->dts = h265parse->ts_trn_nb +
+          (GstClockTime) gst_util_uint64_scale_int
+          (h265parse->sei_cpb_removal_delay * GST_SECOND,
+          sps->vui_params.num_units_in_tick, sps->vui_params.time_scale);
+    }
+  } else {
+    GstClockTime dur;
+
+    GST_LOG_OBJECT (h265parse, "duration based ts");
+    /* naive method: no removal delay specified
+     * track upstream timestamp and provide best guess frame duration */
+    dur = gst_util_uint64_scale_int (duration * GST_SECOND,
+        sps->vui_params.num_units_in_tick, sps->vui_params.time_scale);
+    /* sanity check */
+    if (dur < GST_MSECOND) {
+      GST_DEBUG_OBJECT (h265parse, "discarding dur %" GST_TIME_FORMAT,
+          GST_TIME_ARGS (dur));
+    } else {
+      *out_dur = dur;
+    }
+  }
+
+exit:
+  if (GST_CLOCK_TIME_IS_VALID (upstream))
+    *out_ts = h265parse->dts = upstream;
+
+  if (GST_CLOCK_TIME_IS_VALID (*out_dur) &&
+      GST_CLOCK_TIME_IS_VALID (h265parse->dts))
+    h265parse->dts += *out_dur;
+}
+
 static GstFlowReturn
 gst_h265_parse_parse_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
 {
@@ -1371,9 +1556,11 @@ gst_h265_parse_parse_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
 
   gst_h265_parse_update_src_caps (h265parse, NULL);
 
-  /* Fixme: Implement timestamp interpolation based on SEI Messagses */
-  GST_FIXME_OBJECT (h265parse,
-      "Implement timestamp/duration interpolation based on SEI message");
+  /* don't mess with timestamps if provided by upstream,
+   * particularly since our ts not that good they handle seeking etc */
+  if (h265parse->do_ts)
+    gst_h265_parse_get_timestamp (h265parse,
+        &GST_BUFFER_TIMESTAMP (buffer), &GST_BUFFER_DURATION (buffer));
 
   if (h265parse->keyframe)
     GST_BUFFER_FLAG_UNSET (buffer, GST_BUFFER_FLAG_DELTA_UNIT);
@@ -1391,6 +1578,18 @@ gst_h265_parse_parse_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
     gst_buffer_unref (buf);
   }
 
+  /* attach SEI derived metas to whichever buffer is pushed downstream */
+  if (frame->out_buffer)
+    buffer = frame->out_buffer;
+
+  if (h265parse->have_recovery_point)
+    gst_buffer_add_h265_recovery_point_meta (buffer,
+        &h265parse->recovery_point);
+
+  if (h265parse->cc_data->len > 0)
+    gst_buffer_add_h265_caption_meta (buffer, h265parse->cc_data->data,
+        h265parse->cc_data->len);
+
   return GST_FLOW_OK;
 }
 
@@ -1547,6 +1746,9 @@ gst_h265_parse_pre_push_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
     gst_h265_parse_prepare_key_unit (h265parse, event);
   }
 
+  gst_keyframe_index_add_frame (h265parse->kf_index, parse, frame,
+      h265parse->key_type);
+
   /* periodic VPS/SPS/PPS sending */
   if (h265parse->interval > 0 || h265parse->push_codec) {
     GstClockTime timestamp = GST_BUFFER_TIMESTAMP (buffer);
@@ -1943,11 +2145,22 @@ gst_h265_parse_event (GstBaseParse * parse, GstEvent * event)
       break;
     }
     case GST_EVENT_FLUSH_STOP:
+      h265parse->dts = GST_CLOCK_TIME_NONE;
+      h265parse->ts_trn_nb = GST_CLOCK_TIME_NONE;
 
       res = GST_BASE_PARSE_CLASS (parent_class)->sink_event (parse, event);
       break;
     case GST_EVENT_SEGMENT:
     {
+      const GstSegment *segment;
+
+      gst_event_parse_segment (event, &segment);
+      /* don't try to mess with more subtle cases (e.g. seek) */
+      if (segment->format == GST_FORMAT_TIME &&
+          (segment->start != 0 || segment->rate != 1.0
+              || segment->applied_rate != 1.0))
+        h265parse->do_ts = FALSE;
+
       res = GST_BASE_PARSE_CLASS (parent_class)->sink_event (parse, event);
       break;
     }
@@ -1996,6 +2209,15 @@ gst_h265_parse_src_event (GstBaseParse * parse, GstEvent * event)
   return res;
 }
 
+static gboolean
+gst_h265_parse_src_query (GstBaseParse * parse, GstQuery * query)
+{
+  GstH265Parse *h265parse = GST_H265_PARSE (parse);
+
+  return gst_keyframe_index_src_query (h265parse->kf_index, parse, query,
+      GST_BASE_PARSE_CLASS (parent_class));
+}
+
 static void
 gst_h265_parse_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
@@ -2007,6 +2229,9 @@ gst_h265_parse_set_property (GObject * object, guint prop_id,
     case PROP_CONFIG_INTERVAL:
       parse->interval = g_value_get_uint (value);
       break;
+    case PROP_INDEX_LOCATION:
+      gst_keyframe_index_set_property (parse->kf_index, value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -2024,6 +2249,9 @@ gst_h265_parse_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_CONFIG_INTERVAL:
       g_value_set_uint (value, parse->interval);
       break;
+    case PROP_INDEX_LOCATION:
+      gst_keyframe_index_get_property (parse->kf_index, value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -25,6 +25,8 @@
 #include <gst/base/gstbaseparse.h>
 #include <gst/codecparsers/gsth265parser.h>
 
+#include "gstkeyframeindex.h"
+
 G_BEGIN_DECLS
 
 #define GST_TYPE_H265_PARSE \
@@ -78,17 +80,36 @@ struct _GstH265Parse
   GstBuffer *sps_nals[GST_H265_MAX_SPS_COUNT];
   GstBuffer *pps_nals[GST_H265_MAX_PPS_COUNT];
 
+  /* Infos we need to keep track of */
+  guint32 sei_cpb_removal_delay;
+  guint8 sei_pic_struct;
+  guint8 sei_pic_struct_pres_flag;
+
+  /* cached timestamps */
+  /* (trying to) track upstream dts and interpolate */
+  GstClockTime dts;
+  /* dts at start of last buffering period */
+  GstClockTime ts_trn_nb;
+  gboolean do_ts;
+
   /* frame parsing */
   gint idr_pos, sei_pos;
   gboolean update_caps;
   GstAdapter *frame_out;
   gboolean keyframe;
+  GstKeyframeIndexType key_type;
+  /* SEI payloads to attach as metas to the frame */
+  gboolean have_recovery_point;
+  GstH265RecoveryPoint recovery_point;
+  GByteArray *cc_data;
   /* AU state */
   gboolean picture_start;
 
   /* props */
   guint interval;
 
+  GstKeyframeIndex *kf_index;
+
   gboolean sent_codec_tag;
 
   GstClockTime pending_key_unit_ts;
@@ -0,0 +1,555 @@
+/* GStreamer video parsers keyframe index
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * The keyframe index is shared by the elementary stream video parsers.
+ * It records the timestamps, byte offsets, picture type and GOP size of
+ * every keyframe pushed downstream, answers the GST_QUERY_CUSTOM query
+ * named GST_KEYFRAME_INDEX_QUERY_NAME and can be stored to, or seeded
+ * from, a simple text sidecar file.
+ *
+ * Sidecar files contain one keyframe per line:
+ *
+ *   <pts> <dts> <offset> <frame-type> <gop-size>
+ *
+ * with timestamps in nanoseconds (-1 if unknown). Lines starting with
+ * '#' are ignored.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "gstkeyframeindex.h"
+
+GST_DEBUG_CATEGORY_STATIC (keyframe_index_debug);
+#define GST_CAT_DEFAULT keyframe_index_debug
+
+#define SIDECAR_HEADER "# GstKeyframeIndex 1\n# pts dts offset type gop-size\n"
+
+static const gchar *type_names[] = {
+  "I", "IDR", "CRA", "BLA"
+};
+
+static const gchar *
+gst_keyframe_index_type_name (GstKeyframeIndexType type)
+{
+  if (type < G_N_ELEMENTS (type_names))
+    return type_names[type];
+  return "I";
+}
+
+static GstKeyframeIndexType
+gst_keyframe_index_type_from_name (const gchar * name)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (type_names); i++) {
+    if (strcmp (name, type_names[i]) == 0)
+      return i;
+  }
+  return GST_KEYFRAME_INDEX_TYPE_I;
+}
+
+GstKeyframeIndex *
+gst_keyframe_index_new (void)
+{
+  GstKeyframeIndex *index;
+  static gsize init = 0;
+
+  if (g_once_init_enter (&init)) {
+    GST_DEBUG_CATEGORY_INIT (keyframe_index_debug, "keyframeindex", 0,
+        "video parsers keyframe index");
+    g_once_init_leave (&init, 1);
+  }
+
+  index = g_slice_new0 (GstKeyframeIndex);
+  g_mutex_init (&index->lock);
+  index->entries = g_array_new (FALSE, FALSE, sizeof (GstKeyframeIndexEntry));
+  index->cur_key = -1;
+  index->last_offset = -1;
+
+  return index;
+}
+
+void
+gst_keyframe_index_free (GstKeyframeIndex * index)
+{
+  g_return_if_fail (index != NULL);
+
+  g_array_free (index->entries, TRUE);
+  g_free (index->location);
+  g_mutex_clear (&index->lock);
+  g_slice_free (GstKeyframeIndex, index);
+}
+
+void
+gst_keyframe_index_clear (GstKeyframeIndex * index)
+{
+  g_return_if_fail (index != NULL);
+
+  g_mutex_lock (&index->lock);
+  g_array_set_size (index->entries, 0);
+  index->cur_key = -1;
+  index->cur_gop_size = 0;
+  index->last_offset = -1;
+  index->pending_seed = FALSE;
+  g_mutex_unlock (&index->lock);
+}
+
+/* Returns the position of the entry at @offset, or where it should be
+ * inserted if there is none. Must be called with the lock held */
+static guint
+gst_keyframe_index_find (GstKeyframeIndex * index, guint64 offset,
+    gboolean * exact)
+{
+  guint lo = 0, hi = index->entries->len;
+
+  *exact = FALSE;
+  while (lo < hi) {
+    guint mid = lo + (hi - lo) / 2;
+    GstKeyframeIndexEntry *entry =
+        &g_array_index (index->entries, GstKeyframeIndexEntry, mid);
+
+    if (entry->offset == offset) {
+      *exact = TRUE;
+      return mid;
+    } else if (entry->offset < offset) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  return lo;
+}
+
+static guint
+gst_keyframe_index_insert (GstKeyframeIndex * index,
+    const GstKeyframeIndexEntry * entry)
+{
+  gboolean exact;
+  guint pos;
+
+  pos = gst_keyframe_index_find (index, entry->offset, &exact);
+  if (exact) {
+    GstKeyframeIndexEntry *old =
+        &g_array_index (index->entries, GstKeyframeIndexEntry, pos);
+    guint gop_size = old->gop_size;
+
+    *old = *entry;
+    /* keep what we learned before if the GOP is still being counted */
+    if (old->gop_size == 0)
+      old->gop_size = gop_size;
+  } else {
+    g_array_insert_val (index->entries, pos, *entry);
+  }
+
+  return pos;
+}
+
+/* Hands entries loaded from a sidecar to the base class, so that its
+ * seeking can go straight to a keyframe instead of scanning. Must be
+ * called with the lock held */
+static void
+gst_keyframe_index_seed (GstKeyframeIndex * index, GstBaseParse * parse)
+{
+  guint i;
+
+  for (i = 0; i < index->entries->len; i++) {
+    GstKeyframeIndexEntry *entry =
+        &g_array_index (index->entries, GstKeyframeIndexEntry, i);
+
+    if (GST_CLOCK_TIME_IS_VALID (entry->pts))
+      gst_base_parse_add_index_entry (parse, entry->offset, entry->pts,
+          TRUE, TRUE);
+  }
+
+  GST_DEBUG_OBJECT (parse, "seeded base index with %u keyframes",
+      index->entries->len);
+  index->pending_seed = FALSE;
+}
+
+/**
+ * gst_keyframe_index_add_frame:
+ * @index: a #GstKeyframeIndex
+ * @parse: the parser pushing @frame
+ * @frame: the frame about to be pushed downstream
+ * @type: picture type, only relevant for keyframes
+ *
+ * Accounts @frame in the index. Keyframes get a new entry, other frames
+ * only extend the size of the GOP currently being parsed. Meant to be
+ * called from the pre_push_frame vfunc, when timestamps are final.
+ */
+void
+gst_keyframe_index_add_frame (GstKeyframeIndex * index, GstBaseParse * parse,
+    GstBaseParseFrame * frame, GstKeyframeIndexType type)
+{
+  GstBuffer *buffer = frame->buffer;
+  guint64 offset = frame->offset;
+
+  if (frame->flags & GST_BASE_PARSE_FRAME_FLAG_NO_FRAME)
+    return;
+  if (offset == (guint64) - 1)
+    return;
+
+  g_mutex_lock (&index->lock);
+
+  if (G_UNLIKELY (index->pending_seed))
+    gst_keyframe_index_seed (index, parse);
+
+  /* frames in between are unknown after a seek, so the running GOP
+   * size can't be trusted anymore */
+  if (GST_BUFFER_IS_DISCONT (buffer) ||
+      (index->last_offset != (guint64) - 1 && offset <= index->last_offset))
+    index->cur_key = -1;
+  index->last_offset = offset;
+
+  if (!GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT)) {
+    GstKeyframeIndexEntry entry;
+
+    if (index->cur_key >= 0)
+      g_array_index (index->entries, GstKeyframeIndexEntry,
+          index->cur_key).gop_size = index->cur_gop_size;
+
+    entry.pts = GST_BUFFER_PTS (buffer);
+    entry.dts = GST_BUFFER_DTS (buffer);
+    entry.offset = offset;
+    entry.type = type;
+    entry.gop_size = 0;
+
+    index->cur_key = gst_keyframe_index_insert (index, &entry);
+    index->cur_gop_size = 1;
+
+    GST_LOG_OBJECT (parse, "%s keyframe at offset %" G_GUINT64_FORMAT
+        ", pts %" GST_TIME_FORMAT, gst_keyframe_index_type_name (type),
+        offset, GST_TIME_ARGS (entry.pts));
+  } else if (index->cur_key >= 0) {
+    index->cur_gop_size++;
+  }
+
+  g_mutex_unlock (&index->lock);
+}
+
+static GstStructure *
+gst_keyframe_index_entry_to_structure (const GstKeyframeIndexEntry * entry)
+{
+  return gst_structure_new ("keyframe",
+      "pts", G_TYPE_UINT64, entry->pts,
+      "dts", G_TYPE_UINT64, entry->dts,
+      "offset", G_TYPE_UINT64, entry->offset,
+      "frame-type", G_TYPE_STRING, gst_keyframe_index_type_name (entry->type),
+      "gop-size", G_TYPE_UINT, entry->gop_size, NULL);
+}
+
+/* Returns the GOP size of @pos, including the GOP currently being parsed.
+ * Must be called with the lock held */
+static guint
+gst_keyframe_index_gop_size (GstKeyframeIndex * index, gint pos)
+{
+  if (pos == index->cur_key)
+    return index->cur_gop_size;
+  return g_array_index (index->entries, GstKeyframeIndexEntry, pos).gop_size;
+}
+
+/**
+ * gst_keyframe_index_handle_query:
+ * @index: a #GstKeyframeIndex
+ * @query: a #GstQuery
+ *
+ * Returns: %TRUE if @query was a keyframe index query and could be
+ * answered.
+ */
+gboolean
+gst_keyframe_index_handle_query (GstKeyframeIndex * index, GstQuery * query)
+{
+  GstStructure *s;
+  guint64 timestamp;
+  gboolean res = TRUE;
+  guint i;
+
+  if (GST_QUERY_TYPE (query) != GST_QUERY_CUSTOM)
+    return FALSE;
+
+  s = gst_query_writable_structure (query);
+  if (!s || !gst_structure_has_name (s, GST_KEYFRAME_INDEX_QUERY_NAME))
+    return FALSE;
+
+  g_mutex_lock (&index->lock);
+  if (gst_structure_get_uint64 (s, "timestamp", &timestamp)) {
+    GstKeyframeIndexEntry *best = NULL;
+    gint best_pos = -1;
+
+    for (i = 0; i < index->entries->len; i++) {
+      GstKeyframeIndexEntry *entry =
+          &g_array_index (index->entries, GstKeyframeIndexEntry, i);
+
+      if (!GST_CLOCK_TIME_IS_VALID (entry->pts) || entry->pts > timestamp)
+        continue;
+      if (best == NULL || entry->pts > best->pts) {
+        best = entry;
+        best_pos = i;
+      }
+    }
+
+    if (best) {
+      gst_structure_set (s,
+          "pts", G_TYPE_UINT64, best->pts,
+          "dts", G_TYPE_UINT64, best->dts,
+          "offset", G_TYPE_UINT64, best->offset,
+          "frame-type", G_TYPE_STRING,
+          gst_keyframe_index_type_name (best->type), "gop-size", G_TYPE_UINT,
+          gst_keyframe_index_gop_size (index, best_pos), NULL);
+    } else {
+      res = FALSE;
+    }
+  } else {
+    GValue array = G_VALUE_INIT;
+
+    g_value_init (&array, GST_TYPE_ARRAY);
+    for (i = 0; i < index->entries->len; i++) {
+      GstKeyframeIndexEntry entry =
+          g_array_index (index->entries, GstKeyframeIndexEntry, i);
+      GValue v = G_VALUE_INIT;
+
+      entry.gop_size = gst_keyframe_index_gop_size (index, i);
+      g_value_init (&v, GST_TYPE_STRUCTURE);
+      g_value_take_boxed (&v, gst_keyframe_index_entry_to_structure (&entry));
+      gst_value_array_append_value (&array, &v);
+      g_value_unset (&v);
+    }
+    gst_structure_take_value (s, "entries", &array);
+  }
+  g_mutex_unlock (&index->lock);
+
+  return res;
+}
+
+/**
+ * gst_keyframe_index_src_query:
+ * @index: a #GstKeyframeIndex
+ * @parse: the parser handling @query
+ * @query: a #GstQuery
+ * @parent_class: the class of the parent of the parser
+ *
+ * Answers keyframe index queries, and chains up for all the others. Meant
+ * to be the whole src_query vfunc of the parsers.
+ *
+ * Returns: %TRUE if @query could be answered.
+ */
+gboolean
+gst_keyframe_index_src_query (GstKeyframeIndex * index, GstBaseParse * parse,
+    GstQuery * query, GstBaseParseClass * parent_class)
+{
+  if (gst_keyframe_index_handle_query (index, query))
+    return TRUE;
+
+  return parent_class->src_query (parse, query);
+}
+
+/**
+ * gst_keyframe_index_load:
+ * @index: a #GstKeyframeIndex
+ * @location: sidecar file name
+ *
+ * Merges the entries of the sidecar at @location into @index. They are
+ * handed to the base class index on the next gst_keyframe_index_add_frame().
+ *
+ * Returns: %TRUE if the file could be read.
+ */
+gboolean
+gst_keyframe_index_load (GstKeyframeIndex * index, const gchar * location)
+{
+  gchar *contents = NULL;
+  gchar **lines, **line;
+  GError *err = NULL;
+  guint count = 0;
+
+  if (!g_file_get_contents (location, &contents, NULL, &err)) {
+    GST_DEBUG ("no keyframe index at %s: %s", location, err->message);
+    g_clear_error (&err);
+    return FALSE;
+  }
+
+  lines = g_strsplit (contents, "\n", -1);
+  g_free (contents);
+
+  g_mutex_lock (&index->lock);
+  for (line = lines; *line; line++) {
+    GstKeyframeIndexEntry entry;
+    gchar **fields;
+
+    if (**line == '#' || **line == '\0')
+      continue;
+
+    fields = g_strsplit_set (g_strstrip (*line), " \t", 5);
+    if (g_strv_length (fields) == 5) {
+      entry.pts = g_ascii_strtoll (fields[0], NULL, 10);
+      entry.dts = g_ascii_strtoll (fields[1], NULL, 10);
+      entry.offset = g_ascii_strtoull (fields[2], NULL, 10);
+      entry.type = gst_keyframe_index_type_from_name (fields[3]);
+      entry.gop_size = g_ascii_strtoull (fields[4], NULL, 10);
+      gst_keyframe_index_insert (index, &entry);
+      count++;
+    } else {
+      GST_WARNING ("ignoring malformed keyframe index line '%s'", *line);
+    }
+    g_strfreev (fields);
+  }
+  index->cur_key = -1;
+  index->pending_seed = (count > 0);
+  g_mutex_unlock (&index->lock);
+
+  g_strfreev (lines);
+
+  GST_DEBUG ("loaded %u keyframes from %s", count, location);
+
+  return TRUE;
+}
+
+/**
+ * gst_keyframe_index_save:
+ * @index: a #GstKeyframeIndex
+ * @location: sidecar file name
+ *
+ * Writes @index to @location, replacing any existing file.
+ *
+ * Returns: %TRUE on success.
+ */
+gboolean
+gst_keyframe_index_save (GstKeyframeIndex * index, const gchar * location)
+{
+  GString *str;
+  GError *err = NULL;
+  gboolean res;
+  guint i;
+
+  str = g_string_new (SIDECAR_HEADER);
+
+  g_mutex_lock (&index->lock);
+  for (i = 0; i < index->entries->len; i++) {
+    GstKeyframeIndexEntry *entry =
+        &g_array_index (index->entries, GstKeyframeIndexEntry, i);
+
+    g_string_append_printf (str, "%" G_GINT64_FORMAT " %" G_GINT64_FORMAT
+        " %" G_GUINT64_FORMAT " %s %u\n", (gint64) entry->pts,
+        (gint64) entry->dts, entry->offset,
+        gst_keyframe_index_type_name (entry->type),
+        gst_keyframe_index_gop_size (index, i));
+  }
+  g_mutex_unlock (&index->lock);
+
+  res = g_file_set_contents (location, str->str, str->len, &err);
+  if (!res) {
+    GST_WARNING ("failed to write keyframe index to %s: %s", location,
+        err->message);
+    g_clear_error (&err);
+  }
+  g_string_free (str, TRUE);
+
+  return res;
+}
+
+static gchar *
+gst_keyframe_index_dup_location (GstKeyframeIndex * index)
+{
+  gchar *location;
+
+  g_mutex_lock (&index->lock);
+  location = g_strdup (index->location);
+  g_mutex_unlock (&index->lock);
+
+  return location;
+}
+
+/**
+ * gst_keyframe_index_start:
+ * @index: a #GstKeyframeIndex
+ *
+ * Empties @index and seeds it from the sidecar of the "index-location"
+ * property, if any. Meant to be called from the start vfunc.
+ */
+void
+gst_keyframe_index_start (GstKeyframeIndex * index)
+{
+  gchar *location;
+
+  gst_keyframe_index_clear (index);
+  location = gst_keyframe_index_dup_location (index);
+  if (location)
+    gst_keyframe_index_load (index, location);
+  g_free (location);
+}
+
+/**
+ * gst_keyframe_index_stop:
+ * @index: a #GstKeyframeIndex
+ *
+ * Writes @index to the sidecar of the "index-location" property, if any.
+ * Meant to be called from the stop vfunc.
+ */
+void
+gst_keyframe_index_stop (GstKeyframeIndex * index)
+{
+  gchar *location;
+
+  location = gst_keyframe_index_dup_location (index);
+  if (location)
+    gst_keyframe_index_save (index, location);
+  g_free (location);
+}
+
+/**
+ * gst_keyframe_index_install_property:
+ * @klass: the class of a parser
+ * @prop_id: the id of the property in the parser
+ *
+ * Installs the "index-location" property, whose value is then handled by
+ * gst_keyframe_index_set_property() and gst_keyframe_index_get_property().
+ */
+void
+gst_keyframe_index_install_property (GObjectClass * klass, guint prop_id)
+{
+  g_object_class_install_property (klass, prop_id,
+      g_param_spec_string ("index-location", "Keyframe index location",
+          "Sidecar file to seed the keyframe index from on start and "
+          "to write it to on stop (NULL = disabled)", NULL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+}
+
+void
+gst_keyframe_index_set_property (GstKeyframeIndex * index,
+    const GValue * value)
+{
+  g_mutex_lock (&index->lock);
+  g_free (index->location);
+  index->location = g_value_dup_string (value);
+  g_mutex_unlock (&index->lock);
+}
+
+void
+gst_keyframe_index_get_property (GstKeyframeIndex * index, GValue * value)
+{
+  g_mutex_lock (&index->lock);
+  g_value_set_string (value, index->location);
+  g_mutex_unlock (&index->lock);
+}
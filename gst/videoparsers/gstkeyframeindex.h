@@ -0,0 +1,111 @@
+/* GStreamer video parsers keyframe index
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_KEYFRAME_INDEX_H__
+#define __GST_KEYFRAME_INDEX_H__
+
+#include <gst/gst.h>
+#include <gst/base/gstbaseparse.h>
+
+G_BEGIN_DECLS
+
+/* Name of the structure carried by the custom query that is answered
+ * by the parsers keeping a keyframe index.
+ *
+ * If the query structure contains a "timestamp" field (guint64), the
+ * nearest keyframe at or before that timestamp is returned in the
+ * "pts", "dts", "offset", "frame-type" and "gop-size" fields.
+ * Otherwise the complete index is returned in the "entries" field as a
+ * GstValueArray of "keyframe" structures carrying the same fields. */
+#define GST_KEYFRAME_INDEX_QUERY_NAME "GstKeyframeIndex"
+
+typedef enum
+{
+  GST_KEYFRAME_INDEX_TYPE_I = 0,
+  GST_KEYFRAME_INDEX_TYPE_IDR,
+  GST_KEYFRAME_INDEX_TYPE_CRA,
+  GST_KEYFRAME_INDEX_TYPE_BLA
+} GstKeyframeIndexType;
+
+typedef struct _GstKeyframeIndexEntry GstKeyframeIndexEntry;
+typedef struct _GstKeyframeIndex GstKeyframeIndex;
+
+struct _GstKeyframeIndexEntry
+{
+  GstClockTime pts;
+  GstClockTime dts;
+  guint64 offset;
+  GstKeyframeIndexType type;
+  /* number of frames up to the next keyframe, 0 if unknown */
+  guint gop_size;
+};
+
+struct _GstKeyframeIndex
+{
+  GMutex lock;
+
+  /* GstKeyframeIndexEntry, sorted by offset */
+  GArray *entries;
+
+  /* entry of the GOP currently being parsed, or -1 */
+  gint cur_key;
+  guint cur_gop_size;
+  guint64 last_offset;
+
+  /* entries loaded from a sidecar that still need to be handed
+   * to the base class index */
+  gboolean pending_seed;
+
+  /* sidecar file of the "index-location" property, or NULL */
+  gchar *location;
+};
+
+GstKeyframeIndex * gst_keyframe_index_new        (void);
+void               gst_keyframe_index_free       (GstKeyframeIndex * index);
+void               gst_keyframe_index_clear      (GstKeyframeIndex * index);
+
+void               gst_keyframe_index_add_frame  (GstKeyframeIndex * index,
+                                                  GstBaseParse * parse,
+                                                  GstBaseParseFrame * frame,
+                                                  GstKeyframeIndexType type);
+
+gboolean           gst_keyframe_index_handle_query (GstKeyframeIndex * index,
+                                                  GstQuery * query);
+gboolean           gst_keyframe_index_src_query  (GstKeyframeIndex * index,
+                                                  GstBaseParse * parse,
+                                                  GstQuery * query,
+                                                  GstBaseParseClass * parent_class);
+
+gboolean           gst_keyframe_index_load       (GstKeyframeIndex * index,
+                                                  const gchar * location);
+gboolean           gst_keyframe_index_save       (GstKeyframeIndex * index,
+                                                  const gchar * location);
+
+void               gst_keyframe_index_start      (GstKeyframeIndex * index);
+void               gst_keyframe_index_stop       (GstKeyframeIndex * index);
+
+void               gst_keyframe_index_install_property (GObjectClass * klass,
+                                                  guint prop_id);
+void               gst_keyframe_index_set_property (GstKeyframeIndex * index,
+                                                  const GValue * value);
+void               gst_keyframe_index_get_property (GstKeyframeIndex * index,
+                                                  GValue * value);
+
+G_END_DECLS
+#endif /* __GST_KEYFRAME_INDEX_H__ */
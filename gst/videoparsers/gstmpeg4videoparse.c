@@ -67,6 +67,7 @@ enum
   PROP_0,
   PROP_DROP,
   PROP_CONFIG_INTERVAL,
+  PROP_INDEX_LOCATION,
   PROP_LAST
 };
 
@@ -92,6 +93,9 @@ static void gst_mpeg4vparse_get_property (GObject * object, guint prop_id,
 static gboolean gst_mpeg4vparse_event (GstBaseParse * parse, GstEvent * event);
 static gboolean gst_mpeg4vparse_src_event (GstBaseParse * parse,
     GstEvent * event);
+static gboolean gst_mpeg4vparse_src_query (GstBaseParse * parse,
+    GstQuery * query);
+static void gst_mpeg4vparse_finalize (GObject * object);
 
 static void
 gst_mpeg4vparse_set_property (GObject * object, guint property_id,
@@ -106,6 +110,9 @@ gst_mpeg4vparse_set_property (GObject * object, guint property_id,
     case PROP_CONFIG_INTERVAL:
       parse->interval = g_value_get_uint (value);
       break;
+    case PROP_INDEX_LOCATION:
+      gst_keyframe_index_set_property (parse->kf_index, value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
   }
@@ -124,6 +131,9 @@ gst_mpeg4vparse_get_property (GObject * object, guint property_id,
     case PROP_CONFIG_INTERVAL:
       g_value_set_uint (value, parse->interval);
       break;
+    case PROP_INDEX_LOCATION:
+      gst_keyframe_index_get_property (parse->kf_index, value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
   }
@@ -140,6 +150,7 @@ gst_mpeg4vparse_class_init (GstMpeg4VParseClass * klass)
 
   gobject_class->set_property = gst_mpeg4vparse_set_property;
   gobject_class->get_property = gst_mpeg4vparse_get_property;
+  gobject_class->finalize = gst_mpeg4vparse_finalize;
 
   g_object_class_install_property (gobject_class, PROP_DROP,
       g_param_spec_boolean ("drop", "drop",
@@ -155,6 +166,8 @@ gst_mpeg4vparse_class_init (GstMpeg4VParseClass * klass)
           0, 3600, DEFAULT_CONFIG_INTERVAL,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  gst_keyframe_index_install_property (gobject_class, PROP_INDEX_LOCATION);
+
   gst_element_class_add_pad_template (element_class,
       gst_static_pad_template_get (&src_template));
   gst_element_class_add_pad_template (element_class,
@@ -178,6 +191,7 @@ gst_mpeg4vparse_class_init (GstMpeg4VParseClass * klass)
   parse_class->get_sink_caps = GST_DEBUG_FUNCPTR (gst_mpeg4vparse_get_caps);
   parse_class->sink_event = GST_DEBUG_FUNCPTR (gst_mpeg4vparse_event);
   parse_class->src_event = GST_DEBUG_FUNCPTR (gst_mpeg4vparse_src_event);
+  parse_class->src_query = GST_DEBUG_FUNCPTR (gst_mpeg4vparse_src_query);
 }
 
 static void
@@ -185,11 +199,22 @@ gst_mpeg4vparse_init (GstMpeg4VParse * parse)
 {
   parse->interval = DEFAULT_CONFIG_INTERVAL;
   parse->last_report = GST_CLOCK_TIME_NONE;
+  parse->kf_index = gst_keyframe_index_new ();
 
   gst_base_parse_set_pts_interpolation (GST_BASE_PARSE (parse), FALSE);
   GST_PAD_SET_ACCEPT_INTERSECT (GST_BASE_PARSE_SINK_PAD (parse));
 }
 
+static void
+gst_mpeg4vparse_finalize (GObject * object)
+{
+  GstMpeg4VParse *mp4vparse = GST_MPEG4VIDEO_PARSE (object);
+
+  gst_keyframe_index_free (mp4vparse->kf_index);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 static void
 gst_mpeg4vparse_reset_frame (GstMpeg4VParse * mp4vparse)
 {
@@ -227,6 +252,8 @@ gst_mpeg4vparse_start (GstBaseParse * parse)
   /* at least this much for a valid frame */
   gst_base_parse_set_min_frame_size (parse, 6);
 
+  gst_keyframe_index_start (mp4vparse->kf_index);
+
   return TRUE;
 }
 
@@ -239,6 +266,8 @@ gst_mpeg4vparse_stop (GstBaseParse * parse)
 
   gst_mpeg4vparse_reset (mp4vparse);
 
+  gst_keyframe_index_stop (mp4vparse->kf_index);
+
   return TRUE;
 }
 
@@ -735,6 +764,9 @@ gst_mpeg4vparse_pre_push_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
     push_codec = TRUE;
   }
 
+  gst_keyframe_index_add_frame (mp4vparse->kf_index, parse, frame,
+      GST_KEYFRAME_INDEX_TYPE_I);
+
   /* periodic config sending */
   if (mp4vparse->interval > 0 || push_codec) {
     GstClockTime timestamp = GST_BUFFER_TIMESTAMP (buffer);
@@ -983,3 +1015,12 @@ gst_mpeg4vparse_src_event (GstBaseParse * parse, GstEvent * event)
 
   return res;
 }
+
+static gboolean
+gst_mpeg4vparse_src_query (GstBaseParse * parse, GstQuery * query)
+{
+  GstMpeg4VParse *mp4vparse = GST_MPEG4VIDEO_PARSE (parse);
+
+  return gst_keyframe_index_src_query (mp4vparse->kf_index, parse, query,
+      GST_BASE_PARSE_CLASS (parent_class));
+}
@@ -25,6 +25,8 @@
 
 #include <gst/codecparsers/gstmpeg4parser.h>
 
+#include "gstkeyframeindex.h"
+
 G_BEGIN_DECLS
 
 #define GST_TYPE_MPEG4VIDEO_PARSE            (gst_mpeg4vparse_get_type())
@@ -68,6 +70,9 @@ struct _GstMpeg4VParse {
   /* properties */
   gboolean drop;
   guint interval;
+
+  GstKeyframeIndex *kf_index;
+
   GstClockTime pending_key_unit_ts;
   GstEvent *force_key_unit_event;
 };
@@ -60,6 +60,7 @@ enum
   PROP_0,
   PROP_DROP,
   PROP_GOP_SPLIT,
+  PROP_INDEX_LOCATION,
   PROP_LAST
 };
 
@@ -79,6 +80,9 @@ static GstFlowReturn gst_mpegv_parse_pre_push_frame (GstBaseParse * parse,
     GstBaseParseFrame * frame);
 static gboolean gst_mpegv_parse_sink_query (GstBaseParse * parse,
     GstQuery * query);
+static gboolean gst_mpegv_parse_src_query (GstBaseParse * parse,
+    GstQuery * query);
+static void gst_mpegv_parse_finalize (GObject * object);
 
 static void gst_mpegv_parse_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec);
@@ -98,6 +102,9 @@ gst_mpegv_parse_set_property (GObject * object, guint property_id,
     case PROP_GOP_SPLIT:
       parse->gop_split = g_value_get_boolean (value);
       break;
+    case PROP_INDEX_LOCATION:
+      gst_keyframe_index_set_property (parse->kf_index, value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
   }
@@ -116,6 +123,9 @@ gst_mpegv_parse_get_property (GObject * object, guint property_id,
     case PROP_GOP_SPLIT:
       g_value_set_boolean (value, parse->gop_split);
       break;
+    case PROP_INDEX_LOCATION:
+      gst_keyframe_index_get_property (parse->kf_index, value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
   }
@@ -135,6 +145,7 @@ gst_mpegv_parse_class_init (GstMpegvParseClass * klass)
 
   gobject_class->set_property = gst_mpegv_parse_set_property;
   gobject_class->get_property = gst_mpegv_parse_get_property;
+  gobject_class->finalize = gst_mpegv_parse_finalize;
 
   g_object_class_install_property (gobject_class, PROP_DROP,
       g_param_spec_boolean ("drop", "drop",
@@ -147,6 +158,8 @@ gst_mpegv_parse_class_init (GstMpegvParseClass * klass)
           "Split frame when encountering GOP", DEFAULT_PROP_GOP_SPLIT,
           G_PARAM_CONSTRUCT | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  gst_keyframe_index_install_property (gobject_class, PROP_INDEX_LOCATION);
+
   gst_element_class_add_pad_template (element_class,
       gst_static_pad_template_get (&src_template));
   gst_element_class_add_pad_template (element_class,
@@ -169,17 +182,29 @@ gst_mpegv_parse_class_init (GstMpegvParseClass * klass)
   parse_class->pre_push_frame =
       GST_DEBUG_FUNCPTR (gst_mpegv_parse_pre_push_frame);
   parse_class->sink_query = GST_DEBUG_FUNCPTR (gst_mpegv_parse_sink_query);
+  parse_class->src_query = GST_DEBUG_FUNCPTR (gst_mpegv_parse_src_query);
 }
 
 static void
 gst_mpegv_parse_init (GstMpegvParse * parse)
 {
   parse->config_flags = FLAG_NONE;
+  parse->kf_index = gst_keyframe_index_new ();
 
   gst_base_parse_set_pts_interpolation (GST_BASE_PARSE (parse), FALSE);
   GST_PAD_SET_ACCEPT_INTERSECT (GST_BASE_PARSE_SINK_PAD (parse));
 }
 
+static void
+gst_mpegv_parse_finalize (GObject * object)
+{
+  GstMpegvParse *mpvparse = GST_MPEGVIDEO_PARSE (object);
+
+  gst_keyframe_index_free (mpvparse->kf_index);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 static void
 gst_mpegv_parse_reset_frame (GstMpegvParse * mpvparse)
 {
@@ -238,6 +263,15 @@ gst_mpegv_parse_sink_query (GstBaseParse * parse, GstQuery * query)
   return res;
 }
 
+static gboolean
+gst_mpegv_parse_src_query (GstBaseParse * parse, GstQuery * query)
+{
+  GstMpegvParse *mpvparse = GST_MPEGVIDEO_PARSE (parse);
+
+  return gst_keyframe_index_src_query (mpvparse->kf_index, parse, query,
+      GST_BASE_PARSE_CLASS (parent_class));
+}
+
 static gboolean
 gst_mpegv_parse_start (GstBaseParse * parse)
 {
@@ -249,6 +283,8 @@ gst_mpegv_parse_start (GstBaseParse * parse)
   /* at least this much for a valid frame */
   gst_base_parse_set_min_frame_size (parse, 6);
 
+  gst_keyframe_index_start (mpvparse->kf_index);
+
   return TRUE;
 }
 
@@ -261,6 +297,8 @@ gst_mpegv_parse_stop (GstBaseParse * parse)
 
   gst_mpegv_parse_reset (mpvparse);
 
+  gst_keyframe_index_stop (mpvparse->kf_index);
+
   return TRUE;
 }
 
@@ -962,6 +1000,9 @@ gst_mpegv_parse_pre_push_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
   /* usual clipping applies */
   frame->flags |= GST_BASE_PARSE_FRAME_FLAG_CLIP;
 
+  gst_keyframe_index_add_frame (mpvparse->kf_index, parse, frame,
+      GST_KEYFRAME_INDEX_TYPE_I);
+
   if (mpvparse->send_mpeg_meta) {
     GstBuffer *buf;
 
@@ -30,6 +30,8 @@
 
 #include <gst/codecparsers/gstmpegvideoparser.h>
 
+#include "gstkeyframeindex.h"
+
 G_BEGIN_DECLS
 
 #define GST_TYPE_MPEGVIDEO_PARSE            (gst_mpegv_parse_get_type())
@@ -91,6 +93,8 @@ struct _GstMpegvParse {
   gboolean drop;
   gboolean gop_split;
 
+  GstKeyframeIndex *kf_index;
+
   int fps_num;
   int fps_den;
   int frame_repeat_count;
@@ -192,6 +192,8 @@ static gboolean gst_vc1_parse_handle_seq_hdr (GstVC1Parse * vc1parse,
     GstBuffer * buf, guint offset, guint size);
 static gboolean gst_vc1_parse_handle_entrypoint (GstVC1Parse * vc1parse,
     GstBuffer * buf, guint offset, guint size);
+static void gst_vc1_parse_handle_frame_hdr (GstVC1Parse * vc1parse,
+    GstBuffer * buf, guint offset, guint size);
 static void gst_vc1_parse_update_stream_format_properties (GstVC1Parse *
     vc1parse);
 
@@ -270,6 +272,7 @@ gst_vc1_parse_reset (GstVC1Parse * vc1parse)
   gst_buffer_replace (&vc1parse->seq_layer_buffer, NULL);
   gst_buffer_replace (&vc1parse->seq_hdr_buffer, NULL);
   gst_buffer_replace (&vc1parse->entrypoint_buffer, NULL);
+  vc1parse->entrypoint_valid = FALSE;
 }
 
 static gboolean
@@ -802,7 +805,7 @@ gst_vc1_parse_handle_bdu (GstVC1Parse * vc1parse, GstVC1StartCode startcode,
       }
       break;
     case GST_VC1_FRAME:
-      /* TODO: Check if keyframe */
+      gst_vc1_parse_handle_frame_hdr (vc1parse, buffer, offset, size);
       break;
     default:
       break;
@@ -1087,7 +1090,7 @@ gst_vc1_parse_handle_frame (GstBaseParse * parse, GstBaseParseFrame * frame,
         }
       } else {
         /* Must be a frame or a frame + field */
-        /* TODO: Check if keyframe */
+        gst_vc1_parse_handle_frame_hdr (vc1parse, buffer, 0, size);
       }
     }
     ret = GST_FLOW_OK;
@@ -1296,6 +1299,7 @@ gst_vc1_parse_handle_seq_hdr (GstVC1Parse * vc1parse,
   g_assert (gst_buffer_get_size (buf) >= offset + size);
   gst_buffer_replace (&vc1parse->seq_hdr_buffer, NULL);
   memset (&vc1parse->seq_hdr, 0, sizeof (vc1parse->seq_hdr));
+  vc1parse->entrypoint_valid = FALSE;
 
   gst_buffer_map (buf, &minfo, GST_MAP_READ);
   pres =
@@ -1493,9 +1497,64 @@ gst_vc1_parse_handle_entrypoint (GstVC1Parse * vc1parse,
   vc1parse->entrypoint_buffer =
       gst_buffer_copy_region (buf, GST_BUFFER_COPY_ALL, offset, size);
 
+  /* The entrypoint carries the coded size that frame headers are parsed
+   * against, an invalid one only disables keyframe detection */
+  vc1parse->entrypoint_valid = FALSE;
+  if (vc1parse->seq_hdr_buffer) {
+    GstVC1EntryPointHdr entrypoint;
+    GstMapInfo minfo;
+
+    gst_buffer_map (buf, &minfo, GST_MAP_READ);
+    vc1parse->entrypoint_valid =
+        gst_vc1_parse_entry_point_header (minfo.data + offset, size,
+        &entrypoint, &vc1parse->seq_hdr) == GST_VC1_PARSER_OK;
+    gst_buffer_unmap (buf, &minfo);
+
+    if (!vc1parse->entrypoint_valid)
+      GST_WARNING_OBJECT (vc1parse, "Failed to parse entrypoint header");
+  }
+
   return TRUE;
 }
 
+/* Parses the frame header in headers only mode, without storing the
+ * bitplanes, to find out if the frame is a keyframe */
+static void
+gst_vc1_parse_handle_frame_hdr (GstVC1Parse * vc1parse,
+    GstBuffer * buf, guint offset, guint size)
+{
+  GstVC1ParserResult pres;
+  GstVC1FrameHdr framehdr;
+  GstMapInfo minfo;
+
+  g_assert (gst_buffer_get_size (buf) >= offset + size);
+
+  /* Simple/main profile streams with a sequence layer only don't have a
+   * sequence header to parse frames against */
+  if (!vc1parse->seq_hdr_buffer)
+    return;
+  if (vc1parse->seq_hdr.profile == GST_VC1_PROFILE_ADVANCED
+      && !vc1parse->entrypoint_valid)
+    return;
+
+  gst_buffer_map (buf, &minfo, GST_MAP_READ);
+  pres = gst_vc1_parse_frame_header (minfo.data + offset, size, &framehdr,
+      &vc1parse->seq_hdr, NULL);
+  gst_buffer_unmap (buf, &minfo);
+
+  if (pres != GST_VC1_PARSER_OK) {
+    GST_DEBUG_OBJECT (vc1parse, "Failed to parse frame header");
+    return;
+  }
+
+  GST_LOG_OBJECT (vc1parse, "Frame of picture type %d", framehdr.ptype);
+
+  if (framehdr.ptype == GST_VC1_PICTURE_TYPE_I)
+    GST_BUFFER_FLAG_UNSET (buf, GST_BUFFER_FLAG_DELTA_UNIT);
+  else
+    GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT);
+}
+
 static void
 gst_vc1_parse_update_stream_format_properties (GstVC1Parse * vc1parse)
 {
@@ -99,6 +99,8 @@ struct _GstVC1Parse
   GstVC1SeqHdr seq_hdr;
   GstBuffer *seq_hdr_buffer;
   GstBuffer *entrypoint_buffer;
+  /* TRUE if seq_hdr holds a valid entrypoint, advanced profile only */
+  gboolean entrypoint_valid;
 
   GstVC1SeqLayer seq_layer;
   GstBuffer *seq_layer_buffer;
@@ -0,0 +1,435 @@
+/* GStreamer
+ *
+ * unit test for the DASH MPD parser
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "../../ext/dash/gstmpdparser.c"
+#undef GST_CAT_DEFAULT
+
+#include <gst/check/gstcheck.h>
+
+GST_DEBUG_CATEGORY (gst_dash_demux_debug);
+
+/* The video timeline, in ms:
+ *   0-2-4-6       3 segments of 2 s
+ *   6-7-8         2 segments of 1 s
+ *   8-10          a gap
+ *   10-12-14-16   segments of 2 s repeated up to the next S@t
+ *   16-19-...-28  segments of 3 s repeated up to the end of the Period,
+ *   28-30         the last one cut at the end of the Period
+ * The audio stream uses a SegmentList of 3 segments of 2 s, the
+ * application stream a SegmentTemplate with segments of 2 s */
+static const gchar mpd[] =
+    "<?xml version=\"1.0\"?>"
+    "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\" type=\"static\" "
+    "profiles=\"urn:mpeg:dash:profile:isoff-live:2011\" "
+    "mediaPresentationDuration=\"PT30S\" minBufferTime=\"PT2S\">"
+    "<Period>"
+    "<AdaptationSet mimeType=\"video/mp4\">"
+    "<Representation id=\"v\" bandwidth=\"250000\">"
+    "<SegmentTemplate timescale=\"1000\" media=\"video-$Number$.mp4\" "
+    "startNumber=\"1\">"
+    "<SegmentTimeline>"
+    "<S t=\"0\" d=\"2000\" r=\"2\"/>"
+    "<S d=\"1000\" r=\"1\"/>"
+    "<S t=\"10000\" d=\"2000\" r=\"-1\"/>"
+    "<S t=\"16000\" d=\"3000\" r=\"-1\"/>"
+    "</SegmentTimeline>"
+    "</SegmentTemplate>"
+    "</Representation>"
+    "</AdaptationSet>"
+    "<AdaptationSet mimeType=\"audio/mp4\">"
+    "<Representation id=\"a\" bandwidth=\"64000\">"
+    "<SegmentList duration=\"2\">"
+    "<SegmentURL media=\"audio-0.mp4\"/><SegmentURL media=\"audio-1.mp4\"/>"
+    "<SegmentURL media=\"audio-2.mp4\"/>"
+    "</SegmentList>"
+    "</Representation>"
+    "</AdaptationSet>"
+    "<AdaptationSet mimeType=\"application/mp4\">"
+    "<Representation id=\"t\" bandwidth=\"1000\">"
+    "<SegmentTemplate duration=\"2\" media=\"text-$Number$.mp4\"/>"
+    "</Representation>" "</AdaptationSet>" "</Period>" "</MPD>";
+
+/* A live timeline with a presentationTimeOffset of 10 s, in period time:
+ *   0-2-4-6       3 segments of 2 s
+ *   6-7-8         2 segments of 1 s
+ *   8-10          a gap
+ *   10-12         the latest segment */
+static const gchar live_mpd[] =
+    "<?xml version=\"1.0\"?>"
+    "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\" type=\"dynamic\" "
+    "profiles=\"urn:mpeg:dash:profile:isoff-live:2011\" "
+    "availabilityStartTime=\"2014-01-01T00:00:00Z\" minBufferTime=\"PT2S\">"
+    "<Period>"
+    "<AdaptationSet mimeType=\"video/mp4\">"
+    "<Representation id=\"v\" bandwidth=\"250000\">"
+    "<SegmentTemplate timescale=\"90000\" presentationTimeOffset=\"900000\" "
+    "media=\"video-$Time$.mp4\">"
+    "<SegmentTimeline>"
+    "<S t=\"900000\" d=\"180000\" r=\"2\"/>"
+    "<S d=\"90000\" r=\"1\"/>"
+    "<S t=\"1800000\" d=\"180000\"/>"
+    "</SegmentTimeline>"
+    "</SegmentTemplate>"
+    "</Representation>" "</AdaptationSet>" "</Period>" "</MPD>";
+
+/* A live MPD whose timeline holds n segments of 2 s from start ms */
+static gchar *
+sliding_mpd (const gchar * period_id, guint start, guint n)
+{
+  return g_strdup_printf ("<?xml version=\"1.0\"?>"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\" type=\"dynamic\" "
+      "profiles=\"urn:mpeg:dash:profile:isoff-live:2011\" "
+      "availabilityStartTime=\"2014-01-01T00:00:00Z\" "
+      "minimumUpdatePeriod=\"PT2S\" minBufferTime=\"PT2S\">"
+      "<Period id=\"%s\">"
+      "<AdaptationSet id=\"1\" mimeType=\"video/mp4\">"
+      "<Representation id=\"v\" bandwidth=\"250000\">"
+      "<SegmentTemplate timescale=\"1000\" media=\"video-$Time$.mp4\">"
+      "<SegmentTimeline>"
+      "<S t=\"%u\" d=\"2000\" r=\"%u\"/>"
+      "</SegmentTimeline>"
+      "</SegmentTemplate>"
+      "</Representation>" "</AdaptationSet>" "</Period>" "</MPD>",
+      period_id, start, n - 1);
+}
+
+static GstMpdClient *
+setup_client (const gchar * data)
+{
+  GstMpdClient *client = gst_mpd_client_new ();
+
+  fail_unless (gst_mpd_parse (client, data, strlen (data)));
+  fail_unless (gst_mpd_client_setup_media_presentation (client));
+  fail_unless (gst_mpd_client_set_period_index (client, 0));
+
+  return client;
+}
+
+static GstActiveStream *
+setup_stream (GstMpdClient * client, GstStreamMimeType mime_type)
+{
+  guint n_streams = g_list_length (client->active_streams);
+
+  fail_unless (gst_mpd_client_setup_streaming (client, mime_type, ""));
+
+  return gst_mpdparser_get_active_stream_by_index (client, n_streams);
+}
+
+GST_START_TEST (test_timeline_runs)
+{
+  GstMpdClient *client = setup_client (mpd);
+  GstActiveStream *stream = setup_stream (client, GST_STREAM_VIDEO);
+  GstMediaTimelineRun *run;
+  GstMediaSegment segment;
+
+  /* a run per S node, the last segment split off to fix its duration */
+  fail_unless (stream->timeline != NULL);
+  fail_unless (stream->segments == NULL);
+  fail_unless_equals_int (stream->timeline->len, 5);
+  fail_unless_equals_int (stream->timeline_n_segments, 13);
+
+  run = &g_array_index (stream->timeline, GstMediaTimelineRun, 2);
+  fail_unless_equals_int (run->first_idx, 5);
+  fail_unless_equals_int (run->count, 3);
+  fail_unless_equals_int (run->number, 6);
+  fail_unless_equals_uint64 (run->start_time, 10 * GST_SECOND);
+
+  run = &g_array_index (stream->timeline, GstMediaTimelineRun, 3);
+  fail_unless_equals_int (run->first_idx, 8);
+  fail_unless_equals_int (run->count, 4);
+  fail_unless_equals_uint64 (run->duration, 3 * GST_SECOND);
+
+  fail_unless (gst_mpdparser_get_chunk_by_index (client, 0, 12, &segment));
+  fail_unless_equals_int (segment.number, 13);
+  fail_unless_equals_uint64 (segment.start, 28000);
+  fail_unless_equals_uint64 (segment.start_time, 28 * GST_SECOND);
+  fail_unless_equals_uint64 (segment.duration, 2 * GST_SECOND);
+  fail_if (gst_mpdparser_get_chunk_by_index (client, 0, 13, &segment));
+
+  gst_mpd_client_free (client);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_timeline_index_at_time)
+{
+  GstMpdClient *client = setup_client (mpd);
+  GstActiveStream *stream = setup_stream (client, GST_STREAM_VIDEO);
+
+#define INDEX_CONTAINING(ms) \
+  gst_mpdparser_get_timeline_index_at_time (stream, (ms) * GST_MSECOND, TRUE)
+#define INDEX_AFTER(ms) \
+  gst_mpdparser_get_timeline_index_at_time (stream, (ms) * GST_MSECOND, FALSE)
+
+  /* within and at the boundaries of the runs */
+  fail_unless_equals_int (INDEX_CONTAINING (0), 0);
+  fail_unless_equals_int (INDEX_CONTAINING (1999), 0);
+  fail_unless_equals_int (INDEX_CONTAINING (2000), 1);
+  fail_unless_equals_int (INDEX_CONTAINING (5999), 2);
+  fail_unless_equals_int (INDEX_CONTAINING (6000), 3);
+  fail_unless_equals_int (INDEX_CONTAINING (7500), 4);
+  fail_unless_equals_int (INDEX_CONTAINING (10000), 5);
+  fail_unless_equals_int (INDEX_CONTAINING (15999), 7);
+  fail_unless_equals_int (INDEX_CONTAINING (16000), 8);
+  fail_unless_equals_int (INDEX_CONTAINING (27999), 11);
+  fail_unless_equals_int (INDEX_CONTAINING (28000), 12);
+  fail_unless_equals_int (INDEX_CONTAINING (29999), 12);
+
+  /* in the gap and past the end */
+  fail_unless_equals_int (INDEX_CONTAINING (8000), 5);
+  fail_unless_equals_int (INDEX_CONTAINING (9999), 5);
+  fail_unless_equals_int (INDEX_CONTAINING (30000), 13);
+  fail_unless_equals_int (INDEX_CONTAINING (60000), 13);
+
+  /* the first segment starting at or after the position */
+  fail_unless_equals_int (INDEX_AFTER (0), 0);
+  fail_unless_equals_int (INDEX_AFTER (1), 1);
+  fail_unless_equals_int (INDEX_AFTER (2000), 1);
+  fail_unless_equals_int (INDEX_AFTER (5000), 3);
+  fail_unless_equals_int (INDEX_AFTER (7001), 5);
+  fail_unless_equals_int (INDEX_AFTER (8500), 5);
+  fail_unless_equals_int (INDEX_AFTER (16000), 8);
+  fail_unless_equals_int (INDEX_AFTER (28001), 13);
+
+#undef INDEX_CONTAINING
+#undef INDEX_AFTER
+
+  gst_mpd_client_free (client);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_timeline_index_at_period_time)
+{
+  GstMpdClient *client = setup_client (mpd);
+  GstActiveStream *stream = setup_stream (client, GST_STREAM_VIDEO);
+
+#define INDEX(ms) \
+  gst_mpdparser_get_timeline_index_at_period_time (stream, (ms) * GST_MSECOND)
+
+  /* within and at the boundaries of the runs */
+  fail_unless_equals_int (INDEX (0), 0);
+  fail_unless_equals_int (INDEX (1999), 0);
+  fail_unless_equals_int (INDEX (2000), 1);
+  fail_unless_equals_int (INDEX (6000), 3);
+  fail_unless_equals_int (INDEX (7999), 4);
+  fail_unless_equals_int (INDEX (10000), 5);
+  fail_unless_equals_int (INDEX (15999), 7);
+  fail_unless_equals_int (INDEX (16000), 8);
+  fail_unless_equals_int (INDEX (29999), 12);
+
+  /* a gap or the time past the end map to the latest segment before */
+  fail_unless_equals_int (INDEX (8000), 4);
+  fail_unless_equals_int (INDEX (9999), 4);
+  fail_unless_equals_int (INDEX (30000), 12);
+  fail_unless_equals_int (INDEX (60000), 12);
+
+  gst_mpd_client_free (client);
+
+  /* the period time is matched against S@t in the timescale, after the
+   * presentationTimeOffset */
+  client = setup_client (live_mpd);
+  stream = setup_stream (client, GST_STREAM_VIDEO);
+  fail_unless_equals_int (stream->timeline_n_segments, 6);
+
+  fail_unless_equals_int (INDEX (0), 0);
+  fail_unless_equals_int (INDEX (1999), 0);
+  fail_unless_equals_int (INDEX (2000), 1);
+  fail_unless_equals_int (INDEX (5999), 2);
+  fail_unless_equals_int (INDEX (6000), 3);
+  fail_unless_equals_int (INDEX (7000), 4);
+  fail_unless_equals_int (INDEX (8000), 4);
+  fail_unless_equals_int (INDEX (9999), 4);
+  fail_unless_equals_int (INDEX (10000), 5);
+  fail_unless_equals_int (INDEX (60000), 5);
+
+#undef INDEX
+
+  gst_mpd_client_free (client);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_segment_index_at_position)
+{
+  GstMpdClient *client = setup_client (mpd);
+  GstActiveStream *video = setup_stream (client, GST_STREAM_VIDEO);
+  GstActiveStream *audio = setup_stream (client, GST_STREAM_AUDIO);
+  GstActiveStream *text = setup_stream (client, GST_STREAM_APPLICATION);
+
+#define INDEX(stream, ms) \
+  gst_mpd_client_get_segment_index_at_position (client, stream, \
+      (ms) * GST_MSECOND)
+
+  /* SegmentTimeline */
+  fail_unless_equals_int (INDEX (video, 0), 0);
+  fail_unless_equals_int (INDEX (video, 6000), 3);
+  fail_unless_equals_int (INDEX (video, 8000), 5);
+  fail_unless_equals_int (INDEX (video, 12000), 6);
+  fail_unless_equals_int (INDEX (video, 29000), 12);
+  fail_unless_equals_int (INDEX (video, 30000), 13);
+
+  /* SegmentList */
+  fail_unless_equals_int (INDEX (audio, 0), 0);
+  fail_unless_equals_int (INDEX (audio, 1999), 0);
+  fail_unless_equals_int (INDEX (audio, 2000), 1);
+  fail_unless_equals_int (INDEX (audio, 5999), 2);
+  fail_unless_equals_int (INDEX (audio, 6000), 3);
+
+  /* SegmentTemplate without a timeline */
+  fail_unless_equals_int (INDEX (text, 0), 0);
+  fail_unless_equals_int (INDEX (text, 3999), 1);
+  fail_unless_equals_int (INDEX (text, 4000), 2);
+
+#undef INDEX
+
+  gst_mpd_client_free (client);
+}
+
+GST_END_TEST;
+
+static gboolean
+update_client (GstMpdClient * client, const gchar * data, gboolean * changed)
+{
+  return gst_mpd_client_update (client, data, strlen (data), changed);
+}
+
+GST_START_TEST (test_update)
+{
+  gchar *data = sliding_mpd ("p0", 0, 5);
+  GstMpdClient *client = setup_client (data);
+  GstActiveStream *stream = setup_stream (client, GST_STREAM_VIDEO);
+  GstRepresentationNode *representation;
+  GstPeriodNode *period;
+  GstMediaSegment segment;
+  gboolean changed;
+
+  /* the same file is not parsed again */
+  representation = stream->cur_representation;
+  fail_unless (update_client (client, data, &changed));
+  fail_if (changed);
+  fail_unless (stream->cur_representation == representation);
+  g_free (data);
+
+  /* the stream moves to the nodes of the new file and continues with the
+   * segment it was at, now the second one of the window */
+  gst_mpd_client_set_segment_index (stream, 3);
+  data = sliding_mpd ("p0", 4000, 6);
+  fail_unless (update_client (client, data, &changed));
+  fail_unless (changed);
+  g_free (data);
+
+  fail_unless (stream->cur_representation != representation);
+  fail_unless_equals_string (stream->cur_representation->id, "v");
+  period = client->mpd_node->Periods->data;
+  fail_unless (stream->cur_adapt_set == period->AdaptationSets->data);
+  fail_unless_equals_int (stream->timeline_n_segments, 6);
+  fail_unless_equals_int (gst_mpd_client_get_segment_index (stream), 1);
+  fail_unless (gst_mpdparser_get_chunk_by_index (client, 0, 1, &segment));
+  fail_unless_equals_uint64 (segment.start, 6000);
+
+  /* a stream waiting for the next segment continues with it */
+  gst_mpd_client_set_segment_index (stream, 6);
+  data = sliding_mpd ("p0", 8000, 6);
+  fail_unless (update_client (client, data, &changed));
+  fail_unless (changed);
+  g_free (data);
+
+  fail_unless_equals_int (gst_mpd_client_get_segment_index (stream), 4);
+  fail_unless (gst_mpdparser_get_chunk_by_index (client, 0, 4, &segment));
+  fail_unless_equals_uint64 (segment.start, 16000);
+
+  gst_mpd_client_free (client);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_update_revert)
+{
+  gchar *data = sliding_mpd ("p0", 0, 5);
+  GstMpdClient *client = setup_client (data);
+  GstActiveStream *stream = setup_stream (client, GST_STREAM_VIDEO);
+  GstRepresentationNode *representation = stream->cur_representation;
+  GstAdaptationSetNode *adapt_set = stream->cur_adapt_set;
+  GstMPDNode *mpd_node = client->mpd_node;
+  GstMediaSegment segment;
+  gboolean changed;
+
+  g_free (data);
+  gst_mpd_client_set_segment_index (stream, 2);
+
+  /* a file that can't be parsed */
+  changed = TRUE;
+  fail_if (update_client (client, "<MPD", &changed));
+  fail_if (changed);
+  fail_unless (client->mpd_node == mpd_node);
+
+  /* the current Period is missing from the new file: the stream, already
+   * saved for the update, goes back to the previous nodes and position */
+  data = sliding_mpd ("p1", 4000, 6);
+  fail_if (update_client (client, data, &changed));
+  fail_if (changed);
+  g_free (data);
+
+  fail_unless (client->mpd_node == mpd_node);
+  fail_unless_equals_int (client->period_idx, 0);
+  fail_unless (stream->cur_adapt_set == adapt_set);
+  fail_unless (stream->cur_representation == representation);
+  fail_unless (stream->cur_seg_template != NULL);
+  fail_unless_equals_int (stream->timeline_n_segments, 5);
+  fail_unless_equals_int (gst_mpd_client_get_segment_index (stream), 2);
+  fail_unless (gst_mpdparser_get_chunk_by_index (client, 0, 2, &segment));
+  fail_unless_equals_uint64 (segment.start, 4000);
+
+  /* and the next valid file is still applied */
+  data = sliding_mpd ("p0", 2000, 5);
+  fail_unless (update_client (client, data, &changed));
+  fail_unless (changed);
+  g_free (data);
+  fail_unless (client->mpd_node != mpd_node);
+  fail_unless_equals_int (gst_mpd_client_get_segment_index (stream), 1);
+
+  gst_mpd_client_free (client);
+}
+
+GST_END_TEST;
+
+static Suite *
+dash_mpd_suite (void)
+{
+  Suite *s = suite_create ("dash_mpd");
+  TCase *tc_chain = tcase_create ("general");
+
+  GST_DEBUG_CATEGORY_INIT (gst_dash_demux_debug, "dashdemux", 0,
+      "dashdemux element");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_timeline_runs);
+  tcase_add_test (tc_chain, test_timeline_index_at_time);
+  tcase_add_test (tc_chain, test_timeline_index_at_period_time);
+  tcase_add_test (tc_chain, test_segment_index_at_position);
+  tcase_add_test (tc_chain, test_update);
+  tcase_add_test (tc_chain, test_update_revert);
+
+  return s;
+}
+
+GST_CHECK_MAIN (dash_mpd);
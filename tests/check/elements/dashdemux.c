@@ -0,0 +1,289 @@
+/* GStreamer
+ *
+ * unit test for dashdemux
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <gst/check/gstcheck.h>
+#include "elements/testdlsrc.h"
+
+#define BASE_URI "testdl://dash.example.com/"
+#define MPD_URI BASE_URI "stream.mpd"
+#define N_SEGMENTS 4
+#define SEGMENT_SIZE (3 * TEST_DL_SRC_CHUNK_SIZE)
+
+static const gchar mpd[] =
+    "<?xml version=\"1.0\"?>"
+    "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\" type=\"static\" "
+    "profiles=\"urn:mpeg:dash:profile:isoff-on-demand:2011\" "
+    "mediaPresentationDuration=\"PT8S\" minBufferTime=\"PT2S\">"
+    "<Period>"
+    "<AdaptationSet mimeType=\"video/mp4\">"
+    "<Representation id=\"v\" bandwidth=\"250000\" width=\"320\" "
+    "height=\"240\">"
+    "<SegmentList duration=\"2\">"
+    "<SegmentURL media=\"video-0.mp4\"/><SegmentURL media=\"video-1.mp4\"/>"
+    "<SegmentURL media=\"video-2.mp4\"/><SegmentURL media=\"video-3.mp4\"/>"
+    "</SegmentList>"
+    "</Representation>"
+    "</AdaptationSet>"
+    "<AdaptationSet mimeType=\"audio/mp4\">"
+    "<Representation id=\"a\" bandwidth=\"64000\" audioSamplingRate=\"44100\">"
+    "<SegmentList duration=\"2\">"
+    "<SegmentURL media=\"audio-0.mp4\"/><SegmentURL media=\"audio-1.mp4\"/>"
+    "<SegmentURL media=\"audio-2.mp4\"/><SegmentURL media=\"audio-3.mp4\"/>"
+    "</SegmentList>"
+    "</Representation>" "</AdaptationSet>" "</Period>" "</MPD>";
+
+typedef struct
+{
+  GMutex lock;
+  GstElement *pipeline;
+  GList *sinkpads;
+  GHashTable *data;             /* sink pad -> GByteArray */
+} OutputLog;
+
+static gchar *
+segment_uri (const gchar * type, guint index)
+{
+  return g_strdup_printf (BASE_URI "%s-%u.mp4", type, index);
+}
+
+static guint8 *
+segment_data (const gchar * type, guint index)
+{
+  guint8 *data = g_malloc (SEGMENT_SIZE);
+  guint seed = (type[0] == 'v' ? 13 : 101) + index * 31;
+  guint i;
+
+  for (i = 0; i < SEGMENT_SIZE; i++)
+    data[i] = (seed + i) & 0xff;
+
+  return data;
+}
+
+static void
+add_resources (void)
+{
+  const gchar *types[] = { "video", "audio" };
+  guint i, j;
+
+  test_dl_src_reset ();
+  test_dl_src_add_resource (MPD_URI, mpd, strlen (mpd));
+  for (i = 0; i < G_N_ELEMENTS (types); i++) {
+    for (j = 0; j < N_SEGMENTS; j++) {
+      gchar *uri = segment_uri (types[i], j);
+      guint8 *data = segment_data (types[i], j);
+
+      test_dl_src_add_resource (uri, data, SEGMENT_SIZE);
+      g_free (data);
+      g_free (uri);
+    }
+  }
+}
+
+static GstPadProbeReturn
+_output_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  OutputLog *log = user_data;
+  GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+  GByteArray *data;
+  GstMapInfo map;
+
+  g_mutex_lock (&log->lock);
+  data = g_hash_table_lookup (log->data, pad);
+  if (data == NULL) {
+    data = g_byte_array_new ();
+    g_hash_table_insert (log->data, pad, data);
+  }
+  gst_buffer_map (buffer, &map, GST_MAP_READ);
+  g_byte_array_append (data, map.data, map.size);
+  gst_buffer_unmap (buffer, &map);
+  g_mutex_unlock (&log->lock);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+_pad_added (GstElement * demux, GstPad * pad, OutputLog * log)
+{
+  GstElement *sink;
+  GstPad *sinkpad;
+
+  sink = gst_element_factory_make ("fakesink", NULL);
+  g_object_set (sink, "sync", FALSE, NULL);
+  gst_bin_add (GST_BIN (log->pipeline), sink);
+  gst_element_sync_state_with_parent (sink);
+
+  sinkpad = gst_element_get_static_pad (sink, "sink");
+  fail_unless_equals_int (gst_pad_link (pad, sinkpad), GST_PAD_LINK_OK);
+  gst_pad_add_probe (sinkpad, GST_PAD_PROBE_TYPE_BUFFER, _output_probe, log,
+      NULL);
+
+  g_mutex_lock (&log->lock);
+  log->sinkpads = g_list_prepend (log->sinkpads, sinkpad);
+  g_mutex_unlock (&log->lock);
+}
+
+static void
+output_log_init (OutputLog * log)
+{
+  GstElement *src, *demux;
+
+  g_mutex_init (&log->lock);
+  log->sinkpads = NULL;
+  log->data = g_hash_table_new_full (NULL, NULL, NULL,
+      (GDestroyNotify) g_byte_array_unref);
+
+  log->pipeline = gst_pipeline_new (NULL);
+  src = gst_element_make_from_uri (GST_URI_SRC, MPD_URI, NULL, NULL);
+  fail_unless (src != NULL);
+  demux = gst_element_factory_make ("dashdemux", NULL);
+  fail_unless (demux != NULL);
+  gst_bin_add_many (GST_BIN (log->pipeline), src, demux, NULL);
+  fail_unless (gst_element_link (src, demux));
+  g_signal_connect (demux, "pad-added", G_CALLBACK (_pad_added), log);
+}
+
+static void
+output_log_wait_eos (OutputLog * log)
+{
+  GstMessage *msg;
+  GstBus *bus;
+
+  bus = gst_element_get_bus (log->pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, 10 * GST_SECOND,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless (msg != NULL);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+}
+
+/* Checks that each pad got all the segments of its stream, in order */
+static void
+output_log_check (OutputLog * log)
+{
+  GList *walk;
+
+  fail_unless_equals_int (g_list_length (log->sinkpads), 2);
+  for (walk = log->sinkpads; walk; walk = walk->next) {
+    GstPad *sinkpad = walk->data;
+    GByteArray *data = g_hash_table_lookup (log->data, sinkpad);
+    GstCaps *caps = gst_pad_get_current_caps (sinkpad);
+    const gchar *name;
+    guint i;
+
+    fail_unless (caps != NULL);
+    name = gst_structure_get_name (gst_caps_get_structure (caps, 0));
+    fail_unless (data != NULL);
+    fail_unless_equals_int (data->len, N_SEGMENTS * SEGMENT_SIZE);
+    for (i = 0; i < N_SEGMENTS; i++) {
+      guint8 *expected = segment_data (name, i);
+
+      fail_unless (memcmp (data->data + i * SEGMENT_SIZE, expected,
+              SEGMENT_SIZE) == 0, "%s segment %u differs", name, i);
+      g_free (expected);
+    }
+    gst_caps_unref (caps);
+  }
+}
+
+static void
+output_log_clear (OutputLog * log)
+{
+  gst_element_set_state (log->pipeline, GST_STATE_NULL);
+  gst_object_unref (log->pipeline);
+  g_list_free_full (log->sinkpads, gst_object_unref);
+  g_hash_table_unref (log->data);
+  g_mutex_clear (&log->lock);
+}
+
+GST_START_TEST (test_streaming)
+{
+  OutputLog log;
+
+  add_resources ();
+  output_log_init (&log);
+
+  fail_unless (gst_element_set_state (log.pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+  output_log_wait_eos (&log);
+  output_log_check (&log);
+
+  output_log_clear (&log);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_parallel_downloads)
+{
+  OutputLog log;
+  gchar *video_uri, *uri;
+  guint i;
+
+  add_resources ();
+  output_log_init (&log);
+
+  /* while the download of a video segment doesn't progress, the audio
+   * stream downloads all its segments */
+  video_uri = segment_uri ("video", 1);
+  test_dl_src_hold (video_uri);
+
+  fail_unless (gst_element_set_state (log.pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+
+  for (i = 0; i < N_SEGMENTS; i++) {
+    uri = segment_uri ("audio", i);
+    fail_unless (test_dl_src_wait_requests (uri, 1),
+        "audio segment %u was not downloaded", i);
+    g_free (uri);
+  }
+  fail_unless (test_dl_src_wait_requests (video_uri, 1));
+  uri = segment_uri ("video", 2);
+  fail_unless_equals_int (test_dl_src_get_requests (uri), 0);
+  g_free (uri);
+
+  test_dl_src_release (video_uri);
+  output_log_wait_eos (&log);
+  output_log_check (&log);
+
+  g_free (video_uri);
+  output_log_clear (&log);
+}
+
+GST_END_TEST;
+
+static Suite *
+dashdemux_suite (void)
+{
+  Suite *s = suite_create ("dashdemux");
+  TCase *tc_chain = tcase_create ("general");
+
+  test_dl_src_register ();
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_streaming);
+  tcase_add_test (tc_chain, test_parallel_downloads);
+
+  return s;
+}
+
+GST_CHECK_MAIN (dashdemux);
@@ -246,6 +246,79 @@ GST_START_TEST (test_parse_detect_stream)
 GST_END_TEST;
 
 
+GST_START_TEST (test_parse_keyframe_index)
+{
+  GstElement *h264parse;
+  GstPad *srcpad, *sinkpad;
+  GstBuffer *buf;
+  GstQuery *query;
+  GstCaps *caps;
+  const GstStructure *s;
+  const GValue *entries;
+  guint64 prev_offset = 0;
+  gsize size;
+  guint i;
+
+  h264parse = gst_check_setup_element ("h264parse");
+  srcpad = gst_check_setup_src_pad (h264parse, ctx_src_template);
+  sinkpad = gst_check_setup_sink_pad (h264parse, ctx_sink_template);
+  gst_pad_set_active (srcpad, TRUE);
+  caps = gst_caps_from_string (SRC_CAPS_TMPL);
+  gst_check_setup_events (srcpad, h264parse, caps, GST_FORMAT_BYTES);
+  gst_caps_unref (caps);
+  gst_pad_set_active (sinkpad, TRUE);
+  fail_unless (gst_element_set_state (h264parse,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+
+  /* config followed by three IDR access units */
+  size = sizeof (h264_sps) + sizeof (h264_pps) + 3 * sizeof (h264_idrframe);
+  buf = gst_buffer_new_and_alloc (size);
+  gst_buffer_fill (buf, 0, h264_sps, sizeof (h264_sps));
+  gst_buffer_fill (buf, sizeof (h264_sps), h264_pps, sizeof (h264_pps));
+  for (i = 0; i < 3; i++)
+    gst_buffer_fill (buf, sizeof (h264_sps) + sizeof (h264_pps) +
+        i * sizeof (h264_idrframe), h264_idrframe, sizeof (h264_idrframe));
+  fail_unless_equals_int (gst_pad_push (srcpad, buf), GST_FLOW_OK);
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_eos ()));
+
+  query = gst_query_new_custom (GST_QUERY_CUSTOM,
+      gst_structure_new_empty ("GstKeyframeIndex"));
+  fail_unless (gst_pad_peer_query (sinkpad, query));
+
+  s = gst_query_get_structure (query);
+  entries = gst_structure_get_value (s, "entries");
+  fail_unless (entries != NULL);
+  fail_unless_equals_int (gst_value_array_get_size (entries), 3);
+
+  for (i = 0; i < 3; i++) {
+    const GstStructure *entry;
+    guint64 offset;
+    guint gop_size;
+
+    entry = gst_value_get_structure (gst_value_array_get_value (entries, i));
+    fail_unless (gst_structure_get_uint64 (entry, "offset", &offset));
+    fail_unless (gst_structure_get_uint (entry, "gop-size", &gop_size));
+    fail_unless_equals_string (gst_structure_get_string (entry,
+            "frame-type"), "IDR");
+    fail_unless_equals_int (gop_size, 1);
+    if (i > 0)
+      fail_unless (offset > prev_offset);
+    prev_offset = offset;
+  }
+  gst_query_unref (query);
+
+  gst_element_set_state (h264parse, GST_STATE_NULL);
+  gst_check_drop_buffers ();
+  gst_pad_set_active (srcpad, FALSE);
+  gst_pad_set_active (sinkpad, FALSE);
+  gst_check_teardown_src_pad (h264parse);
+  gst_check_teardown_sink_pad (h264parse);
+  gst_check_teardown_element (h264parse);
+}
+
+GST_END_TEST;
+
+
 static Suite *
 h264parse_suite (void)
 {
@@ -259,6 +332,7 @@ h264parse_suite (void)
   tcase_add_test (tc_chain, test_parse_split);
   tcase_add_test (tc_chain, test_parse_skip_garbage);
   tcase_add_test (tc_chain, test_parse_detect_stream);
+  tcase_add_test (tc_chain, test_parse_keyframe_index);
 
   return s;
 }
@@ -0,0 +1,287 @@
+/* GStreamer
+ *
+ * unit test for the m3u8 playlist parser of hlsdemux
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "../../ext/hls/m3u8.c"
+#undef GST_CAT_DEFAULT
+
+#include <gst/check/gstcheck.h>
+
+GST_DEBUG_CATEGORY (fragmented_debug);
+
+#define PLAYLIST_URI "http://example.com/media.m3u8"
+
+static const gchar *vod_playlist =
+    "#EXTM3U\n"
+    "#EXT-X-TARGETDURATION:10\n"
+    "#EXTINF:10,\nfragment-0.ts\n"
+    "#EXTINF:10,\nfragment-1.ts\n"
+    "#EXTINF:5,\nfragment-2.ts\n"
+    "#EXTINF:10,\nfragment-3.ts\n" "#EXT-X-ENDLIST\n";
+
+/* Returns a live playlist of @n fragments from @first, the fragment with
+ * sequence number i lasting (i % 3 + 8) seconds */
+static gchar *
+live_playlist (guint first, guint n, const gchar * name)
+{
+  GString *playlist = g_string_new ("#EXTM3U\n#EXT-X-TARGETDURATION:10\n");
+  guint i;
+
+  g_string_append_printf (playlist, "#EXT-X-MEDIA-SEQUENCE:%u\n", first);
+  for (i = first; i < first + n; i++)
+    g_string_append_printf (playlist, "#EXTINF:%u,%s %u\n%s-%u.ts\n",
+        i % 3 + 8, name, i, name, i);
+
+  return g_string_free (playlist, FALSE);
+}
+
+static GstM3U8MediaFile *
+get_file (GstM3U8Client * client, guint index)
+{
+  fail_unless (index < client->current->files->len);
+  return g_ptr_array_index (client->current->files, index);
+}
+
+static void
+check_files (GstM3U8Client * client, guint first, guint n,
+    const gchar * name)
+{
+  GstClockTime start;
+  guint i;
+
+  fail_unless_equals_int (client->current->files->len, n);
+  start = get_file (client, 0)->start;
+  for (i = 0; i < n; i++) {
+    GstM3U8MediaFile *file = get_file (client, i);
+    gchar *uri = g_strdup_printf ("http://example.com/%s-%u.ts", name,
+        first + i);
+    gchar *title = g_strdup_printf ("%s %u", name, first + i);
+
+    fail_unless_equals_int (file->sequence, first + i);
+    fail_unless_equals_string (file->uri, uri);
+    fail_unless_equals_string (file->relative_uri,
+        strrchr (uri, '/') + 1);
+    fail_unless_equals_string (file->title, title);
+    fail_unless_equals_uint64 (file->duration,
+        ((first + i) % 3 + 8) * GST_SECOND);
+    fail_unless_equals_uint64 (file->start, start);
+    start += file->duration;
+
+    g_free (title);
+    g_free (uri);
+  }
+}
+
+GST_START_TEST (test_sliding_window)
+{
+  GstM3U8Client *client = gst_m3u8_client_new (PLAYLIST_URI);
+  GstM3U8MediaFile *file1, *file2;
+
+  fail_unless (gst_m3u8_client_update (client, live_playlist (0, 3, "a")));
+  check_files (client, 0, 3, "a");
+  fail_unless_equals_uint64 (get_file (client, 0)->start, 0);
+  file1 = get_file (client, 1);
+  file2 = get_file (client, 2);
+
+  /* the fragments still in the window are kept, with their start */
+  fail_unless (gst_m3u8_client_update (client, live_playlist (1, 4, "a")));
+  check_files (client, 1, 4, "a");
+  fail_unless (get_file (client, 0) == file1);
+  fail_unless (get_file (client, 1) == file2);
+  fail_unless_equals_uint64 (file1->start, 8 * GST_SECOND);
+
+  /* even when the window jumped past some fragments */
+  fail_unless (gst_m3u8_client_update (client, live_playlist (4, 2, "a")));
+  check_files (client, 4, 2, "a");
+
+  /* and new fragments are parsed again once the window moved past them */
+  fail_unless (gst_m3u8_client_update (client, live_playlist (10, 2, "a")));
+  check_files (client, 10, 2, "a");
+
+  gst_m3u8_client_free (client);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_restarted_sequence)
+{
+  GstM3U8Client *client = gst_m3u8_client_new (PLAYLIST_URI);
+  GstM3U8MediaFile *file1;
+
+  fail_unless (gst_m3u8_client_update (client, live_playlist (0, 3, "a")));
+
+  /* the same sequence numbers with other URIs are other fragments */
+  fail_unless (gst_m3u8_client_update (client, live_playlist (1, 3, "b")));
+  check_files (client, 1, 3, "b");
+
+  /* the sequence numbers went back */
+  fail_unless (gst_m3u8_client_update (client, live_playlist (0, 3, "a")));
+  check_files (client, 0, 3, "a");
+  fail_unless_equals_uint64 (get_file (client, 0)->start, 0);
+  file1 = get_file (client, 1);
+
+  /* the URIs only changed from the middle of the window on */
+  fail_unless (gst_m3u8_client_update (client,
+          g_strdup ("#EXTM3U\n#EXT-X-TARGETDURATION:10\n"
+              "#EXT-X-MEDIA-SEQUENCE:1\n#EXTINF:9,a 1\na-1.ts\n"
+              "#EXTINF:10,b 2\nb-2.ts\n")));
+  fail_unless_equals_int (client->current->files->len, 2);
+  fail_unless (get_file (client, 0) == file1);
+  fail_unless_equals_string (get_file (client, 1)->uri,
+      "http://example.com/b-2.ts");
+  fail_unless_equals_string (get_file (client, 1)->title, "b 2");
+  fail_unless_equals_uint64 (get_file (client, 1)->start,
+      get_file (client, 0)->start + 9 * GST_SECOND);
+
+  gst_m3u8_client_free (client);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_position)
+{
+  GstM3U8Client *client = gst_m3u8_client_new (PLAYLIST_URI);
+  GstClockTime position, duration;
+  const gchar *uri, *key;
+  const guint8 *iv;
+  gboolean discont, unsupported_key;
+
+  fail_unless (gst_m3u8_client_update (client, live_playlist (0, 3, "a")));
+  gst_m3u8_client_get_current_position (client, &position);
+  fail_unless_equals_uint64 (position, 0);
+  fail_unless (gst_m3u8_client_get_next_fragment (client, &discont, &uri,
+          &duration, &position, &key, &iv, &unsupported_key));
+  fail_unless_equals_string (uri, "http://example.com/a-0.ts");
+  fail_unless_equals_uint64 (position, 0);
+  fail_unless (gst_m3u8_client_get_next_fragment (client, &discont, &uri,
+          &duration, &position, &key, &iv, &unsupported_key));
+  fail_unless_equals_uint64 (position, 8 * GST_SECOND);
+
+  /* the position is relative to the start of the window */
+  fail_unless (gst_m3u8_client_update (client, live_playlist (1, 3, "a")));
+  gst_m3u8_client_get_current_position (client, &position);
+  fail_unless_equals_uint64 (position, 9 * GST_SECOND);
+
+  /* the window moved past the next fragment, start from its beginning */
+  fail_unless (gst_m3u8_client_update (client, live_playlist (5, 3, "a")));
+  fail_unless (gst_m3u8_client_get_next_fragment (client, &discont, &uri,
+          &duration, &position, &key, &iv, &unsupported_key));
+  fail_unless_equals_string (uri, "http://example.com/a-5.ts");
+  fail_unless (discont);
+  fail_unless_equals_uint64 (position, 0);
+
+  /* the end of the window */
+  fail_unless (gst_m3u8_client_get_next_fragment (client, &discont, &uri,
+          &duration, &position, &key, &iv, &unsupported_key));
+  fail_unless (gst_m3u8_client_get_next_fragment (client, &discont, &uri,
+          &duration, &position, &key, &iv, &unsupported_key));
+  fail_if (gst_m3u8_client_has_next_fragment (client));
+  gst_m3u8_client_get_current_position (client, &position);
+  fail_unless_equals_uint64 (position, 27 * GST_SECOND);
+
+  gst_m3u8_client_free (client);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_duration)
+{
+  GstM3U8Client *client = gst_m3u8_client_new (PLAYLIST_URI);
+
+  fail_unless (gst_m3u8_client_update (client, g_strdup (vod_playlist)));
+  fail_unless_equals_uint64 (gst_m3u8_client_get_duration (client),
+      35 * GST_SECOND);
+  gst_m3u8_client_free (client);
+
+  /* live playlists have no duration */
+  client = gst_m3u8_client_new (PLAYLIST_URI);
+  fail_unless (gst_m3u8_client_update (client, live_playlist (0, 3, "a")));
+  fail_unless_equals_uint64 (gst_m3u8_client_get_duration (client),
+      GST_CLOCK_TIME_NONE);
+  gst_m3u8_client_free (client);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_sequence_at_position)
+{
+  GstM3U8Client *client = gst_m3u8_client_new (PLAYLIST_URI);
+  gint sequence;
+
+  fail_unless (gst_m3u8_client_update (client, g_strdup (vod_playlist)));
+
+  fail_unless (gst_m3u8_client_get_sequence_at_position (client, 0,
+          &sequence));
+  fail_unless_equals_int (sequence, 0);
+  fail_unless (gst_m3u8_client_get_sequence_at_position (client,
+          10 * GST_SECOND - 1, &sequence));
+  fail_unless_equals_int (sequence, 0);
+  fail_unless (gst_m3u8_client_get_sequence_at_position (client,
+          10 * GST_SECOND, &sequence));
+  fail_unless_equals_int (sequence, 1);
+  fail_unless (gst_m3u8_client_get_sequence_at_position (client,
+          22 * GST_SECOND, &sequence));
+  fail_unless_equals_int (sequence, 2);
+  fail_unless (gst_m3u8_client_get_sequence_at_position (client,
+          25 * GST_SECOND, &sequence));
+  fail_unless_equals_int (sequence, 3);
+  fail_unless (gst_m3u8_client_get_sequence_at_position (client,
+          35 * GST_SECOND - 1, &sequence));
+  fail_unless_equals_int (sequence, 3);
+  fail_if (gst_m3u8_client_get_sequence_at_position (client,
+          35 * GST_SECOND, &sequence));
+  gst_m3u8_client_free (client);
+
+  /* positions are relative to the start of the window */
+  client = gst_m3u8_client_new (PLAYLIST_URI);
+  fail_unless (gst_m3u8_client_update (client, live_playlist (0, 3, "a")));
+  fail_unless (gst_m3u8_client_update (client, live_playlist (2, 3, "a")));
+  fail_unless (gst_m3u8_client_get_sequence_at_position (client, 0,
+          &sequence));
+  fail_unless_equals_int (sequence, 2);
+  fail_unless (gst_m3u8_client_get_sequence_at_position (client,
+          10 * GST_SECOND, &sequence));
+  fail_unless_equals_int (sequence, 3);
+  fail_if (gst_m3u8_client_get_sequence_at_position (client,
+          27 * GST_SECOND, &sequence));
+  gst_m3u8_client_free (client);
+}
+
+GST_END_TEST;
+
+static Suite *
+hls_m3u8_suite (void)
+{
+  Suite *s = suite_create ("hls_m3u8");
+  TCase *tc_chain = tcase_create ("general");
+
+  GST_DEBUG_CATEGORY_INIT (fragmented_debug, "fragmented", 0, "fragmented");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_sliding_window);
+  tcase_add_test (tc_chain, test_restarted_sequence);
+  tcase_add_test (tc_chain, test_position);
+  tcase_add_test (tc_chain, test_duration);
+  tcase_add_test (tc_chain, test_sequence_at_position);
+
+  return s;
+}
+
+GST_CHECK_MAIN (hls_m3u8);
@@ -0,0 +1,428 @@
+/* GStreamer
+ *
+ * unit test for hlsdemux
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "../../ext/hls/m3u8.c"
+#undef GST_CAT_DEFAULT
+#include "../../ext/hls/gsthlsdemux.c"
+#undef GST_CAT_DEFAULT
+
+#include <gst/check/gstcheck.h>
+
+GST_DEBUG_CATEGORY (fragmented_debug);
+
+/* one variant of 800 kbps: with a target duration of 10 s, its fragments
+ * are estimated to 1000000 bytes */
+#define FRAGMENT_SIZE_ESTIMATE 1000000
+
+static const gchar *variant_playlist =
+    "#EXTM3U\n"
+    "#EXT-X-STREAM-INF:PROGRAM-ID=1,BANDWIDTH=800000\n" "media.m3u8\n";
+
+static const gchar *vod_playlist =
+    "#EXTM3U\n"
+    "#EXT-X-TARGETDURATION:10\n"
+    "#EXTINF:10,\nfragment-0.ts\n"
+    "#EXTINF:10,\nfragment-1.ts\n"
+    "#EXTINF:10,\nfragment-2.ts\n"
+    "#EXTINF:10,\nfragment-3.ts\n"
+    "#EXTINF:10,\nfragment-4.ts\n" "#EXT-X-ENDLIST\n";
+
+static const gchar *live_playlist =
+    "#EXTM3U\n"
+    "#EXT-X-TARGETDURATION:10\n"
+    "#EXT-X-MEDIA-SEQUENCE:0\n"
+    "#EXTINF:10,\nfragment-0.ts\n" "#EXTINF:10,\nfragment-1.ts\n";
+
+static GstHLSDemux *
+setup_demux (const gchar * media_playlist)
+{
+  GstHLSDemux *demux = g_object_new (GST_TYPE_HLS_DEMUX, NULL);
+
+  gst_hls_demux_set_location (demux, "http://example.com/main.m3u8");
+  fail_unless (gst_m3u8_client_update (demux->client,
+          g_strdup (variant_playlist)));
+  fail_unless (gst_m3u8_client_update (demux->client,
+          g_strdup (media_playlist)));
+
+  return demux;
+}
+
+static void
+queue_fragment (GstHLSDemux * demux, guint64 size)
+{
+  GstFragment *fragment = gst_fragment_new ();
+
+  fragment->size = size;
+  g_mutex_lock (&demux->queue_lock);
+  g_queue_push_tail (demux->queue, fragment);
+  demux->queued_bytes += size;
+  g_mutex_unlock (&demux->queue_lock);
+}
+
+GST_START_TEST (test_prefetch_fragments_cache)
+{
+  GstHLSDemux *demux = setup_demux (vod_playlist);
+
+  /* without a byte budget, up to fragments-cache fragments are queued */
+  g_object_set (demux, "fragments-cache", 3, "max-buffering-bytes", 0, NULL);
+  fail_unless (gst_hls_demux_need_prefetch (demux));
+  queue_fragment (demux, FRAGMENT_SIZE_ESTIMATE);
+  queue_fragment (demux, FRAGMENT_SIZE_ESTIMATE);
+  fail_unless (gst_hls_demux_need_prefetch (demux));
+  queue_fragment (demux, FRAGMENT_SIZE_ESTIMATE);
+  fail_if (gst_hls_demux_need_prefetch (demux));
+
+  /* and nothing once the whole playlist was downloaded */
+  gst_hls_demux_clear_queue (demux);
+  fail_unless_equals_uint64 (demux->queued_bytes, 0);
+  fail_unless (gst_hls_demux_need_prefetch (demux));
+  demux->end_of_playlist = TRUE;
+  fail_if (gst_hls_demux_need_prefetch (demux));
+
+  gst_object_unref (demux);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_prefetch_max_buffering_bytes)
+{
+  GstHLSDemux *demux = setup_demux (vod_playlist);
+
+  /* the next fragment must fit in the budget next to the queued ones */
+  g_object_set (demux, "fragments-cache", 10, "max-buffering-bytes",
+      5 * FRAGMENT_SIZE_ESTIMATE / 2, NULL);
+  fail_unless (gst_hls_demux_need_prefetch (demux));
+  queue_fragment (demux, FRAGMENT_SIZE_ESTIMATE);
+  fail_unless (gst_hls_demux_need_prefetch (demux));
+  queue_fragment (demux, FRAGMENT_SIZE_ESTIMATE);
+  fail_if (gst_hls_demux_need_prefetch (demux));
+
+  /* the actual size of the queued fragments counts */
+  gst_hls_demux_clear_queue (demux);
+  queue_fragment (demux, FRAGMENT_SIZE_ESTIMATE * 3 / 4);
+  queue_fragment (demux, FRAGMENT_SIZE_ESTIMATE * 3 / 4);
+  fail_unless (gst_hls_demux_need_prefetch (demux));
+  queue_fragment (demux, 1);
+  fail_if (gst_hls_demux_need_prefetch (demux));
+
+  /* a budget smaller than a fragment still lets one be downloaded */
+  g_object_set (demux, "max-buffering-bytes", 1000, NULL);
+  gst_hls_demux_clear_queue (demux);
+  fail_unless (gst_hls_demux_need_prefetch (demux));
+  queue_fragment (demux, FRAGMENT_SIZE_ESTIMATE);
+  fail_if (gst_hls_demux_need_prefetch (demux));
+
+  gst_object_unref (demux);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_prefetch_live)
+{
+  GstHLSDemux *demux = setup_demux (live_playlist);
+
+  /* a live playlist waits for the next update once all of its fragments
+   * were downloaded, even with room in the queue */
+  fail_unless (gst_hls_demux_need_prefetch (demux));
+  demux->client->sequence = 2;
+  fail_if (gst_hls_demux_need_prefetch (demux));
+
+  gst_object_unref (demux);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_iv_from_string)
+{
+  guint8 iv[16], expected[16];
+  guint i;
+
+  for (i = 0; i < 16; i++)
+    expected[i] = i * 0x11;
+
+  fail_unless (iv_from_string ("0x00112233445566778899aabbccddeeff", iv));
+  fail_unless (memcmp (iv, expected, 16) == 0);
+  memset (iv, 0, 16);
+  fail_unless (iv_from_string ("0X00112233445566778899AABBCCDDEEFF", iv));
+  fail_unless (memcmp (iv, expected, 16) == 0);
+  memset (iv, 0, 16);
+  fail_unless (iv_from_string ("00112233445566778899aabbccddeeff", iv));
+  fail_unless (memcmp (iv, expected, 16) == 0);
+
+  /* 128 bits, no more, no less, and only hexadecimal digits */
+  fail_if (iv_from_string ("0x00112233445566778899aabbccddeef", iv));
+  fail_if (iv_from_string ("0x00112233445566778899aabbccddeeff00", iv));
+  fail_if (iv_from_string ("0x00112233445566778899aabbccddeefg", iv));
+  fail_if (iv_from_string ("", iv));
+}
+
+GST_END_TEST;
+
+static const gchar *encrypted_playlist =
+    "#EXTM3U\n"
+    "#EXT-X-TARGETDURATION:10\n"
+    "#EXT-X-MEDIA-SEQUENCE:7\n"
+    "#EXT-X-KEY:METHOD=AES-128,URI=\"key-0.bin\"\n"
+    "#EXTINF:10,\nfragment-7.ts\n"
+    "#EXT-X-KEY:METHOD=AES-128,URI=\"key-1.bin\","
+    "IV=0x00112233445566778899aabbccddeeff\n"
+    "#EXTINF:10,\nfragment-8.ts\n"
+    "#EXT-X-KEY:METHOD=NONE\n"
+    "#EXTINF:10,\nfragment-9.ts\n"
+    "#EXT-X-KEY:METHOD=SAMPLE-AES,URI=\"key-2.bin\"\n"
+    "#EXTINF:10,\nfragment-10.ts\n" "#EXT-X-ENDLIST\n";
+
+typedef struct
+{
+  const gchar *uri;
+  const gchar *key;
+  guint8 iv[16];
+  gboolean unsupported_key;
+} ExpectedFragment;
+
+GST_START_TEST (test_fragment_keys)
+{
+  GstM3U8Client *client = gst_m3u8_client_new ("http://example.com/a.m3u8");
+  ExpectedFragment expected[] = {
+    /* without an IV, the sequence number is used */
+    {"http://example.com/fragment-7.ts", "http://example.com/key-0.bin",
+        {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 7}, FALSE},
+    {"http://example.com/fragment-8.ts", "http://example.com/key-1.bin",
+          {0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa,
+            0xbb, 0xcc, 0xdd, 0xee, 0xff}, FALSE},
+    {"http://example.com/fragment-9.ts", NULL, {0,}, FALSE},
+    /* not decryptable, and not clear either */
+    {"http://example.com/fragment-10.ts", NULL, {0,}, TRUE},
+  };
+  GstClockTime duration, timestamp;
+  const gchar *uri, *key;
+  const guint8 *iv;
+  gboolean discont, unsupported_key;
+  guint i;
+
+  fail_unless (gst_m3u8_client_update (client, g_strdup (encrypted_playlist)));
+
+  for (i = 0; i < G_N_ELEMENTS (expected); i++) {
+    fail_unless (gst_m3u8_client_get_next_fragment (client, &discont, &uri,
+            &duration, &timestamp, &key, &iv, &unsupported_key));
+    fail_unless_equals_string (uri, expected[i].uri);
+    fail_unless_equals_string (key, expected[i].key);
+    if (key)
+      fail_unless (memcmp (iv, expected[i].iv, 16) == 0,
+          "wrong IV for %s", uri);
+    fail_unless_equals_int (unsupported_key, expected[i].unsupported_key);
+  }
+
+  gst_m3u8_client_free (client);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_unsupported_key)
+{
+  GstHLSDemux *demux = setup_demux (encrypted_playlist);
+
+  /* the fragment fails without anything being downloaded */
+  demux->client->sequence = 10;
+  fail_if (gst_hls_demux_get_next_fragment (demux, TRUE));
+  fail_if (demux->end_of_playlist);
+  fail_unless (g_queue_is_empty (demux->queue));
+  fail_unless_equals_int (demux->client->sequence, 11);
+
+  gst_object_unref (demux);
+}
+
+GST_END_TEST;
+
+static const guint8 aes_key[16] = "0123456789abcdef";
+static const guint8 aes_iv[16] = "fedcba9876543210";
+
+static void
+decryptor_init (GstHLSDemuxDecryptor * decryptor)
+{
+  gnutls_datum_t key_d = { (unsigned char *) aes_key, 16 };
+  gnutls_datum_t iv_d = { (unsigned char *) aes_iv, 16 };
+
+  memset (decryptor, 0, sizeof (GstHLSDemuxDecryptor));
+  fail_unless (gnutls_cipher_init (&decryptor->aes_ctx,
+          gnutls_cipher_get_id ("AES-128-CBC"), &key_d, &iv_d) == 0);
+  decryptor->adapter = gst_adapter_new ();
+}
+
+static void
+decryptor_clear (GstHLSDemuxDecryptor * decryptor)
+{
+  if (decryptor->decrypted)
+    gst_buffer_unref (decryptor->decrypted);
+  g_object_unref (decryptor->adapter);
+  gnutls_cipher_deinit (decryptor->aes_ctx);
+}
+
+static void
+encrypt (guint8 * data, gsize size)
+{
+  gnutls_datum_t key_d = { (unsigned char *) aes_key, 16 };
+  gnutls_datum_t iv_d = { (unsigned char *) aes_iv, 16 };
+  gnutls_cipher_hd_t aes_ctx;
+
+  fail_unless (gnutls_cipher_init (&aes_ctx,
+          gnutls_cipher_get_id ("AES-128-CBC"), &key_d, &iv_d) == 0);
+  fail_unless (gnutls_cipher_encrypt (aes_ctx, data, size) == 0);
+  gnutls_cipher_deinit (aes_ctx);
+}
+
+/* Returns @size bytes of data padded with PKCS7 and encrypted */
+static guint8 *
+encrypt_data (gsize size, gsize * encrypted_size)
+{
+  guint8 padding = AES_BLOCK_SIZE - size % AES_BLOCK_SIZE;
+  guint8 *data;
+  gsize i;
+
+  *encrypted_size = size + padding;
+  data = g_malloc (*encrypted_size);
+  for (i = 0; i < size; i++)
+    data[i] = i % 251;
+  memset (data + size, padding, padding);
+  encrypt (data, *encrypted_size);
+
+  return data;
+}
+
+/* Feeds @size bytes of encrypted data to a decryptor in chunks of
+ * @chunk_size and checks the decrypted data */
+static void
+check_decrypt (gsize size, gsize chunk_size)
+{
+  GstHLSDemuxDecryptor decryptor;
+  gsize encrypted_size, offset;
+  guint8 *encrypted;
+  GstMapInfo map;
+  gsize i;
+
+  decryptor_init (&decryptor);
+  encrypted = encrypt_data (size, &encrypted_size);
+
+  for (offset = 0; offset < encrypted_size; offset += chunk_size) {
+    gsize n = MIN (chunk_size, encrypted_size - offset);
+
+    fail_unless_equals_int (gst_hls_demux_decrypt_chunk (NULL,
+            gst_buffer_new_wrapped (g_memdup (encrypted + offset, n), n),
+            &decryptor), GST_FLOW_OK);
+    /* the last block is held back, even when the chunks end on a block
+     * boundary, as it carries the padding */
+    fail_unless (gst_adapter_available (decryptor.adapter) > 0);
+    if ((offset + n) % AES_BLOCK_SIZE == 0)
+      fail_unless (gst_adapter_available (decryptor.adapter) >=
+          AES_BLOCK_SIZE);
+  }
+  fail_unless (gst_hls_demux_decryptor_finish (&decryptor));
+
+  fail_unless (decryptor.decrypted != NULL);
+  fail_unless_equals_int (gst_buffer_get_size (decryptor.decrypted), size);
+  gst_buffer_map (decryptor.decrypted, &map, GST_MAP_READ);
+  for (i = 0; i < size; i++) {
+    if (map.data[i] != i % 251)
+      break;
+  }
+  fail_unless_equals_int (i, size);
+  gst_buffer_unmap (decryptor.decrypted, &map);
+
+  g_free (encrypted);
+  decryptor_clear (&decryptor);
+}
+
+GST_START_TEST (test_decrypt)
+{
+  /* a whole block of padding, the chunks ending on block boundaries */
+  check_decrypt (8 * DECRYPT_CHUNK_SIZE, DECRYPT_CHUNK_SIZE);
+  check_decrypt (8 * DECRYPT_CHUNK_SIZE, DECRYPT_CHUNK_SIZE + AES_BLOCK_SIZE);
+  /* partial padding, chunks splitting blocks */
+  check_decrypt (3 * DECRYPT_CHUNK_SIZE + 5, 1000);
+  check_decrypt (3 * DECRYPT_CHUNK_SIZE + 5, DECRYPT_CHUNK_SIZE - 1);
+  /* less than a block of data */
+  check_decrypt (0, 1000);
+  check_decrypt (7, 1000);
+}
+
+GST_END_TEST;
+
+static gboolean
+decrypt (const guint8 * data, gsize size)
+{
+  GstHLSDemuxDecryptor decryptor;
+  gboolean ret;
+
+  decryptor_init (&decryptor);
+  fail_unless_equals_int (gst_hls_demux_decrypt_chunk (NULL,
+          gst_buffer_new_wrapped (g_memdup (data, size), size), &decryptor),
+      GST_FLOW_OK);
+  ret = gst_hls_demux_decryptor_finish (&decryptor);
+  decryptor_clear (&decryptor);
+
+  return ret;
+}
+
+GST_START_TEST (test_decrypt_errors)
+{
+  guint8 data[2 * AES_BLOCK_SIZE];
+  gsize encrypted_size;
+  guint8 *encrypted;
+
+  /* truncated data */
+  encrypted = encrypt_data (100, &encrypted_size);
+  fail_unless (decrypt (encrypted, encrypted_size));
+  fail_if (decrypt (encrypted, encrypted_size - 1));
+  g_free (encrypted);
+
+  /* padding bytes out of the 1..16 range */
+  memset (data, AES_BLOCK_SIZE + 1, sizeof (data));
+  encrypt (data, sizeof (data));
+  fail_if (decrypt (data, sizeof (data)));
+  memset (data, 0, sizeof (data));
+  encrypt (data, sizeof (data));
+  fail_if (decrypt (data, sizeof (data)));
+}
+
+GST_END_TEST;
+
+static Suite *
+hlsdemux_suite (void)
+{
+  Suite *s = suite_create ("hlsdemux");
+  TCase *tc_chain = tcase_create ("general");
+
+  GST_DEBUG_CATEGORY_INIT (fragmented_debug, "fragmented", 0, "fragmented");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_prefetch_fragments_cache);
+  tcase_add_test (tc_chain, test_prefetch_max_buffering_bytes);
+  tcase_add_test (tc_chain, test_prefetch_live);
+  tcase_add_test (tc_chain, test_iv_from_string);
+  tcase_add_test (tc_chain, test_fragment_keys);
+  tcase_add_test (tc_chain, test_unsupported_key);
+  tcase_add_test (tc_chain, test_decrypt);
+  tcase_add_test (tc_chain, test_decrypt_errors);
+
+  return s;
+}
+
+GST_CHECK_MAIN (hlsdemux);
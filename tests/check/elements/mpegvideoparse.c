@@ -24,6 +24,8 @@
  */
 
 #include <gst/check/gstcheck.h>
+#include <glib/gstdio.h>
+#include <unistd.h>
 #include "parser.h"
 
 #define SRC_CAPS_TMPL   "video/mpeg, mpegversion=(int)2, systemstream=(boolean)false, parsed=(boolean)false"
@@ -224,6 +226,118 @@ GST_START_TEST (test_parse_gop_split)
 GST_END_TEST;
 
 
+static GstPad *index_srcpad, *index_sinkpad;
+
+static GstElement *
+setup_index_element (const gchar * location)
+{
+  GstElement *mpvparse;
+  GstCaps *caps;
+
+  mpvparse = gst_check_setup_element ("mpegvideoparse");
+  g_object_set (mpvparse, "index-location", location, NULL);
+  index_srcpad = gst_check_setup_src_pad (mpvparse, &srctemplate);
+  index_sinkpad = gst_check_setup_sink_pad (mpvparse, &sinktemplate);
+  gst_pad_set_active (index_srcpad, TRUE);
+  caps = gst_caps_from_string (SRC_CAPS_TMPL);
+  gst_check_setup_events (index_srcpad, mpvparse, caps, GST_FORMAT_BYTES);
+  gst_caps_unref (caps);
+  gst_pad_set_active (index_sinkpad, TRUE);
+  fail_unless (gst_element_set_state (mpvparse,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+
+  return mpvparse;
+}
+
+static void
+cleanup_index_element (GstElement * mpvparse)
+{
+  gst_element_set_state (mpvparse, GST_STATE_NULL);
+  gst_check_drop_buffers ();
+  gst_pad_set_active (index_srcpad, FALSE);
+  gst_pad_set_active (index_sinkpad, FALSE);
+  gst_check_teardown_src_pad (mpvparse);
+  gst_check_teardown_sink_pad (mpvparse);
+  gst_check_teardown_element (mpvparse);
+}
+
+static void
+check_keyframe_index (guint n_keyframes)
+{
+  GstQuery *query;
+  const GstStructure *s;
+  const GValue *entries;
+  guint64 prev_offset = 0;
+  guint i;
+
+  query = gst_query_new_custom (GST_QUERY_CUSTOM,
+      gst_structure_new_empty ("GstKeyframeIndex"));
+  fail_unless (gst_pad_peer_query (index_sinkpad, query));
+
+  s = gst_query_get_structure (query);
+  entries = gst_structure_get_value (s, "entries");
+  fail_unless (entries != NULL);
+  fail_unless_equals_int (gst_value_array_get_size (entries), n_keyframes);
+
+  for (i = 0; i < n_keyframes; i++) {
+    const GstStructure *entry;
+    guint64 offset;
+
+    entry = gst_value_get_structure (gst_value_array_get_value (entries, i));
+    fail_unless (gst_structure_get_uint64 (entry, "offset", &offset));
+    fail_unless_equals_string (gst_structure_get_string (entry,
+            "frame-type"), "I");
+    if (i > 0)
+      fail_unless (offset > prev_offset);
+    prev_offset = offset;
+  }
+  gst_query_unref (query);
+}
+
+GST_START_TEST (test_parse_keyframe_index)
+{
+  GstElement *mpvparse;
+  GstBuffer *buf;
+  gchar *location;
+  gsize size;
+  gint fd;
+  guint i;
+
+  fd = g_file_open_tmp ("mpegvideoparse-index-XXXXXX", &location, NULL);
+  fail_unless (fd >= 0);
+  close (fd);
+  g_unlink (location);
+
+  mpvparse = setup_index_element (location);
+
+  /* sequence header followed by three I frames */
+  size = sizeof (mpeg2_seq) + 3 * sizeof (mpeg2_iframe);
+  buf = gst_buffer_new_and_alloc (size);
+  gst_buffer_fill (buf, 0, mpeg2_seq, sizeof (mpeg2_seq));
+  for (i = 0; i < 3; i++)
+    gst_buffer_fill (buf, sizeof (mpeg2_seq) + i * sizeof (mpeg2_iframe),
+        mpeg2_iframe, sizeof (mpeg2_iframe));
+  fail_unless_equals_int (gst_pad_push (index_srcpad, buf), GST_FLOW_OK);
+  fail_unless (gst_pad_push_event (index_srcpad, gst_event_new_eos ()));
+
+  check_keyframe_index (3);
+
+  /* stopping stores the index in the sidecar file */
+  cleanup_index_element (mpvparse);
+  fail_unless (g_file_test (location, G_FILE_TEST_EXISTS));
+
+  /* which is loaded again on start, before any data arrived */
+  mpvparse = setup_index_element (location);
+  check_keyframe_index (3);
+  cleanup_index_element (mpvparse);
+
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+
 static Suite *
 mpegvideoparse_suite (void)
 {
@@ -237,6 +351,7 @@ mpegvideoparse_suite (void)
   tcase_add_test (tc_chain, test_parse_detect_stream_mpeg1);
   tcase_add_test (tc_chain, test_parse_detect_stream_mpeg2);
   tcase_add_test (tc_chain, test_parse_gop_split);
+  tcase_add_test (tc_chain, test_parse_keyframe_index);
 
   return s;
 }
@@ -0,0 +1,239 @@
+/* GStreamer
+ *
+ * unit test for mssdemux
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <gst/check/gstcheck.h>
+#include "elements/testdlsrc.h"
+
+#define MANIFEST_URI "testdl://mss.example.com/stream.ism/Manifest"
+#define FRAGMENT_URI_FORMAT \
+    "testdl://mss.example.com/stream.ism/QualityLevels(128000)/" \
+    "Fragments(audio=%" G_GUINT64_FORMAT ")"
+#define N_FRAGMENTS 4
+#define FRAGMENT_DURATION 20000000      /* 2 s in the default timescale */
+#define FRAGMENT_SIZE (4 * TEST_DL_SRC_CHUNK_SIZE)
+
+static const gchar manifest[] =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+    "<SmoothStreamingMedia MajorVersion=\"2\" MinorVersion=\"0\" "
+    "Duration=\"80000000\">"
+    "<StreamIndex Type=\"audio\" Chunks=\"4\" QualityLevels=\"1\" "
+    "Url=\"QualityLevels({bitrate})/Fragments(audio={start time})\">"
+    "<QualityLevel Index=\"0\" Bitrate=\"128000\" FourCC=\"AACL\" "
+    "SamplingRate=\"44100\" Channels=\"2\" CodecPrivateData=\"1210\"/>"
+    "<c d=\"20000000\"/><c d=\"20000000\"/>"
+    "<c d=\"20000000\"/><c d=\"20000000\"/>"
+    "</StreamIndex>" "</SmoothStreamingMedia>";
+
+typedef struct
+{
+  GMutex lock;
+  GByteArray *data;
+  /* the first buffer is held back until this URI was requested twice, so
+   * the chunks of its first request are still queued when that fails */
+  const gchar *held_until_retry;
+} OutputLog;
+
+static gchar *
+fragment_uri (guint index)
+{
+  return g_strdup_printf (FRAGMENT_URI_FORMAT,
+      (guint64) index * FRAGMENT_DURATION);
+}
+
+static guint8 *
+fragment_data (guint index)
+{
+  guint8 *data = g_malloc (FRAGMENT_SIZE);
+  guint i;
+
+  for (i = 0; i < FRAGMENT_SIZE; i++)
+    data[i] = (index * 61 + i) & 0xff;
+
+  return data;
+}
+
+static void
+add_resources (void)
+{
+  guint i;
+
+  test_dl_src_reset ();
+  test_dl_src_add_resource (MANIFEST_URI, manifest, strlen (manifest));
+  for (i = 0; i < N_FRAGMENTS; i++) {
+    gchar *uri = fragment_uri (i);
+    guint8 *data = fragment_data (i);
+
+    test_dl_src_add_resource (uri, data, FRAGMENT_SIZE);
+    g_free (data);
+    g_free (uri);
+  }
+}
+
+static GstPadProbeReturn
+_output_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  OutputLog *log = user_data;
+  GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+  GstMapInfo map;
+
+  g_mutex_lock (&log->lock);
+  if (log->held_until_retry) {
+    fail_unless (test_dl_src_wait_requests (log->held_until_retry, 2));
+    log->held_until_retry = NULL;
+  }
+
+  gst_buffer_map (buffer, &map, GST_MAP_READ);
+  g_byte_array_append (log->data, map.data, map.size);
+  gst_buffer_unmap (buffer, &map);
+  g_mutex_unlock (&log->lock);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+_pad_added (GstElement * demux, GstPad * pad, gpointer user_data)
+{
+  GstElement *pipeline = GST_ELEMENT (gst_element_get_parent (demux));
+  GstElement *sink;
+  GstPad *sinkpad;
+
+  sink = gst_element_factory_make ("fakesink", NULL);
+  g_object_set (sink, "sync", FALSE, NULL);
+  gst_bin_add (GST_BIN (pipeline), sink);
+  gst_element_sync_state_with_parent (sink);
+
+  sinkpad = gst_element_get_static_pad (sink, "sink");
+  fail_unless_equals_int (gst_pad_link (pad, sinkpad), GST_PAD_LINK_OK);
+  gst_pad_add_probe (sinkpad, GST_PAD_PROBE_TYPE_BUFFER, _output_probe,
+      user_data, NULL);
+  gst_object_unref (sinkpad);
+  gst_object_unref (pipeline);
+}
+
+static void
+run_pipeline (OutputLog * log)
+{
+  GstElement *pipeline, *src, *demux;
+  GstMessage *msg;
+  GstBus *bus;
+
+  pipeline = gst_pipeline_new (NULL);
+  src = gst_element_make_from_uri (GST_URI_SRC, MANIFEST_URI, NULL, NULL);
+  fail_unless (src != NULL);
+  demux = gst_element_factory_make ("mssdemux", NULL);
+  fail_unless (demux != NULL);
+  gst_bin_add_many (GST_BIN (pipeline), src, demux, NULL);
+  fail_unless (gst_element_link (src, demux));
+  g_signal_connect (demux, "pad-added", G_CALLBACK (_pad_added), log);
+
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, 10 * GST_SECOND,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless (msg != NULL);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+}
+
+static void
+check_output (OutputLog * log)
+{
+  guint i;
+
+  fail_unless_equals_int (log->data->len, N_FRAGMENTS * FRAGMENT_SIZE);
+  for (i = 0; i < N_FRAGMENTS; i++) {
+    guint8 *data = fragment_data (i);
+
+    fail_unless (memcmp (log->data->data + i * FRAGMENT_SIZE, data,
+            FRAGMENT_SIZE) == 0, "fragment %u differs", i);
+    g_free (data);
+  }
+}
+
+GST_START_TEST (test_streaming)
+{
+  OutputLog log = { {0}, };
+
+  add_resources ();
+  g_mutex_init (&log.lock);
+  log.data = g_byte_array_new ();
+
+  run_pipeline (&log);
+
+  check_output (&log);
+
+  g_byte_array_unref (log.data);
+  g_mutex_clear (&log.lock);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_streaming_retry)
+{
+  OutputLog log = { {0}, };
+  gchar *uri;
+
+  add_resources ();
+  g_mutex_init (&log.lock);
+  log.data = g_byte_array_new ();
+
+  /* the first download of the second fragment fails halfway, the chunks it
+   * got must not be output before those of the retry */
+  uri = fragment_uri (1);
+  test_dl_src_add_failure (uri, FRAGMENT_SIZE / 2);
+  log.held_until_retry = uri;
+
+  run_pipeline (&log);
+
+  fail_unless_equals_int (test_dl_src_get_requests (uri), 2);
+  check_output (&log);
+
+  g_free (uri);
+  g_byte_array_unref (log.data);
+  g_mutex_clear (&log.lock);
+}
+
+GST_END_TEST;
+
+static Suite *
+mssdemux_suite (void)
+{
+  Suite *s = suite_create ("mssdemux");
+  TCase *tc_chain = tcase_create ("general");
+
+  test_dl_src_register ();
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_streaming);
+  tcase_add_test (tc_chain, test_streaming_retry);
+
+  return s;
+}
+
+GST_CHECK_MAIN (mssdemux);
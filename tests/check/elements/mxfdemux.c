@@ -21,13 +21,16 @@
  */
 
 #include <gst/check/gstcheck.h>
+#include <glib/gstdio.h>
 #include <string.h>
+#include <unistd.h>
 #include "mxfdemux.h"
 
 static GstPad *mysrcpad, *mysinkpad;
 static GMainLoop *loop = NULL;
 static gboolean have_eos = FALSE;
 static gboolean have_data = FALSE;
+static gboolean pull_mode = FALSE;
 
 static GstStaticPadTemplate mysrctemplate =
 GST_STATIC_PAD_TEMPLATE ("src", GST_PAD_SRC, GST_PAD_ALWAYS,
@@ -69,6 +72,16 @@ _sink_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
   fail_unless (gst_buffer_memcmp (buffer, 0, mxf_essence,
           sizeof (mxf_essence)) == 0);
 
+  /* In pull mode the essence must not keep the data pulled from
+   * upstream alive */
+  if (pull_mode) {
+    GstMapInfo map;
+
+    gst_buffer_map (buffer, &map, GST_MAP_READ);
+    fail_if (map.data >= mxf_file && map.data < mxf_file + sizeof (mxf_file));
+    gst_buffer_unmap (buffer, &map);
+  }
+
   fail_unless (GST_BUFFER_TIMESTAMP (buffer) == 0);
   fail_unless (GST_BUFFER_DURATION (buffer) == 200 * GST_MSECOND);
 
@@ -192,6 +205,7 @@ GST_START_TEST (test_pull)
 
   have_eos = FALSE;
   have_data = FALSE;
+  pull_mode = TRUE;
   loop = g_main_loop_new (NULL, FALSE);
 
   mxfdemux = gst_element_factory_make ("mxfdemux", NULL);
@@ -228,6 +242,7 @@ GST_START_TEST (test_pull)
   gst_object_unref (mysrcpad);
   g_main_loop_unref (loop);
   loop = NULL;
+  pull_mode = FALSE;
 }
 
 GST_END_TEST;
@@ -287,6 +302,542 @@ GST_START_TEST (test_push)
 
 GST_END_TEST;
 
+/* Runs @pipeline until EOS */
+static void
+run_pipeline (GstElement * pipeline)
+{
+  GstMessage *msg;
+  GstBus *bus;
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS);
+}
+
+static void
+set_location (GstElement * pipeline, const gchar * name,
+    const gchar * location)
+{
+  GstElement *element;
+
+  element = gst_bin_get_by_name (GST_BIN (pipeline), name);
+  fail_unless (element != NULL);
+  g_object_set (element, "location", location, NULL);
+  gst_object_unref (element);
+}
+
+/* Muxes @n_frames frames of raw video and @n_audio_tracks tracks of
+ * raw audio into a temporary file, with @mux_props set on mxfmux */
+static gchar *
+create_mxf_file (guint n_frames, guint n_audio_tracks, const gchar * mux_props)
+{
+  GstElement *pipeline;
+  GString *pipeline_str;
+  gchar *location;
+  gint fd;
+  guint i;
+
+  fd = g_file_open_tmp ("mxfdemux-XXXXXX.mxf", &location, NULL);
+  fail_unless (fd >= 0);
+  close (fd);
+
+  pipeline_str = g_string_new (NULL);
+  g_string_append_printf (pipeline_str, "videotestsrc num-buffers=%u ! "
+      "video/x-raw,format=(string)v308,width=160,height=120,framerate=25/1 ! "
+      "mxfmux name=mux %s ! filesink name=sink", n_frames, mux_props);
+  for (i = 0; i < n_audio_tracks; i++) {
+    g_string_append_printf (pipeline_str, " audiotestsrc num-buffers=%u "
+        "samplesperbuffer=1920 freq=%u ! audioconvert ! "
+        "audio/x-raw,rate=48000,channels=2 ! mux.", n_frames, 440 + 20 * i);
+  }
+  pipeline = gst_parse_launch (pipeline_str->str, NULL);
+  fail_unless (pipeline != NULL);
+  g_string_free (pipeline_str, TRUE);
+
+  set_location (pipeline, "sink", location);
+  run_pipeline (pipeline);
+  gst_object_unref (pipeline);
+
+  return location;
+}
+
+typedef struct
+{
+  GMutex lock;
+  GArray *offsets;
+  GArray *sizes;
+} PullLog;
+
+static GstPadProbeReturn
+_pull_log_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  PullLog *log = user_data;
+  guint64 offset = GST_PAD_PROBE_INFO_OFFSET (info);
+  guint size = GST_PAD_PROBE_INFO_SIZE (info);
+
+  g_mutex_lock (&log->lock);
+  g_array_append_val (log->offsets, offset);
+  g_array_append_val (log->sizes, size);
+  g_mutex_unlock (&log->lock);
+
+  return GST_PAD_PROBE_OK;
+}
+
+#define READ_AHEAD_SIZE (1024 * 1024)
+
+GST_START_TEST (test_pull_read_ahead)
+{
+  GstElement *pipeline;
+  GstElement *src;
+  GstPad *srcpad;
+  gchar *location;
+  PullLog log;
+  guint i, n_read_ahead = 0;
+
+  location = create_mxf_file (50, 1, "");
+
+  g_mutex_init (&log.lock);
+  log.offsets = g_array_new (FALSE, FALSE, sizeof (guint64));
+  log.sizes = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  pipeline = gst_parse_launch ("filesrc name=src ! "
+      "mxfdemux name=demux demux. ! fakesink sync=false "
+      "demux. ! fakesink sync=false", NULL);
+  fail_unless (pipeline != NULL);
+  set_location (pipeline, "src", location);
+
+  src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  srcpad = gst_element_get_static_pad (src, "src");
+  gst_pad_add_probe (srcpad, GST_PAD_PROBE_TYPE_PULL |
+      GST_PAD_PROBE_TYPE_BUFFER, _pull_log_probe, &log, NULL);
+  gst_object_unref (srcpad);
+  gst_object_unref (src);
+
+  run_pipeline (pipeline);
+  gst_object_unref (pipeline);
+
+  /* A read-ahead window is only filled for sequential reads, i.e. from
+   * the end of the previous upstream pull or from inside the previous
+   * window. The jumps to the random index pack at the end of the file
+   * and back are pulled directly */
+  for (i = 1; i < log.offsets->len; i++) {
+    guint64 offset = g_array_index (log.offsets, guint64, i);
+    guint64 prev_offset = g_array_index (log.offsets, guint64, i - 1);
+    guint prev_size = g_array_index (log.sizes, guint, i - 1);
+
+    if (g_array_index (log.sizes, guint, i) != READ_AHEAD_SIZE)
+      continue;
+
+    n_read_ahead++;
+    fail_unless (offset >= prev_offset && offset <= prev_offset + prev_size,
+        "read-ahead at %" G_GUINT64_FORMAT " after pull of %u bytes at %"
+        G_GUINT64_FORMAT, offset, prev_size, prev_offset);
+  }
+  fail_unless (n_read_ahead > 1);
+
+  g_array_free (log.offsets, TRUE);
+  g_array_free (log.sizes, TRUE);
+  g_mutex_clear (&log.lock);
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+typedef struct
+{
+  GMutex lock;
+  GstElement *pipeline;
+  GHashTable *n_buffers;
+  guint n_video, n_audio;
+  GstPad *video_pad;
+  GPtrArray *video_buffers;
+} TrackLog;
+
+static GstPadProbeReturn
+_track_log_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  TrackLog *log = user_data;
+  guint n;
+
+  g_mutex_lock (&log->lock);
+  n = GPOINTER_TO_UINT (g_hash_table_lookup (log->n_buffers, pad));
+  g_hash_table_insert (log->n_buffers, pad, GUINT_TO_POINTER (n + 1));
+  if (log->video_buffers && pad == log->video_pad)
+    g_ptr_array_add (log->video_buffers,
+        gst_buffer_ref (GST_PAD_PROBE_INFO_BUFFER (info)));
+  g_mutex_unlock (&log->lock);
+
+  return GST_PAD_PROBE_OK;
+}
+
+/* Only keeps the video buffers that were pushed after the last flush */
+static GstPadProbeReturn
+_track_log_flush_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  TrackLog *log = user_data;
+  GstEvent *event = GST_PAD_PROBE_INFO_EVENT (info);
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP) {
+    g_mutex_lock (&log->lock);
+    if (log->video_buffers && pad == log->video_pad)
+      g_ptr_array_set_size (log->video_buffers, 0);
+    g_mutex_unlock (&log->lock);
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+_track_pad_added (GstElement * element, GstPad * pad, gpointer user_data)
+{
+  TrackLog *log = user_data;
+  GstElement *sink;
+  GstPad *sinkpad;
+  GstCaps *caps;
+  const gchar *media_type;
+
+  caps = gst_pad_get_current_caps (pad);
+  fail_unless (caps != NULL);
+  media_type = gst_structure_get_name (gst_caps_get_structure (caps, 0));
+
+  g_mutex_lock (&log->lock);
+  if (strcmp (media_type, "video/x-raw") == 0) {
+    log->n_video++;
+    log->video_pad = pad;
+  }
+  else if (strcmp (media_type, "audio/x-raw") == 0)
+    log->n_audio++;
+  else
+    fail ("unexpected caps %" GST_PTR_FORMAT, caps);
+  g_hash_table_insert (log->n_buffers, pad, GUINT_TO_POINTER (0));
+  g_mutex_unlock (&log->lock);
+  gst_caps_unref (caps);
+
+  sink = gst_element_factory_make ("fakesink", NULL);
+  g_object_set (sink, "sync", FALSE, NULL);
+  gst_bin_add (GST_BIN (log->pipeline), sink);
+  sinkpad = gst_element_get_static_pad (sink, "sink");
+  fail_unless (gst_pad_link (pad, sinkpad) == GST_PAD_LINK_OK);
+  gst_object_unref (sinkpad);
+  gst_element_sync_state_with_parent (sink);
+
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, _track_log_probe, log,
+      NULL);
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_EVENT_FLUSH,
+      _track_log_flush_probe, log, NULL);
+}
+
+#define N_AUDIO_TRACKS 24
+
+/* Every track adds a track, sequence and source clip to both packages
+ * plus a descriptor, so the header metadata has more than enough local
+ * sets for mxfdemux to split the parsing over several threads */
+GST_START_TEST (test_pull_many_tracks)
+{
+  GstElement *demux;
+  GHashTableIter iter;
+  gpointer value;
+  gchar *location;
+  TrackLog log;
+
+  location = create_mxf_file (10, N_AUDIO_TRACKS, "");
+
+  g_mutex_init (&log.lock);
+  log.n_buffers = g_hash_table_new (NULL, NULL);
+  log.n_video = log.n_audio = 0;
+  log.video_pad = NULL;
+  log.video_buffers = NULL;
+
+  log.pipeline = gst_parse_launch ("filesrc name=src ! mxfdemux name=demux",
+      NULL);
+  fail_unless (log.pipeline != NULL);
+  set_location (log.pipeline, "src", location);
+
+  demux = gst_bin_get_by_name (GST_BIN (log.pipeline), "demux");
+  g_signal_connect (demux, "pad-added", G_CALLBACK (_track_pad_added), &log);
+  gst_object_unref (demux);
+
+  run_pipeline (log.pipeline);
+
+  fail_unless_equals_int (log.n_video, 1);
+  fail_unless_equals_int (log.n_audio, N_AUDIO_TRACKS);
+  fail_unless_equals_int (g_hash_table_size (log.n_buffers),
+      1 + N_AUDIO_TRACKS);
+  g_hash_table_iter_init (&iter, log.n_buffers);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    fail_unless (GPOINTER_TO_UINT (value) > 0);
+
+  gst_object_unref (log.pipeline);
+  g_hash_table_unref (log.n_buffers);
+  g_mutex_clear (&log.lock);
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+static guint
+track_log_get_video_buffers (TrackLog * log)
+{
+  guint n;
+
+  g_mutex_lock (&log->lock);
+  n = GPOINTER_TO_UINT (g_hash_table_lookup (log->n_buffers, log->video_pad));
+  g_mutex_unlock (&log->lock);
+
+  return n;
+}
+
+/* Writes the first half of a complete file, lets mxfdemux wait at its
+ * end, seeks back to the start and then appends the second half */
+GST_START_TEST (test_pull_follow)
+{
+  GstElement *demux;
+  GstMessage *msg;
+  GstBus *bus;
+  gchar *location, *data;
+  gsize size;
+  gint64 duration;
+  guint n_video_buffers;
+  FILE *file;
+  TrackLog log;
+
+  location = create_mxf_file (50, 1, "streamable=true");
+  fail_unless (g_file_get_contents (location, &data, &size, NULL));
+  fail_unless (g_file_set_contents (location, data, size / 2, NULL));
+
+  g_mutex_init (&log.lock);
+  log.n_buffers = g_hash_table_new (NULL, NULL);
+  log.n_video = log.n_audio = 0;
+  log.video_pad = NULL;
+  log.video_buffers = NULL;
+
+  log.pipeline = gst_parse_launch ("filesrc name=src ! "
+      "mxfdemux name=demux follow=true follow-timeout=0", NULL);
+  fail_unless (log.pipeline != NULL);
+  set_location (log.pipeline, "src", location);
+
+  demux = gst_bin_get_by_name (GST_BIN (log.pipeline), "demux");
+  g_signal_connect (demux, "pad-added", G_CALLBACK (_track_pad_added), &log);
+  gst_object_unref (demux);
+
+  bus = gst_element_get_bus (log.pipeline);
+  fail_unless (gst_element_set_state (log.pipeline,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+
+  /* Wait until the first half is played, the end of the file must not
+   * be the end of the stream */
+  msg = gst_bus_timed_pop_filtered (bus, GST_SECOND,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless (msg == NULL);
+  fail_unless_equals_int (log.n_video, 1);
+  n_video_buffers = track_log_get_video_buffers (&log);
+  fail_unless (n_video_buffers > 0 && n_video_buffers < 50);
+
+  /* Seeking must interrupt the wait */
+  fail_unless (gst_element_seek_simple (log.pipeline, GST_FORMAT_TIME,
+          GST_SEEK_FLAG_FLUSH, 0));
+  fail_unless (gst_element_get_state (log.pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE) == GST_STATE_CHANGE_SUCCESS);
+
+  file = g_fopen (location, "ab");
+  fail_unless (file != NULL);
+  fail_unless_equals_int (fwrite (data + size / 2, 1, size - size / 2, file),
+      size - size / 2);
+  fclose (file);
+
+  msg = gst_bus_timed_pop_filtered (bus, 30 * GST_SECOND,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless (msg != NULL);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+
+  fail_unless_equals_int (track_log_get_video_buffers (&log),
+      n_video_buffers + 50);
+
+  /* The footer completes the file, the duration comes from its final
+   * metadata again */
+  fail_unless (gst_element_query_duration (log.pipeline, GST_FORMAT_TIME,
+          &duration));
+  fail_unless_equals_uint64 (duration, 2 * GST_SECOND);
+
+  fail_unless (gst_element_set_state (log.pipeline,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS);
+  gst_object_unref (bus);
+  gst_object_unref (log.pipeline);
+  g_hash_table_unref (log.n_buffers);
+  g_mutex_clear (&log.lock);
+  g_free (data);
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+/* Demuxes @location, in push mode in blocks of @blocksize bytes, and
+ * returns the video buffers */
+static GPtrArray *
+demux_video_buffers (const gchar * location, gboolean push_mode,
+    guint blocksize)
+{
+  GstElement *demux;
+  gchar *pipeline_str;
+  TrackLog log;
+
+  g_mutex_init (&log.lock);
+  log.n_buffers = g_hash_table_new (NULL, NULL);
+  log.n_video = log.n_audio = 0;
+  log.video_pad = NULL;
+  log.video_buffers =
+      g_ptr_array_new_with_free_func ((GDestroyNotify) gst_buffer_unref);
+
+  pipeline_str = g_strdup_printf ("filesrc name=src blocksize=%u ! %s "
+      "mxfdemux name=demux", blocksize, push_mode ? "queue !" : "");
+  log.pipeline = gst_parse_launch (pipeline_str, NULL);
+  fail_unless (log.pipeline != NULL);
+  g_free (pipeline_str);
+  set_location (log.pipeline, "src", location);
+
+  demux = gst_bin_get_by_name (GST_BIN (log.pipeline), "demux");
+  g_signal_connect (demux, "pad-added", G_CALLBACK (_track_pad_added), &log);
+  gst_object_unref (demux);
+
+  run_pipeline (log.pipeline);
+  fail_unless_equals_int (log.n_video, 1);
+
+  gst_object_unref (log.pipeline);
+  g_hash_table_unref (log.n_buffers);
+  g_mutex_clear (&log.lock);
+
+  return log.video_buffers;
+}
+
+/* Frames that span many small input buffers must be copied once into a
+ * single memory and not pile up the memories of the input buffers */
+GST_START_TEST (test_push_small_buffers)
+{
+  GPtrArray *pull_buffers, *push_buffers;
+  gchar *location;
+  guint i;
+
+  location = create_mxf_file (25, 1, "");
+
+  pull_buffers = demux_video_buffers (location, FALSE, 4096);
+  push_buffers = demux_video_buffers (location, TRUE, 4096);
+
+  fail_unless_equals_int (pull_buffers->len, 25);
+  fail_unless_equals_int (push_buffers->len, 25);
+  for (i = 0; i < push_buffers->len; i++) {
+    GstBuffer *pull_buffer = g_ptr_array_index (pull_buffers, i);
+    GstBuffer *push_buffer = g_ptr_array_index (push_buffers, i);
+    GstMapInfo map;
+
+    fail_unless_equals_int (gst_buffer_n_memory (push_buffer), 1);
+    fail_unless_equals_int (gst_buffer_get_size (push_buffer),
+        gst_buffer_get_size (pull_buffer));
+
+    gst_buffer_map (pull_buffer, &map, GST_MAP_READ);
+    fail_unless (gst_buffer_memcmp (push_buffer, 0, map.data, map.size) == 0);
+    gst_buffer_unmap (pull_buffer, &map);
+  }
+
+  g_ptr_array_unref (pull_buffers);
+  g_ptr_array_unref (push_buffers);
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+/* mxfmux writes a timecode track starting at 0, so a seek to timecode
+ * 25 is a seek to frame 25, one second in at 25 fps */
+GST_START_TEST (test_pull_seek_timecode)
+{
+  GstElement *demux;
+  GstFormat format;
+  GstQuery *query;
+  GstMessage *msg;
+  GstBus *bus;
+  GstBuffer *buffer;
+  gchar *location;
+  gboolean seekable;
+  TrackLog log;
+  guint i;
+
+  format = gst_format_get_by_nick ("mxf-timecode");
+  fail_unless (format != GST_FORMAT_UNDEFINED);
+
+  location = create_mxf_file (50, 1, "");
+
+  g_mutex_init (&log.lock);
+  log.n_buffers = g_hash_table_new (NULL, NULL);
+  log.n_video = log.n_audio = 0;
+  log.video_pad = NULL;
+  log.video_buffers =
+      g_ptr_array_new_with_free_func ((GDestroyNotify) gst_buffer_unref);
+
+  log.pipeline = gst_parse_launch ("filesrc name=src ! mxfdemux name=demux",
+      NULL);
+  fail_unless (log.pipeline != NULL);
+  set_location (log.pipeline, "src", location);
+
+  demux = gst_bin_get_by_name (GST_BIN (log.pipeline), "demux");
+  g_signal_connect (demux, "pad-added", G_CALLBACK (_track_pad_added), &log);
+
+  fail_unless (gst_element_set_state (log.pipeline,
+          GST_STATE_PAUSED) != GST_STATE_CHANGE_FAILURE);
+  fail_unless (gst_element_get_state (log.pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE) == GST_STATE_CHANGE_SUCCESS);
+
+  query = gst_query_new_seeking (format);
+  fail_unless (gst_element_query (demux, query));
+  gst_query_parse_seeking (query, NULL, &seekable, NULL, NULL);
+  fail_unless (seekable);
+  gst_query_unref (query);
+  gst_object_unref (demux);
+
+  fail_unless (gst_element_seek (log.pipeline, 1.0, format,
+          GST_SEEK_FLAG_FLUSH, GST_SEEK_TYPE_SET, 25, GST_SEEK_TYPE_NONE, -1));
+
+  bus = gst_element_get_bus (log.pipeline);
+  fail_unless (gst_element_set_state (log.pipeline,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  fail_unless_equals_int (log.video_buffers->len, 25);
+  for (i = 0; i < log.video_buffers->len; i++) {
+    buffer = g_ptr_array_index (log.video_buffers, i);
+    fail_unless_equals_uint64 (GST_BUFFER_PTS (buffer),
+        (25 + i) * GST_SECOND / 25);
+  }
+
+  fail_unless (gst_element_set_state (log.pipeline,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS);
+  gst_object_unref (log.pipeline);
+  g_ptr_array_unref (log.video_buffers);
+  g_hash_table_unref (log.n_buffers);
+  g_mutex_clear (&log.lock);
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
 static Suite *
 mxfdemux_suite (void)
 {
@@ -302,6 +853,11 @@ mxfdemux_suite (void)
   tcase_set_timeout (tc_chain, 180);
   tcase_add_test (tc_chain, test_pull);
   tcase_add_test (tc_chain, test_push);
+  tcase_add_test (tc_chain, test_pull_read_ahead);
+  tcase_add_test (tc_chain, test_pull_many_tracks);
+  tcase_add_test (tc_chain, test_pull_follow);
+  tcase_add_test (tc_chain, test_push_small_buffers);
+  tcase_add_test (tc_chain, test_pull_seek_timecode);
 
   return s;
 }
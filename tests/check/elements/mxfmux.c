@@ -21,6 +21,7 @@
  */
 
 #include <gst/check/gstcheck.h>
+#include <glib/gstdio.h>
 #include <string.h>
 
 static const gchar *
@@ -156,6 +157,249 @@ GST_START_TEST (test_raw_video_stride_transform)
 
 GST_END_TEST;
 
+typedef struct
+{
+  GMutex lock;
+  gboolean seeked;
+  guint64 first_offset;
+} PullOffsetData;
+
+static GstPadProbeReturn
+pull_offset_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  PullOffsetData *d = user_data;
+
+  g_mutex_lock (&d->lock);
+  if (d->seeked && d->first_offset == -1)
+    d->first_offset = GST_PAD_PROBE_INFO_OFFSET (info);
+  g_mutex_unlock (&d->lock);
+
+  return GST_PAD_PROBE_OK;
+}
+
+GST_START_TEST (test_index_table)
+{
+  static const guint8 index_table_segment_key[] = {
+    0x06, 0x0e, 0x2b, 0x34, 0x02, 0x53, 0x01, 0x01,
+    0x0d, 0x01, 0x02, 0x01, 0x01, 0x10, 0x01, 0x00
+  };
+  gchar *pipeline_str, *location, *contents;
+  GstElement *pipeline, *src;
+  GstPad *srcpad;
+  PullOffsetData data;
+  gsize length, i;
+  gboolean found = FALSE;
+
+  location = g_strdup_printf ("%s/mxfmux-index-%u.mxf", g_get_tmp_dir (),
+      g_random_int ());
+
+  pipeline_str = g_strdup_printf ("videotestsrc num-buffers=100 ! "
+      "video/x-raw,format=(string)v308,width=160,height=120,framerate=25/1 ! "
+      "mxfmux name=mux ! " "filesink location=%s "
+      "audiotestsrc num-buffers=100 ! "
+      "audioconvert ! " "audio/x-raw,rate=48000,channels=2 ! " "mux. ",
+      location);
+
+  run_test (pipeline_str);
+  g_free (pipeline_str);
+
+  fail_unless (g_file_get_contents (location, &contents, &length, NULL));
+  for (i = 0; i + 16 <= length && !found; i++)
+    found = (memcmp (contents + i, index_table_segment_key, 16) == 0);
+  fail_unless (found);
+  g_free (contents);
+
+  /* Without an index the demuxer would have to scan the essence up to
+   * the seek target, with one it reads from the target directly */
+  pipeline_str = g_strdup_printf ("filesrc name=src location=%s ! "
+      "mxfdemux name=demux demux. ! fakesink demux. ! fakesink", location);
+  pipeline = gst_parse_launch (pipeline_str, NULL);
+  fail_unless (pipeline != NULL);
+  g_free (pipeline_str);
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PAUSED) != GST_STATE_CHANGE_FAILURE);
+  fail_unless (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE) == GST_STATE_CHANGE_SUCCESS);
+
+  g_mutex_init (&data.lock);
+  data.seeked = FALSE;
+  data.first_offset = -1;
+  src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  srcpad = gst_element_get_static_pad (src, "src");
+  gst_pad_add_probe (srcpad, GST_PAD_PROBE_TYPE_PULL |
+      GST_PAD_PROBE_TYPE_BUFFER, pull_offset_probe, &data, NULL);
+
+  g_mutex_lock (&data.lock);
+  data.seeked = TRUE;
+  g_mutex_unlock (&data.lock);
+  fail_unless (gst_element_seek_simple (pipeline, GST_FORMAT_TIME,
+          GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_KEY_UNIT, 3 * GST_SECOND));
+  fail_unless (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE) == GST_STATE_CHANGE_SUCCESS);
+
+  g_mutex_lock (&data.lock);
+  fail_unless (data.first_offset != -1);
+  fail_unless (data.first_offset > length / 2);
+  g_mutex_unlock (&data.lock);
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS);
+  gst_object_unref (srcpad);
+  gst_object_unref (src);
+  gst_object_unref (pipeline);
+  g_mutex_clear (&data.lock);
+
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+typedef struct
+{
+  guint64 offset;
+  guint8 type;
+  guint8 status;
+  guint64 this_partition;
+  guint64 prev_partition;
+  guint64 footer_partition;
+  guint64 header_byte_count;
+  guint64 index_byte_count;
+  guint32 body_sid;
+} PartitionPack;
+
+/* Walks over all KLV packets of a file and collects its partition packs */
+static GArray *
+parse_partition_packs (const guint8 * data, gsize size)
+{
+  static const guint8 partition_pack_key[] = {
+    0x06, 0x0e, 0x2b, 0x34, 0x02, 0x05, 0x01, 0x01,
+    0x0d, 0x01, 0x02, 0x01, 0x01
+  };
+  GArray *packs = g_array_new (FALSE, FALSE, sizeof (PartitionPack));
+  gsize offset = 0;
+
+  while (offset < size) {
+    const guint8 *value;
+    guint64 length;
+    guint length_size = 1, i;
+
+    fail_unless (offset + 17 <= size);
+    fail_unless (memcmp (data + offset, partition_pack_key, 4) == 0);
+
+    length = data[offset + 16];
+    if (length & 0x80) {
+      length_size += length & 0x7f;
+      fail_unless (length_size > 1 && length_size <= 9);
+      fail_unless (offset + 16 + length_size <= size);
+      length = 0;
+      for (i = 1; i < length_size; i++)
+        length = (length << 8) | data[offset + 16 + i];
+    }
+    value = data + offset + 16 + length_size;
+    fail_unless (offset + 16 + length_size + length <= size);
+
+    if (memcmp (data + offset, partition_pack_key, 13) == 0 &&
+        data[offset + 13] >= 0x02 && data[offset + 13] <= 0x04) {
+      PartitionPack p;
+
+      fail_unless (length >= 88);
+      p.offset = offset;
+      p.type = data[offset + 13];
+      p.status = data[offset + 14];
+      p.this_partition = GST_READ_UINT64_BE (value + 8);
+      p.prev_partition = GST_READ_UINT64_BE (value + 16);
+      p.footer_partition = GST_READ_UINT64_BE (value + 24);
+      p.header_byte_count = GST_READ_UINT64_BE (value + 32);
+      p.index_byte_count = GST_READ_UINT64_BE (value + 40);
+      p.body_sid = GST_READ_UINT32_BE (value + 60);
+      g_array_append_val (packs, p);
+    }
+
+    offset += 16 + length_size + length;
+  }
+
+  return packs;
+}
+
+GST_START_TEST (test_streamable_body_partitions)
+{
+  gchar *pipeline, *location, *contents;
+  GArray *packs;
+  PartitionPack *p;
+  gsize length;
+  guint i, n_metadata_copies = 0;
+
+  location = g_strdup_printf ("%s/mxfmux-streamable-%u.mxf", g_get_tmp_dir (),
+      g_random_int ());
+
+  pipeline = g_strdup_printf ("videotestsrc num-buffers=50 ! "
+      "video/x-raw,format=(string)v308,width=64,height=48,framerate=25/1 ! "
+      "mxfmux name=mux streamable=true body-partition-interval=500000000 ! "
+      "filesink location=%s "
+      "audiotestsrc num-buffers=50 ! "
+      "audioconvert ! " "audio/x-raw,rate=48000,channels=2 ! " "mux. ",
+      location);
+
+  run_test (pipeline);
+  g_free (pipeline);
+
+  fail_unless (g_file_get_contents (location, &contents, &length, NULL));
+  packs = parse_partition_packs ((const guint8 *) contents, length);
+  g_free (contents);
+
+  /* Header, the first body partition, one every 0.5s and the footer */
+  fail_unless (packs->len >= 6);
+
+  /* The header partition must not have been rewritten */
+  p = &g_array_index (packs, PartitionPack, 0);
+  fail_unless_equals_int (p->type, 0x02);
+  fail_unless_equals_int (p->status, 0x01);
+  fail_unless_equals_uint64 (p->footer_partition, 0);
+  fail_unless (p->header_byte_count > 0);
+
+  for (i = 1; i < packs->len; i++) {
+    p = &g_array_index (packs, PartitionPack, i);
+
+    fail_unless_equals_uint64 (p->this_partition, p->offset);
+    fail_unless_equals_uint64 (p->prev_partition,
+        g_array_index (packs, PartitionPack, i - 1).offset);
+
+    if (i == packs->len - 1)
+      break;
+
+    fail_unless_equals_int (p->type, 0x03);
+    fail_unless_equals_int (p->status, 0x01);
+    fail_unless (p->body_sid != 0);
+    /* Every later body partition indexes the previous one */
+    if (i > 1)
+      fail_unless (p->index_byte_count > 0);
+    if (p->header_byte_count > 0)
+      n_metadata_copies++;
+  }
+  fail_unless (n_metadata_copies >= 3);
+
+  p = &g_array_index (packs, PartitionPack, packs->len - 1);
+  fail_unless_equals_int (p->type, 0x04);
+  fail_unless_equals_int (p->status, 0x04);
+  fail_unless_equals_uint64 (p->footer_partition, p->offset);
+  fail_unless (p->header_byte_count > 0);
+
+  g_array_free (packs, TRUE);
+
+  /* The demuxer must be able to play the file */
+  pipeline = g_strdup_printf ("filesrc location=%s ! mxfdemux name=demux "
+      "demux. ! fakesink demux. ! fakesink", location);
+  run_test (pipeline);
+  g_free (pipeline);
+
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_jpeg2000_alaw)
 {
   gchar *pipeline;
@@ -256,6 +500,8 @@ mxfmux_suite (void)
   tcase_add_test (tc_chain, test_mpeg2);
   tcase_add_test (tc_chain, test_raw_video_raw_audio);
   tcase_add_test (tc_chain, test_raw_video_stride_transform);
+  tcase_add_test (tc_chain, test_index_table);
+  tcase_add_test (tc_chain, test_streamable_body_partitions);
   tcase_add_test (tc_chain, test_jpeg2000_alaw);
   tcase_add_test (tc_chain, test_dnxhd_mp3);
   tcase_add_test (tc_chain, test_multiple_av_streams);
@@ -0,0 +1,379 @@
+/* GStreamer
+ *
+ * URI source serving in-memory resources to the download tests
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/base/gstbasesrc.h>
+#include "elements/testdlsrc.h"
+
+#define TEST_DL_SRC_WAIT_TIMEOUT (5 * G_TIME_SPAN_SECOND)
+
+typedef struct
+{
+  GstBaseSrc parent;
+
+  gchar *uri;
+  GBytes *data;
+  guint64 fail_offset;
+  gboolean flushing;
+} GstTestDlSrc;
+
+typedef struct
+{
+  GstBaseSrcClass parent_class;
+} GstTestDlSrcClass;
+
+static GMutex lock;
+static GCond cond;
+static GHashTable *resources;   /* uri -> GBytes */
+static GHashTable *failures;    /* uri -> offset the next request fails at */
+static GHashTable *requests;    /* uri -> number of requests */
+static GHashTable *held;        /* uris whose downloads don't progress */
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC, GST_PAD_ALWAYS, GST_STATIC_CAPS_ANY);
+
+GType gst_test_dl_src_get_type (void);
+static void gst_test_dl_src_uri_handler_init (gpointer g_iface,
+    gpointer iface_data);
+
+#define gst_test_dl_src_parent_class parent_class
+G_DEFINE_TYPE_WITH_CODE (GstTestDlSrc, gst_test_dl_src, GST_TYPE_BASE_SRC,
+    G_IMPLEMENT_INTERFACE (GST_TYPE_URI_HANDLER,
+        gst_test_dl_src_uri_handler_init));
+
+static void
+gst_test_dl_src_finalize (GObject * object)
+{
+  GstTestDlSrc *src = (GstTestDlSrc *) object;
+
+  g_free (src->uri);
+  if (src->data)
+    g_bytes_unref (src->data);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static gboolean
+gst_test_dl_src_start (GstBaseSrc * basesrc)
+{
+  GstTestDlSrc *src = (GstTestDlSrc *) basesrc;
+  guint64 *fail_offset = NULL;
+  GBytes *data = NULL;
+  guint n_requests;
+
+  if (src->uri == NULL) {
+    GST_ELEMENT_ERROR (src, RESOURCE, NOT_FOUND, (NULL), ("No URI set"));
+    return FALSE;
+  }
+
+  g_mutex_lock (&lock);
+  n_requests = GPOINTER_TO_UINT (g_hash_table_lookup (requests, src->uri));
+  g_hash_table_insert (requests, g_strdup (src->uri),
+      GUINT_TO_POINTER (n_requests + 1));
+  g_cond_broadcast (&cond);
+
+  data = g_hash_table_lookup (resources, src->uri);
+  src->data = data ? g_bytes_ref (data) : NULL;
+  src->fail_offset = G_MAXUINT64;
+  fail_offset = g_hash_table_lookup (failures, src->uri);
+  if (fail_offset) {
+    src->fail_offset = *fail_offset;
+    g_hash_table_remove (failures, src->uri);
+  }
+  g_mutex_unlock (&lock);
+
+  if (src->data == NULL) {
+    GST_ELEMENT_ERROR (src, RESOURCE, NOT_FOUND, (NULL),
+        ("No resource for %s", src->uri));
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static gboolean
+gst_test_dl_src_stop (GstBaseSrc * basesrc)
+{
+  GstTestDlSrc *src = (GstTestDlSrc *) basesrc;
+
+  if (src->data) {
+    g_bytes_unref (src->data);
+    src->data = NULL;
+  }
+
+  return TRUE;
+}
+
+static gboolean
+gst_test_dl_src_is_seekable (GstBaseSrc * basesrc)
+{
+  return TRUE;
+}
+
+static gboolean
+gst_test_dl_src_get_size (GstBaseSrc * basesrc, guint64 * size)
+{
+  GstTestDlSrc *src = (GstTestDlSrc *) basesrc;
+
+  if (src->data == NULL)
+    return FALSE;
+
+  *size = g_bytes_get_size (src->data);
+  return TRUE;
+}
+
+static GstFlowReturn
+gst_test_dl_src_create (GstBaseSrc * basesrc, guint64 offset, guint length,
+    GstBuffer ** buffer)
+{
+  GstTestDlSrc *src = (GstTestDlSrc *) basesrc;
+  gsize size = g_bytes_get_size (src->data);
+
+  if (offset >= size)
+    return GST_FLOW_EOS;
+
+  g_mutex_lock (&lock);
+  while (g_hash_table_contains (held, src->uri) && !src->flushing)
+    g_cond_wait (&cond, &lock);
+  if (src->flushing) {
+    g_mutex_unlock (&lock);
+    return GST_FLOW_FLUSHING;
+  }
+  g_mutex_unlock (&lock);
+
+  if (offset >= src->fail_offset) {
+    GST_ELEMENT_ERROR (src, RESOURCE, READ, (NULL),
+        ("Failing %s at offset %" G_GUINT64_FORMAT, src->uri, offset));
+    return GST_FLOW_ERROR;
+  }
+
+  length = MIN (length, size - offset);
+  length = MIN (length, src->fail_offset - offset);
+
+  *buffer = gst_buffer_new_allocate (NULL, length, NULL);
+  gst_buffer_fill (*buffer, 0,
+      (const guint8 *) g_bytes_get_data (src->data, NULL) + offset, length);
+  GST_BUFFER_OFFSET (*buffer) = offset;
+  GST_BUFFER_OFFSET_END (*buffer) = offset + length;
+
+  return GST_FLOW_OK;
+}
+
+static gboolean
+gst_test_dl_src_unlock (GstBaseSrc * basesrc)
+{
+  GstTestDlSrc *src = (GstTestDlSrc *) basesrc;
+
+  g_mutex_lock (&lock);
+  src->flushing = TRUE;
+  g_cond_broadcast (&cond);
+  g_mutex_unlock (&lock);
+
+  return TRUE;
+}
+
+static gboolean
+gst_test_dl_src_unlock_stop (GstBaseSrc * basesrc)
+{
+  GstTestDlSrc *src = (GstTestDlSrc *) basesrc;
+
+  g_mutex_lock (&lock);
+  src->flushing = FALSE;
+  g_mutex_unlock (&lock);
+
+  return TRUE;
+}
+
+static void
+gst_test_dl_src_class_init (GstTestDlSrcClass * klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+  GstElementClass *element_class = (GstElementClass *) klass;
+  GstBaseSrcClass *basesrc_class = (GstBaseSrcClass *) klass;
+
+  gobject_class->finalize = gst_test_dl_src_finalize;
+
+  gst_element_class_add_pad_template (element_class,
+      gst_static_pad_template_get (&src_template));
+  gst_element_class_set_static_metadata (element_class, "Test download source",
+      "Source", "Serves in-memory resources for testdl:// URIs",
+      "GStreamer maintainers");
+
+  basesrc_class->start = gst_test_dl_src_start;
+  basesrc_class->stop = gst_test_dl_src_stop;
+  basesrc_class->unlock = gst_test_dl_src_unlock;
+  basesrc_class->unlock_stop = gst_test_dl_src_unlock_stop;
+  basesrc_class->is_seekable = gst_test_dl_src_is_seekable;
+  basesrc_class->get_size = gst_test_dl_src_get_size;
+  basesrc_class->create = gst_test_dl_src_create;
+}
+
+static void
+gst_test_dl_src_init (GstTestDlSrc * src)
+{
+  gst_base_src_set_blocksize (GST_BASE_SRC (src), TEST_DL_SRC_CHUNK_SIZE);
+}
+
+static GstURIType
+gst_test_dl_src_uri_get_type (GType type)
+{
+  return GST_URI_SRC;
+}
+
+static const gchar *const *
+gst_test_dl_src_uri_get_protocols (GType type)
+{
+  static const gchar *protocols[] = { "testdl", NULL };
+
+  return protocols;
+}
+
+static gchar *
+gst_test_dl_src_uri_get_uri (GstURIHandler * handler)
+{
+  GstTestDlSrc *src = (GstTestDlSrc *) handler;
+
+  return g_strdup (src->uri);
+}
+
+static gboolean
+gst_test_dl_src_uri_set_uri (GstURIHandler * handler, const gchar * uri,
+    GError ** error)
+{
+  GstTestDlSrc *src = (GstTestDlSrc *) handler;
+
+  /* like the HTTP sources, the URI can be changed between downloads */
+  GST_OBJECT_LOCK (src);
+  g_free (src->uri);
+  src->uri = g_strdup (uri);
+  GST_OBJECT_UNLOCK (src);
+
+  return TRUE;
+}
+
+static void
+gst_test_dl_src_uri_handler_init (gpointer g_iface, gpointer iface_data)
+{
+  GstURIHandlerInterface *iface = (GstURIHandlerInterface *) g_iface;
+
+  iface->get_type = gst_test_dl_src_uri_get_type;
+  iface->get_protocols = gst_test_dl_src_uri_get_protocols;
+  iface->get_uri = gst_test_dl_src_uri_get_uri;
+  iface->set_uri = gst_test_dl_src_uri_set_uri;
+}
+
+void
+test_dl_src_register (void)
+{
+  g_mutex_lock (&lock);
+  if (resources == NULL) {
+    resources = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+        (GDestroyNotify) g_bytes_unref);
+    failures = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+    requests = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    held = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  }
+  g_mutex_unlock (&lock);
+
+  gst_element_register (NULL, "testdlsrc", GST_RANK_PRIMARY + 1,
+      gst_test_dl_src_get_type ());
+}
+
+void
+test_dl_src_reset (void)
+{
+  g_mutex_lock (&lock);
+  g_hash_table_remove_all (resources);
+  g_hash_table_remove_all (failures);
+  g_hash_table_remove_all (requests);
+  g_hash_table_remove_all (held);
+  g_mutex_unlock (&lock);
+}
+
+void
+test_dl_src_add_resource (const gchar * uri, gconstpointer data, gsize size)
+{
+  g_mutex_lock (&lock);
+  g_hash_table_insert (resources, g_strdup (uri), g_bytes_new (data, size));
+  g_mutex_unlock (&lock);
+}
+
+/* The next request of @uri fails after @offset bytes were served */
+void
+test_dl_src_add_failure (const gchar * uri, guint64 offset)
+{
+  guint64 *fail_offset = g_new (guint64, 1);
+
+  *fail_offset = offset;
+  g_mutex_lock (&lock);
+  g_hash_table_insert (failures, g_strdup (uri), fail_offset);
+  g_mutex_unlock (&lock);
+}
+
+/* Downloads of @uri stop serving data until test_dl_src_release() */
+void
+test_dl_src_hold (const gchar * uri)
+{
+  g_mutex_lock (&lock);
+  g_hash_table_add (held, g_strdup (uri));
+  g_mutex_unlock (&lock);
+}
+
+void
+test_dl_src_release (const gchar * uri)
+{
+  g_mutex_lock (&lock);
+  g_hash_table_remove (held, uri);
+  g_cond_broadcast (&cond);
+  g_mutex_unlock (&lock);
+}
+
+guint
+test_dl_src_get_requests (const gchar * uri)
+{
+  guint n_requests;
+
+  g_mutex_lock (&lock);
+  n_requests = GPOINTER_TO_UINT (g_hash_table_lookup (requests, uri));
+  g_mutex_unlock (&lock);
+
+  return n_requests;
+}
+
+/* Waits until @uri was requested at least @n_requests times, returns FALSE
+ * if that didn't happen in a few seconds */
+gboolean
+test_dl_src_wait_requests (const gchar * uri, guint n_requests)
+{
+  gint64 end_time = g_get_monotonic_time () + TEST_DL_SRC_WAIT_TIMEOUT;
+  gboolean ret = TRUE;
+
+  g_mutex_lock (&lock);
+  while (GPOINTER_TO_UINT (g_hash_table_lookup (requests, uri)) < n_requests) {
+    if (!g_cond_wait_until (&cond, &lock, end_time)) {
+      ret = GPOINTER_TO_UINT (g_hash_table_lookup (requests, uri)) >=
+          n_requests;
+      break;
+    }
+  }
+  g_mutex_unlock (&lock);
+
+  return ret;
+}
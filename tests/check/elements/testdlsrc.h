@@ -0,0 +1,45 @@
+/* GStreamer
+ *
+ * URI source serving in-memory resources to the download tests
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __TEST_DL_SRC_H__
+#define __TEST_DL_SRC_H__
+
+#include <gst/gst.h>
+
+/* The "testdlsrc" element handles testdl:// URIs. Every request of a URI
+ * starts a new download of the resource added for it, which is served in
+ * chunks of TEST_DL_SRC_CHUNK_SIZE bytes. Requests of unknown URIs fail
+ * like a missing file would. */
+#define TEST_DL_SRC_CHUNK_SIZE 1024
+
+void test_dl_src_register (void);
+void test_dl_src_reset (void);
+
+void test_dl_src_add_resource (const gchar * uri, gconstpointer data,
+    gsize size);
+void test_dl_src_add_failure (const gchar * uri, guint64 offset);
+void test_dl_src_hold (const gchar * uri);
+void test_dl_src_release (const gchar * uri);
+
+guint test_dl_src_get_requests (const gchar * uri);
+gboolean test_dl_src_wait_requests (const gchar * uri, guint n_requests);
+
+#endif /* __TEST_DL_SRC_H__ */
@@ -0,0 +1,198 @@
+/* GStreamer
+ *
+ * unit test for the adaptive bitrate controller
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/gst.h>
+#include <gst/check/gstcheck.h>
+#include <gst/uridownloader/gstabrcontroller.h>
+
+static const guint64 bitrates[] = { 1000000, 2000000, 4000000, 8000000 };
+
+#define N_BITRATES G_N_ELEMENTS (bitrates)
+#define FRAGMENT_DURATION (2 * GST_SECOND)
+
+GST_START_TEST (test_abr_no_estimate)
+{
+  GstAbrController abr;
+
+  gst_abr_controller_init (&abr);
+  gst_abr_controller_set_policy (&abr, GST_ABR_POLICY_THROUGHPUT);
+
+  fail_unless_equals_uint64 (gst_abr_controller_get_throughput (&abr), 0);
+  /* nothing measured, stay where we are */
+  fail_unless_equals_int (gst_abr_controller_select (&abr, bitrates,
+          N_BITRATES, 2, 0, 0, FRAGMENT_DURATION), 2);
+  fail_unless_equals_int (gst_abr_controller_select (&abr, bitrates, 0, 0,
+          0, 0, FRAGMENT_DURATION), -1);
+
+  gst_abr_controller_clear (&abr);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_abr_throughput)
+{
+  GstAbrController abr;
+
+  gst_abr_controller_init (&abr);
+  gst_abr_controller_set_policy (&abr, GST_ABR_POLICY_THROUGHPUT);
+
+  /* 8 Mbps, of which 80% can be used */
+  gst_abr_controller_add_sample (&abr, 1000000, GST_SECOND);
+  fail_unless_equals_uint64 (gst_abr_controller_get_throughput (&abr),
+      8000000);
+  fail_unless_equals_int (gst_abr_controller_select (&abr, bitrates,
+          N_BITRATES, 0, 0, 0, FRAGMENT_DURATION), 2);
+
+  /* other streams take a part of the bandwidth */
+  fail_unless_equals_int (gst_abr_controller_select (&abr, bitrates,
+          N_BITRATES, 0, 3000000, 0, FRAGMENT_DURATION), 1);
+
+  /* the limit always applies */
+  gst_abr_controller_set_max_bitrate (&abr, 2000000);
+  fail_unless_equals_int (gst_abr_controller_select (&abr, bitrates,
+          N_BITRATES, 0, 0, 0, FRAGMENT_DURATION), 1);
+  gst_abr_controller_set_max_bitrate (&abr, 0);
+
+  /* a single slow download is enough to switch down */
+  gst_abr_controller_add_sample (&abr, 125000, GST_SECOND);
+  fail_unless_equals_int (gst_abr_controller_select (&abr, bitrates,
+          N_BITRATES, 2, 0, 0, FRAGMENT_DURATION), 0);
+
+  gst_abr_controller_reset (&abr);
+  fail_unless_equals_uint64 (gst_abr_controller_get_throughput (&abr), 0);
+
+  gst_abr_controller_clear (&abr);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_abr_buffer)
+{
+  GstAbrController abr;
+
+  gst_abr_controller_init (&abr);
+  gst_abr_controller_set_policy (&abr, GST_ABR_POLICY_BUFFER);
+  gst_abr_controller_set_buffer_target (&abr, 30 * GST_SECOND);
+
+  /* plenty of bandwidth: the buffer level decides */
+  gst_abr_controller_add_sample (&abr, 12500000, GST_SECOND);
+  fail_unless_equals_int (gst_abr_controller_select (&abr, bitrates,
+          N_BITRATES, 3, 0, 0, FRAGMENT_DURATION), 0);
+  fail_unless_equals_int (gst_abr_controller_select (&abr, bitrates,
+          N_BITRATES, 0, 0, 30 * GST_SECOND, FRAGMENT_DURATION), 3);
+
+  /* full buffer but little bandwidth: don't switch up past the
+   * throughput */
+  gst_abr_controller_reset (&abr);
+  gst_abr_controller_add_sample (&abr, 375000, GST_SECOND);
+  fail_unless_equals_int (gst_abr_controller_select (&abr, bitrates,
+          N_BITRATES, 0, 0, 30 * GST_SECOND, FRAGMENT_DURATION), 1);
+
+  gst_abr_controller_clear (&abr);
+}
+
+GST_END_TEST;
+
+static gint
+select_second (GstAbrController * abr, const guint64 * rates, guint n_rates,
+    gint current, guint64 throughput, GstClockTime buffer_level,
+    gpointer user_data)
+{
+  return 1;
+}
+
+static void
+count_notify (gpointer user_data)
+{
+  (*(gint *) user_data)++;
+}
+
+GST_START_TEST (test_abr_custom)
+{
+  GstAbrController abr;
+  GstMessage *msg;
+  const GstStructure *s;
+  guint64 bitrate;
+  gint notified = 0;
+
+  gst_abr_controller_init (&abr);
+  gst_abr_controller_set_policy (&abr, GST_ABR_POLICY_CUSTOM);
+  gst_abr_controller_set_select_func (&abr, select_second, &notified,
+      count_notify);
+
+  fail_unless_equals_int (gst_abr_controller_select (&abr, bitrates,
+          N_BITRATES, 3, 0, 0, FRAGMENT_DURATION), 1);
+
+  msg = gst_abr_controller_new_decision_message (&abr, NULL, "video");
+  s = gst_message_get_structure (msg);
+  fail_unless (gst_structure_has_name (s, GST_ABR_DECISION_MESSAGE_NAME));
+  fail_unless_equals_string (gst_structure_get_string (s, "reason"),
+      "custom");
+  fail_unless_equals_string (gst_structure_get_string (s, "stream-id"),
+      "video");
+  fail_unless (gst_structure_get_uint64 (s, "bitrate", &bitrate));
+  fail_unless_equals_uint64 (bitrate, 2000000);
+  fail_unless (gst_structure_get_uint64 (s, "previous-bitrate", &bitrate));
+  fail_unless_equals_uint64 (bitrate, 8000000);
+  gst_message_unref (msg);
+
+  gst_abr_controller_clear (&abr);
+  fail_unless_equals_int (notified, 1);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_abr_policy_type)
+{
+  GEnumClass *klass = g_type_class_ref (GST_TYPE_ABR_POLICY);
+
+  /* elements can't install a selection function, so their properties
+   * don't offer the custom policy */
+  fail_unless (g_enum_get_value_by_nick (klass, "hybrid") != NULL);
+  fail_unless (g_enum_get_value_by_nick (klass, "custom") == NULL);
+  fail_unless (g_enum_get_value (klass, GST_ABR_POLICY_CUSTOM) == NULL);
+
+  g_type_class_unref (klass);
+}
+
+GST_END_TEST;
+
+static Suite *
+abr_controller_suite (void)
+{
+  Suite *s = suite_create ("abrcontroller");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_abr_no_estimate);
+  tcase_add_test (tc_chain, test_abr_throughput);
+  tcase_add_test (tc_chain, test_abr_buffer);
+  tcase_add_test (tc_chain, test_abr_custom);
+  tcase_add_test (tc_chain, test_abr_policy_type);
+
+  return s;
+}
+
+GST_CHECK_MAIN (abr_controller);
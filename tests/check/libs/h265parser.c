@@ -0,0 +1,266 @@
+/* Gstreamer
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+#include <gst/check/gstcheck.h>
+#include <gst/codecparsers/gsth265parser.h>
+#include <gst/codecparsers/gsth265meta.h>
+
+/* prefix SEI, recovery point: recovery_poc_cnt 0, exact match, no broken
+ * link */
+static guint8 sei_recovery_point[] = {
+  0x00, 0x00, 0x01, 0x4e, 0x01, 0x06, 0x01, 0xd0, 0x80
+};
+
+/* prefix SEI, ATSC A/53 registered user data with one cc_data triplet */
+static guint8 sei_user_data_cc[] = {
+  0x00, 0x00, 0x01, 0x4e, 0x01, 0x04, 0x0e,
+  0xb5, 0x00, 0x31, 0x47, 0x41, 0x39, 0x34, 0x03,
+  0x41, 0xff, 0xfc, 0x80, 0x80, 0xff, 0x80
+};
+
+/* 64x64 IDR access unit: VPS, SPS and PPS followed by 8 slice segments of
+ * two 16x16 CTBs each, with slice_qp_delta going from -4 to 3 */
+static guint8 au_multi_slice[] = {
+  0x00, 0x00, 0x00, 0x01, 0x40, 0x01, 0x0c, 0x01,
+  0xff, 0xff, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00,
+  0x90, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00,
+  0x1e, 0xf0, 0x24, 0x00, 0x00, 0x00, 0x01, 0x42,
+  0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00,
+  0x90, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00,
+  0x1e, 0xa0, 0x20, 0x81, 0x05, 0xfe, 0xab, 0x08,
+  0x20, 0x00, 0x00, 0x00, 0x01, 0x44, 0x01, 0xc0,
+  0x71, 0x80, 0x12, 0x00, 0x00, 0x00, 0x01, 0x26,
+  0x01, 0xac, 0x4c, 0xa5, 0x5a, 0x11, 0x00, 0x00,
+  0x00, 0x01, 0x26, 0x01, 0x24, 0xcf, 0xa5, 0x5a,
+  0x22, 0x00, 0x00, 0x00, 0x01, 0x26, 0x01, 0x28,
+  0xcb, 0xa5, 0x5a, 0x33, 0x00, 0x00, 0x00, 0x01,
+  0x26, 0x01, 0x2c, 0xdc, 0xa5, 0x5a, 0x44, 0x00,
+  0x00, 0x00, 0x01, 0x26, 0x01, 0x30, 0xf0, 0xa5,
+  0x5a, 0x55, 0x00, 0x00, 0x00, 0x01, 0x26, 0x01,
+  0x34, 0xd4, 0xa5, 0x5a, 0x66, 0x00, 0x00, 0x00,
+  0x01, 0x26, 0x01, 0x38, 0xc9, 0xa5, 0x5a, 0x77,
+  0x00, 0x00, 0x00, 0x01, 0x26, 0x01, 0x3c, 0xcd,
+  0xa5, 0x5a, 0x88
+};
+
+GST_START_TEST (test_h265_parse_sei_recovery_point)
+{
+  GstH265ParserResult res;
+  GstH265NalUnit nalu;
+  GstH265SEIMessage sei;
+  GstH265Parser *parser = gst_h265_parser_new ();
+
+  res = gst_h265_parser_identify_nalu_unchecked (parser, sei_recovery_point,
+      0, sizeof (sei_recovery_point), &nalu);
+  assert_equals_int (res, GST_H265_PARSER_OK);
+  assert_equals_int (nalu.type, GST_H265_NAL_PREFIX_SEI);
+
+  res = gst_h265_parser_parse_sei (parser, &nalu, &sei);
+  assert_equals_int (res, GST_H265_PARSER_OK);
+  assert_equals_int (sei.payloadType, GST_H265_SEI_RECOVERY_POINT);
+  assert_equals_int (sei.payload.recovery_point.recovery_poc_cnt, 0);
+  assert_equals_int (sei.payload.recovery_point.exact_match_flag, 1);
+  assert_equals_int (sei.payload.recovery_point.broken_link_flag, 0);
+  gst_h265_sei_free (&sei);
+
+  gst_h265_parser_free (parser);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_h265_parse_sei_user_data_cc)
+{
+  GstH265ParserResult res;
+  GstH265NalUnit nalu;
+  GstH265SEIMessage sei;
+  GstH265RegisteredUserData *rud;
+  GstH265CaptionMeta *cc_meta;
+  GstBuffer *buffer;
+  const guint8 *cc;
+  gsize cc_size;
+  GstH265Parser *parser = gst_h265_parser_new ();
+
+  res = gst_h265_parser_identify_nalu_unchecked (parser, sei_user_data_cc,
+      0, sizeof (sei_user_data_cc), &nalu);
+  assert_equals_int (res, GST_H265_PARSER_OK);
+
+  res = gst_h265_parser_parse_sei (parser, &nalu, &sei);
+  assert_equals_int (res, GST_H265_PARSER_OK);
+  assert_equals_int (sei.payloadType, GST_H265_SEI_REGISTERED_USER_DATA);
+
+  rud = &sei.payload.registered_user_data;
+  assert_equals_int (rud->country_code, 0xb5);
+  assert_equals_int (rud->size, 13);
+
+  fail_unless (gst_h265_registered_user_data_get_cc_data (rud, &cc,
+          &cc_size));
+  assert_equals_int (cc_size, 3);
+  assert_equals_int (cc[0], 0xfc);
+
+  buffer = gst_buffer_new ();
+  gst_buffer_add_h265_caption_meta (buffer, cc, cc_size);
+  gst_h265_sei_free (&sei);
+
+  cc_meta = gst_buffer_get_h265_caption_meta (buffer);
+  fail_unless (cc_meta != NULL);
+  assert_equals_int (cc_meta->size, 3);
+  fail_unless (memcmp (cc_meta->data, sei_user_data_cc + 17, 3) == 0);
+  gst_buffer_unref (buffer);
+
+  gst_h265_parser_free (parser);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_h265_parse_au_serial)
+{
+  GstH265Parser *parser = gst_h265_parser_new ();
+  GstH265ParserResult res;
+  GstH265AUNalUnit *au_nal;
+  GArray *nals;
+  guint i;
+
+  nals = g_array_new (FALSE, FALSE, sizeof (GstH265AUNalUnit));
+  res = gst_h265_parser_parse_au (parser, au_multi_slice,
+      sizeof (au_multi_slice), 0, nals);
+  assert_equals_int (res, GST_H265_PARSER_OK);
+  assert_equals_int (nals->len, 11);
+
+  assert_equals_int (g_array_index (nals, GstH265AUNalUnit, 0).nalu.type,
+      GST_H265_NAL_VPS);
+  assert_equals_int (g_array_index (nals, GstH265AUNalUnit, 1).nalu.type,
+      GST_H265_NAL_SPS);
+  assert_equals_int (g_array_index (nals, GstH265AUNalUnit, 2).nalu.type,
+      GST_H265_NAL_PPS);
+  for (i = 0; i < 3; i++) {
+    au_nal = &g_array_index (nals, GstH265AUNalUnit, i);
+    assert_equals_int (au_nal->result, GST_H265_PARSER_OK);
+  }
+  assert_equals_int (parser->sps[0].width, 64);
+  assert_equals_int (parser->sps[0].height, 64);
+
+  for (i = 0; i < 8; i++) {
+    au_nal = &g_array_index (nals, GstH265AUNalUnit, 3 + i);
+    assert_equals_int (au_nal->nalu.type, GST_H265_NAL_SLICE_IDR_W_RADL);
+    assert_equals_int (au_nal->result, GST_H265_PARSER_OK);
+    assert_equals_int (au_nal->slice.first_slice_segment_in_pic_flag, i == 0);
+    assert_equals_int (au_nal->slice.segment_address, 2 * i);
+    assert_equals_int (au_nal->slice.type, GST_H265_I_SLICE);
+    assert_equals_int (au_nal->slice.qp_delta, (gint) i - 4);
+    fail_unless (au_nal->slice.pps == &parser->pps[0]);
+  }
+
+  for (i = 0; i < nals->len; i++)
+    gst_h265_au_nal_unit_free (&g_array_index (nals, GstH265AUNalUnit, i));
+  g_array_free (nals, TRUE);
+  gst_h265_parser_free (parser);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_h265_parse_au_parallel)
+{
+  GstH265Parser *serial = gst_h265_parser_new ();
+  GstH265Parser *parallel = gst_h265_parser_new ();
+  GstH265ParserResult res;
+  GArray *expected, *nals;
+  guint i, run;
+
+  expected = g_array_new (FALSE, FALSE, sizeof (GstH265AUNalUnit));
+  res = gst_h265_parser_parse_au (serial, au_multi_slice,
+      sizeof (au_multi_slice), 0, expected);
+  assert_equals_int (res, GST_H265_PARSER_OK);
+
+  gst_h265_parser_set_max_threads (parallel, 4);
+
+  /* the workers complete in any order, the result must not depend on it */
+  for (run = 0; run < 50; run++) {
+    nals = g_array_new (FALSE, FALSE, sizeof (GstH265AUNalUnit));
+    res = gst_h265_parser_parse_au (parallel, au_multi_slice,
+        sizeof (au_multi_slice), 0, nals);
+    assert_equals_int (res, GST_H265_PARSER_OK);
+    assert_equals_int (nals->len, expected->len);
+
+    for (i = 0; i < nals->len; i++) {
+      GstH265AUNalUnit *a = &g_array_index (expected, GstH265AUNalUnit, i);
+      GstH265AUNalUnit *b = &g_array_index (nals, GstH265AUNalUnit, i);
+
+      assert_equals_int (b->nalu.type, a->nalu.type);
+      assert_equals_int (b->nalu.offset, a->nalu.offset);
+      assert_equals_int (b->nalu.size, a->nalu.size);
+      assert_equals_int (b->result, a->result);
+      if (a->nalu.type != GST_H265_NAL_SLICE_IDR_W_RADL)
+        continue;
+
+      assert_equals_int (b->slice.first_slice_segment_in_pic_flag,
+          a->slice.first_slice_segment_in_pic_flag);
+      assert_equals_int (b->slice.segment_address, a->slice.segment_address);
+      assert_equals_int (b->slice.type, a->slice.type);
+      assert_equals_int (b->slice.qp_delta, a->slice.qp_delta);
+      assert_equals_int (b->slice.header_size, a->slice.header_size);
+      fail_unless (b->slice.pps == &parallel->pps[0]);
+    }
+
+    for (i = 0; i < nals->len; i++)
+      gst_h265_au_nal_unit_free (&g_array_index (nals, GstH265AUNalUnit, i));
+    g_array_free (nals, TRUE);
+  }
+
+  for (i = 0; i < expected->len; i++)
+    gst_h265_au_nal_unit_free (&g_array_index (expected, GstH265AUNalUnit,
+            i));
+  g_array_free (expected, TRUE);
+  gst_h265_parser_free (serial);
+  gst_h265_parser_free (parallel);
+}
+
+GST_END_TEST;
+
+static Suite *
+h265parser_suite (void)
+{
+  Suite *s = suite_create ("H265 Parser library");
+
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_h265_parse_sei_recovery_point);
+  tcase_add_test (tc_chain, test_h265_parse_sei_user_data_cc);
+  tcase_add_test (tc_chain, test_h265_parse_au_serial);
+  tcase_add_test (tc_chain, test_h265_parse_au_parallel);
+
+  return s;
+}
+
+int
+main (int argc, char **argv)
+{
+  int nf;
+
+  Suite *s = h265parser_suite ();
+
+  SRunner *sr = srunner_create (s);
+
+  gst_check_init (&argc, &argv);
+
+  srunner_run_all (sr, CK_NORMAL);
+  nf = srunner_ntests_failed (sr);
+  srunner_free (sr);
+
+  return nf;
+}
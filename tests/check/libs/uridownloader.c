@@ -0,0 +1,206 @@
+/* GStreamer
+ *
+ * unit test for the URI downloader
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include <gst/gst.h>
+#include <gst/check/gstcheck.h>
+#include <gst/uridownloader/gsturidownloader.h>
+#include "elements/testdlsrc.h"
+
+#define RESOURCE_SIZE (10 * TEST_DL_SRC_CHUNK_SIZE + 100)
+
+#define URI "testdl://example.com/resource"
+
+static guint8 resource[RESOURCE_SIZE];
+
+static void
+setup (void)
+{
+  guint i;
+
+  for (i = 0; i < RESOURCE_SIZE; i++)
+    resource[i] = (i * 7) & 0xff;
+
+  test_dl_src_reset ();
+  test_dl_src_add_resource (URI, resource, RESOURCE_SIZE);
+}
+
+static void
+check_fragment (GstFragment * fragment, gsize offset, gsize size)
+{
+  GstBuffer *buffer;
+
+  fail_unless (fragment != NULL);
+  fail_unless (fragment->completed);
+  fail_unless_equals_uint64 (fragment->size, size);
+
+  buffer = gst_fragment_get_buffer (fragment);
+  fail_unless (buffer != NULL);
+  fail_unless_equals_int (gst_buffer_get_size (buffer), size);
+  fail_unless (gst_buffer_memcmp (buffer, 0, resource + offset, size) == 0);
+  gst_buffer_unref (buffer);
+  g_object_unref (fragment);
+}
+
+typedef struct
+{
+  GByteArray *data;
+  guint n_chunks;
+  guint max_chunks;             /* fail the download after that many chunks */
+} ChunkLog;
+
+static GstFlowReturn
+_chunk_received (GstUriDownloader * downloader, GstBuffer * buffer,
+    gpointer user_data)
+{
+  ChunkLog *log = user_data;
+  GstMapInfo map;
+
+  if (log->max_chunks && log->n_chunks == log->max_chunks) {
+    gst_buffer_unref (buffer);
+    return GST_FLOW_ERROR;
+  }
+
+  log->n_chunks++;
+  gst_buffer_map (buffer, &map, GST_MAP_READ);
+  g_byte_array_append (log->data, map.data, map.size);
+  gst_buffer_unmap (buffer, &map);
+  gst_buffer_unref (buffer);
+
+  return GST_FLOW_OK;
+}
+
+GST_START_TEST (test_fetch)
+{
+  GstUriDownloader *downloader = gst_uri_downloader_new ();
+
+  check_fragment (gst_uri_downloader_fetch_uri (downloader, URI), 0,
+      RESOURCE_SIZE);
+  fail_unless_equals_int (test_dl_src_get_requests (URI), 1);
+
+  /* unknown resources fail like a missing file */
+  fail_unless (gst_uri_downloader_fetch_uri (downloader,
+          "testdl://a.example.com/missing") == NULL);
+
+  g_object_unref (downloader);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_fetch_streaming)
+{
+  GstUriDownloader *downloader = gst_uri_downloader_new ();
+  ChunkLog log = { NULL, };
+  GstFragment *fragment;
+
+  log.data = g_byte_array_new ();
+  fragment = gst_uri_downloader_fetch_uri_streaming (downloader, URI, 0,
+      -1, _chunk_received, &log);
+
+  /* the chunks are handed out as they arrive, the fragment only keeps
+   * the size for the bandwidth measurements */
+  fail_unless (fragment != NULL);
+  fail_unless (fragment->completed);
+  fail_unless_equals_uint64 (fragment->size, RESOURCE_SIZE);
+  fail_unless (gst_fragment_get_buffer (fragment) == NULL);
+  g_object_unref (fragment);
+
+  fail_unless_equals_int (log.n_chunks, 11);
+  fail_unless_equals_int (log.data->len, RESOURCE_SIZE);
+  fail_unless (memcmp (log.data->data, resource, RESOURCE_SIZE) == 0);
+
+  g_byte_array_unref (log.data);
+  g_object_unref (downloader);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_fetch_streaming_failure)
+{
+  GstUriDownloader *downloader = gst_uri_downloader_new ();
+  ChunkLog log = { NULL, };
+
+  /* the source fails after three chunks, those are already handed out */
+  log.data = g_byte_array_new ();
+  test_dl_src_add_failure (URI, 3 * TEST_DL_SRC_CHUNK_SIZE);
+  fail_unless (gst_uri_downloader_fetch_uri_streaming (downloader, URI,
+          0, -1, _chunk_received, &log) == NULL);
+  fail_unless_equals_int (log.n_chunks, 3);
+  fail_unless_equals_int (log.data->len, 3 * TEST_DL_SRC_CHUNK_SIZE);
+
+  /* the callback fails the download */
+  g_byte_array_set_size (log.data, 0);
+  log.n_chunks = 0;
+  log.max_chunks = 2;
+  fail_unless (gst_uri_downloader_fetch_uri_streaming (downloader, URI,
+          0, -1, _chunk_received, &log) == NULL);
+  fail_unless_equals_int (log.n_chunks, 2);
+
+  /* and the next download is complete again */
+  check_fragment (gst_uri_downloader_fetch_uri (downloader, URI), 0,
+      RESOURCE_SIZE);
+
+  g_byte_array_unref (log.data);
+  g_object_unref (downloader);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_fetch_range)
+{
+  GstUriDownloader *downloader = gst_uri_downloader_new ();
+
+  check_fragment (gst_uri_downloader_fetch_uri_with_range (downloader,
+          URI, 100, 200), 100, 100);
+  check_fragment (gst_uri_downloader_fetch_uri_with_range (downloader,
+          URI, 2000, -1), 2000, RESOURCE_SIZE - 2000);
+  check_fragment (gst_uri_downloader_fetch_uri (downloader, URI), 0,
+      RESOURCE_SIZE);
+
+  g_object_unref (downloader);
+}
+
+GST_END_TEST;
+
+static Suite *
+uri_downloader_suite (void)
+{
+  Suite *s = suite_create ("uridownloader");
+  TCase *tc_chain = tcase_create ("general");
+
+  test_dl_src_register ();
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_checked_fixture (tc_chain, setup, NULL);
+  tcase_add_test (tc_chain, test_fetch);
+  tcase_add_test (tc_chain, test_fetch_streaming);
+  tcase_add_test (tc_chain, test_fetch_streaming_failure);
+  tcase_add_test (tc_chain, test_fetch_range);
+
+  return s;
+}
+
+GST_CHECK_MAIN (uri_downloader);
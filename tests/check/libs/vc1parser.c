@@ -917,6 +917,50 @@ GST_START_TEST (test_vc1_parse_b_frame_header_main)
 
 GST_END_TEST;
 
+GST_START_TEST (test_vc1_bitplanes_reuse)
+{
+  GstVC1FrameHdr framehdr, framehdr_nobp;
+  GstVC1SeqHdr seqhdr;
+  GstVC1BitPlanes b = { 0, };
+  guint8 *arena;
+
+  GstVC1SeqStructC *structc = &seqhdr.struct_c;
+
+  structc->coded_height = 240;
+  structc->coded_width = 320;
+
+  assert_equals_int (gst_vc1_parse_sequence_header (bframe_header_main,
+          sizeof (bframe_header_main), &seqhdr), GST_VC1_PARSER_OK);
+
+  gst_vc1_bitplanes_ensure_size (&b, &seqhdr);
+  assert_equals_int (b.size, 315);
+  arena = b.acpred;
+  fail_unless (arena != NULL);
+
+  assert_equals_int (gst_vc1_parse_frame_header (bframe_main,
+          sizeof (bframe_main), &framehdr, &seqhdr, &b), GST_VC1_PARSER_OK);
+
+  /* same size for the next frame, the memory is reused */
+  gst_vc1_bitplanes_ensure_size (&b, &seqhdr);
+  assert_equals_int (b.size, 315);
+  fail_unless (b.acpred == arena);
+  fail_unless (b.forwardmb == arena + 6 * 315);
+
+  /* headers only mode gives the same header */
+  assert_equals_int (gst_vc1_parse_frame_header (bframe_main,
+          sizeof (bframe_main), &framehdr_nobp, &seqhdr, NULL),
+      GST_VC1_PARSER_OK);
+  assert_equals_int (framehdr_nobp.ptype, framehdr.ptype);
+  assert_equals_int (framehdr_nobp.pquant, framehdr.pquant);
+  assert_equals_int (framehdr_nobp.header_size, framehdr.header_size);
+
+  gst_vc1_bitplanes_free_1 (&b);
+  fail_unless (b.acpred == NULL);
+  assert_equals_int (b.size, 0);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_vc1_parse_bi_frame_header_main)
 {
   GstVC1FrameHdr framehdr;
@@ -1212,6 +1256,7 @@ vc1parser_suite (void)
   tcase_add_test (tc_chain, test_vc1_identify_bdu);
   tcase_add_test (tc_chain, test_vc1_parse_p_frame_header_main);
   tcase_add_test (tc_chain, test_vc1_parse_b_frame_header_main);
+  tcase_add_test (tc_chain, test_vc1_bitplanes_reuse);
   tcase_add_test (tc_chain, test_vc1_parse_bi_frame_header_main);
   tcase_add_test (tc_chain, test_vc1_parse_i_frame_header_main);
   tcase_add_test (tc_chain, test_vc1_parse_i_frame_header_adv);
@@ -0,0 +1,539 @@
+/* GStreamer
+ *
+ * codecparsers-bench.c: throughput benchmark for the codecparsers library
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Runs the codecparsers over elementary streams and reports the parsing
+ * throughput in MB/s and units (NALs, packets or BDUs) per second, as well
+ * as the number of heap allocations done per frame.
+ *
+ * Usage:
+ *   codecparsers-bench -p h264 stream.264 [stream2.264 ...]
+ *   codecparsers-bench -p all -g 64
+ *
+ * Recorded streams exercise the whole header parsing. Generated streams
+ * (-g) only contain units with random payloads, so they mostly measure
+ * the start code scanning and unit identification.
+ *
+ * Allocations are counted through g_mem_set_vtable(), which has to be
+ * called before anything else allocates, and with G_SLICE=always-malloc so
+ * that slice allocations are seen as well.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include <gst/gst.h>
+#include <gst/codecparsers/gsth264parser.h>
+#include <gst/codecparsers/gsth265parser.h>
+#include <gst/codecparsers/gstmpegvideoparser.h>
+#include <gst/codecparsers/gstmpeg4parser.h>
+#include <gst/codecparsers/gstvc1parser.h>
+
+typedef struct
+{
+  guint64 bytes;
+  guint64 units;
+  guint64 frames;
+  guint64 errors;
+} BenchStats;
+
+typedef void (*BenchFunc) (const guint8 * data, gsize size,
+    BenchStats * stats);
+
+typedef struct
+{
+  const gchar *name;
+  BenchFunc func;
+  /* start code suffix and unit type bytes used for generated streams */
+  guint8 sc_len;
+  const guint8 *unit_types;
+  guint n_unit_types;
+  guint8 unit_header_len;
+} BenchParser;
+
+/*** allocation counting ***/
+
+static volatile gint n_allocs = 0;
+
+static gpointer
+count_malloc (gsize n_bytes)
+{
+  g_atomic_int_inc (&n_allocs);
+  return malloc (n_bytes);
+}
+
+static gpointer
+count_realloc (gpointer mem, gsize n_bytes)
+{
+  g_atomic_int_inc (&n_allocs);
+  return realloc (mem, n_bytes);
+}
+
+static gpointer
+count_calloc (gsize n_blocks, gsize n_block_bytes)
+{
+  g_atomic_int_inc (&n_allocs);
+  return calloc (n_blocks, n_block_bytes);
+}
+
+static GMemVTable count_vtable = {
+  count_malloc,
+  count_realloc,
+  free,
+  count_calloc,
+  count_malloc,
+  count_realloc
+};
+
+/*** parsers ***/
+
+static void
+bench_h264 (const guint8 * data, gsize size, BenchStats * stats)
+{
+  GstH264NalParser *parser = gst_h264_nal_parser_new ();
+  GstH264ParserResult res;
+  GstH264NalUnit nalu;
+  GstH264SliceHdr slice;
+  GstH264SEIMessage sei;
+  guint offset = 0;
+
+  while (offset < size) {
+    res = gst_h264_parser_identify_nalu (parser, data, offset, size, &nalu);
+    if (res == GST_H264_PARSER_NO_NAL_END)
+      res = GST_H264_PARSER_OK;
+    if (res != GST_H264_PARSER_OK)
+      break;
+
+    stats->units++;
+    switch (nalu.type) {
+      case GST_H264_NAL_SLICE:
+      case GST_H264_NAL_SLICE_DPA:
+      case GST_H264_NAL_SLICE_IDR:
+        res = gst_h264_parser_parse_slice_hdr (parser, &nalu, &slice, TRUE,
+            TRUE);
+        if (res == GST_H264_PARSER_OK && slice.first_mb_in_slice == 0)
+          stats->frames++;
+        break;
+      case GST_H264_NAL_SEI:
+        res = gst_h264_parser_parse_sei (parser, &nalu, &sei);
+        break;
+      default:
+        res = gst_h264_parser_parse_nal (parser, &nalu);
+        break;
+    }
+    if (res != GST_H264_PARSER_OK)
+      stats->errors++;
+
+    offset = nalu.offset + nalu.size;
+  }
+
+  gst_h264_nal_parser_free (parser);
+}
+
+static void
+bench_h265 (const guint8 * data, gsize size, BenchStats * stats)
+{
+  GstH265Parser *parser = gst_h265_parser_new ();
+  GstH265ParserResult res;
+  GstH265NalUnit nalu;
+  GstH265SliceHdr slice;
+  GstH265SEIMessage sei;
+  guint offset = 0;
+
+  while (offset < size) {
+    res = gst_h265_parser_identify_nalu (parser, data, offset, size, &nalu);
+    if (res == GST_H265_PARSER_NO_NAL_END)
+      res = GST_H265_PARSER_OK;
+    if (res != GST_H265_PARSER_OK)
+      break;
+
+    stats->units++;
+    if (nalu.type <= GST_H265_NAL_SLICE_RASL_R ||
+        (nalu.type >= GST_H265_NAL_SLICE_BLA_W_LP &&
+            nalu.type <= GST_H265_NAL_SLICE_CRA_NUT)) {
+      res = gst_h265_parser_parse_slice_hdr (parser, &nalu, &slice);
+      if (res == GST_H265_PARSER_OK) {
+        if (slice.first_slice_segment_in_pic_flag)
+          stats->frames++;
+        gst_h265_slice_hdr_free (&slice);
+      }
+    } else if (nalu.type == GST_H265_NAL_PREFIX_SEI ||
+        nalu.type == GST_H265_NAL_SUFFIX_SEI) {
+      res = gst_h265_parser_parse_sei (parser, &nalu, &sei);
+      if (res == GST_H265_PARSER_OK)
+        gst_h265_sei_free (&sei);
+    } else {
+      res = gst_h265_parser_parse_nal (parser, &nalu);
+    }
+    if (res != GST_H265_PARSER_OK)
+      stats->errors++;
+
+    offset = nalu.offset + nalu.size;
+  }
+
+  gst_h265_parser_free (parser);
+}
+
+static void
+bench_mpegvideo (const guint8 * data, gsize size, BenchStats * stats)
+{
+  GstMpegVideoPacket packet;
+  GstMpegVideoSequenceHdr seqhdr;
+  GstMpegVideoSequenceExt seqext;
+  GstMpegVideoPictureHdr pichdr;
+  GstMpegVideoPictureExt picext;
+  GstMpegVideoGop gop;
+  GstMpegVideoSliceHdr slicehdr;
+  gboolean have_seqhdr = FALSE;
+  gboolean ok;
+  guint offset = 0;
+
+  while (gst_mpeg_video_parse (&packet, data, size, offset)) {
+    if (packet.size < 0)
+      packet.size = size - packet.offset;
+
+    stats->units++;
+    ok = TRUE;
+    switch (packet.type) {
+      case GST_MPEG_VIDEO_PACKET_SEQUENCE:
+        ok = have_seqhdr =
+            gst_mpeg_video_packet_parse_sequence_header (&packet, &seqhdr);
+        break;
+      case GST_MPEG_VIDEO_PACKET_GOP:
+        ok = gst_mpeg_video_packet_parse_gop (&packet, &gop);
+        break;
+      case GST_MPEG_VIDEO_PACKET_PICTURE:
+        ok = gst_mpeg_video_packet_parse_picture_header (&packet, &pichdr);
+        stats->frames++;
+        break;
+      case GST_MPEG_VIDEO_PACKET_EXTENSION:
+        if (packet.size < 1)
+          break;
+        switch (packet.data[packet.offset] >> 4) {
+          case GST_MPEG_VIDEO_PACKET_EXT_SEQUENCE:
+            ok = gst_mpeg_video_packet_parse_sequence_extension (&packet,
+                &seqext);
+            break;
+          case GST_MPEG_VIDEO_PACKET_EXT_PICTURE:
+            ok = gst_mpeg_video_packet_parse_picture_extension (&packet,
+                &picext);
+            break;
+          default:
+            break;
+        }
+        break;
+      default:
+        if (GST_MPEG_VIDEO_PACKET_IS_SLICE (packet.type) && have_seqhdr)
+          ok = gst_mpeg_video_packet_parse_slice_header (&packet, &slicehdr,
+              &seqhdr, NULL);
+        break;
+    }
+    if (!ok)
+      stats->errors++;
+
+    offset = packet.offset + packet.size;
+  }
+}
+
+static void
+bench_mpeg4 (const guint8 * data, gsize size, BenchStats * stats)
+{
+  GstMpeg4ParseResult res;
+  GstMpeg4Packet packet;
+  GstMpeg4VisualObject vo;
+  GstMpeg4VideoSignalType signal_type;
+  GstMpeg4VideoObjectLayer vol;
+  GstMpeg4VideoObjectPlane vop;
+  GstMpeg4GroupOfVOP gov;
+  gboolean have_vol = FALSE;
+  guint offset = 0;
+
+  memset (&vo, 0, sizeof (vo));
+
+  while (offset + 4 < size) {
+    res = gst_mpeg4_parse (&packet, TRUE, NULL, data, offset, size);
+    if (res == GST_MPEG4_PARSER_NO_PACKET_END) {
+      packet.size = size - packet.offset;
+      res = GST_MPEG4_PARSER_OK;
+    }
+    if (res != GST_MPEG4_PARSER_OK || packet.size == 0)
+      break;
+
+    stats->units++;
+    if (packet.type == GST_MPEG4_VISUAL_OBJ) {
+      res = gst_mpeg4_parse_visual_object (&vo, &signal_type,
+          packet.data + packet.offset, packet.size);
+    } else if (packet.type >= GST_MPEG4_VIDEO_LAYER_FIRST &&
+        packet.type <= GST_MPEG4_VIDEO_LAYER_LAST) {
+      res = gst_mpeg4_parse_video_object_layer (&vol, &vo,
+          packet.data + packet.offset, packet.size);
+      have_vol = (res == GST_MPEG4_PARSER_OK);
+    } else if (packet.type == GST_MPEG4_GROUP_OF_VOP) {
+      res = gst_mpeg4_parse_group_of_vop (&gov,
+          packet.data + packet.offset, packet.size);
+    } else if (packet.type == GST_MPEG4_VIDEO_OBJ_PLANE) {
+      stats->frames++;
+      if (have_vol)
+        res = gst_mpeg4_parse_video_object_plane (&vop, NULL, &vol,
+            packet.data + packet.offset, packet.size);
+    }
+    if (res != GST_MPEG4_PARSER_OK)
+      stats->errors++;
+
+    offset = packet.offset + packet.size;
+  }
+}
+
+static void
+bench_vc1 (const guint8 * data, gsize size, BenchStats * stats)
+{
+  GstVC1ParserResult res;
+  GstVC1BDU bdu;
+  GstVC1SeqHdr seqhdr;
+  GstVC1EntryPointHdr entrypoint;
+  GstVC1FrameHdr framehdr;
+  GstVC1BitPlanes bitplanes = { 0, };
+  gboolean have_seqhdr = FALSE, have_entrypoint = FALSE;
+
+  while (size > 4) {
+    res = gst_vc1_identify_next_bdu (data, size, &bdu);
+    if (res == GST_VC1_PARSER_NO_BDU_END) {
+      bdu.size = size - bdu.offset;
+      res = GST_VC1_PARSER_OK;
+    }
+    if (res != GST_VC1_PARSER_OK)
+      break;
+
+    stats->units++;
+    switch (bdu.type) {
+      case GST_VC1_SEQUENCE:
+        res = gst_vc1_parse_sequence_header (bdu.data + bdu.offset, bdu.size,
+            &seqhdr);
+        have_seqhdr = (res == GST_VC1_PARSER_OK);
+        have_entrypoint = FALSE;
+        break;
+      case GST_VC1_ENTRYPOINT:
+        if (!have_seqhdr)
+          break;
+        res = gst_vc1_parse_entry_point_header (bdu.data + bdu.offset,
+            bdu.size, &entrypoint, &seqhdr);
+        have_entrypoint = (res == GST_VC1_PARSER_OK);
+        if (have_entrypoint)
+          gst_vc1_bitplanes_ensure_size (&bitplanes, &seqhdr);
+        break;
+      case GST_VC1_FRAME:
+        stats->frames++;
+        if (have_entrypoint)
+          res = gst_vc1_parse_frame_header (bdu.data + bdu.offset, bdu.size,
+              &framehdr, &seqhdr, &bitplanes);
+        break;
+      default:
+        break;
+    }
+    if (res != GST_VC1_PARSER_OK)
+      stats->errors++;
+
+    data += bdu.offset + bdu.size;
+    size -= bdu.offset + bdu.size;
+  }
+
+  gst_vc1_bitplanes_free_1 (&bitplanes);
+}
+
+static const guint8 h264_unit_types[] = { 0x67, 0x68, 0x06, 0x65, 0x41, 0x41,
+  0x41, 0x01
+};
+static const guint8 h265_unit_types[] = { 0x40, 0x42, 0x44, 0x4e, 0x26, 0x02,
+  0x02, 0x02
+};
+static const guint8 mpegvideo_unit_types[] = { 0xb3, 0xb5, 0xb8, 0x00, 0x01,
+  0x02, 0x03, 0x04
+};
+static const guint8 mpeg4_unit_types[] = { 0xb0, 0xb5, 0x00, 0x20, 0xb3, 0xb6,
+  0xb6, 0xb6
+};
+static const guint8 vc1_unit_types[] = { 0x0f, 0x0e, 0x0d, 0x0d, 0x0d, 0x0c,
+  0x0b, 0x0d
+};
+
+static const BenchParser parsers[] = {
+  {"h264", bench_h264, 3, h264_unit_types, G_N_ELEMENTS (h264_unit_types), 1},
+  {"h265", bench_h265, 3, h265_unit_types, G_N_ELEMENTS (h265_unit_types), 2},
+  {"mpegvideo", bench_mpegvideo, 3, mpegvideo_unit_types,
+      G_N_ELEMENTS (mpegvideo_unit_types), 1},
+  {"mpeg4", bench_mpeg4, 3, mpeg4_unit_types, G_N_ELEMENTS (mpeg4_unit_types),
+      1},
+  {"vc1", bench_vc1, 3, vc1_unit_types, G_N_ELEMENTS (vc1_unit_types), 1},
+};
+
+/*** stream generation ***/
+
+/* Generates @size bytes of units made of a start code, a unit type picked
+ * from the parser's list and a random payload without any start code
+ * emulation. */
+static GBytes *
+generate_stream (const BenchParser * parser, gsize size, guint32 seed)
+{
+  GRand *rand = g_rand_new_with_seed (seed);
+  guint8 *data = g_malloc (size);
+  gsize pos = 0, unit_size, i;
+
+  while (pos + 8 < size) {
+    unit_size = MIN (g_rand_int_range (rand, 64, 16384), size - pos);
+
+    data[pos++] = 0x00;
+    data[pos++] = 0x00;
+    data[pos++] = 0x01;
+    data[pos++] =
+        parser->unit_types[g_rand_int_range (rand, 0, parser->n_unit_types)];
+    if (parser->unit_header_len == 2)
+      data[pos++] = 0x01;
+
+    for (i = pos; i < pos + unit_size - 5 && i < size; i++)
+      data[i] = g_rand_int_range (rand, 1, 256);
+    pos = i;
+  }
+  for (; pos < size; pos++)
+    data[pos] = 0xff;
+
+  g_rand_free (rand);
+
+  return g_bytes_new_take (data, size);
+}
+
+/*** main ***/
+
+static void
+run_bench (const BenchParser * parser, const gchar * name, GBytes * bytes,
+    guint iterations)
+{
+  BenchStats stats = { 0, };
+  const guint8 *data;
+  gsize size;
+  gint64 start, elapsed;
+  gint allocs;
+  gdouble secs;
+  guint i;
+
+  data = g_bytes_get_data (bytes, &size);
+
+  g_atomic_int_set (&n_allocs, 0);
+  start = g_get_monotonic_time ();
+  for (i = 0; i < iterations; i++) {
+    stats.bytes += size;
+    parser->func (data, size, &stats);
+  }
+  elapsed = g_get_monotonic_time () - start;
+  allocs = g_atomic_int_get (&n_allocs);
+
+  secs = MAX (elapsed, 1) / (gdouble) G_USEC_PER_SEC;
+
+  g_print ("%-10s %-30s %9.2f MB/s %12.0f units/s %10" G_GUINT64_FORMAT
+      " frames %8.2f allocs/frame %" G_GUINT64_FORMAT " errors\n",
+      parser->name, name, stats.bytes / secs / (1024.0 * 1024.0),
+      stats.units / secs, stats.frames,
+      stats.frames ? allocs / (gdouble) stats.frames : 0.0, stats.errors);
+}
+
+int
+main (int argc, gchar ** argv)
+{
+  gchar *parser_name = NULL;
+  gint generate_mb = 0;
+  gint iterations = 1;
+  GOptionEntry options[] = {
+    {"parser", 'p', 0, G_OPTION_ARG_STRING, &parser_name,
+        "Parser to run: h264, h265, mpegvideo, mpeg4, vc1 or all", "NAME"},
+    {"generate", 'g', 0, G_OPTION_ARG_INT, &generate_mb,
+        "Run over a generated stream of SIZE MB", "SIZE"},
+    {"iterations", 'n', 0, G_OPTION_ARG_INT, &iterations,
+        "Number of times each stream is parsed", "N"},
+    {NULL}
+  };
+  GOptionContext *ctx;
+  GError *err = NULL;
+  guint p;
+  gint i;
+
+  /* must happen before anything allocates */
+  g_mem_set_vtable (&count_vtable);
+  g_setenv ("G_SLICE", "always-malloc", TRUE);
+
+  ctx = g_option_context_new ("[FILE...] - benchmark the codecparsers");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("Error initializing: %s\n", err->message);
+    g_clear_error (&err);
+    g_option_context_free (ctx);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (parser_name == NULL || (argc < 2 && generate_mb <= 0)) {
+    g_printerr ("Usage: %s -p PARSER [-n N] (-g SIZE | FILE...)\n", argv[0]);
+    return 1;
+  }
+
+  iterations = MAX (iterations, 1);
+
+  for (p = 0; p < G_N_ELEMENTS (parsers); p++) {
+    if (strcmp (parser_name, "all") != 0 &&
+        strcmp (parser_name, parsers[p].name) != 0)
+      continue;
+
+    if (generate_mb > 0) {
+      GBytes *bytes = generate_stream (&parsers[p],
+          (gsize) generate_mb * 1024 * 1024, 0x5eed);
+
+      run_bench (&parsers[p], "(generated)", bytes, iterations);
+      g_bytes_unref (bytes);
+    }
+
+    for (i = 1; i < argc; i++) {
+      GMappedFile *file;
+      GBytes *bytes;
+      gchar *basename;
+
+      file = g_mapped_file_new (argv[i], FALSE, &err);
+      if (!file) {
+        g_printerr ("Could not open %s: %s\n", argv[i], err->message);
+        g_clear_error (&err);
+        continue;
+      }
+
+      bytes = g_bytes_new_with_free_func (g_mapped_file_get_contents (file),
+          g_mapped_file_get_length (file),
+          (GDestroyNotify) g_mapped_file_unref, file);
+
+      basename = g_path_get_basename (argv[i]);
+      run_bench (&parsers[p], basename, bytes, iterations);
+      g_free (basename);
+      g_bytes_unref (bytes);
+    }
+  }
+
+  g_free (parser_name);
+
+  return 0;
+}
@@ -0,0 +1,425 @@
+/* GStreamer
+ *
+ * mxfdemux-bench.c: corpus generator and benchmark for mxfdemux
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Generates synthetic MXF files with mxfmux and measures for each of them
+ * the time until mxfdemux prerolled (open time), the latency of random
+ * flushing seeks and the demuxing throughput in MB/s.
+ *
+ * Usage:
+ *   mxfdemux-bench -v raw -a raw -d 60 -s 1920x1080
+ *   mxfdemux-bench -v mpeg2 -a alaw --atom -k -o /tmp/corpus
+ *   mxfdemux-bench --push file1.mxf [file2.mxf ...]
+ *
+ * Files given on the command line are benchmarked instead of generating
+ * new ones. Generated files are removed afterwards unless -k is given,
+ * which makes the generator usable to build a corpus for other tools.
+ *
+ * mxfmux only writes OP1a files. With --atom every track is written into
+ * its own single track file instead, which is the layout of OP-Atom.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+
+typedef struct
+{
+  const gchar *name;
+  /* raw caps fed into the encoder and the encoder itself, if any */
+  const gchar *format;
+  const gchar *encoder;
+} BenchEssence;
+
+static const BenchEssence video_essences[] = {
+  {"raw", "UYVY", NULL},
+  {"mpeg2", "I420", "avenc_mpeg2video ! mpegvideoparse"},
+  {"jpeg2000", "I420", "openjpegenc"},
+  {"dnxhd", "Y42B", "avenc_dnxhd bitrate=36000000"},
+  {"none", NULL, NULL}
+};
+
+static const BenchEssence audio_essences[] = {
+  {"raw", "S16LE", NULL},
+  {"alaw", "S16LE", "alawenc"},
+  {"none", NULL, NULL}
+};
+
+typedef struct
+{
+  gint64 open_time;
+  gint64 seek_time_total;
+  gint64 seek_time_max;
+  guint n_seeks;
+  gint64 play_time;
+  guint64 size;
+} BenchResult;
+
+/*** options ***/
+
+static gchar *video_type = NULL;
+static gchar *audio_type = NULL;
+static gint duration = 10;
+static gchar *frame_size = NULL;
+static gint n_seeks = 20;
+static gboolean atom = FALSE;
+static gboolean push_mode = FALSE;
+static gboolean keep = FALSE;
+static gchar *output_dir = NULL;
+static guint64 body_partition_interval = 0;
+static gchar **files = NULL;
+
+static GOptionEntry entries[] = {
+  {"video", 'v', 0, G_OPTION_ARG_STRING, &video_type,
+      "Video essence: raw, mpeg2, jpeg2000, dnxhd or none (default raw)",
+      NULL},
+  {"audio", 'a', 0, G_OPTION_ARG_STRING, &audio_type,
+      "Audio essence: raw, alaw or none (default raw)", NULL},
+  {"duration", 'd', 0, G_OPTION_ARG_INT, &duration,
+      "Duration of generated files in seconds (default 10)", NULL},
+  {"size", 's', 0, G_OPTION_ARG_STRING, &frame_size,
+      "Frame size of generated video as WxH (default 720x576)", NULL},
+  {"seeks", 'n', 0, G_OPTION_ARG_INT, &n_seeks,
+      "Number of random seeks (default 20)", NULL},
+  {"atom", 0, 0, G_OPTION_ARG_NONE, &atom,
+      "Write every track into its own file", NULL},
+  {"body-partition-interval", 'b', 0, G_OPTION_ARG_INT64,
+        &body_partition_interval,
+      "Body partition interval of generated files in nanoseconds", NULL},
+  {"push", 'p', 0, G_OPTION_ARG_NONE, &push_mode,
+      "Run mxfdemux in push mode", NULL},
+  {"keep", 'k', 0, G_OPTION_ARG_NONE, &keep,
+      "Keep generated files", NULL},
+  {"output-dir", 'o', 0, G_OPTION_ARG_FILENAME, &output_dir,
+      "Directory for generated files (default: temporary directory)", NULL},
+  {G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &files, NULL,
+      NULL},
+  {NULL}
+};
+
+static const BenchEssence *
+find_essence (const BenchEssence * essences, const gchar * name)
+{
+  for (; essences->name; essences++) {
+    if (strcmp (essences->name, name) == 0)
+      return essences;
+  }
+
+  return NULL;
+}
+
+/*** pipeline helpers ***/
+
+static gboolean
+run_until (GstElement * pipeline, GstMessageType types, gint64 * elapsed)
+{
+  GstBus *bus = gst_element_get_bus (pipeline);
+  GstMessage *msg;
+  gint64 start = g_get_monotonic_time ();
+  gboolean ret = FALSE;
+
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      types | GST_MESSAGE_ERROR);
+  if (elapsed)
+    *elapsed = g_get_monotonic_time () - start;
+
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR) {
+    GError *err = NULL;
+    gchar *debug = NULL;
+
+    gst_message_parse_error (msg, &err, &debug);
+    g_printerr ("Error from %s: %s\n%s\n", GST_OBJECT_NAME (msg->src),
+        err->message, debug ? debug : "");
+    g_clear_error (&err);
+    g_free (debug);
+  } else {
+    ret = TRUE;
+  }
+
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  return ret;
+}
+
+static gboolean
+generate_file (const gchar * location, const BenchEssence * video,
+    const BenchEssence * audio, gint width, gint height)
+{
+  GString *desc = g_string_new (NULL);
+  GstElement *pipeline, *sink;
+  GError *err = NULL;
+  gboolean ret;
+
+  g_string_append_printf (desc, "mxfmux name=mux "
+      "body-partition-interval=%" G_GUINT64_FORMAT " ! filesink name=sink",
+      body_partition_interval);
+
+  if (video && video->format) {
+    g_string_append_printf (desc, " videotestsrc num-buffers=%d "
+        "pattern=ball ! video/x-raw,format=%s,width=%d,height=%d,"
+        "framerate=25/1 ! ", duration * 25, video->format, width, height);
+    if (video->encoder)
+      g_string_append_printf (desc, "%s ! ", video->encoder);
+    g_string_append (desc, "mux.");
+  }
+
+  if (audio && audio->format) {
+    g_string_append_printf (desc, " audiotestsrc num-buffers=%d "
+        "samplesperbuffer=1920 ! audioconvert ! audio/x-raw,format=%s,"
+        "rate=48000,channels=2 ! ", duration * 25, audio->format);
+    if (audio->encoder)
+      g_string_append_printf (desc, "%s ! ", audio->encoder);
+    g_string_append (desc, "mux.");
+  }
+
+  pipeline = gst_parse_launch (desc->str, &err);
+  if (!pipeline) {
+    g_printerr ("Failed to create pipeline '%s': %s\n", desc->str,
+        err->message);
+    g_clear_error (&err);
+    g_string_free (desc, TRUE);
+    return FALSE;
+  }
+  g_string_free (desc, TRUE);
+
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  g_object_set (sink, "location", location, NULL);
+  gst_object_unref (sink);
+
+  g_print ("Generating %s\n", location);
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  ret = run_until (pipeline, GST_MESSAGE_EOS, NULL);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return ret;
+}
+
+static void
+on_pad_added (GstElement * demux, GstPad * pad, GstElement * pipeline)
+{
+  GstElement *sink = gst_element_factory_make ("fakesink", NULL);
+  GstPad *sinkpad;
+
+  g_object_set (sink, "sync", FALSE, "async", TRUE, NULL);
+  gst_bin_add (GST_BIN (pipeline), sink);
+  sinkpad = gst_element_get_static_pad (sink, "sink");
+  gst_pad_link (pad, sinkpad);
+  gst_object_unref (sinkpad);
+  gst_element_sync_state_with_parent (sink);
+}
+
+static gboolean
+bench_file (const gchar * location, BenchResult * result)
+{
+  GstElement *pipeline, *src, *demux;
+  GError *err = NULL;
+  gint64 file_duration = -1;
+  GStatBuf st;
+  guint i;
+
+  memset (result, 0, sizeof (BenchResult));
+  if (g_stat (location, &st) == 0)
+    result->size = st.st_size;
+
+  /* The queue forces mxfdemux into push mode */
+  pipeline = gst_parse_launch (push_mode ?
+      "filesrc name=src ! queue ! mxfdemux name=demux" :
+      "filesrc name=src ! mxfdemux name=demux", &err);
+  if (!pipeline) {
+    g_printerr ("Failed to create pipeline: %s\n", err->message);
+    g_clear_error (&err);
+    return FALSE;
+  }
+
+  src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  g_object_set (src, "location", location, NULL);
+  gst_object_unref (src);
+
+  demux = gst_bin_get_by_name (GST_BIN (pipeline), "demux");
+  g_signal_connect (demux, "pad-added", G_CALLBACK (on_pad_added), pipeline);
+  gst_object_unref (demux);
+
+  /* Open: until all streams prerolled */
+  gst_element_set_state (pipeline, GST_STATE_PAUSED);
+  if (!run_until (pipeline, GST_MESSAGE_ASYNC_DONE, &result->open_time))
+    goto error;
+
+  gst_element_query_duration (pipeline, GST_FORMAT_TIME, &file_duration);
+
+  /* Random flushing seeks, each until prerolled again */
+  for (i = 0; i < (guint) n_seeks && file_duration > 0; i++) {
+    gint64 position = g_random_double () * file_duration;
+    gint64 elapsed;
+
+    if (!gst_element_seek_simple (pipeline, GST_FORMAT_TIME,
+            GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_KEY_UNIT, position)) {
+      g_printerr ("Seek to %" GST_TIME_FORMAT " failed\n",
+          GST_TIME_ARGS (position));
+      continue;
+    }
+
+    if (!run_until (pipeline, GST_MESSAGE_ASYNC_DONE, &elapsed))
+      goto error;
+
+    result->seek_time_total += elapsed;
+    result->seek_time_max = MAX (result->seek_time_max, elapsed);
+    result->n_seeks++;
+  }
+
+  /* Throughput: everything from the start */
+  if (result->n_seeks > 0) {
+    gst_element_seek_simple (pipeline, GST_FORMAT_TIME, GST_SEEK_FLAG_FLUSH,
+        0);
+    if (!run_until (pipeline, GST_MESSAGE_ASYNC_DONE, NULL))
+      goto error;
+  }
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  if (!run_until (pipeline, GST_MESSAGE_EOS, &result->play_time))
+    goto error;
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return TRUE;
+
+error:
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return FALSE;
+}
+
+static void
+print_result (const gchar * location, const BenchResult * result)
+{
+  gchar *basename = g_path_get_basename (location);
+
+  g_print ("%-32s %10.1f MB  open %8.2f ms  seek avg %8.2f ms  "
+      "max %8.2f ms  %10.2f MB/s\n", basename,
+      result->size / (1024.0 * 1024.0), result->open_time / 1000.0,
+      result->n_seeks ? result->seek_time_total / 1000.0 /
+      result->n_seeks : 0.0, result->seek_time_max / 1000.0,
+      result->play_time ? (result->size / (1024.0 * 1024.0)) /
+      (result->play_time / (gdouble) G_USEC_PER_SEC) : 0.0);
+
+  g_free (basename);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *ctx;
+  GError *err = NULL;
+  GPtrArray *locations;
+  gboolean generated = FALSE;
+  gint width = 720, height = 576;
+  guint i;
+  gint ret = 0;
+
+  ctx = g_option_context_new ("[FILE...]");
+  g_option_context_add_main_entries (ctx, entries, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("Error initializing: %s\n", err->message);
+    g_clear_error (&err);
+    g_option_context_free (ctx);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (frame_size && sscanf (frame_size, "%dx%d", &width, &height) != 2) {
+    g_printerr ("Invalid frame size '%s'\n", frame_size);
+    return 1;
+  }
+
+  locations = g_ptr_array_new_with_free_func (g_free);
+
+  if (files) {
+    for (i = 0; files[i]; i++)
+      g_ptr_array_add (locations, g_strdup (files[i]));
+  } else {
+    const BenchEssence *video, *audio;
+    const gchar *dir = output_dir ? output_dir : g_get_tmp_dir ();
+    gchar *prefix;
+
+    video = find_essence (video_essences, video_type ? video_type : "raw");
+    audio = find_essence (audio_essences, audio_type ? audio_type : "raw");
+    if (!video || !audio) {
+      g_printerr ("Unknown essence type\n");
+      return 1;
+    }
+
+    prefix = g_strdup_printf ("%s/mxfdemux-bench-%s-%s-%dx%d-%ds", dir,
+        video->name, audio->name, width, height, duration);
+
+    if (atom) {
+      if (video->format) {
+        g_ptr_array_add (locations, g_strdup_printf ("%s-v1.mxf", prefix));
+        if (!generate_file (g_ptr_array_index (locations, locations->len - 1),
+                video, NULL, width, height))
+          ret = 1;
+      }
+      if (audio->format && ret == 0) {
+        g_ptr_array_add (locations, g_strdup_printf ("%s-a1.mxf", prefix));
+        if (!generate_file (g_ptr_array_index (locations, locations->len - 1),
+                NULL, audio, width, height))
+          ret = 1;
+      }
+    } else {
+      g_ptr_array_add (locations, g_strdup_printf ("%s.mxf", prefix));
+      if (!generate_file (g_ptr_array_index (locations, 0), video, audio,
+              width, height))
+        ret = 1;
+    }
+    g_free (prefix);
+    generated = TRUE;
+  }
+
+  for (i = 0; i < locations->len && ret == 0; i++) {
+    const gchar *location = g_ptr_array_index (locations, i);
+    BenchResult result;
+
+    if (!bench_file (location, &result)) {
+      g_printerr ("Benchmarking %s failed\n", location);
+      ret = 1;
+      break;
+    }
+    print_result (location, &result);
+  }
+
+  if (generated && !keep) {
+    for (i = 0; i < locations->len; i++)
+      g_unlink (g_ptr_array_index (locations, i));
+  }
+
+  g_ptr_array_free (locations, TRUE);
+
+  return ret;
+}